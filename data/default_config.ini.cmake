@@ -18,6 +18,9 @@ horizontal_offset                   = 0
 vertical_offset                     = 0
 minimum_fps                         = 18
 maximum_fps                         = 10000
+flag_redraw_on_demand               = false
+redraw_on_demand_max_interval       = 5
+flag_gpu_projection                 = false
 #viewport_effect                     = sphericMirrorDistorter
 viewport_effect                     = none
 
@@ -28,6 +28,7 @@
 #include "StelModuleMgr.hpp"
 #include "StelObjectMgr.hpp"
 #include "StelTextureMgr.hpp"
+#include "StelJsonCatalog.hpp"
 #include "StelJsonParser.hpp"
 #include "StelFileMgr.hpp"
 #include "StelUtils.hpp"
@@ -480,105 +481,63 @@ bool Exoplanets::backupJsonFile(bool deleteOriginal)
 	return true;
 }
 
+//! Create the exoplanetary systems while the catalog is read, one star at a time.
+class ExoplanetsCatalogReader : public StelJsonRecordVisitor
+{
+public:
+	ExoplanetsCatalogReader(Exoplanets* aplugin) : StelJsonRecordVisitor("stars"), plugin(aplugin) {;}
+	virtual void record(const QString& name, const QVariant& value)
+	{
+		plugin->addStar(name, value.toMap());
+	}
+private:
+	Exoplanets* plugin;
+};
+
 /*
   Read the JSON file and create list of exoplanets.
 */
 void Exoplanets::readJsonFile(void)
 {
-	setEPMap(loadEPMap());
+	ep.clear();
+	PSCount = EPCountAll = EPCountPH = 0;
+	ExoplanetsCatalogReader reader(this);
+	StelJsonCatalog::readRecords(jsonCatalogPath, reader);
 	emit(updateStateChanged(updateState));
 }
 
 /*
-  Parse JSON file and load exoplanets to map
+  Add a star and its exoplanets to the list
 */
-QVariantMap Exoplanets::loadEPMap(QString path)
+void Exoplanets::addStar(const QString& designation, QVariantMap data)
 {
-	if (path.isEmpty())
-	    path = jsonCatalogPath;
+	data["designation"] = designation;
 
-	QVariantMap map;
-	QFile jsonFile(path);
-	if (!jsonFile.open(QIODevice::ReadOnly))
-		qWarning() << "Exoplanets: cannot open " << QDir::toNativeSeparators(path);
-	else
-	{
-		map = StelJsonParser::parse(jsonFile.readAll()).toMap();
-		jsonFile.close();
-	}
-	return map;
-}
+	PSCount++;
 
-/*
-  Set items for list of struct from data map
-*/
-void Exoplanets::setEPMap(const QVariantMap& map)
-{
-	ep.clear();
-	PSCount = EPCountAll = EPCountPH = 0;
-	QVariantMap epsMap = map.value("stars").toMap();
-	foreach(QString epsKey, epsMap.keys())
+	ExoplanetP eps(new Exoplanet(data));
+	if (eps->initialized)
 	{
-		QVariantMap epsData = epsMap.value(epsKey).toMap();
-		epsData["designation"] = epsKey;
-
-		PSCount++;
-
-		ExoplanetP eps(new Exoplanet(epsData));
-		if (eps->initialized)
-		{
-			ep.append(eps);
-			EPCountAll += eps->getCountExoplanets();
-			EPCountPH += eps->getCountHabitableExoplanets();
-		}
-
+		ep.append(eps);
+		EPCountAll += eps->getCountExoplanets();
+		EPCountPH += eps->getCountHabitableExoplanets();
 	}
 }
 
 int Exoplanets::getJsonFileFormatVersion(void)
 {
-	int jsonVersion = -1;
-	QFile jsonEPCatalogFile(jsonCatalogPath);
-	if (!jsonEPCatalogFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Exoplanets: cannot open " << QDir::toNativeSeparators(jsonCatalogPath);
-		return jsonVersion;
-	}
-
-	QVariantMap map;
-	map = StelJsonParser::parse(&jsonEPCatalogFile).toMap();
-	jsonEPCatalogFile.close();
-	if (map.contains("version"))
-	{
-		jsonVersion = map.value("version").toInt();
-	}
-
+	const int jsonVersion = StelJsonCatalog::getFormatVersion(jsonCatalogPath);
 	qDebug() << "Exoplanets: version of the format of the catalog:" << jsonVersion;
 	return jsonVersion;
 }
 
 bool Exoplanets::checkJsonFileFormat()
 {
-	QFile jsonEPCatalogFile(jsonCatalogPath);
-	if (!jsonEPCatalogFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Exoplanets: cannot open " << QDir::toNativeSeparators(jsonCatalogPath);
-		return false;
-	}
-
-	QVariantMap map;
-	try
-	{
-		map = StelJsonParser::parse(&jsonEPCatalogFile).toMap();
-		jsonEPCatalogFile.close();
-	}
-	catch (std::runtime_error& e)
-	{
-		qDebug() << "Exoplanets: file format is wrong! Error:" << e.what();
-		return false;
-	}
-
-	return true;
+	bool ok;
+	StelJsonCatalog::load(jsonCatalogPath, &ok);
+	if (!ok)
+		qDebug() << "Exoplanets: file format is wrong!";
+	return ok;
 }
 
 ExoplanetP Exoplanets::getByID(const QString& id)
@@ -197,6 +197,8 @@ public slots:
 	void messageTimeout(void);
 
 private:
+	friend class ExoplanetsCatalogReader;
+
 	// Font used for displaying our text
 	QFont font;
 
@@ -225,11 +227,8 @@ private:
 	//! @return valid boolean, e.g. "true"
 	bool checkJsonFileFormat(void);
 
-	//! parse JSON file and load exoplanets to map
-	QVariantMap loadEPMap(QString path=QString());
-
-	//! set items for list of struct from data map
-	void setEPMap(const QVariantMap& map);
+	//! add the exoplanetary system of a star of the catalog
+	void addStar(const QString& designation, QVariantMap data);
 
 	QString jsonCatalogPath;
 
@@ -27,7 +27,7 @@
 #include "StelObjectMgr.hpp"
 #include "StelModuleMgr.hpp"
 #include "StelTextureMgr.hpp"
-#include "StelJsonParser.hpp"
+#include "StelJsonCatalog.hpp"
 #include "StelFileMgr.hpp"
 #include "LabelMgr.hpp"
 #include "LandscapeMgr.hpp"
@@ -788,16 +788,7 @@ QVariantMap MeteorShowers::loadShowersMap(QString path)
 	if(path.isEmpty())
 		path = showersJsonPath;
 
-	QVariantMap map;
-	QFile jsonFile(path);
-	if(!jsonFile.open(QIODevice::ReadOnly))
-		qWarning() << "MeteorShowers: cannot open" << path;
-	else
-	{
-		map = StelJsonParser::parse(jsonFile.readAll()).toMap();
-		jsonFile.close();
-	}
-	return map;
+	return StelJsonCatalog::load(path);
 }
 
 void MeteorShowers::readJsonFile(void)
@@ -913,48 +904,18 @@ bool MeteorShowers::backupJsonFile(bool deleteOriginal)
 
 int MeteorShowers::getJsonFileFormatVersion(void)
 {
-	int jsonVersion = -1;
-	QFile showersJsonFile(showersJsonPath);
-	if(!showersJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "MeteorShowers: cannot open" << QDir::toNativeSeparators(showersJsonPath);
-		return jsonVersion;
-	}
-
-	QVariantMap map;
-	map = StelJsonParser::parse(&showersJsonFile).toMap();
-	if(map.contains("version"))
-	{
-		jsonVersion = map.value("version").toInt();
-	}
-
-	showersJsonFile.close();
+	const int jsonVersion = StelJsonCatalog::getFormatVersion(showersJsonPath);
 	qDebug() << "MeteorShowers: version of the format of the catalog:" << jsonVersion;
 	return jsonVersion;
 }
 
 bool MeteorShowers::checkJsonFileFormat()
 {
-	QFile showersJsonFile(showersJsonPath);
-	if(!showersJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "MeteorShowers: cannot open" << QDir::toNativeSeparators(showersJsonPath);
-		return false;
-	}
-	
-	QVariantMap map;
-	try
-	{
-		map = StelJsonParser::parse(&showersJsonFile).toMap();
-		showersJsonFile.close();
-	}
-	catch(std::runtime_error& e)
-	{
-		qDebug() << "MeteorShowers: file format is wrong! Error:" << e.what();
-		return false;
-	}
-	
-	return true;
+	bool ok;
+	StelJsonCatalog::load(showersJsonPath, &ok);
+	if(!ok)
+		qDebug() << "MeteorShowers: file format is wrong!";
+	return ok;
 }
 
 void MeteorShowers::readSettingsFromConfig(void)
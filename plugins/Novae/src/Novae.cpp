@@ -26,7 +26,7 @@
 #include "StelLocaleMgr.hpp"
 #include "StelModuleMgr.hpp"
 #include "StelObjectMgr.hpp"
-#include "StelJsonParser.hpp"
+#include "StelJsonCatalog.hpp"
 #include "StelFileMgr.hpp"
 #include "StelUtils.hpp"
 #include "StelPainter.hpp"
@@ -469,16 +469,7 @@ QVariantMap Novae::loadNovaeMap(QString path)
 	if (path.isEmpty())
 	    path = novaeJsonPath;
 
-	QVariantMap map;
-	QFile jsonFile(path);
-	if (!jsonFile.open(QIODevice::ReadOnly))
-		qWarning() << "Novae: cannot open" << QDir::toNativeSeparators(path);
-	else
-	{
-		map = StelJsonParser::parse(jsonFile.readAll()).toMap();
-		jsonFile.close();
-	}
-	return map;
+	return StelJsonCatalog::load(path);
 }
 
 /*
@@ -506,49 +497,19 @@ void Novae::setNovaeMap(const QVariantMap& map)
 }
 
 int Novae::getJsonFileVersion(void)
-{	
-	int jsonVersion = -1;
-	QFile novaeJsonFile(novaeJsonPath);
-	if (!novaeJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Novae: cannot open" << QDir::toNativeSeparators(novaeJsonPath);
-		return jsonVersion;
-	}
-
-	QVariantMap map;
-	map = StelJsonParser::parse(&novaeJsonFile).toMap();
-	if (map.contains("version"))
-	{
-		jsonVersion = map.value("version").toInt();
-	}
-
-	novaeJsonFile.close();
+{
+	const int jsonVersion = StelJsonCatalog::getFormatVersion(novaeJsonPath);
 	qDebug() << "Novae: version of the catalog:" << jsonVersion;
 	return jsonVersion;
 }
 
 bool Novae::checkJsonFileFormat()
 {
-	QFile novaeJsonFile(novaeJsonPath);
-	if (!novaeJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Novae: cannot open" << QDir::toNativeSeparators(novaeJsonPath);
-		return false;
-	}
-
-	QVariantMap map;
-	try
-	{
-		map = StelJsonParser::parse(&novaeJsonFile).toMap();
-		novaeJsonFile.close();
-	}
-	catch (std::runtime_error& e)
-	{
-		qDebug() << "Novae: file format is wrong! Error:" << e.what();
-		return false;
-	}
-
-	return true;
+	bool ok;
+	StelJsonCatalog::load(novaeJsonPath, &ok);
+	if (!ok)
+		qDebug() << "Novae: file format is wrong!";
+	return ok;
 }
 
 NovaP Novae::getByID(const QString& id)
@@ -730,20 +691,10 @@ QString Novae::getNovaeList()
 float Novae::getLowerLimitBrightness()
 {
 	float lowerLimit = 10.f;
-	QFile novaeJsonFile(novaeJsonPath);
-	if (!novaeJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Novae: cannot open" << QDir::toNativeSeparators(novaeJsonPath);
-		return lowerLimit;
-	}
-
-	QVariantMap map;
-	map = StelJsonParser::parse(&novaeJsonFile).toMap();
+	const QVariantMap map = StelJsonCatalog::load(novaeJsonPath);
 	if (map.contains("limit"))
 	{
 		lowerLimit = map.value("limit").toFloat();
 	}
-
-	novaeJsonFile.close();
 	return lowerLimit;
 }
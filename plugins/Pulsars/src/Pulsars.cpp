@@ -28,7 +28,7 @@
 #include "StelModuleMgr.hpp"
 #include "StelObjectMgr.hpp"
 #include "StelTextureMgr.hpp"
-#include "StelJsonParser.hpp"
+#include "StelJsonCatalog.hpp"
 #include "StelFileMgr.hpp"
 #include "StelUtils.hpp"
 #include "StelTranslator.hpp"
@@ -501,16 +501,7 @@ QVariantMap Pulsars::loadPSRMap(QString path)
 	if (path.isEmpty())
 	    path = jsonCatalogPath;
 
-	QVariantMap map;
-	QFile jsonFile(path);
-	if (!jsonFile.open(QIODevice::ReadOnly))
-		qWarning() << "Pulsars: cannot open" << QDir::toNativeSeparators(path);
-	else
-	{
-		map = StelJsonParser::parse(jsonFile.readAll()).toMap();
-		jsonFile.close();
-	}
-	return map;
+	return StelJsonCatalog::load(path);
 }
 
 /*
@@ -537,48 +528,18 @@ void Pulsars::setPSRMap(const QVariantMap& map)
 
 int Pulsars::getJsonFileFormatVersion(void)
 {
-	int jsonVersion = -1;
-	QFile jsonPSRCatalogFile(jsonCatalogPath);
-	if (!jsonPSRCatalogFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Pulsars: cannot open" << QDir::toNativeSeparators(jsonCatalogPath);
-		return jsonVersion;
-	}
-
-	QVariantMap map;
-	map = StelJsonParser::parse(&jsonPSRCatalogFile).toMap();
-	if (map.contains("version"))
-	{
-		jsonVersion = map.value("version").toInt();
-	}
-
-	jsonPSRCatalogFile.close();
+	const int jsonVersion = StelJsonCatalog::getFormatVersion(jsonCatalogPath);
 	qDebug() << "Pulsars: version of the format of the catalog:" << jsonVersion;
 	return jsonVersion;
 }
 
 bool Pulsars::checkJsonFileFormat()
 {
-	QFile jsonPSRCatalogFile(jsonCatalogPath);
-	if (!jsonPSRCatalogFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Pulsars: cannot open" << QDir::toNativeSeparators(jsonCatalogPath);
-		return false;
-	}
-
-	QVariantMap map;
-	try
-	{
-		map = StelJsonParser::parse(&jsonPSRCatalogFile).toMap();
-		jsonPSRCatalogFile.close();
-	}
-	catch (std::runtime_error& e)
-	{
-		qDebug() << "Pulsars: file format is wrong! Error:" << e.what();
-		return false;
-	}
-
-	return true;
+	bool ok;
+	StelJsonCatalog::load(jsonCatalogPath, &ok);
+	if (!ok)
+		qDebug() << "Pulsars: file format is wrong!";
+	return ok;
 }
 
 PulsarP Pulsars::getByID(const QString& id)
@@ -28,7 +28,7 @@
 #include "StelModuleMgr.hpp"
 #include "StelObjectMgr.hpp"
 #include "StelTextureMgr.hpp"
-#include "StelJsonParser.hpp"
+#include "StelJsonCatalog.hpp"
 #include "StelFileMgr.hpp"
 #include "StelUtils.hpp"
 #include "StelTranslator.hpp"
@@ -504,16 +504,7 @@ QVariantMap Quasars::loadQSOMap(QString path)
 	if (path.isEmpty())
 	    path = catalogJsonPath;
 
-	QVariantMap map;
-	QFile jsonFile(path);
-	if (!jsonFile.open(QIODevice::ReadOnly))
-		qWarning() << "Quasars: cannot open" << QDir::toNativeSeparators(path);
-	else
-	{
-		map = StelJsonParser::parse(jsonFile.readAll()).toMap();
-		jsonFile.close();
-	}
-	return map;
+	return StelJsonCatalog::load(path);
 }
 
 /*
@@ -540,48 +531,18 @@ void Quasars::setQSOMap(const QVariantMap& map)
 
 int Quasars::getJsonFileFormatVersion(void)
 {
-	int jsonVersion = -1;
-	QFile catalogJsonFile(catalogJsonPath);
-	if (!catalogJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Quasars: cannot open" << QDir::toNativeSeparators(catalogJsonPath);
-		return jsonVersion;
-	}
-
-	QVariantMap map;
-	map = StelJsonParser::parse(&catalogJsonFile).toMap();
-	if (map.contains("version"))
-	{
-		jsonVersion = map.value("version").toInt();
-	}
-
-	catalogJsonFile.close();
+	const int jsonVersion = StelJsonCatalog::getFormatVersion(catalogJsonPath);
 	qDebug() << "Quasars: version of the format of the catalog:" << jsonVersion;
 	return jsonVersion;
 }
 
 bool Quasars::checkJsonFileFormat()
 {
-	QFile catalogJsonFile(catalogJsonPath);
-	if (!catalogJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Quasars: cannot open" << QDir::toNativeSeparators(catalogJsonPath);
-		return false;
-	}
-
-	QVariantMap map;
-	try
-	{
-		map = StelJsonParser::parse(&catalogJsonFile).toMap();
-		catalogJsonFile.close();
-	}
-	catch (std::runtime_error& e)
-	{
-		qDebug() << "Quasars: file format is wrong! Error:" << e.what();
-		return false;
-	}
-
-	return true;
+	bool ok;
+	StelJsonCatalog::load(catalogJsonPath, &ok);
+	if (!ok)
+		qDebug() << "Quasars: file format is wrong!";
+	return ok;
 }
 
 QuasarP Quasars::getByID(const QString& id)
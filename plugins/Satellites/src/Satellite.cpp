@@ -416,13 +416,11 @@ void Satellite::setNewTleElements(const QString& tle1, const QString& tle2)
 	parseInternationalDesignator(tle1);
 }
 
-void Satellite::update(double)
+void Satellite::update(const gSatWrapper::ObserverContext& context)
 {
 	if (pSatWrapper && orbitValid)
 	{
-		StelCore* core = StelApp::getInstance().getCore();
-		double JD = core->getJDay();
-		epochTime = JD - core->getDeltaT(JD)/86400; // Delta T anti-correction for artificial satellites
+		epochTime = context.julianDaysEpoch;
 
 		pSatWrapper->setEpoch(epochTime);
 		position                 = pSatWrapper->getTEMEPos();
@@ -442,15 +440,15 @@ void Satellite::update(double)
 			return;
 		}
 
-		elAzPosition             = pSatWrapper->getAltAz();
+		elAzPosition             = pSatWrapper->getAltAz(context);
 		elAzPosition.normalize();
 
-		pSatWrapper->getSlantRange(range, rangeRate);
-		visibility = pSatWrapper->getVisibilityPredict();
-		phaseAngle = pSatWrapper->getPhaseAngle();
+		pSatWrapper->getSlantRange(context, range, rangeRate);
+		visibility = pSatWrapper->getVisibilityPredict(context);
+		phaseAngle = pSatWrapper->getPhaseAngle(context);
 
 		// Compute orbit points to draw orbit line.
-		if (orbitDisplayed) computeOrbitPoints();
+		if (orbitDisplayed) computeOrbitPoints(context);
 	}
 }
 
@@ -647,7 +645,7 @@ float Satellite::calculateOrbitSegmentIntensity(int segNum)
 	}
 }
 
-void Satellite::computeOrbitPoints()
+void Satellite::computeOrbitPoints(const gSatWrapper::ObserverContext& context)
 {
 	gTimeSpan computeInterval(0, 0, 0, orbitLineSegmentDuration);
 	gTimeSpan orbitSpan(0, 0, 0, orbitLineSegments*orbitLineSegmentDuration/2);
@@ -665,7 +663,7 @@ void Satellite::computeOrbitPoints()
 		for (int i=0; i<=orbitLineSegments; i++)
 		{
 			pSatWrapper->setEpoch(epochTm.getGmtTm());
-			elAzVector  = pSatWrapper->getAltAz();
+			elAzVector  = pSatWrapper->getAltAz(context);
 			orbitPoints.append(elAzVector);
 			epochTm    += computeInterval;
 		}
@@ -694,7 +692,7 @@ void Satellite::computeOrbitPoints()
 				//remove points at beginning of list and add points at end.
 				orbitPoints.removeFirst();
 				pSatWrapper->setEpoch(epochTm.getGmtTm());
-				elAzVector  = pSatWrapper->getAltAz();
+				elAzVector  = pSatWrapper->getAltAz(context);
 				orbitPoints.append(elAzVector);
 				epochTm    += computeInterval;
 			}
@@ -722,7 +720,7 @@ void Satellite::computeOrbitPoints()
 			{ //remove points at end of list and add points at beginning.
 				orbitPoints.removeLast();
 				pSatWrapper->setEpoch(epochTm.getGmtTm());
-				elAzVector  = pSatWrapper->getAltAz();
+				elAzVector  = pSatWrapper->getAltAz(context);
 				orbitPoints.push_front(elAzVector);
 				epochTm -= computeInterval;
 
@@ -136,8 +136,10 @@ public:
 	//! the tleElements values and configures internal orbit parameters.
 	void setNewTleElements(const QString& tle1, const QString& tle2);
 
-	// calculate faders, new position
-	void update(double deltaTime);
+	//! Calculate the new position for the epoch of the given context.
+	//! It only accesses the satellite's own data, so different satellites
+	//! can be updated concurrently.
+	void update(const gSatWrapper::ObserverContext& context);
 
 	double getDoppler(double freq) const;
 	static float showLabels;
@@ -167,7 +169,7 @@ public:
 
 private:
 	//draw orbits methods
-	void computeOrbitPoints();
+	void computeOrbitPoints(const gSatWrapper::ObserverContext& context);
 	void drawOrbit(StelPainter& painter);
 	//! returns 0 - 1.0 for the DRAWORBIT_FADE_NUMBER segments at
 	//! each end of an orbit, with 1 in the middle.
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "SatellitePassPredictor.hpp"
+#include "gsatellite/stdsat.h"
+
+#include <QtConcurrent>
+
+#include <cmath>
+
+static const double SECONDS_PER_DAY = 86400.;
+
+const double SatellitePassPredictor::coarseStep = 60.;
+const double SatellitePassPredictor::timePrecision = 1.;
+
+QVariantMap SatellitePass::toVariantMap() const
+{
+	QVariantMap map;
+	map.insert("id", id);
+	map.insert("name", name);
+	map.insert("aos", aos);
+	map.insert("tca", tca);
+	map.insert("los", los);
+	map.insert("maxElevation", maxElevation);
+	map.insert("aosAzimuth", aosAzimuth);
+	map.insert("tcaAzimuth", tcaAzimuth);
+	map.insert("losAzimuth", losAzimuth);
+	return map;
+}
+
+static bool passLessThan(const SatellitePass& p1, const SatellitePass& p2)
+{
+	return p1.aos < p2.aos;
+}
+
+SatellitePassPredictor::SatellitePassPredictor(const gSatWrapper::ObserverContext& c, double start, double end,
+                                               double minEl, double dT)
+	: context(c)
+	, startEpoch(start)
+	, endEpoch(end)
+	, minElevation(minEl)
+	, deltaT(dT)
+{
+}
+
+double SatellitePassPredictor::elevationAt(gSatWrapper& sat, double epoch, double* azimuth) const
+{
+	sat.setEpoch(epoch);
+	// Components towards south, east and zenith, in Km
+	Vec3d topo = sat.getAltAz(context);
+	if (azimuth)
+	{
+		double az = std::atan2(topo[1], -topo[0])*180./M_PI;
+		*azimuth = az<0. ? az+360. : az;
+	}
+	return std::asin(topo[2]/topo.length())*180./M_PI;
+}
+
+double SatellitePassPredictor::refineCrossing(gSatWrapper& sat, double t0, double t1, bool rising) const
+{
+	// t0 is on the "below" side for a rise, on the "above" side for a set
+	const double precision = timePrecision/SECONDS_PER_DAY;
+	while (t1-t0 > precision)
+	{
+		const double t = 0.5*(t0+t1);
+		const bool above = elevationAt(sat, t) >= minElevation;
+		if (above == rising)
+			t1 = t;
+		else
+			t0 = t;
+	}
+	return 0.5*(t0+t1);
+}
+
+double SatellitePassPredictor::refineMaximum(gSatWrapper& sat, double t0, double t1) const
+{
+	static const double invPhi = 0.5*(std::sqrt(5.)-1.);
+	const double precision = timePrecision/SECONDS_PER_DAY;
+	double a = t1 - invPhi*(t1-t0);
+	double b = t0 + invPhi*(t1-t0);
+	double ea = elevationAt(sat, a);
+	double eb = elevationAt(sat, b);
+	while (t1-t0 > precision)
+	{
+		if (ea > eb)
+		{
+			t1 = b;
+			b = a; eb = ea;
+			a = t1 - invPhi*(t1-t0);
+			ea = elevationAt(sat, a);
+		}
+		else
+		{
+			t0 = a;
+			a = b; ea = eb;
+			b = t0 + invPhi*(t1-t0);
+			eb = elevationAt(sat, b);
+		}
+	}
+	return 0.5*(t0+t1);
+}
+
+void SatellitePassPredictor::appendPass(gSatWrapper& sat, SatellitePass& pass, double aos, double tca, double los, QList<SatellitePass>& passes) const
+{
+	pass.aos = aos + deltaT;
+	pass.los = los + deltaT;
+	pass.tca = tca + deltaT;
+	pass.maxElevation = elevationAt(sat, tca, &pass.tcaAzimuth);
+	elevationAt(sat, aos, &pass.aosAzimuth);
+	elevationAt(sat, los, &pass.losAzimuth);
+	passes.append(pass);
+}
+
+QList<SatellitePass> SatellitePassPredictor::operator()(const SatellitePassJob& job) const
+{
+	QList<SatellitePass> passes;
+
+	// Mean motion in revolutions per day, TLE line 2 columns 53-63
+	const double meanMotion = job.tle2.mid(52, 11).trimmed().toDouble();
+	if (meanMotion <= 0.)
+		return passes;
+
+	// Upper bound of the elevation rate while the satellite is below the horizon:
+	// its orbital velocity seen from at least the distance to the horizon, plus the
+	// Earth rotation. It allows much larger steps far from the minimum elevation.
+	const double n = meanMotion*2.*M_PI/SECONDS_PER_DAY; // rad/s
+	const double a = std::pow(KMU/(n*n), 1./3.);          // Km
+	const double horizonDistance = std::sqrt(qMax(a*a - KEARTHRADIUS*KEARTHRADIUS, 1.));
+	const double maxRateBelowHorizon = (n*a/horizonDistance + KMFACTOR)*180./M_PI; // deg/s
+	const double belowThreshold = qMin(minElevation, 0.) - 1.;
+
+	// Worker thread: the epoch is given, StelApp must not be accessed
+	gSatWrapper sat(job.id, QString(job.tle1), QString(job.tle2), startEpoch);
+
+	const double step = coarseStep/SECONDS_PER_DAY;
+	SatellitePass pass;
+	pass.id = job.id;
+	pass.name = job.name;
+
+	double t = startEpoch;
+	double el = elevationAt(sat, t);
+	// A pass in progress at the start of the window begins at the start of the window
+	bool inPass = el >= minElevation;
+	double aos = t;
+	double bestT = t;
+	double bestEl = el;
+	// The previous sample, to find the maxima of the samples
+	double tPrev = t;
+	double elPrev = el;
+
+	while (t < endEpoch)
+	{
+		double dt = step;
+		if (!inPass && el < belowThreshold)
+		{
+			// Go at most half way to the minimum elevation at the maximum rate
+			dt = qBound(step, 0.5*(minElevation-el)/maxRateBelowHorizon/SECONDS_PER_DAY, 1.);
+		}
+		const double t1 = qMin(t+dt, endEpoch);
+		const double el1 = elevationAt(sat, t1);
+
+		if (!inPass && el1 >= minElevation)
+		{
+			aos = refineCrossing(sat, t, t1, true);
+			inPass = true;
+			bestT = t1;
+			bestEl = el1;
+		}
+		else if (!inPass && el >= belowThreshold && el > elPrev && el >= el1)
+		{
+			// The elevation may exceed the minimum elevation around this maximum of the samples only.
+			// Before a large step the rate bound keeps it below the minimum elevation, so one step before is enough.
+			const double t0 = qMax(tPrev, t-step);
+			const double tca = refineMaximum(sat, t0, t1);
+			if (elevationAt(sat, tca) >= minElevation)
+				appendPass(sat, pass, refineCrossing(sat, t0, tca, true), tca, refineCrossing(sat, tca, t1, false), passes);
+		}
+		else if (inPass && el1 > bestEl)
+		{
+			bestT = t1;
+			bestEl = el1;
+		}
+
+		if (inPass && (el1 < minElevation || t1 >= endEpoch))
+		{
+			const double los = el1 < minElevation ? refineCrossing(sat, t, t1, false) : t1;
+			const double tca = refineMaximum(sat, qMax(aos, bestT-step), qMin(los, bestT+step));
+			appendPass(sat, pass, aos, tca, los, passes);
+			inPass = false;
+		}
+
+		tPrev = t;
+		elPrev = el;
+		t = t1;
+		el = el1;
+	}
+
+	return passes;
+}
+
+QList<SatellitePass> SatellitePassPredictor::predict(const QList<SatellitePassJob>& jobs) const
+{
+	const QList<QList<SatellitePass> > results = QtConcurrent::blockingMapped<QList<QList<SatellitePass> > >(jobs, *this);
+	QList<SatellitePass> passes;
+	foreach (const QList<SatellitePass>& p, results)
+		passes.append(p);
+	qSort(passes.begin(), passes.end(), passLessThan);
+	return passes;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _SATELLITEPASSPREDICTOR_HPP_
+#define _SATELLITEPASSPREDICTOR_HPP_ 1
+
+#include "gSatWrapper.hpp"
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QVariantMap>
+
+//! A pass of a satellite above a given elevation.
+//! Times are expressed in Julian Days, in the same time scale as StelCore::getJDay().
+struct SatellitePass
+{
+	QString id;          //!< Satellite identifier (NORAD number)
+	QString name;        //!< Satellite name
+	double aos;          //!< Acquisition of signal: the satellite rises above the minimum elevation
+	double tca;          //!< Time of closest approach, i.e. of maximum elevation
+	double los;          //!< Loss of signal: the satellite sets below the minimum elevation
+	double maxElevation; //!< Maximum elevation during the pass (degrees)
+	double aosAzimuth;   //!< Azimuth at AOS, from north through east (degrees)
+	double tcaAzimuth;   //!< Azimuth at TCA (degrees)
+	double losAzimuth;   //!< Azimuth at LOS (degrees)
+
+	//! Convert the pass to a QVariantMap, for use in scripts.
+	QVariantMap toVariantMap() const;
+};
+
+//! Input of the pass prediction for one satellite.
+struct SatellitePassJob
+{
+	QString id;
+	QString name;
+	QByteArray tle1;
+	QByteArray tle2;
+};
+
+//! @class SatellitePassPredictor
+//! Find the passes of satellites above a minimum elevation over a time window.
+//! For each satellite, the elevation is first sampled with a coarse step, which
+//! grows when the satellite is far below the minimum elevation. Every bracketed
+//! crossing of the minimum elevation is then refined by bisection (AOS/LOS),
+//! and the maximum elevation by golden section search (TCA). A low pass can be
+//! shorter than the coarse step, so the maxima of the samples below the minimum
+//! elevation are also refined, to find the passes which rise and set between two samples.
+//! The satellites are independent, so they are processed in parallel using the
+//! global QThreadPool. Each job works on its own copy of the orbital elements,
+//! so prediction does not interfere with the satellites being displayed.
+class SatellitePassPredictor
+{
+public:
+	typedef QList<SatellitePass> result_type;
+
+	//! @param context the observer location, see gSatWrapper::computeObserverContext().
+	//! @param startEpoch start of the search window (Julian Days UTC, as used by gSatWrapper).
+	//! @param endEpoch end of the search window (Julian Days UTC).
+	//! @param minElevation the minimum elevation defining a pass (degrees).
+	//! @param deltaT the Delta T correction in days, used to convert the results to StelCore's JD.
+	SatellitePassPredictor(const gSatWrapper::ObserverContext& context, double startEpoch, double endEpoch,
+	                       double minElevation, double deltaT);
+
+	//! Predict the passes of one satellite. Thread safe.
+	QList<SatellitePass> operator()(const SatellitePassJob& job) const;
+
+	//! Predict the passes of all the given satellites in parallel.
+	//! @return the passes sorted by AOS.
+	QList<SatellitePass> predict(const QList<SatellitePassJob>& jobs) const;
+
+	//! Default coarse sampling step when close to the minimum elevation, in seconds.
+	static const double coarseStep;
+	//! Precision of the AOS, TCA and LOS times, in seconds.
+	static const double timePrecision;
+
+private:
+	//! Compute the elevation and azimuth (degrees) of the satellite at the given epoch.
+	double elevationAt(gSatWrapper& sat, double epoch, double* azimuth=NULL) const;
+	//! Find the time at which the elevation crosses minElevation between t0 and t1 by bisection.
+	double refineCrossing(gSatWrapper& sat, double t0, double t1, bool rising) const;
+	//! Find the time of maximum elevation between t0 and t1 by golden section search.
+	double refineMaximum(gSatWrapper& sat, double t0, double t1) const;
+	//! Complete the pass with the given times (Julian Days UTC) and the azimuths, and append it to passes.
+	void appendPass(gSatWrapper& sat, SatellitePass& pass, double aos, double tca, double los, QList<SatellitePass>& passes) const;
+
+	gSatWrapper::ObserverContext context;
+	double startEpoch;
+	double endEpoch;
+	double minElevation;
+	double deltaT;
+};
+
+#endif // _SATELLITEPASSPREDICTOR_HPP_
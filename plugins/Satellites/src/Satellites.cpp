@@ -51,6 +51,7 @@
 #include <QVariantMap>
 #include <QVariant>
 #include <QDir>
+#include <QtConcurrent>
 
 StelModule* SatellitesStelPluginInterface::getStelModule() const
 {
@@ -687,9 +688,98 @@ void Satellites::saveSettings()
 	saveTleSources(updateUrls);
 }
 
+//! Create the satellites while the catalog is read, one satellite at a time.
+class SatellitesCatalogReader : public StelJsonRecordVisitor
+{
+public:
+	SatellitesCatalogReader(Satellites* aplugin) : StelJsonRecordVisitor("satellites"), plugin(aplugin)
+	{
+		defaultHintColor << plugin->defaultHintColor[0] << plugin->defaultHintColor[1] << plugin->defaultHintColor[2];
+	}
+	virtual void member(const QString& name, const QVariant& value)
+	{
+		if (name=="hintColor")
+		{
+			const QVariantList list = value.toList();
+			if (list.size() < 3)
+			{
+				qWarning() << "Satellites: invalid hintColor in the catalog:" << value;
+				return;
+			}
+			defaultHintColor = list;
+			plugin->defaultHintColor.set(list.at(0).toDouble(), list.at(1).toDouble(), list.at(2).toDouble());
+		}
+	}
+	virtual void record(const QString& name, const QVariant& value)
+	{
+		const QVariantMap satData = value.toMap();
+		SatelliteP sat = plugin->addSatellite(name, satData, defaultHintColor);
+		// The hint color of the catalog may come after the satellites: remember which ones use it
+		if (sat && !satData.contains("hintColor"))
+			defaultColored.append(qMakePair(sat, !satData.contains("orbitColor")));
+	}
+	//! Set the hint color of the catalog to the satellites which have none, once the catalog is read.
+	void applyDefaultHintColor()
+	{
+		for (int i=0; i<defaultColored.size(); ++i)
+		{
+			const SatelliteP& sat = defaultColored.at(i).first;
+			sat->hintColor = plugin->defaultHintColor;
+			if (defaultColored.at(i).second)
+				sat->orbitColor = plugin->defaultHintColor;
+		}
+		defaultColored.clear();
+	}
+private:
+	Satellites* plugin;
+	QVariantList defaultHintColor;
+	//! The satellites without hint color, and whether they also have no orbit color.
+	QList<QPair<SatelliteP, bool> > defaultColored;
+};
+
+//! Only read the version, the satellites are ignored.
+class SatellitesVersionReader : public StelJsonRecordVisitor
+{
+public:
+	SatellitesVersionReader() : StelJsonRecordVisitor("satellites") {;}
+	virtual void member(const QString& name, const QVariant& value)
+	{
+		if (name=="creator")
+			creator = value.toString();
+	}
+	virtual void record(const QString&, const QVariant&) {;}
+	QString creator;
+};
+
 void Satellites::loadCatalog()
 {
-	setDataMap(loadDataMap());
+	if (satelliteListModel)
+		satelliteListModel->beginSatellitesChange();
+
+	satellites.clear();
+	groups.clear();
+	QFile jsonFile(catalogPath);
+	if (!jsonFile.open(QIODevice::ReadOnly))
+		qWarning() << "Satellites::loadCatalog cannot open " << QDir::toNativeSeparators(catalogPath);
+	else
+	{
+		// The satellites are created while parsing, the catalog is never entirely in memory
+		SatellitesCatalogReader reader(this);
+		try
+		{
+			StelJsonParser::parse(&jsonFile, reader);
+		}
+		catch (std::runtime_error& e)
+		{
+			qWarning() << "Satellites::loadCatalog error:" << e.what();
+		}
+		reader.applyDefaultHintColor();
+		jsonFile.close();
+	}
+	qSort(satellites);
+
+	if (satelliteListModel)
+		satelliteListModel->endSatellitesChange();
 }
 
 const QString Satellites::readCatalogVersion()
@@ -702,11 +792,11 @@ const QString Satellites::readCatalogVersion()
 		return jsonVersion;
 	}
 
-	QVariantMap map;
-	map = StelJsonParser::parse(&satelliteJsonFile).toMap();
-	if (map.contains("creator"))
+	SatellitesVersionReader reader;
+	StelJsonParser::parse(&satelliteJsonFile, reader);
+	if (!reader.creator.isEmpty())
 	{
-		QString creator = map.value("creator").toString();
+		QString creator = reader.creator;
 		QRegExp vRx(".*(\\d+\\.\\d+\\.\\d+).*");
 		if (vRx.exactMatch(creator))
 		{
@@ -744,66 +834,25 @@ bool Satellites::saveDataMap(const QVariantMap& map, QString path)
 	}
 }
 
-QVariantMap Satellites::loadDataMap(QString path)
+SatelliteP Satellites::addSatellite(const QString& id, QVariantMap satData, const QVariantList& defaultHintColor)
 {
-	if (path.isEmpty())
-		path = catalogPath;
+	if (!satData.contains("hintColor"))
+		satData["hintColor"] = defaultHintColor;
 
-	QVariantMap map;
-	QFile jsonFile(path);
-	if (!jsonFile.open(QIODevice::ReadOnly))
-		qWarning() << "Satellites::loadTleMap cannot open " << QDir::toNativeSeparators(path);
-	else
-	{
-		map = StelJsonParser::parse(&jsonFile).toMap();
-		jsonFile.close();
-	}
-	return map;
-}
-
-void Satellites::setDataMap(const QVariantMap& map)
-{
-	int numReadOk = 0;
-	QVariantList defaultHintColorMap;
-	defaultHintColorMap << defaultHintColor[0] << defaultHintColor[1] << defaultHintColor[2];
+	if (!satData.contains("orbitColor"))
+		satData["orbitColor"] = satData["hintColor"];
 
-	if (map.contains("hintColor"))
-	{
-		defaultHintColorMap = map.value("hintColor").toList();
-		defaultHintColor.set(defaultHintColorMap.at(0).toDouble(), defaultHintColorMap.at(1).toDouble(), defaultHintColorMap.at(2).toDouble());
-	}
+	if (!satData.contains("stdMag") && qsMagList.contains(id))
+		satData["stdMag"] = qsMagList[id];
 
-	if (satelliteListModel)
-		satelliteListModel->beginSatellitesChange();
-	
-	satellites.clear();
-	groups.clear();
-	QVariantMap satMap = map.value("satellites").toMap();
-	foreach(const QString& satId, satMap.keys())
+	SatelliteP sat(new Satellite(id, satData));
+	if (sat->initialized)
 	{
-		QVariantMap satData = satMap.value(satId).toMap();
-
-		if (!satData.contains("hintColor"))
-			satData["hintColor"] = defaultHintColorMap;
-
-		if (!satData.contains("orbitColor"))
-			satData["orbitColor"] = satData["hintColor"];
-
-		if (!satData.contains("stdMag") && qsMagList.contains(satId))
-			satData["stdMag"] = qsMagList[satId];
-
-		SatelliteP sat(new Satellite(satId, satData));
-		if (sat->initialized)
-		{
-			satellites.append(sat);
-			groups.unite(sat->groups);
-			numReadOk++;
-		}
+		satellites.append(sat);
+		groups.unite(sat->groups);
+		return sat;
 	}
-	qSort(satellites);
-	
-	if (satelliteListModel)
-		satelliteListModel->endSatellitesChange();
+	return SatelliteP();
 }
 
 QVariantMap Satellites::createDataMap(void)
@@ -1552,18 +1601,78 @@ void Satellites::parseQSMagFile(QString qsMagFile)
 	qsmFile.close();
 }
 
-void Satellites::update(double deltaTime)
+QList<SatellitePass> Satellites::predictPasses(double startJD, double days, double minElevation, const QStringList& idList)
 {
-	if (StelApp::getInstance().getCore()->getCurrentLocation().planetName != earth->getEnglishName() || !isValidRangeDates() || (!hintFader && hintFader.getInterstate() <= 0.))
-		return;
+	StelCore* core = StelApp::getInstance().getCore();
+	if (core->getCurrentLocation().planetName != earth->getEnglishName())
+		return QList<SatellitePass>();
 
-	hintFader.update((int)(deltaTime*1000));
+	QList<SatellitePassJob> jobs;
+	foreach (const SatelliteP& sat, satellites)
+	{
+		if (!sat->initialized || !sat->orbitValid)
+			continue;
+		if (!idList.isEmpty() && !idList.contains(sat->id))
+			continue;
+		SatellitePassJob job;
+		job.id = sat->id;
+		job.name = sat->name;
+		job.tle1 = sat->tleElements.first;
+		job.tle2 = sat->tleElements.second;
+		jobs.append(job);
+	}
 
-	foreach(const SatelliteP& sat, satellites)
+	// Same Delta T anti-correction as in update()
+	const double deltaT = core->getDeltaT(startJD)/86400.;
+	const double startEpoch = startJD - deltaT;
+	SatellitePassPredictor predictor(gSatWrapper::computeObserverContext(startEpoch),
+	                                 startEpoch, startEpoch + days, minElevation, deltaT);
+	return predictor.predict(jobs);
+}
+
+QVariantList Satellites::getPasses(double days, double minElevation, const QStringList& idList)
+{
+	QVariantList result;
+	double JD = StelApp::getInstance().getCore()->getJDay();
+	foreach (const SatellitePass& pass, predictPasses(JD, days, minElevation, idList))
+		result.append(pass.toVariantMap());
+	return result;
+}
+
+//! Functor propagating one satellite, used to shard Satellites::update()
+//! over the global thread pool.
+class SatelliteUpdater
+{
+public:
+	typedef void result_type;
+	SatelliteUpdater(const gSatWrapper::ObserverContext& c) : context(c) {;}
+	void operator()(SatelliteP& sat) const
 	{
 		if (sat->initialized && sat->displayed)
-			sat->update(deltaTime);
+			sat->update(context);
 	}
+private:
+	gSatWrapper::ObserverContext context;
+};
+
+void Satellites::update(double deltaTime)
+{
+	StelCore* core = StelApp::getInstance().getCore();
+	if (core->getCurrentLocation().planetName != earth->getEnglishName() || !isValidRangeDates() || (!hintFader && hintFader.getInterstate() <= 0.))
+		return;
+
+	hintFader.update((int)(deltaTime*1000));
+
+	// The observer and Sun vectors are shared by all satellites, so they are
+	// computed only once per frame, here in the main thread.
+	double JD = core->getJDay();
+	double epoch = JD - core->getDeltaT(JD)/86400; // Delta T anti-correction for artificial satellites
+	const gSatWrapper::ObserverContext context = gSatWrapper::computeObserverContext(epoch);
+
+	// Satellites are independent from each other: propagate them in parallel.
+	// The call blocks until all of them are updated, so the draw pass always
+	// sees a consistent set of positions.
+	QtConcurrent::blockingMap(satellites, SatelliteUpdater(context));
 }
 
 void Satellites::draw(StelCore* core)
@@ -1591,6 +1700,20 @@ void Satellites::draw(StelCore* core)
 		drawPointer(core, painter);
 }
 
+bool Satellites::needsRedraw(const StelCore* core) const
+{
+	if (hintFader.isFading())
+		return true;
+	if (!hintFader || core->getTimeRate()==0. || core->getCurrentLocation().planetName != earth->getEnglishName() || !isValidRangeDates())
+		return false;
+	foreach (const SatelliteP& sat, satellites)
+	{
+		if (sat && sat->initialized && sat->displayed)
+			return true;
+	}
+	return false;
+}
+
 void Satellites::drawPointer(StelCore* core, StelPainter& painter)
 {
 	const StelProjectorP prj = core->getProjection(StelCore::FrameJ2000);
@@ -1632,10 +1755,11 @@ bool Satellites::checkJsonFileFormat()
 		return false;
 	}
 
-	QVariantMap map;
 	try
 	{
-		map = StelJsonParser::parse(&jsonFile).toMap();
+		// Only check the syntax, without building the document
+		StelJsonVisitor visitor;
+		StelJsonParser::parse(&jsonFile, visitor);
 		jsonFile.close();
 	}
 	catch (std::runtime_error& e)
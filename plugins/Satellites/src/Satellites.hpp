@@ -21,6 +21,7 @@
 
 #include "StelObjectModule.hpp"
 #include "Satellite.hpp"
+#include "SatellitePassPredictor.hpp"
 #include "StelFader.hpp"
 #include "StelGui.hpp"
 #include "StelDialog.hpp"
@@ -173,6 +174,9 @@ public:
 	virtual void draw(StelCore* core);
 	virtual void drawPointer(StelCore* core, StelPainter& painter);
 	virtual double getCallOrder(StelModuleActionName actionName) const;
+	//! Return true while the hints are fading, or while displayed satellites are
+	//! drawn and the time runs, as low satellites move much faster than the sky drift.
+	virtual bool needsRedraw(const StelCore* core) const;
 
 	///////////////////////////////////////////////////////////////////////////
 	// Methods defined in StelObjectManager class
@@ -263,6 +267,17 @@ public:
 	//! The changes are not saved to file.
 	void remove(const QStringList& idList);
 
+	//! Predict the passes of satellites above the current location.
+	//! The satellites are processed in parallel, see SatellitePassPredictor.
+	//! @param startJD start of the search window, in Julian Days (as StelCore::getJDay()).
+	//! @param days duration of the search window in days.
+	//! @param minElevation the minimum elevation defining a pass, in degrees.
+	//! @param idList identifiers of the satellites to consider. If empty,
+	//! all the satellites with a valid orbit are used.
+	//! @return the passes, sorted by time of acquisition of signal.
+	QList<SatellitePass> predictPasses(double startJD, double days, double minElevation=10.,
+	                                   const QStringList& idList=QStringList());
+
 	//! get whether or not the plugin will try to update TLE data from the internet
 	//! @return true if updates are set to be done, false otherwise
 	bool getUpdatesEnabled(void) {return updatesEnabled;}
@@ -440,9 +455,20 @@ public slots:
 	//! Save the current satellite catalog to disk.
 	void saveCatalog(QString path=QString());
 
+	//! Predict the passes of satellites above the current location, starting now.
+	//! Script friendly version of predictPasses().
+	//! @param days duration of the search window in days.
+	//! @param minElevation the minimum elevation defining a pass, in degrees.
+	//! @param idList identifiers (NORAD numbers) of the satellites to consider, all if empty.
+	//! @return a list of maps with the keys id, name, aos, tca, los (JD), maxElevation,
+	//! aosAzimuth, tcaAzimuth and losAzimuth (degrees).
+	QVariantList getPasses(double days=1., double minElevation=10., const QStringList& idList=QStringList());
+
 private slots:
 
 private:
+	friend class SatellitesCatalogReader;
+
 	//! Add to the current collection the satellite described by the data.
 	//! @warning Use only in other methods! Does not update satelliteListModel!
 	//! @todo This probably could be done easier if Satellite had a constructor
@@ -475,11 +501,10 @@ private:
 	//! If no path is specified, catalogPath is used.
 	//! @see createDataMap()
 	bool saveDataMap(const QVariantMap& map, QString path=QString());
-	//! Load a structure representing a satellite catalog from a JSON file.
-	//! If no path is specified, catalogPath is used.
-	QVariantMap loadDataMap(QString path=QString());
-	//! Parse a satellite catalog structure into internal satellite data.
-	void setDataMap(const QVariantMap& map);
+	//! Create a satellite from its record in the catalog.
+	//! @param defaultHintColor the hint color of the catalog, used when the record has none.
+	//! @return the new satellite, or a null pointer if it could not be initialized.
+	SatelliteP addSatellite(const QString& id, QVariantMap satData, const QVariantList& defaultHintColor);
 	//! Make a satellite catalog structure from current satellite data.
 	//! @return a representation of a JSON file.
 	QVariantMap createDataMap();
@@ -44,6 +44,16 @@
 
 
 gSatWrapper::gSatWrapper(QString designation, QString tle1,QString tle2)
+{
+	init(designation, tle1, tle2, StelApp::getInstance().getCore()->getJDay());
+}
+
+gSatWrapper::gSatWrapper(QString designation, QString tle1, QString tle2, double ai_julianDaysEpoch)
+{
+	init(designation, tle1, tle2, ai_julianDaysEpoch);
+}
+
+void gSatWrapper::init(const QString& designation, const QString& tle1, const QString& tle2, double ai_julianDaysEpoch)
 {
 	// The TLE library actually modifies the TLE strings, which is annoying (because
 	// when we get updates, we want to check if there has been a change by using ==
@@ -59,7 +69,7 @@ gSatWrapper::gSatWrapper(QString designation, QString tle1,QString tle2)
 	pSatellite = new gSatTEME(designation.toLatin1().data(),
 	                          t1.data(),
 	                          t2.data());
-	updateEpoch();
+	setEpoch(ai_julianDaysEpoch);
 }
 
 
@@ -137,13 +147,45 @@ void gSatWrapper::setEpoch(double ai_julianDaysEpoch)
 }
 
 
-void gSatWrapper::calcObserverECIPosition(Vec3d& ao_position, Vec3d& ao_velocity)
+gSatWrapper::ObserverContext gSatWrapper::currentLocationContext()
 {
+	StelLocation loc = StelApp::getInstance().getCore()->getCurrentLocation();
+
+	ObserverContext context;
+	context.julianDaysEpoch = 0.;
+	context.latitude        = loc.latitude * KDEG2RAD;
+	context.longitude       = loc.longitude * KDEG2RAD;
+	context.altitude        = loc.altitude/1000.;
+	context.sunAboveHorizon = false;
+	return context;
+}
 
-	StelLocation loc   = StelApp::getInstance().getCore()->getCurrentLocation();
+gSatWrapper::ObserverContext gSatWrapper::computeObserverContext(double ai_julianDaysEpoch)
+{
+	StelCore* core = StelApp::getInstance().getCore();
+	ObserverContext context = currentLocationContext();
+	context.julianDaysEpoch = ai_julianDaysEpoch;
 
-	double radLatitude = loc.latitude * KDEG2RAD;
-        double theta       = epoch.toThetaLMST(loc.longitude * KDEG2RAD);
+	// All positions in ECI system are positions referenced in a StelCore::EquinoxEq system centered in the earth centre
+	Vec3d observerECIPos;
+	Vec3d observerECIVel;
+	calcObserverECIPosition(gTime(ai_julianDaysEpoch), context, observerECIPos, observerECIVel);
+
+	SolarSystem *solsystem = (SolarSystem*)StelApp::getInstance().getModuleMgr().getModule("SolarSystem");
+	Vec3d sunEquinoxEqPos  = solsystem->getSun()->getEquinoxEquatorialPos(core);
+
+	//sunEquinoxEqPos is measured in AU. we need meassure it in Km
+	context.sunECIPos.set(sunEquinoxEqPos[0]*AU, sunEquinoxEqPos[1]*AU, sunEquinoxEqPos[2]*AU);
+	context.sunECIPos = context.sunECIPos + observerECIPos; //Change ref system centre
+	context.sunAboveHorizon = solsystem->getSun()->getAltAzPosGeometric(core)[2] > 0.0;
+
+	return context;
+}
+
+void gSatWrapper::calcObserverECIPosition(const gTime& ai_epoch, const ObserverContext& ai_context, Vec3d& ao_position, Vec3d& ao_velocity)
+{
+	double radLatitude = ai_context.latitude;
+        double theta       = ai_epoch.toThetaLMST(ai_context.longitude);
 	double r;
 	double c,sq;
 
@@ -153,10 +195,10 @@ void gSatWrapper::calcObserverECIPosition(Vec3d& ao_position, Vec3d& ao_velocity
 	c = 1/sqrt(1 + __f*(__f - 2)*Sqr(sin(radLatitude)));
 	sq = Sqr(1 - __f)*c;
 
-	r = (KEARTHRADIUS*c + (loc.altitude/1000))*cos(radLatitude);
+	r = (KEARTHRADIUS*c + ai_context.altitude)*cos(radLatitude);
 	ao_position[0] = r * cos(theta);/*kilometers*/
 	ao_position[1] = r * sin(theta);
-	ao_position[2] = (KEARTHRADIUS*sq + (loc.altitude/1000))*sin(radLatitude);
+	ao_position[2] = (KEARTHRADIUS*sq + ai_context.altitude)*sin(radLatitude);
         ao_velocity[0] = -KMFACTOR*ao_position[1];/*kilometers/second*/
         ao_velocity[1] =  KMFACTOR*ao_position[0];
         ao_velocity[2] =  0;
@@ -166,16 +208,19 @@ void gSatWrapper::calcObserverECIPosition(Vec3d& ao_position, Vec3d& ao_velocity
 
 Vec3d gSatWrapper::getAltAz()
 {
+	return getAltAz(currentLocationContext());
+}
 
-	StelLocation loc   = StelApp::getInstance().getCore()->getCurrentLocation();
+Vec3d gSatWrapper::getAltAz(const ObserverContext& ai_context)
+{
 	Vec3d topoSatPos;
 	Vec3d observerECIPos;
 	Vec3d observerECIVel;
 
-	double  radLatitude    = loc.latitude * KDEG2RAD;
-        double  theta          = epoch.toThetaLMST(loc.longitude * KDEG2RAD);
+	double  radLatitude    = ai_context.latitude;
+        double  theta          = epoch.toThetaLMST(ai_context.longitude);
 
-	calcObserverECIPosition(observerECIPos, observerECIVel);
+	calcObserverECIPosition(epoch, ai_context, observerECIPos, observerECIVel);
 
 	Vec3d satECIPos  = getTEMEPos();
 	Vec3d slantRange = satECIPos - observerECIPos;
@@ -197,12 +242,17 @@ Vec3d gSatWrapper::getAltAz()
 }
 
 void  gSatWrapper::getSlantRange(double &ao_slantRange, double &ao_slantRangeRate)
+{
+	getSlantRange(currentLocationContext(), ao_slantRange, ao_slantRangeRate);
+}
+
+void  gSatWrapper::getSlantRange(const ObserverContext& ai_context, double &ao_slantRange, double &ao_slantRangeRate)
 {
 
 	Vec3d observerECIPos;
 	Vec3d observerECIVel;
 
-	calcObserverECIPosition(observerECIPos, observerECIVel);
+	calcObserverECIPosition(epoch, ai_context, observerECIPos, observerECIVel);
 
 
         Vec3d satECIPos            = getTEMEPos();
@@ -216,53 +266,37 @@ void  gSatWrapper::getSlantRange(double &ao_slantRange, double &ao_slantRangeRat
 
 Vec3d gSatWrapper::getSunECIPos()
 {
-	// All positions in ECI system are positions referenced in a StelCore::EquinoxEq system centered in the earth centre
-	Vec3d observerECIPos;
-	Vec3d observerECIVel;
-	Vec3d sunECIPos;
-	Vec3d sunEquinoxEqPos;
-
-	calcObserverECIPosition(observerECIPos, observerECIVel);
-
-	SolarSystem *solsystem = (SolarSystem*)StelApp::getInstance().getModuleMgr().getModule("SolarSystem");
-	sunEquinoxEqPos        = solsystem->getSun()->getEquinoxEquatorialPos(StelApp::getInstance().getCore());
-
-	//sunEquinoxEqPos is measured in AU. we need meassure it in Km
-	sunECIPos.set(sunEquinoxEqPos[0]*AU, sunEquinoxEqPos[1]*AU, sunEquinoxEqPos[2]*AU);
-	sunECIPos = sunECIPos + observerECIPos; //Change ref system centre
-
-	return sunECIPos;
+	return computeObserverContext(epoch.getGmtTm()).sunECIPos;
 }
 
 // Operation getVisibilityPredict
 // @brief This operation predicts the satellite visibility contidions.
 int gSatWrapper::getVisibilityPredict()
+{
+	return getVisibilityPredict(computeObserverContext(epoch.getGmtTm()));
+}
+
+int gSatWrapper::getVisibilityPredict(const ObserverContext& ai_context)
 {
 	Vec3d satECIPos;
 	Vec3d satAltAzPos;
-	Vec3d sunECIPos;
-	Vec3d sunAltAzPos;
 
 	double sunSatAngle, Dist;
 	int   visibility;
 
-	satAltAzPos = getAltAz();
+	satAltAzPos = getAltAz(ai_context);
 
 	if (satAltAzPos[2] > 0)
 	{
 		satECIPos = getTEMEPos();
-		SolarSystem *solsystem = (SolarSystem*)StelApp::getInstance().getModuleMgr().getModule("SolarSystem");		
-		sunAltAzPos        = solsystem->getSun()->getAltAzPosGeometric(StelApp::getInstance().getCore());
-
-		sunECIPos = getSunECIPos();
 
-		if (sunAltAzPos[2] > 0.0)
+		if (ai_context.sunAboveHorizon)
 		{
 			visibility = RADAR_SUN;
 		}
 		else
 		{
-			sunSatAngle = sunECIPos.angle(satECIPos);
+			sunSatAngle = ai_context.sunECIPos.angle(satECIPos);
 			Dist = satECIPos.length()*cos(sunSatAngle - (M_PI/2));
 
 			if (Dist > KEARTHRADIUS)
@@ -283,10 +317,10 @@ int gSatWrapper::getVisibilityPredict()
 
 double gSatWrapper::getPhaseAngle()
 {
-	Vec3d sunECIPos = getSunECIPos();
-	return sunECIPos.angle(getTEMEPos());
+	return getPhaseAngle(computeObserverContext(epoch.getGmtTm()));
 }
 
-
-
-
+double gSatWrapper::getPhaseAngle(const ObserverContext& ai_context)
+{
+	return ai_context.sunECIPos.angle(getTEMEPos());
+}
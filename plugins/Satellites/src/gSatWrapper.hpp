@@ -47,9 +47,31 @@ class gSatWrapper
 {
 
 public:
+	//! Observer and Sun data shared by all the satellites for one epoch.
+	//! It is computed once per frame in the main thread by computeObserverContext(),
+	//! so that the satellites can then be propagated in worker threads without
+	//! accessing StelApp or the SolarSystem module.
+	struct ObserverContext
+	{
+		double julianDaysEpoch; //!< Epoch of the context (Julian Days, UTC)
+		double latitude;        //!< Observer latitude (radians)
+		double longitude;       //!< Observer longitude (radians)
+		double altitude;        //!< Observer altitude (Km)
+		Vec3d  sunECIPos;       //!< Sun position in ECI system for the epoch (Km)
+		bool   sunAboveHorizon; //!< Whether the Sun is above the observer horizon
+	};
+
         gSatWrapper(QString designation, QString tle1,QString tle2);
+	//! Create the wrapper at the given epoch (Julian Days, UTC).
+	//! Unlike the other constructor it does not access StelApp, so it can be used in worker threads.
+	gSatWrapper(QString designation, QString tle1, QString tle2, double ai_julianDaysEpoch);
         ~gSatWrapper();
 
+	// Operation computeObserverContext
+	//! @brief Compute the observer and Sun data for the current location at the given epoch.
+	//! Must be called from the main thread.
+	static ObserverContext computeObserverContext(double ai_julianDaysEpoch);
+
 	// Operation updateEpoch
 	//! @brief This operation update Epoch timestamp for gSatTEME object
 	//! from Stellarium Julian Date.
@@ -88,6 +110,9 @@ public:
 	//!   Dr. T.S. Kelso
 	//!   http://www.celestrak.com/columns/v02n02/
 	Vec3d getAltAz();
+	//! Same as getAltAz(), for the observer location of the given context.
+	//! The epoch of the context is not used, so it can be called after setEpoch() with any epoch.
+	Vec3d getAltAz(const ObserverContext& ai_context);
 
         // Operation getSlantRange
         //! @brief This operation compute the slant range (distance between the
@@ -96,6 +121,7 @@ public:
         //! @param &ao_slantRangeRate Reference to a output variable where the method store the slant range variation in Km/s
         //! @return void
 	void  getSlantRange(double &ao_slantRange, double &ao_slantRangeRate); //meassured in km and km/s
+	void  getSlantRange(const ObserverContext& ai_context, double &ao_slantRange, double &ao_slantRangeRate);
 
 
         // Operation getVisibilityPredict
@@ -114,8 +140,11 @@ public:
         //!   Fundamentals of Astrodynamis and Applications (Third Edition) pg 898
         //!   David A. Vallado
         int getVisibilityPredict();
+	//! Same as getVisibilityPredict(), using the Sun data of the given context.
+	int getVisibilityPredict(const ObserverContext& ai_context);
 
 	double getPhaseAngle();
+	double getPhaseAngle(const ObserverContext& ai_context);
 
 
 private:
@@ -129,9 +158,17 @@ private:
 	//!  Orbital Coordinate Systems, Part II
 	//!   Dr. T.S. Kelso
 	//!   http://www.celestrak.com/columns/v02n02/
+        //! @param ai_epoch the epoch for which the observer position is computed
+        //! @param ai_context the observer location
         //! @param[out] ao_position Observer ECI position vector measured in Km
         //! @param[out] ao_vel Observer ECI velocity vector measured in Km/s
-        void calcObserverECIPosition(Vec3d& ao_position, Vec3d& ao_vel);
+        static void calcObserverECIPosition(const gTime& ai_epoch, const ObserverContext& ai_context, Vec3d& ao_position, Vec3d& ao_vel);
+
+	//! Get a context for the current location, without the Sun data.
+	static ObserverContext currentLocationContext();
+
+	//! Create the gSatTEME object from the TLE, at the given epoch.
+	void init(const QString& designation, const QString& tle1, const QString& tle2, double ai_julianDaysEpoch);
 
 
 private:
@@ -26,7 +26,7 @@
 #include "StelModuleMgr.hpp"
 #include "StelObjectMgr.hpp"
 #include "StelTextureMgr.hpp"
-#include "StelJsonParser.hpp"
+#include "StelJsonCatalog.hpp"
 #include "StelFileMgr.hpp"
 #include "StelUtils.hpp"
 #include "StelTranslator.hpp"
@@ -452,16 +452,7 @@ QVariantMap Supernovae::loadSNeMap(QString path)
 	if (path.isEmpty())
 	    path = sneJsonPath;
 
-	QVariantMap map;
-	QFile jsonFile(path);
-	if (!jsonFile.open(QIODevice::ReadOnly))
-		qWarning() << "Supernovae: cannot open" << QDir::toNativeSeparators(path);
-	else
-	{
-		map = StelJsonParser::parse(jsonFile.readAll()).toMap();
-		jsonFile.close();
-	}
-	return map;
+	return StelJsonCatalog::load(path);
 }
 
 /*
@@ -489,69 +480,29 @@ void Supernovae::setSNeMap(const QVariantMap& map)
 }
 
 int Supernovae::getJsonFileVersion(void)
-{	
-	int jsonVersion = -1;
-	QFile sneJsonFile(sneJsonPath);
-	if (!sneJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Supernovae: cannot open" << QDir::toNativeSeparators(sneJsonPath);
-		return jsonVersion;
-	}
-
-	QVariantMap map;
-	map = StelJsonParser::parse(&sneJsonFile).toMap();
-	if (map.contains("version"))
-	{
-		jsonVersion = map.value("version").toInt();
-	}
-
-	sneJsonFile.close();
+{
+	const int jsonVersion = StelJsonCatalog::getFormatVersion(sneJsonPath);
 	qDebug() << "Supernovae: version of the catalog:" << jsonVersion;
 	return jsonVersion;
 }
 
 bool Supernovae::checkJsonFileFormat()
 {
-	QFile sneJsonFile(sneJsonPath);
-	if (!sneJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Supernovae: cannot open " << QDir::toNativeSeparators(sneJsonPath);
-		return false;
-	}
-
-	QVariantMap map;
-	try
-	{
-		map = StelJsonParser::parse(&sneJsonFile).toMap();
-		sneJsonFile.close();
-	}
-	catch (std::runtime_error& e)
-	{
-		qDebug() << "Supernovae: file format is wrong! Error:" << e.what();
-		return false;
-	}
-
-	return true;
+	bool ok;
+	StelJsonCatalog::load(sneJsonPath, &ok);
+	if (!ok)
+		qDebug() << "Supernovae: file format is wrong!";
+	return ok;
 }
 
 float Supernovae::getLowerLimitBrightness()
 {
 	float lowerLimit = 10.f;
-	QFile sneJsonFile(sneJsonPath);
-	if (!sneJsonFile.open(QIODevice::ReadOnly))
-	{
-		qWarning() << "Supernovae: cannot open" << QDir::toNativeSeparators(sneJsonPath);
-		return lowerLimit;
-	}
-
-	QVariantMap map;
-	map = StelJsonParser::parse(&sneJsonFile).toMap();
+	const QVariantMap map = StelJsonCatalog::load(sneJsonPath);
 	if (map.contains("limit"))
 	{
 		lowerLimit = map.value("limit").toFloat();
 	}
-
-	sneJsonFile.close();
 	return lowerLimit;
 }
 
@@ -39,6 +39,7 @@
 #include <QString>
 #include <QTcpSocket>
 #include <QTextStream>
+#include <QThread>
 
 #ifdef Q_OS_WIN32
 	#include <windows.h> // GetSystemTimeAsFileTime()
@@ -137,16 +138,13 @@ QString TelescopeClient::getInfoString(const StelCore* core, const InfoStringGro
 	return str;
 }
 
-//! returns the current system time in microseconds since the Epoch
-//! Prior to revision 6308, it was necessary to put put this method in an
-//! #ifdef block, as duplicate function definition caused errors during static
-//! linking.
-qint64 getNow(void)
+//! returns the current system time in microseconds since the Epoch.
+//! Unlike getNow(), it does not use StelCore and can be called from any thread.
+qint64 getSystemMicros(void)
 {
 // At the moment this can't be done in a platform-independent way with Qt
 // (QDateTime and QTime don't support microsecond precision)
 	qint64 t;
-	StelCore *core = StelApp::getInstance().getCore();
 #ifdef Q_OS_WIN32
 	FILETIME file_time;
 	GetSystemTimeAsFileTime(&file_time);
@@ -156,15 +154,27 @@ qint64 getNow(void)
 	gettimeofday(&tv,0);
 	t = tv.tv_sec * 1000000LL + tv.tv_usec;
 #endif
-	return t - core->getDeltaT(StelUtils::getJDFromSystem())*1000000; // Delta T anti-correction
+	return t;
 }
 
+//! returns the current system time in microseconds since the Epoch, with Delta T anti-correction
+//! Prior to revision 6308, it was necessary to put put this method in an
+//! #ifdef block, as duplicate function definition caused errors during static
+//! linking.
+qint64 getNow(void)
+{
+	StelCore *core = StelApp::getInstance().getCore();
+	return getSystemMicros() - core->getDeltaT(StelUtils::getJDFromSystem())*1000000; // Delta T anti-correction
+}
+
+QThread* TelescopeTCP::ioThread = NULL;
+int TelescopeTCP::ioThreadUsers = 0;
+
 TelescopeTCP::TelescopeTCP(const QString &name, const QString &params, Equinox eq) :
 		TelescopeClient(name),
-		tcpSocket(new QTcpSocket()),
+		connection(NULL),
 		equinox(eq)
 {
-	hangup();
 	
 	// Example params:
 	// localhost:10000:500000
@@ -228,28 +238,40 @@ TelescopeTCP::TelescopeTCP(const QString &name, const QString &params, Equinox e
 		return;
 	}
 	
-	end_of_timeout = -0x8000000000000000LL;
-	
 	interpolatedPosition.reset();
-	
-	connect(tcpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(socketFailed(QAbstractSocket::SocketError)));
+
+	if (ioThreadUsers++ == 0)
+	{
+		ioThread = new QThread();
+		ioThread->setObjectName("TelescopeTCP I/O");
+		ioThread->start();
+	}
+	connection = new TelescopeTCPConnection(name, address, port, &receivedPositions);
+	connection->moveToThread(ioThread);
+	QMetaObject::invokeMethod(connection, "start", Qt::QueuedConnection);
 }
 
 void TelescopeTCP::hangup(void)
 {
-	if (tcpSocket->isValid())
+	if (!connection)
+		return;
+
+	// Once stopped, the connection is back in this thread and can be deleted
+	QMetaObject::invokeMethod(connection, "stop", Qt::BlockingQueuedConnection);
+	delete connection;
+	connection = NULL;
+	interpolatedPosition.reset();
+
+	if (--ioThreadUsers == 0)
 	{
-		tcpSocket->abort();// Or maybe tcpSocket->close()?
+		ioThread->quit();
+		ioThread->wait();
+		delete ioThread;
+		ioThread = NULL;
 	}
-	
-	readBufferEnd = readBuffer;
-	writeBufferEnd = writeBuffer;
-	wait_for_connection_establishment = false;
-	
-	interpolatedPosition.reset();
 }
 
-//! queues a GOTO command with the specified position to the write buffer.
+//! sends a GOTO command with the specified position through the I/O thread.
 //! For the data format of the command see the
 //! "Stellarium telescope control protocol" text file
 void TelescopeTCP::telescopeGoto(const Vec3d &j2000Pos)
@@ -264,256 +286,72 @@ void TelescopeTCP::telescopeGoto(const Vec3d &j2000Pos)
 		position = core->j2000ToEquinoxEqu(j2000Pos);
 	}
 
-	if (writeBufferEnd - writeBuffer + 20 < (int)sizeof(writeBuffer))
-	{
-		const double ra_signed = atan2(position[1], position[0]);
-		//Workaround for the discrepancy in precision between Windows/Linux/PPC Macs and Intel Macs:
-		const double ra = (ra_signed >= 0) ? ra_signed : (ra_signed + 2.0 * M_PI);
-		const double dec = atan2(position[2], sqrt(position[0]*position[0]+position[1]*position[1]));
-		unsigned int ra_int = (unsigned int)floor(0.5 + ra*(((unsigned int)0x80000000)/M_PI));
-		int dec_int = (int)floor(0.5 + dec*(((unsigned int)0x80000000)/M_PI));
-		// length of packet:
-		*writeBufferEnd++ = 20;
-		*writeBufferEnd++ = 0;
-		// type of packet:
-		*writeBufferEnd++ = 0;
-		*writeBufferEnd++ = 0;
-		// client_micros:
-		qint64 now = getNow();
-		*writeBufferEnd++ = now;
-		now>>=8;
-		*writeBufferEnd++ = now;
-		now>>=8;
-		*writeBufferEnd++ = now;
-		now>>=8;
-		*writeBufferEnd++ = now;
-		now>>=8;
-		*writeBufferEnd++ = now;
-		now>>=8;
-		*writeBufferEnd++ = now;
-		now>>=8;
-		*writeBufferEnd++ = now;
-		now>>=8;
-		*writeBufferEnd++ = now;
-		// ra:
-		*writeBufferEnd++ = ra_int;
-		ra_int>>=8;
-		*writeBufferEnd++ = ra_int;
-		ra_int>>=8;
-		*writeBufferEnd++ = ra_int;
-		ra_int>>=8;
-		*writeBufferEnd++ = ra_int;
-		// dec:
-		*writeBufferEnd++ = dec_int;
-		dec_int>>=8;
-		*writeBufferEnd++ = dec_int;
-		dec_int>>=8;
-		*writeBufferEnd++ = dec_int;
-		dec_int>>=8;
-		*writeBufferEnd++ = dec_int;
-	}
-	else
-	{
-		qDebug() << "TelescopeTCP(" << name << ")::telescopeGoto: "<< "communication is too slow, I will ignore this command";
-	}
+	const double ra_signed = atan2(position[1], position[0]);
+	//Workaround for the discrepancy in precision between Windows/Linux/PPC Macs and Intel Macs:
+	const double ra = (ra_signed >= 0) ? ra_signed : (ra_signed + 2.0 * M_PI);
+	const double dec = atan2(position[2], sqrt(position[0]*position[0]+position[1]*position[1]));
+	unsigned int ra_int = (unsigned int)floor(0.5 + ra*(((unsigned int)0x80000000)/M_PI));
+	int dec_int = (int)floor(0.5 + dec*(((unsigned int)0x80000000)/M_PI));
+	QByteArray packet;
+	packet.reserve(20);
+	// length of packet:
+	packet.append((char)20);
+	packet.append((char)0);
+	// type of packet:
+	packet.append((char)0);
+	packet.append((char)0);
+	// client_micros:
+	qint64 now = getNow();
+	for (int i=0; i<8; ++i, now>>=8)
+		packet.append((char)now);
+	// ra:
+	for (int i=0; i<4; ++i, ra_int>>=8)
+		packet.append((char)ra_int);
+	// dec:
+	for (int i=0; i<4; ++i, dec_int>>=8)
+		packet.append((char)dec_int);
+
+	// Written by the I/O thread
+	QMetaObject::invokeMethod(connection, "sendPacket", Qt::QueuedConnection, Q_ARG(QByteArray, packet));
 }
 
-void TelescopeTCP::performWriting(void)
+void TelescopeTCP::processReceivedPositions(void) const
 {
-	const int to_write = writeBufferEnd - writeBuffer;
-	const int rc = tcpSocket->write(writeBuffer, to_write);
-	if (rc < 0)
-	{
-		//TODO: Better error message. See the Qt documentation.
-		qDebug() << "TelescopeTCP(" << name << ")::performWriting: "
-			<< "write failed: " << tcpSocket->errorString();
-		hangup();
-	}
-	else if (rc > 0)
-	{
-		if (rc >= to_write)
-		{
-			// everything written
-			writeBufferEnd = writeBuffer;
-		}
-		else
-		{
-			// partly written
-			memmove(writeBuffer, writeBuffer + rc, to_write - rc);
-			writeBufferEnd -= rc;
-		}
-	}
-}
+	TelescopePositionSample sample;
+	if (!receivedPositions.pop(sample))
+		return;
 
-//! try to read some data from the telescope server
-void TelescopeTCP::performReading(void)
-{
-	const int to_read = readBuffer + sizeof(readBuffer) - readBufferEnd;
-	const int rc = tcpSocket->read(readBufferEnd, to_read);
-	if (rc < 0)
-	{
-		//TODO: Better error warning. See the Qt documentation.
-		qDebug() << "TelescopeTCP(" << name << ")::performReading: " << "read failed: " << tcpSocket->errorString();
-		hangup();
-	}
-	else if (rc == 0)
-	{
-		qDebug() << "TelescopeTCP(" << name << ")::performReading: " << "server has closed the connection";
-		hangup();
-	}
-	else
+	const StelCore* core = StelApp::getInstance().getCore();
+	// The I/O thread uses the raw system time, see getNow()
+	const qint64 deltaTCorrection = core->getDeltaT(StelUtils::getJDFromSystem())*1000000;
+	do
 	{
-		readBufferEnd += rc;
-		char *p = readBuffer;
-		// parse the data in the read buffer:
-		while (readBufferEnd - p >= 2)
-		{
-			const int size = (int)(((unsigned char)(p[0])) | (((unsigned int)(unsigned char)(p[1])) << 8));
-			if (size > (int)sizeof(readBuffer) || size < 4)
-			{
-				qDebug() << "TelescopeTCP(" << name << ")::performReading: " << "bad packet size: " << size;
-				hangup();
-				return;
-			}
-			if (size > readBufferEnd - p)
-			{
-				// wait for complete packet
-				break;
-			}
-			const int type = (int)(((unsigned char)(p[2])) | (((unsigned int)(unsigned char)(p[3])) << 8));
-			// dispatch:
-			switch (type)
-			{
-				case 0:
-				{
-				// We have received position information.
-				// For the data format of the message see the
-				// "Stellarium telescope control protocol"
-					if (size < 24)
-					{
-						qDebug() << "TelescopeTCP(" << name << ")::performReading: " << "type 0: bad packet size: " << size;
-						hangup();
-						return;
-					}
-					const qint64 server_micros = (qint64)
-						(((quint64)(unsigned char)(p[ 4])) |
-						(((quint64)(unsigned char)(p[ 5])) <<  8) |
-						(((quint64)(unsigned char)(p[ 6])) << 16) |
-						(((quint64)(unsigned char)(p[ 7])) << 24) |
-						(((quint64)(unsigned char)(p[ 8])) << 32) |
-						(((quint64)(unsigned char)(p[ 9])) << 40) |
-						(((quint64)(unsigned char)(p[10])) << 48) |
-						(((quint64)(unsigned char)(p[11])) << 56));
-					const unsigned int ra_int =
-						((unsigned int)(unsigned char)(p[12])) |
-						(((unsigned int)(unsigned char)(p[13])) <<  8) |
-						(((unsigned int)(unsigned char)(p[14])) << 16) |
-						(((unsigned int)(unsigned char)(p[15])) << 24);
-					const int dec_int =
-						(int)(((unsigned int)(unsigned char)(p[16])) |
-						     (((unsigned int)(unsigned char)(p[17])) <<  8) |
-						     (((unsigned int)(unsigned char)(p[18])) << 16) |
-						     (((unsigned int)(unsigned char)(p[19])) << 24));
-					const int status =
-						(int)(((unsigned int)(unsigned char)(p[20])) |
-						     (((unsigned int)(unsigned char)(p[21])) <<  8) |
-						     (((unsigned int)(unsigned char)(p[22])) << 16) |
-						     (((unsigned int)(unsigned char)(p[23])) << 24));
-
-					const double ra  =  ra_int * (M_PI/(unsigned int)0x80000000);
-					const double dec = dec_int * (M_PI/(unsigned int)0x80000000);
-					const double cdec = cos(dec);
-					Vec3d position(cos(ra)*cdec, sin(ra)*cdec, sin(dec));
-					Vec3d j2000Position = position;
-					if (equinox == EquinoxJNow)
-					{
-						const StelCore* core = StelApp::getInstance().getCore();
-						j2000Position = core->equinoxEquToJ2000(position);
-					}
-					interpolatedPosition.add(j2000Position, getNow(), server_micros, status);
-				}
-				break;
-				default:
-					qDebug() << "TelescopeTCP(" << name << ")::performReading: " << "ignoring unknown packet, type: " << type;
-				break;
-			}
-			p += size;
-		}
-		if (p >= readBufferEnd)
-		{
-			// everything handled
-			readBufferEnd = readBuffer;
-		}
-		else
+		if (sample.reset)
 		{
-			// partly handled
-			memmove(readBuffer, p, readBufferEnd - p);
-			readBufferEnd -= (p - readBuffer);
+			interpolatedPosition.reset();
+			continue;
 		}
-	}
+		Vec3d j2000Position = sample.position;
+		if (equinox == EquinoxJNow)
+			j2000Position = core->equinoxEquToJ2000(sample.position);
+		interpolatedPosition.add(j2000Position, sample.systemMicros - deltaTCorrection, sample.serverMicros, sample.status);
+	} while (receivedPositions.pop(sample));
 }
 
 //! estimates where the telescope is by interpolation in the stored
 //! telescope positions:
 Vec3d TelescopeTCP::getJ2000EquatorialPos(const StelCore*) const
 {
+	processReceivedPositions();
 	const qint64 now = getNow() - time_delay;
 	return interpolatedPosition.get(now);
 }
 
-//! checks if the socket is connected, tries to connect if it is not
+//! collects the positions received since the last call.
+//! The connection itself is handled by the I/O thread.
 //@return true if the socket is connected
 bool TelescopeTCP::prepareCommunication()
 {
-	if(tcpSocket->state() == QAbstractSocket::ConnectedState)
-	{
-		if(wait_for_connection_establishment)
-		{
-			wait_for_connection_establishment = false;
-			qDebug() << "TelescopeTCP(" << name << ")::prepareCommunication: Connection established";
-		}
-		return true;
-	}
-	else if(wait_for_connection_establishment)
-	{
-		const qint64 now = getNow();
-		if (now > end_of_timeout)
-		{
-			end_of_timeout = now + 1000000;
-			qDebug() << "TelescopeTCP(" << name << ")::prepareCommunication: Connection attempt timed out";
-			hangup();
-		}
-	}
-	else
-	{
-		const qint64 now = getNow();
-		if (now < end_of_timeout) 
-			return false; //Don't try to reconnect for some time
-		end_of_timeout = now + 5000000;
-		tcpSocket->connectToHost(address, port);
-		wait_for_connection_establishment = true;
-		qDebug() << "TelescopeTCP(" << name << ")::prepareCommunication: Attempting to connect to host" << address.toString() << "at port" << port;
-	}
-	return false;
-}
-
-void TelescopeTCP::performCommunication()
-{
-	if (tcpSocket->state() == QAbstractSocket::ConnectedState)
-	{
-		performWriting();
-		
-		if (tcpSocket->bytesAvailable() > 0)
-		{
-			//If performReading() is called when there are no bytes to read,
-			//it closes the connection
-			performReading();
-		}
-	}
-}
-
-//TODO: More informative error messages?
-void TelescopeTCP::socketFailed(QAbstractSocket::SocketError)
-{
-	qDebug() << "TelescopeTCP(" << name << "): TCP socket error:\n" << tcpSocket->errorString();
+	processReceivedPositions();
+	return isConnected();
 }
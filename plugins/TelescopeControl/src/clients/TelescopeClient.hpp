@@ -36,9 +36,12 @@
 #include "StelApp.hpp"
 #include "StelObject.hpp"
 #include "InterpolatedPosition.hpp"
+#include "TelescopeTCPConnection.hpp"
 
 class StelCore;
+class QThread;
 
+qint64 getSystemMicros(void);
 qint64 getNow(void);
 
 enum Equinox {
@@ -162,45 +165,42 @@ public:
 	}
 	bool isConnected(void) const
 	{
-		//return (tcpSocket->isValid() && !wait_for_connection_establishment);
-		return (tcpSocket->state() == QAbstractSocket::ConnectedState);
+		return (connection && connection->isConnected());
 	}
 	
 private:
 	Vec3d getJ2000EquatorialPos(const StelCore* core=0) const;
 	bool prepareCommunication();
-	void performCommunication();
 	void telescopeGoto(const Vec3d &j2000Pos);
 	bool isInitialized(void) const
 	{
 		return (!address.isNull());
 	}
-	void performReading(void);
-	void performWriting(void);
+	//! Move the positions received by the I/O thread to interpolatedPosition.
+	void processReceivedPositions(void) const;
 	
 private:
 	void hangup(void);
 	QHostAddress address;
 	unsigned int port;
-	QTcpSocket * tcpSocket;
-	bool wait_for_connection_establishment;
-	qint64 end_of_timeout;
-	char readBuffer[120];
-	char *readBufferEnd;
-	char writeBuffer[120];
-	char *writeBufferEnd;
 	int time_delay;
 
-	InterpolatedPosition interpolatedPosition;
+	//! Network side, living in the shared I/O thread.
+	TelescopeTCPConnection* connection;
+	mutable TelescopePositionQueue receivedPositions;
+
+	mutable InterpolatedPosition interpolatedPosition;
 	virtual bool hasKnownPosition(void) const
 	{
+		processReceivedPositions();
 		return interpolatedPosition.isKnown();
 	}
 
 	Equinox equinox;
-	
-private slots:
-	void socketFailed(QAbstractSocket::SocketError socketError);
+
+	//! The thread whose event loop handles the sockets of all the TCP telescopes.
+	static QThread* ioThread;
+	static int ioThreadUsers;
 };
 
 #endif // _TELESCOPE_HPP_
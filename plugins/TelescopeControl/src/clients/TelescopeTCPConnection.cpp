@@ -0,0 +1,269 @@
+/*
+ * Stellarium Telescope Control Plug-in
+ *
+ * Copyright (C) 2006 Johannes Gajdosik
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "TelescopeTCPConnection.hpp"
+#include "TelescopeClient.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QTimer>
+
+//! Delay before reconnecting after a lost connection, in milliseconds.
+static const int RECONNECT_DELAY = 5000;
+//! Delay before reconnecting after a timed out connection attempt, in milliseconds.
+static const int RETRY_DELAY = 1000;
+//! Maximum duration of a connection attempt, in milliseconds.
+static const int CONNECTION_TIMEOUT = 5000;
+
+TelescopeTCPConnection::TelescopeTCPConnection(const QString &name, const QHostAddress &address, quint16 port, TelescopePositionQueue* queue)
+	: name(name)
+	, address(address)
+	, port(port)
+	, queue(queue)
+	, socket(NULL)
+	, retryTimer(NULL)
+	, timeoutTimer(NULL)
+	, connected(0)
+{
+	readBufferEnd = readBuffer;
+}
+
+TelescopeTCPConnection::~TelescopeTCPConnection()
+{
+	Q_ASSERT(socket==NULL);
+}
+
+void TelescopeTCPConnection::start()
+{
+	// The children are created here, so that they belong to the I/O thread
+	socket = new QTcpSocket(this);
+	connect(socket, SIGNAL(connected()), this, SLOT(socketConnected()));
+	connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+	connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(socketError(QAbstractSocket::SocketError)));
+	connect(socket, SIGNAL(readyRead()), this, SLOT(readData()));
+
+	retryTimer = new QTimer(this);
+	retryTimer->setSingleShot(true);
+	connect(retryTimer, SIGNAL(timeout()), this, SLOT(connectToServer()));
+
+	timeoutTimer = new QTimer(this);
+	timeoutTimer->setSingleShot(true);
+	timeoutTimer->setInterval(CONNECTION_TIMEOUT);
+	connect(timeoutTimer, SIGNAL(timeout()), this, SLOT(connectionTimedOut()));
+
+	connectToServer();
+}
+
+void TelescopeTCPConnection::stop()
+{
+	if (socket)
+	{
+		socket->disconnect(this);
+		socket->abort();
+		delete socket;
+		socket = NULL;
+	}
+	delete retryTimer;
+	retryTimer = NULL;
+	delete timeoutTimer;
+	timeoutTimer = NULL;
+	connected.storeRelease(0);
+	moveToThread(QCoreApplication::instance()->thread());
+}
+
+void TelescopeTCPConnection::connectToServer()
+{
+	qDebug() << "TelescopeTCP(" << name << "): Attempting to connect to host" << address.toString() << "at port" << port;
+	readBufferEnd = readBuffer;
+	socket->connectToHost(address, port);
+	timeoutTimer->start();
+}
+
+void TelescopeTCPConnection::socketConnected()
+{
+	timeoutTimer->stop();
+	connected.storeRelease(1);
+	qDebug() << "TelescopeTCP(" << name << "): Connection established";
+}
+
+void TelescopeTCPConnection::socketDisconnected()
+{
+	qDebug() << "TelescopeTCP(" << name << "): server has closed the connection";
+	hangup(RECONNECT_DELAY);
+}
+
+//TODO: More informative error messages?
+void TelescopeTCPConnection::socketError(QAbstractSocket::SocketError)
+{
+	qDebug() << "TelescopeTCP(" << name << "): TCP socket error:\n" << socket->errorString();
+	hangup(RECONNECT_DELAY);
+}
+
+void TelescopeTCPConnection::connectionTimedOut()
+{
+	qDebug() << "TelescopeTCP(" << name << "): Connection attempt timed out";
+	hangup(RETRY_DELAY);
+}
+
+void TelescopeTCPConnection::hangup(int retryDelay)
+{
+	// Several notifications can be received for the same failure
+	if (retryTimer->isActive())
+		return;
+	// Started first, as abort() may emit disconnected() again
+	retryTimer->start(retryDelay);
+
+	timeoutTimer->stop();
+	connected.storeRelease(0);
+	socket->abort();
+	readBufferEnd = readBuffer;
+
+	TelescopePositionSample sample;
+	sample.systemMicros = 0;
+	sample.serverMicros = 0;
+	sample.status = 0;
+	sample.reset = true;
+	queue->push(sample);
+}
+
+void TelescopeTCPConnection::sendPacket(const QByteArray& packet)
+{
+	if (!isConnected())
+		return;
+	// The socket buffers what can not be written immediately
+	if (socket->write(packet) < 0)
+	{
+		qDebug() << "TelescopeTCP(" << name << ")::sendPacket: " << "write failed: " << socket->errorString();
+		hangup(RECONNECT_DELAY);
+	}
+}
+
+//! read the available data from the telescope server
+void TelescopeTCPConnection::readData()
+{
+	while (socket->bytesAvailable() > 0)
+	{
+		const int to_read = readBuffer + sizeof(readBuffer) - readBufferEnd;
+		const int rc = socket->read(readBufferEnd, to_read);
+		if (rc < 0)
+		{
+			qDebug() << "TelescopeTCP(" << name << ")::readData: " << "read failed: " << socket->errorString();
+			hangup(RECONNECT_DELAY);
+			return;
+		}
+		if (rc == 0)
+			return;
+
+		// All the packets of this chunk have been received at the same time
+		const qint64 now = getSystemMicros();
+		readBufferEnd += rc;
+		char *p = readBuffer;
+		// parse the data in the read buffer:
+		while (readBufferEnd - p >= 2)
+		{
+			const int size = (int)(((unsigned char)(p[0])) | (((unsigned int)(unsigned char)(p[1])) << 8));
+			if (size > (int)sizeof(readBuffer) || size < 4)
+			{
+				qDebug() << "TelescopeTCP(" << name << ")::readData: " << "bad packet size: " << size;
+				hangup(RECONNECT_DELAY);
+				return;
+			}
+			if (size > readBufferEnd - p)
+			{
+				// wait for complete packet
+				break;
+			}
+			const int type = (int)(((unsigned char)(p[2])) | (((unsigned int)(unsigned char)(p[3])) << 8));
+			// dispatch:
+			switch (type)
+			{
+				case 0:
+				{
+				// We have received position information.
+				// For the data format of the message see the
+				// "Stellarium telescope control protocol"
+					if (size < 24)
+					{
+						qDebug() << "TelescopeTCP(" << name << ")::readData: " << "type 0: bad packet size: " << size;
+						hangup(RECONNECT_DELAY);
+						return;
+					}
+					const qint64 server_micros = (qint64)
+						(((quint64)(unsigned char)(p[ 4])) |
+						(((quint64)(unsigned char)(p[ 5])) <<  8) |
+						(((quint64)(unsigned char)(p[ 6])) << 16) |
+						(((quint64)(unsigned char)(p[ 7])) << 24) |
+						(((quint64)(unsigned char)(p[ 8])) << 32) |
+						(((quint64)(unsigned char)(p[ 9])) << 40) |
+						(((quint64)(unsigned char)(p[10])) << 48) |
+						(((quint64)(unsigned char)(p[11])) << 56));
+					const unsigned int ra_int =
+						((unsigned int)(unsigned char)(p[12])) |
+						(((unsigned int)(unsigned char)(p[13])) <<  8) |
+						(((unsigned int)(unsigned char)(p[14])) << 16) |
+						(((unsigned int)(unsigned char)(p[15])) << 24);
+					const int dec_int =
+						(int)(((unsigned int)(unsigned char)(p[16])) |
+						     (((unsigned int)(unsigned char)(p[17])) <<  8) |
+						     (((unsigned int)(unsigned char)(p[18])) << 16) |
+						     (((unsigned int)(unsigned char)(p[19])) << 24));
+					const int status =
+						(int)(((unsigned int)(unsigned char)(p[20])) |
+						     (((unsigned int)(unsigned char)(p[21])) <<  8) |
+						     (((unsigned int)(unsigned char)(p[22])) << 16) |
+						     (((unsigned int)(unsigned char)(p[23])) << 24));
+
+					const double ra  =  ra_int * (M_PI/(unsigned int)0x80000000);
+					const double dec = dec_int * (M_PI/(unsigned int)0x80000000);
+					const double cdec = cos(dec);
+
+					TelescopePositionSample sample;
+					sample.position.set(cos(ra)*cdec, sin(ra)*cdec, sin(dec));
+					sample.systemMicros = now;
+					sample.serverMicros = server_micros;
+					sample.status = status;
+					sample.reset = false;
+					if (!queue->push(sample))
+						qDebug() << "TelescopeTCP(" << name << ")::readData: " << "position queue full, dropping position";
+				}
+				break;
+				default:
+					qDebug() << "TelescopeTCP(" << name << ")::readData: " << "ignoring unknown packet, type: " << type;
+				break;
+			}
+			p += size;
+		}
+		if (p >= readBufferEnd)
+		{
+			// everything handled
+			readBufferEnd = readBuffer;
+		}
+		else
+		{
+			// partly handled
+			memmove(readBuffer, p, readBufferEnd - p);
+			readBufferEnd -= (p - readBuffer);
+		}
+	}
+}
@@ -0,0 +1,142 @@
+/*
+ * Stellarium Telescope Control Plug-in
+ *
+ * Copyright (C) 2006 Johannes Gajdosik
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _TELESCOPE_TCP_CONNECTION_HPP_
+#define _TELESCOPE_TCP_CONNECTION_HPP_
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHostAddress>
+#include <QObject>
+#include <QString>
+#include <QTcpSocket>
+
+#include "VecMath.hpp"
+
+class QTimer;
+
+//! A position report received from a telescope server.
+//! The position is the raw one sent by the server (J2000 or JNow,
+//! depending on the client settings).
+struct TelescopePositionSample
+{
+	Vec3d position;
+	//! System time of reception in microseconds, see getSystemMicros()
+	qint64 systemMicros;
+	qint64 serverMicros;
+	int status;
+	//! If set, the connection was lost and the known positions must be discarded.
+	bool reset;
+};
+
+//! Single producer, single consumer lock-free FIFO of position reports.
+//! The I/O thread pushes the samples as soon as they are received, the main
+//! thread pops them when it needs the telescope position.
+//! When the queue is full, new samples are dropped.
+class TelescopePositionQueue
+{
+public:
+	TelescopePositionQueue() : head(0), tail(0) {;}
+
+	//! Called by the producer only.
+	//! @return false if the queue is full.
+	bool push(const TelescopePositionSample& sample)
+	{
+		const int t = tail.load();
+		const int next = (t+1) % Capacity;
+		if (next == head.loadAcquire())
+			return false;
+		samples[t] = sample;
+		tail.storeRelease(next);
+		return true;
+	}
+
+	//! Called by the consumer only.
+	//! @return false if the queue is empty.
+	bool pop(TelescopePositionSample& sample)
+	{
+		const int h = head.load();
+		if (h == tail.loadAcquire())
+			return false;
+		sample = samples[h];
+		head.storeRelease((h+1) % Capacity);
+		return true;
+	}
+
+private:
+	enum {Capacity = 64};
+	TelescopePositionSample samples[Capacity];
+	QAtomicInt head;
+	QAtomicInt tail;
+};
+
+//! Network side of TelescopeTCP.
+//! Instances live in the shared telescope I/O thread, where the sockets of all
+//! the TCP telescopes are multiplexed by the thread's event loop: reading is
+//! driven by the readyRead() notifications instead of being polled every frame,
+//! so position reports are time-stamped when they arrive, whatever the frame rate.
+//! Received positions are published through a TelescopePositionQueue, commands
+//! are sent with sendPacket() through queued connections.
+class TelescopeTCPConnection : public QObject
+{
+	Q_OBJECT
+public:
+	TelescopeTCPConnection(const QString& name, const QHostAddress& address, quint16 port, TelescopePositionQueue* queue);
+	~TelescopeTCPConnection();
+
+	//! Thread safe.
+	bool isConnected() const {return connected.loadAcquire()!=0;}
+
+public slots:
+	//! Create the socket and start connecting. Must run in the I/O thread.
+	void start();
+	//! Close the connection and move back to the main thread, so that the
+	//! object can be deleted there. Must run in the I/O thread.
+	void stop();
+	//! Write a command packet to the server.
+	void sendPacket(const QByteArray& packet);
+
+private slots:
+	void connectToServer();
+	void socketConnected();
+	void socketDisconnected();
+	void socketError(QAbstractSocket::SocketError socketError);
+	void connectionTimedOut();
+	void readData();
+
+private:
+	//! Abort the connection and try again after retryDelay milliseconds.
+	void hangup(int retryDelay);
+
+	const QString name;
+	const QHostAddress address;
+	const quint16 port;
+	TelescopePositionQueue* queue;
+
+	QTcpSocket* socket;
+	QTimer* retryTimer;
+	QTimer* timeoutTimer;
+	char readBuffer[120];
+	char* readBufferEnd;
+	QAtomicInt connected;
+};
+
+#endif // _TELESCOPE_TCP_CONNECTION_HPP_
@@ -228,7 +228,8 @@ StelMainView::StelMainView(QWidget* parent)
 	  flagInvertScreenShotColors(false),
 	  screenShotPrefix("stellarium-"),
 	  screenShotDir(""),
-	  cursorTimeout(-1.f), flagCursorTimeout(false), minFpsTimer(NULL), maxfps(10000.f)
+	  cursorTimeout(-1.f), flagCursorTimeout(false), minFpsTimer(NULL), maxfps(10000.f),
+	  flagRedrawOnDemand(false), maxRedrawInterval(5.f)
 {
 	StelApp::initStatic();
 	
@@ -249,6 +250,7 @@ StelMainView::StelMainView(QWidget* parent)
 	connect(this, SIGNAL(screenshotRequested()), this, SLOT(doScreenshot()));
 
 	lastEventTimeSec = 0;
+	lastRedrawTimeSec = 0;
 
 	// Create an openGL viewport
 	QGLFormat glFormat(QGL::StencilBuffer | QGL::DepthBuffer | QGL::DoubleBuffer);
@@ -308,6 +310,7 @@ void StelMainView::init(QSettings* conf)
 	
 
 	StelPainter::initGLShaders();
+	StelPainter::setFlagGpuProjection(conf->value("video/flag_gpu_projection", false).toBool());
 
 	setResizeMode(QDeclarativeView::SizeRootObjectToView);
 	qmlRegisterType<StelSkyItem>("Stellarium", 1, 0, "StelSky");
@@ -341,6 +344,8 @@ void StelMainView::init(QSettings* conf)
 	setCursorTimeout(conf->value("gui/mouse_cursor_timeout", 10.f).toFloat());
 	maxfps = conf->value("video/maximum_fps",10000.f).toFloat();
 	minfps = conf->value("video/minimum_fps",10000.f).toFloat();
+	flagRedrawOnDemand = conf->value("video/flag_redraw_on_demand", false).toBool();
+	maxRedrawInterval = conf->value("video/redraw_on_demand_max_interval", 5.f).toFloat();
 	flagMaxFpsUpdatePending = false;
 
 	// XXX: This should be done in StelApp::init(), unfortunately for the moment we need init the gui before the
@@ -423,6 +428,9 @@ void StelMainView::setFullScreen(bool b)
 }
 
 void StelMainView::updateScene() {
+	// Skip the frame if it would be identical to the previous one
+	if (flagRedrawOnDemand && !isRedrawNeeded())
+		return;
 	// For some reason the skyItem is not updated when the night mode shader is on.
 	// To fix this we manually do it here.
 	skyItem->update();
@@ -434,6 +442,17 @@ void StelMainView::thereWasAnEvent()
 	lastEventTimeSec = StelApp::getTotalRunTime();
 }
 
+bool StelMainView::isRedrawNeeded() const
+{
+	const double now = StelApp::getTotalRunTime();
+	// GUI interactions: keep drawing during the maximum fps period following an event
+	if (now-lastEventTimeSec<2.5)
+		return true;
+	if (now-lastRedrawTimeSec>=maxRedrawInterval)
+		return true;
+	return stelApp->isRedrawNeeded(now-lastRedrawTimeSec);
+}
+
 void StelMainView::maxFpsSceneUpdate()
 {
 	updateScene();
@@ -443,6 +462,7 @@ void StelMainView::maxFpsSceneUpdate()
 void StelMainView::drawBackground(QPainter*, const QRectF&)
 {
 	const double now = StelApp::getTotalRunTime();
+	lastRedrawTimeSec = now;
 
 	// Determines when the next display will need to be triggered
 	// The current policy is that after an event, the FPS is maximum for 2.5 seconds
@@ -108,6 +108,14 @@ public slots:
 	//! Get the current maximum frames per second.
 	float getMaxFps() {return maxfps;}
 
+	//! Set whether frames are only drawn when something visible changed.
+	//! When activated, the periodic minimum fps refresh is skipped as long as the sky did not move by more
+	//! than half a pixel and no module reports pending changes (see StelApp::isRedrawNeeded()).
+	//! This saves a lot of power on always-on displays.
+	void setFlagRedrawOnDemand(bool b) {flagRedrawOnDemand=b;}
+	//! Get whether frames are only drawn when something visible changed.
+	bool getFlagRedrawOnDemand() const {return flagRedrawOnDemand;}
+
 	void maxFpsSceneUpdate();
 	//! Updates the scene and process all events
 	void updateScene();
@@ -170,7 +178,11 @@ private:
 	//! FPS should be maximized for a couple of seconds.
 	void thereWasAnEvent();
 
+	//! Return whether the next frame needs to be drawn in redraw on demand mode.
+	bool isRedrawNeeded() const;
+
 	double lastEventTimeSec;
+	double lastRedrawTimeSec;
 
 	QTimer* minFpsTimer;
 	bool flagMaxFpsUpdatePending;
@@ -178,6 +190,11 @@ private:
 	float minfps;
 	//! The maximum desired frame rate in frame per second.
 	float maxfps;
+	//! Define whether frames are only drawn when something visible changed.
+	bool flagRedrawOnDemand;
+	//! Maximum time in seconds without redraw in redraw on demand mode.
+	//! This catches the changes not reported by modules, e.g. textures loaded in background.
+	float maxRedrawInterval;
 };
 
 
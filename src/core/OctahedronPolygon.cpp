@@ -22,7 +22,22 @@
 #include "StelSphereGeometry.hpp"
 #include "glues.h"
 
+#include <QCache>
+#include <QCryptographicHash>
 #include <QFile>
+#include <QMutex>
+#include <QtConcurrent>
+
+//! Number of vertices from which the sides are tesselated in parallel
+static const int PARALLEL_TESSELATION_MIN_VERTICES = 256;
+//! Maximum number of vertices of the results kept in the operation cache
+static const int MAX_CACHED_OPERATION_VERTICES = 500000;
+
+//! Results of the boolean operations, by operation and content of the operands.
+//! The same footprints are combined over and over, e.g. when the sky image tiles are loaded again.
+static QCache<QByteArray, OctahedronPolygon> operationCache(MAX_CACHED_OPERATION_VERTICES);
+//! The polygons are also created and combined in loading threads
+static QMutex operationCacheMutex;
 
 const Vec3d OctahedronPolygon::sideDirections[] = {	Vec3d(1,1,1), Vec3d(1,1,-1),Vec3d(-1,1,1),Vec3d(-1,1,-1),
 	Vec3d(1,-1,1),Vec3d(1,-1,-1),Vec3d(-1,-1,1),Vec3d(-1,-1,-1)};
@@ -374,13 +389,48 @@ inline void unprojectOctahedron(Vec3d& v, const Vec3d& sideDirection)
 	v.normalize();
 }
 
-void OctahedronPolygon::updateVertexArray()
+//! The tesselation of one side of the octahedron.
+//! The sides are independent, so that they can be processed in parallel.
+struct OctahedronPolygon::SideTask
 {
-	Q_ASSERT(sides.size()==8);
-	fillCachedVertexArray.vertex.clear();
-	outlineCachedVertexArray.vertex.clear();
+	const OctahedronPolygon* polygon;
+	int sidenb;
+	//! The GLUES winding rule, for the tesselation of the contours.
+	double windingRule;
+	//! The resulting contours.
+	QVector<SubContour> contours;
+	//! The resulting triangles and outline segments on the sphere.
+	QVector<Vec3d> fill;
+	QVector<Vec3d> outline;
+};
 
-	Q_ASSERT(sides.size()==8);
+void OctahedronPolygon::runOnSides(QVector<SideTask>& tasks, void (*func)(SideTask&), double windingRule) const
+{
+	int vertexCount = 0;
+	for (int sidenb=0;sidenb<8;++sidenb)
+	{
+		if (sides[sidenb].isEmpty())
+			continue;
+		SideTask task;
+		task.polygon = this;
+		task.sidenb = sidenb;
+		task.windingRule = windingRule;
+		tasks.append(task);
+		foreach (const SubContour& c, sides[sidenb])
+			vertexCount += c.size();
+	}
+	// Starting the threads costs more than tesselating the small polygons
+	if (tasks.size()>1 && vertexCount>=PARALLEL_TESSELATION_MIN_VERTICES)
+		QtConcurrent::blockingMap(tasks, func);
+	else
+	{
+		for (int i=0;i<tasks.size();++i)
+			func(tasks[i]);
+	}
+}
+
+void OctahedronPolygon::updateSideVertexArrays(SideTask& task)
+{
 	// Use GLUES tesselation functions to transform the polygon into a list of triangles
 	GLUEStesselator* tess = gluesNewTess();
 #ifndef NDEBUG
@@ -392,68 +442,79 @@ void OctahedronPolygon::updateVertexArray()
 	gluesTessCallback(tess, GLUES_TESS_COMBINE_DATA, (GLvoid(*)()) &combineTrianglesCallback);
 	gluesTessProperty(tess, GLUES_TESS_WINDING_RULE, GLUES_TESS_WINDING_POSITIVE);
 
-	// Call the tesselator on each side
-	for (int sidenb=0;sidenb<8;++sidenb)
+	const int sidenb = task.sidenb;
+	const Vec3d& sideDirection = sideDirections[sidenb];
+	QVector<Vec3d> res = task.polygon->tesselateOneSideTriangles(tess, sidenb);
+	gluesDeleteTess(tess);
+	Q_ASSERT(res.size()%3==0);	// There should be only triangles here
+	for (int j=0;j<=res.size()-3;j+=3)
 	{
-		if (sides[sidenb].isEmpty())
-			continue;
-		const Vec3d& sideDirection = sideDirections[sidenb];
-		QVector<Vec3d> res = tesselateOneSideTriangles(tess, sidenb);
-		Q_ASSERT(res.size()%3==0);	// There should be only triangles here
-		for (int j=0;j<=res.size()-3;j+=3)
+		// Post processing, GLU seems to sometimes output triangles oriented in the wrong direction..
+		// Get rid of them in an ugly way. TODO Need to find the real cause.
+		if (((sidenb&1)==0 ?
+		isTriangleConvexPositive2D(res.at(j+2), res.at(j+1), res.at(j)) :
+		isTriangleConvexPositive2D(res.at(j), res.at(j+1), res.at(j+2))))
 		{
-			// Post processing, GLU seems to sometimes output triangles oriented in the wrong direction..
-			// Get rid of them in an ugly way. TODO Need to find the real cause.
-			if (((sidenb&1)==0 ?
-			isTriangleConvexPositive2D(res.at(j+2), res.at(j+1), res.at(j)) :
-			isTriangleConvexPositive2D(res.at(j), res.at(j+1), res.at(j+2))))
-			{
-				fillCachedVertexArray.vertex+=res.at(j);
-				unprojectOctahedron(fillCachedVertexArray.vertex.last(), sideDirection);
-				fillCachedVertexArray.vertex+=res.at(j+1);
-				unprojectOctahedron(fillCachedVertexArray.vertex.last(), sideDirection);
-				fillCachedVertexArray.vertex+=res.at(j+2);
-				unprojectOctahedron(fillCachedVertexArray.vertex.last(), sideDirection);
-			}
-			else
-			{
-				//  Discard vertex..
-				//qDebug() << "Found a fucking CW triangle";
-			}
+			task.fill+=res.at(j);
+			unprojectOctahedron(task.fill.last(), sideDirection);
+			task.fill+=res.at(j+1);
+			unprojectOctahedron(task.fill.last(), sideDirection);
+			task.fill+=res.at(j+2);
+			unprojectOctahedron(task.fill.last(), sideDirection);
+		}
+		else
+		{
+			//  Discard vertex..
+			//qDebug() << "Found a fucking CW triangle";
 		}
+	}
 
-		// Now compute the outline contours, getting rid of non edge segments
-		EdgeVertex previous;
-		foreach (const SubContour& c, sides[sidenb])
+	// Now compute the outline contours, getting rid of non edge segments
+	EdgeVertex previous;
+	foreach (const SubContour& c, task.polygon->sides[sidenb])
+	{
+		Q_ASSERT(!c.isEmpty());
+		previous = c.first();
+		unprojectOctahedron(previous.vertex, sideDirection);
+		for (int j=0;j<c.size()-1;++j)
 		{
-			Q_ASSERT(!c.isEmpty());
-			previous = c.first();
-			unprojectOctahedron(previous.vertex, sideDirection);
-			for (int j=0;j<c.size()-1;++j)
+			if (previous.edgeFlag || c.at(j+1).edgeFlag)
 			{
-				if (previous.edgeFlag || c.at(j+1).edgeFlag)
-				{
-					outlineCachedVertexArray.vertex.append(previous.vertex);
-					previous=c.at(j+1);
-					unprojectOctahedron(previous.vertex, sideDirection);
-					outlineCachedVertexArray.vertex.append(previous.vertex);
-				}
-				else
-				{
-					previous=c.at(j+1);
-					unprojectOctahedron(previous.vertex, sideDirection);
-				}
+				task.outline.append(previous.vertex);
+				previous=c.at(j+1);
+				unprojectOctahedron(previous.vertex, sideDirection);
+				task.outline.append(previous.vertex);
 			}
-			// Last point connects with first point
-			if (previous.edgeFlag || c.first().edgeFlag)
+			else
 			{
-				outlineCachedVertexArray.vertex.append(previous.vertex);
-				outlineCachedVertexArray.vertex.append(c.first().vertex);
-				unprojectOctahedron(outlineCachedVertexArray.vertex.last(), sideDirection);
+				previous=c.at(j+1);
+				unprojectOctahedron(previous.vertex, sideDirection);
 			}
 		}
+		// Last point connects with first point
+		if (previous.edgeFlag || c.first().edgeFlag)
+		{
+			task.outline.append(previous.vertex);
+			task.outline.append(c.first().vertex);
+			unprojectOctahedron(task.outline.last(), sideDirection);
+		}
+	}
+}
+
+void OctahedronPolygon::updateVertexArray()
+{
+	Q_ASSERT(sides.size()==8);
+	fillCachedVertexArray.vertex.clear();
+	outlineCachedVertexArray.vertex.clear();
+
+	// Call the tesselator on each side, and gather the results in the order of the sides
+	QVector<SideTask> tasks;
+	runOnSides(tasks, &updateSideVertexArrays);
+	foreach (const SideTask& task, tasks)
+	{
+		fillCachedVertexArray.vertex += task.fill;
+		outlineCachedVertexArray.vertex += task.outline;
 	}
-	gluesDeleteTess(tess);
 	computeBoundingCap();
 
 #ifndef NDEBUG
@@ -549,10 +610,9 @@ void endLineLoopCallback(OctTessLineLoopCallbackData* data)
 	data->result.clear();
 }
 
-void OctahedronPolygon::tesselate(TessWindingRule windingRule)
+void OctahedronPolygon::tesselateSide(SideTask& task)
 {
-	Q_ASSERT(sides.size()==8);
-	// Use GLUES tesselation functions to transform the polygon into a list of triangles
+	// Use GLUES tesselation functions to compute the contours of the polygon
 	GLUEStesselator* tess = gluesNewTess();
 #ifndef NDEBUG
 	gluesTessCallback(tess, GLUES_TESS_BEGIN, (GLvoid(*)()) &checkBeginLineLoopCallback);
@@ -561,19 +621,76 @@ void OctahedronPolygon::tesselate(TessWindingRule windingRule)
 	gluesTessCallback(tess, GLUES_TESS_VERTEX_DATA, (GLvoid(*)()) &vertexLineLoopCallback);
 	gluesTessCallback(tess, GLUES_TESS_ERROR, (GLvoid(*)()) &errorCallback);
 	gluesTessCallback(tess, GLUES_TESS_COMBINE_DATA, (GLvoid(*)()) &combineLineLoopCallback);
-	const double windRule = (windingRule==OctahedronPolygon::WindingPositive) ? GLUES_TESS_WINDING_POSITIVE : GLUES_TESS_WINDING_ABS_GEQ_TWO;
-	gluesTessProperty(tess, GLUES_TESS_WINDING_RULE, windRule);
+	gluesTessProperty(tess, GLUES_TESS_WINDING_RULE, task.windingRule);
 	gluesTessProperty(tess, GLUES_TESS_BOUNDARY_ONLY, GL_TRUE);
+	task.contours = task.polygon->tesselateOneSideLineLoop(tess, task.sidenb);
+	gluesDeleteTess(tess);
+}
+
+void OctahedronPolygon::tesselate(TessWindingRule windingRule)
+{
+	Q_ASSERT(sides.size()==8);
+	const double windRule = (windingRule==OctahedronPolygon::WindingPositive) ? GLUES_TESS_WINDING_POSITIVE : GLUES_TESS_WINDING_ABS_GEQ_TWO;
 	// Call the tesselator on each side
-	for (int i=0;i<8;++i)
+	QVector<SideTask> tasks;
+	runOnSides(tasks, &tesselateSide, windRule);
+	foreach (const SideTask& task, tasks)
+		sides[task.sidenb] = task.contours;
+}
+
+QByteArray OctahedronPolygon::getOperationKey(char operation, const OctahedronPolygon& other) const
+{
+	// The vertices are hashed one by one, as the padding bytes of EdgeVertex are undefined
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	QVector<double> buf;
+	const OctahedronPolygon* operands[2] = {this, &other};
+	for (int p=0;p<2;++p)
 	{
-		if (sides[i].isEmpty())
-			continue;
-		sides[i] = tesselateOneSideLineLoop(tess, i);
+		for (int sidenb=0;sidenb<8;++sidenb)
+		{
+			foreach (const SubContour& c, operands[p]->sides[sidenb])
+			{
+				buf.resize(c.size()*4+1);
+				double* d = buf.data();
+				*d++ = c.size();
+				foreach (const EdgeVertex& v, c)
+				{
+					*d++ = v.vertex[0];
+					*d++ = v.vertex[1];
+					*d++ = v.vertex[2];
+					*d++ = v.edgeFlag ? 1. : 0.;
+				}
+				hash.addData((const char*)buf.constData(), buf.size()*sizeof(double));
+			}
+			// Separate the sides
+			const double separator = -1.;
+			hash.addData((const char*)&separator, sizeof(double));
+		}
 	}
-	gluesDeleteTess(tess);
+	return hash.result() + operation;
+}
+
+bool OctahedronPolygon::getCachedResult(const QByteArray& key)
+{
+	QMutexLocker locker(&operationCacheMutex);
+	const OctahedronPolygon* res = operationCache.object(key);
+	if (!res)
+		return false;
+	*this = *res;
+	return true;
 }
 
+void OctahedronPolygon::cacheResult(const QByteArray& key) const
+{
+	QMutexLocker locker(&operationCacheMutex);
+	operationCache.insert(key, new OctahedronPolygon(*this), qMax(1, fillCachedVertexArray.vertex.size()+outlineCachedVertexArray.vertex.size()));
+}
+
+void OctahedronPolygon::clearOperationCache()
+{
+	QMutexLocker locker(&operationCacheMutex);
+	operationCache.clear();
+}
 
 QString OctahedronPolygon::toJson() const
 {
@@ -595,28 +712,40 @@ void OctahedronPolygon::inPlaceIntersection(const OctahedronPolygon& mpoly)
 {
 	if (!intersectsBoundingCap(capN, capD, mpoly.capN, mpoly.capD))
 		return;
+	const QByteArray key = getOperationKey('i', mpoly);
+	if (getCachedResult(key))
+		return;
 	append(mpoly);
 	tesselate(WindingAbsGeqTwo);
 	//tesselate(WindingPositive);
 	updateVertexArray();
+	cacheResult(key);
 }
 
 void OctahedronPolygon::inPlaceUnion(const OctahedronPolygon& mpoly)
 {
+	const QByteArray key = getOperationKey('u', mpoly);
+	if (getCachedResult(key))
+		return;
 	const bool intersect = intersectsBoundingCap(capN, capD, mpoly.capN, mpoly.capD);
 	append(mpoly);
 	if (intersect)
 		tesselate(WindingPositive);
 	updateVertexArray();
+	cacheResult(key);
 }
 
 void OctahedronPolygon::inPlaceSubtraction(const OctahedronPolygon& mpoly)
 {
 	if (!intersectsBoundingCap(capN, capD, mpoly.capN, mpoly.capD))
 		return;
+	const QByteArray key = getOperationKey('s', mpoly);
+	if (getCachedResult(key))
+		return;
 	appendReversed(mpoly);
 	tesselate(WindingPositive);
 	updateVertexArray();
+	cacheResult(key);
 }
 
 bool OctahedronPolygon::intersects(const OctahedronPolygon& mpoly) const
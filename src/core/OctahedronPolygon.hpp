@@ -97,6 +97,9 @@ public:
 	bool contains(const Vec3d& p) const;
 	bool isEmpty() const;
 
+	//! Release the memory used by the cached results of the boolean operations.
+	static void clearOperationCache();
+
 	static const OctahedronPolygon& getAllSkyOctahedronPolygon();
 	static const OctahedronPolygon& getEmptyOctahedronPolygon() {static OctahedronPolygon poly; return poly;}
 
@@ -138,6 +141,20 @@ private:
 	//! Tesselate the contours per side, producing (in @var sides) a list of triangles subcontours according to the given rule.
 	void tesselate(TessWindingRule rule);
 
+	struct SideTask;
+	//! Create a task for each non empty side and run the function on them.
+	//! The sides are processed in parallel when the polygon is large enough.
+	void runOnSides(QVector<SideTask>& tasks, void (*func)(SideTask&), double windingRule=0.) const;
+	static void tesselateSide(SideTask& task);
+	static void updateSideVertexArrays(SideTask& task);
+
+	//! Get the key identifying the result of a boolean operation in the cache.
+	QByteArray getOperationKey(char operation, const OctahedronPolygon& other) const;
+	//! Replace this polygon by the cached result of an operation.
+	//! @return false if the result is not in the cache.
+	bool getCachedResult(const QByteArray& key);
+	void cacheResult(const QByteArray& key) const;
+
 	QVector<SubContour> tesselateOneSideLineLoop(struct GLUEStesselator* tess, int sidenb) const;
 	QVector<Vec3d> tesselateOneSideTriangles(struct GLUEStesselator* tess, int sidenb) const;
 	QVarLengthArray<QVector<SubContour>,8 > sides;
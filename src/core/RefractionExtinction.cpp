@@ -93,6 +93,19 @@ void Refraction::setPreTransfoMat(const Mat4d& m)
 							 invertPreTransfoMat[12], invertPreTransfoMat[13], invertPreTransfoMat[14], invertPreTransfoMat[15]);
 }
 
+bool Refraction::isApproximatelyEqual(const StelProjector::ModelViewTranform& other, double tolerance) const
+{
+	const Refraction* refr = dynamic_cast<const Refraction*>(&other);
+	if (!refr || pressure!=refr->pressure || temperature!=refr->temperature)
+		return false;
+	for (int i=0; i<16; ++i)
+	{
+		if (std::fabs(preTransfoMat.r[i] - refr->preTransfoMat.r[i]) > tolerance || std::fabs(postTransfoMat.r[i] - refr->postTransfoMat.r[i]) > tolerance)
+			return false;
+	}
+	return true;
+}
+
 void Refraction::setPostTransfoMat(const Mat4d& m)
 {
 	postTransfoMat=m;
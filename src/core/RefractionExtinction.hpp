@@ -152,6 +152,8 @@ public:
 
 	StelProjector::ModelViewTranformP clone() const {Refraction* refr = new Refraction(); *refr=*this; return StelProjector::ModelViewTranformP(refr);}
 
+	bool isApproximatelyEqual(const StelProjector::ModelViewTranform& other, double tolerance) const;
+
 	//! Set surface air pressure (mbars), influences refraction computation.
 	void setPressure(float p_mbar);
 	float getPressure() const {return pressure;}
@@ -43,6 +43,7 @@
 #include "StelSkyCultureMgr.hpp"
 #include "StelFileMgr.hpp"
 #include "StelJsonParser.hpp"
+#include "StelJsonCatalog.hpp"
 #include "StelSkyLayerMgr.hpp"
 #include "StelAudioMgr.hpp"
 #include "StelVideoMgr.hpp"
@@ -72,6 +73,8 @@
 #include <QDir>
 #include <QCoreApplication>
 #include <QScreen>
+#include <QThread>
+#include <QtConcurrent>
 
 Q_IMPORT_PLUGIN(StelStandardGuiPluginInterface)
 
@@ -210,6 +213,8 @@ StelApp::StelApp(QObject* parent)
 	, saveProjW(-1)
 	, saveProjH(-1)
 	, drawState(0)
+	, flagRedrawRequested(true)
+	, snapshotDeltaTime(0.)
 {
 	// Stat variables
 	nbDownloadedFiles=0;
@@ -383,6 +388,7 @@ void StelApp::init(QSettings* conf)
 	stelObjectMgr = new StelObjectMgr();
 	stelObjectMgr->init();
 	getModuleMgr().registerModule(stelObjectMgr);
+	connect(stelObjectMgr, SIGNAL(selectedObjectChanged(StelModule::StelModuleSelectAction)), this, SLOT(requestRedraw()));
 
 	localeMgr = new StelLocaleMgr();
 	skyCultureMgr = new StelSkyCultureMgr();
@@ -482,6 +488,8 @@ void StelApp::initPlugIns()
 			m->init();
 		}
 	}
+	// The plugins have built their objects from their catalogs
+	StelJsonCatalog::clearMemoryCache();
 }
 
 void StelApp::deinit()
@@ -529,6 +537,18 @@ void StelApp::update(double deltaTime)
 		timeBase+=1.;
 	}
 		
+	// The state computed while the previous frame was drawn becomes the one drawn now
+	snapshotModules.clear();
+	foreach (StelModule* i, moduleMgr->getCallOrders(StelModule::ActionUpdate))
+	{
+		if (i->hasSnapshots())
+		{
+			i->publishSnapshot();
+			snapshotModules.append(i);
+		}
+	}
+	snapshotDeltaTime = deltaTime;
+
 	core->update(deltaTime);
 
 	moduleMgr->update();
@@ -542,6 +562,14 @@ void StelApp::update(double deltaTime)
 	stelObjectMgr->update(deltaTime);
 }
 
+//! Compute the state of the modules for the next frame.
+//! Defined to be passed to QtConcurrent::run
+static void computeSnapshots(const QList<StelModule*>& modules, double deltaTime)
+{
+	foreach (StelModule* i, modules)
+		i->computeSnapshot(deltaTime);
+}
+
 //! Iterate through the drawing sequence.
 bool StelApp::drawPartial()
 {
@@ -550,6 +578,15 @@ bool StelApp::drawPartial()
 		if (!initialized)
 			return false;
 		core->preDraw();
+		// The snapshots of the next frame are computed while this one is drawn
+		if (!snapshotModules.isEmpty())
+		{
+			if (QThread::idealThreadCount()>1)
+				snapshotFuture = QtConcurrent::run(computeSnapshots, snapshotModules, snapshotDeltaTime);
+			else
+				computeSnapshots(snapshotModules, snapshotDeltaTime);
+			snapshotModules.clear();
+		}
 		drawState = 1;
 		return true;
 	}
@@ -563,6 +600,8 @@ bool StelApp::drawPartial()
 		drawState++;
 		return true;
 	}
+	// The modules can only publish their snapshots once they are all computed
+	snapshotFuture.waitForFinished();
 	core->postDraw();
 	drawState = 0;
 	return false;
@@ -572,10 +611,34 @@ bool StelApp::drawPartial()
 void StelApp::draw()
 {
 	Q_ASSERT(drawState == 0);
+	flagRedrawRequested = false;
 	while (drawPartial()) {}
 	Q_ASSERT(drawState == 0);
 }
 
+bool StelApp::isRedrawNeeded(double deltaTime) const
+{
+	if (!initialized || flagRedrawRequested)
+		return true;
+
+#ifndef DISABLE_SCRIPTING
+	// Scripts change the sky without telling anyone
+	if (scriptMgr->scriptIsRunning())
+		return true;
+#endif
+
+	// Passage of time, measured in pixels for the current field of view
+	if (core->getSkyDriftInPixels(deltaTime) >= 0.5)
+		return true;
+
+	foreach (StelModule* i, moduleMgr->getCallOrders(StelModule::ActionDraw))
+	{
+		if (i->needsRedraw(core))
+			return true;
+	}
+	return false;
+}
+
 /*************************************************************************
  Call this when the size of the GL window has changed
 *************************************************************************/
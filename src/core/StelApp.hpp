@@ -23,9 +23,11 @@
 #include "config.h"
 #include <QString>
 #include <QObject>
+#include <QFuture>
 
 // Predeclaration of some classes
 class StelCore;
+class StelModule;
 class StelTextureMgr;
 class StelObjectMgr;
 class StelLocaleMgr;
@@ -156,6 +158,12 @@ public:
 	//! @return true if we should continue drawing (by calling the method again)
 	bool drawPartial();
 
+	//! Return whether something visible changed since the last call to draw().
+	//! This combines the explicit redraw requests, the motion of the sky due to the passage of time
+	//! and the StelModule::needsRedraw() state of every module.
+	//! @param deltaTime the real time in seconds elapsed since the last call to draw().
+	bool isRedrawNeeded(double deltaTime) const;
+
 	//! Call this when the size of the GL window has changed.
 	void glWindowHasBeenResized(float x, float y, float w, float h);
 
@@ -214,6 +222,10 @@ public slots:
 
 	//! do some cleanup and call QCoreApplication::exit(0)
 	void quit();
+
+	//! Notify that something visible changed and that the next frame must be drawn.
+	//! This is only useful when redraw on demand is activated in the main view.
+	void requestRedraw() {flagRedrawRequested=true;}
 signals:
 	void visionNightModeChanged(bool);
 	void colorSchemeChanged(const QString&);
@@ -334,6 +346,16 @@ private:
 
 	//! The state of the drawing sequence
 	int drawState;
+
+	//! Whether a redraw was explicitly requested since the last draw
+	bool flagRedrawRequested;
+
+	//! The modules which compute their state in StelModule::computeSnapshot(), in update order
+	QList<StelModule*> snapshotModules;
+	//! The time increment given to the modules in the last update
+	double snapshotDeltaTime;
+	//! The computation of the snapshots, which runs while the frame is drawn
+	QFuture<void> snapshotFuture;
 	
 	QList<StelProgressController*> progressControllers;
 };
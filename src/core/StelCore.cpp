@@ -35,6 +35,7 @@
 #include "Planet.hpp"
 #include "SolarSystem.hpp"
 #include "LandscapeMgr.hpp"
+#include "HorizonProfile.hpp"
 #include "StelTranslator.hpp"
 #include "StelActionMgr.hpp"
 
@@ -42,6 +43,9 @@
 #include <QDebug>
 #include <QMetaEnum>
 
+#include <cmath>
+#include <limits>
+
 // Init statics transfo matrices
 // See vsop87.doc:
 const Mat4d StelCore::matJ2000ToVsop87(Mat4d::xrotation(-23.4392803055555555556*(M_PI/180)) * Mat4d::zrotation(0.0000275*(M_PI/180)));
@@ -346,9 +350,7 @@ SphericalCap StelCore::getVisibleSkyArea() const
 	up = altAzToJ2000(up, RefractionOff);
 	
 	if (landscapeMgr->getIsLandscapeFullyVisible())
-	{
-		return SphericalCap(up, -0.035f);
-	}
+		return HorizonProfile::getCapAboveHorizon(up, landscapeMgr->getMinimalHorizonAltitude());
 	return SphericalCap(up, -1.f);
 }
 
@@ -1170,6 +1172,24 @@ double StelCore::getLocalSiderealYearLength() const
 	return position->getHomePlanet()->getSiderealPeriod();
 }
 
+double StelCore::getSkyDriftInPixels(double deltaTime) const
+{
+	// Traveling between locations moves everything on screen
+	if (position->isTraveling())
+		return std::numeric_limits<double>::max();
+
+	// The diurnal rotation is the fastest apparent motion of the sky for a planetary observer.
+	// Use one day for the solar system observer, to account for the motion of planets.
+	// Faster objects such as meteors and satellites are handled by StelModule::needsRedraw().
+	double siderealDay = 1.;
+	const PlanetP& home = position->getHomePlanet();
+	if (home->getEnglishName() != "Solar System Observer" && home->getSiderealDay()!=0.)
+		siderealDay = std::fabs(home->getSiderealDay());
+
+	const double angle = std::fabs(getTimeRate()*deltaTime)*2.*M_PI/siderealDay;
+	return angle*getProjection(FrameJ2000)->getPixelPerRadAtCenter();
+}
+
 QString StelCore::getStartupTimeMode()
 {
 	return startupTimeMode;
@@ -271,6 +271,13 @@ public:
 	//! Get the duration of a sidereal year for the current observer in days.
 	double getLocalSiderealYearLength() const;
 
+	//! Get an estimate of the distance in pixels by which the sky moves on screen when
+	//! the simulation advances by deltaTime real seconds at the current time rate and field of view.
+	//! It is used to decide whether the passage of time makes a new frame necessary.
+	//! @param deltaTime the real time increment in seconds.
+	//! @return the sky displacement at the center of the screen in pixels.
+	double getSkyDriftInPixels(double deltaTime) const;
+
 	//! Return the startup mode, can be preset|Preset or anything else
 	QString getStartupTimeMode();
 	void setStartupTimeMode(const QString& s);
@@ -0,0 +1,45 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _STELDOUBLEBUFFER_HPP_
+#define _STELDOUBLEBUFFER_HPP_
+
+//! @class StelDoubleBuffer
+//! The two copies of the state of a StelModule which computes it in StelModule::computeSnapshot().
+//! computeSnapshot() writes the back copy on the worker thread while draw() reads the front one,
+//! and StelModule::publishSnapshot() swaps them. StelApp never calls publishSnapshot() while a
+//! snapshot is being computed, so that no lock is needed.
+template <class T> class StelDoubleBuffer
+{
+public:
+	StelDoubleBuffer() : frontIndex(0) {;}
+
+	//! Get the state to draw.
+	const T& front() const {return buffers[frontIndex];}
+	//! Get the state being computed.
+	T& back() {return buffers[1-frontIndex];}
+	//! Make the back state the one to draw.
+	void swap() {frontIndex = 1-frontIndex;}
+
+private:
+	T buffers[2];
+	int frontIndex;
+};
+
+#endif // _STELDOUBLEBUFFER_HPP_
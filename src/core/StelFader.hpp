@@ -38,6 +38,8 @@ public:
 	// Gets current switch state
 	virtual float getInterstate() const = 0;
 	virtual float getInterstatePercentage() const = 0;
+	// Gets whether a transition between the two states is in progress
+	virtual bool isFading() const {return false;}
 	// Switchors can be used just as bools
 	virtual StelFader& operator=(bool s) = 0;
 	bool operator==(bool s) const {return state==s;}
@@ -114,6 +116,7 @@ public:
 	// Get current switch state
 	float getInterstate() const { return interstate;}
 	float getInterstatePercentage() const {return 100.f * (interstate-minValue)/(maxValue-minValue);}
+	bool isFading() const {return isTransiting;}
 
 	// StelFaders can be used just as bools
 	StelFader& operator=(bool s)
@@ -200,6 +203,7 @@ public:
 	// Get current switch state
 	float getInterstate(void) const { return interstate;}
 	float getInterstatePercentage(void) const {return 100.f * (interstate-minValue)/(maxValue-minValue);}
+	bool isFading() const {return isTransiting;}
 
 	// StelFaders can be used just as bools
 	StelFader& operator=(bool s)
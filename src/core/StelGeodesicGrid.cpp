@@ -35,9 +35,18 @@ Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
 #include "StelGeodesicGrid.hpp"
 
 #include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 
+//! Quantization step of the searched caps, in radians
+static const double SEARCH_CACHE_STEP = 1./1024.;
+//! Maximum angle between a searched cap and its quantized version, in radians
+static const double SEARCH_CACHE_TOLERANCE = 2.*SEARCH_CACHE_STEP;
+//! Maximum number of zones kept in the search cache, all results included
+static const int SEARCH_CACHE_MAX_ZONES = 1<<20;
+
 static const float icosahedron_G = 0.5*(1.0+sqrt(5.0));
 static const float icosahedron_b = 1.0/sqrt(1.0+icosahedron_G*icosahedron_G);
 static const float icosahedron_a = icosahedron_b*icosahedron_G;
@@ -88,7 +97,8 @@ static const TopLevelTriangle icosahedron_triangles[20] =
         {{ 8, 9, 5}}  //  8
     };
 
-StelGeodesicGrid::StelGeodesicGrid(const int lev) : maxLevel(lev<0?0:lev), lastMaxSearchlevel(-1)
+StelGeodesicGrid::StelGeodesicGrid(const int lev)
+	: maxLevel(lev<0?0:lev), searchCache(SEARCH_CACHE_MAX_ZONES), searchCount(0), searchCacheHits(0), lastSearchTime(0.)
 {
 	if (maxLevel > 0)
 	{
@@ -112,7 +122,7 @@ StelGeodesicGrid::StelGeodesicGrid(const int lev) : maxLevel(lev<0?0:lev), lastM
 	{
 		triangles = 0;
 	}
-	cacheSearchResult = new GeodesicSearchResult(*this);
+	searchBuffer = new GeodesicSearchResult(*this);
 }
 
 StelGeodesicGrid::~StelGeodesicGrid(void)
@@ -122,8 +132,8 @@ StelGeodesicGrid::~StelGeodesicGrid(void)
 		for (int i=maxLevel-1;i>=0;i--) delete[] triangles[i];
 		delete[] triangles;
 	}
-	delete cacheSearchResult;
-	cacheSearchResult = NULL;
+	delete searchBuffer;
+	searchBuffer = NULL;
 }
 
 void StelGeodesicGrid::getTriangleCorners(int lev,int index,
@@ -312,17 +322,19 @@ int StelGeodesicGrid::getZoneNumberForPoint(const Vec3f &v,int searchLevel) cons
 
 // First iteration on the icosahedron base triangles
 void StelGeodesicGrid::searchZones(const QVector<SphericalCap>& convex,
+                               int innerOffset,
                                int **inside_list,int **border_list,
                                int maxSearchLevel) const
 {
 	if (maxSearchLevel < 0) maxSearchLevel = 0;
 	else if (maxSearchLevel > maxLevel) maxSearchLevel = maxLevel;
+	const int nrOfCaps = (innerOffset>0) ? innerOffset : convex.size();
 #if defined __STRICT_ANSI__ || !defined __GNUC__
-	int *halfs_used = new int[convex.size()];
+	int *halfs_used = new int[nrOfCaps];
 #else
-	int halfs_used[convex.size()];
+	int halfs_used[nrOfCaps];
 #endif
-	for (int h=0;h<(int)convex.size();h++) {halfs_used[h] = h;}
+	for (int h=0;h<nrOfCaps;h++) {halfs_used[h] = h;}
 #if defined __STRICT_ANSI__ || !defined __GNUC__
 	bool *corner_inside[12];
 	for(int ci=0; ci < 12; ci++) corner_inside[ci]= new bool[convex.size()];
@@ -340,7 +352,7 @@ void StelGeodesicGrid::searchZones(const QVector<SphericalCap>& convex,
 	for (int i=0;i<20;i++)
 	{
 		searchZones(0,i,
-		            convex,halfs_used,convex.size(),
+		            convex,innerOffset,halfs_used,nrOfCaps,
 		            corner_inside[icosahedron_triangles[i].corners[0]],
 		            corner_inside[icosahedron_triangles[i].corners[1]],
 		            corner_inside[icosahedron_triangles[i].corners[2]],
@@ -354,6 +366,7 @@ void StelGeodesicGrid::searchZones(const QVector<SphericalCap>& convex,
 
 void StelGeodesicGrid::searchZones(int lev,int index,
 								   const QVector<SphericalCap>&convex,
+                               const int innerOffset,
                                const int *indexOfUsedSphericalCaps,
                                const int halfSpacesUsed,
                                const bool *corner0_inside,
@@ -371,12 +384,13 @@ void StelGeodesicGrid::searchZones(int lev,int index,
 	for (int h=0;h<halfSpacesUsed;h++)
 	{
 		const int i = indexOfUsedSphericalCaps[h];
+		const int j = i+innerOffset;
 		if (!corner0_inside[i] && !corner1_inside[i] && !corner2_inside[i])
 		{
 			// totally outside this SphericalCap
 			return;
 		}
-		else if (corner0_inside[i] && corner1_inside[i] && corner2_inside[i])
+		else if (corner0_inside[j] && corner1_inside[j] && corner2_inside[j])
 		{
 			// totally inside this SphericalCap
 		}
@@ -419,21 +433,29 @@ void StelGeodesicGrid::searchZones(int lev,int index,
 				edge0_inside[i] = half_space.contains(t.e0);
 				edge1_inside[i] = half_space.contains(t.e1);
 				edge2_inside[i] = half_space.contains(t.e2);
+				if (innerOffset>0)
+				{
+					const int j = i+innerOffset;
+					const SphericalCap& inner_half_space(convex.at(j));
+					edge0_inside[j] = inner_half_space.contains(t.e0);
+					edge1_inside[j] = inner_half_space.contains(t.e1);
+					edge2_inside[j] = inner_half_space.contains(t.e2);
+				}
 			}
 			searchZones(lev,index+0,
-			            convex,halfs_used,halfs_used_count,
+			            convex,innerOffset,halfs_used,halfs_used_count,
 			            corner0_inside,edge2_inside,edge1_inside,
 			            inside_list,border_list,maxSearchLevel);
 			searchZones(lev,index+1,
-			            convex,halfs_used,halfs_used_count,
+			            convex,innerOffset,halfs_used,halfs_used_count,
 			            edge2_inside,corner1_inside,edge0_inside,
 			            inside_list,border_list,maxSearchLevel);
 			searchZones(lev,index+2,
-			            convex,halfs_used,halfs_used_count,
+			            convex,innerOffset,halfs_used,halfs_used_count,
 			            edge1_inside,edge0_inside,corner2_inside,
 			            inside_list,border_list,maxSearchLevel);
 			searchZones(lev,index+3,
-			            convex,halfs_used,halfs_used_count,
+			            convex,innerOffset,halfs_used,halfs_used_count,
 			            edge0_inside,edge1_inside,edge2_inside,
 			            inside_list,border_list,maxSearchLevel);
 #if defined __STRICT_ANSI__ || !defined __GNUC__
@@ -453,28 +475,104 @@ void StelGeodesicGrid::searchZones(int lev,int index,
 *************************************************************************/
 const GeodesicSearchResult* StelGeodesicGrid::search(const QVector<SphericalCap>& convex, int maxSearchLevel) const
 {
-	// Try to use the cached version
-	if (maxSearchLevel==lastMaxSearchlevel && convex==lastSearchRegion)
+	QElapsedTimer timer;
+	timer.start();
+	++searchCount;
+
+	QByteArray key;
+	QVector<SphericalCap> caps;
+	if (!getSearchKey(convex, maxSearchLevel, key, caps))
 	{
-		return cacheSearchResult;
+		searchBuffer->search(convex, 0, maxSearchLevel);
+		lastSearchTime = timer.nsecsElapsed()/1000000.;
+		return searchBuffer;
 	}
-	// Else recompute it and update cache parameters
-	lastMaxSearchlevel = maxSearchLevel;
-	lastSearchRegion = convex;
-	cacheSearchResult->search(convex, maxSearchLevel);
-	return cacheSearchResult;
+
+	// Try to use a cached version
+	const GeodesicSearchResult* cached = searchCache.object(key);
+	if (cached)
+	{
+		++searchCacheHits;
+		lastSearchTime = timer.nsecsElapsed()/1000000.;
+		return cached;
+	}
+
+	// Else compute it for the whole quantization cell, and keep a compact copy
+	searchBuffer->search(caps, convex.size(), maxSearchLevel);
+	GeodesicSearchResult* result = new GeodesicSearchResult(*searchBuffer);
+	searchCache.insert(key, result, qMax(1, result->getZoneCount()));
+	lastSearchTime = timer.nsecsElapsed()/1000000.;
+	return searchBuffer;
 }
 
+bool StelGeodesicGrid::getSearchKey(const QVector<SphericalCap>& convex, int maxSearchLevel, QByteArray& key, QVector<SphericalCap>& caps)
+{
+	const int n = convex.size();
+	QVector<qint32> keyData(1+4*n);
+	keyData[0] = maxSearchLevel;
+	caps.resize(2*n);
+	for (int h=0;h<n;h++)
+	{
+		const SphericalCap& cap = convex.at(h);
+		const double norm = cap.n.length();
+		if (norm<=0.)
+			return false;
+		const Vec3d dir = cap.n/norm;
+		const double radius = std::acos(qBound(-1., cap.d/norm, 1.));
+
+		// Quantize the direction and the angular radius of the cap
+		qint32* q = keyData.data()+1+4*h;
+		for (int i=0;i<3;i++)
+			q[i] = qRound(dir[i]/SEARCH_CACHE_STEP);
+		q[3] = qRound(radius/SEARCH_CACHE_STEP);
+		Vec3d qDir(q[0]*SEARCH_CACHE_STEP, q[1]*SEARCH_CACHE_STEP, q[2]*SEARCH_CACHE_STEP);
+		qDir.normalize();
+		const double qRadius = q[3]*SEARCH_CACHE_STEP;
+
+		// All the caps with the same key lie between the inner and outer caps
+		const double outerRadius = qRadius+SEARCH_CACHE_TOLERANCE;
+		const double innerRadius = qRadius-SEARCH_CACHE_TOLERANCE;
+		caps[h] = SphericalCap(qDir, outerRadius>=M_PI ? -2. : std::cos(outerRadius));
+		caps[n+h] = SphericalCap(qDir, innerRadius<=0. ? 2. : std::cos(innerRadius));
+	}
+	key = QByteArray((const char*)keyData.constData(), keyData.size()*sizeof(qint32));
+	return true;
+}
 
 GeodesicSearchResult::GeodesicSearchResult(const StelGeodesicGrid &grid)
 		:grid(grid),
 		zones(new int*[grid.getMaxLevel()+1]),
 		inside(new int*[grid.getMaxLevel()+1]),
-		border(new int*[grid.getMaxLevel()+1])
+		border(new int*[grid.getMaxLevel()+1]),
+		end(new int*[grid.getMaxLevel()+1])
 {
 	for (int i=0;i<=grid.getMaxLevel();i++)
 	{
 		zones[i] = new int[StelGeodesicGrid::nrOfZones(i)];
+		inside[i] = zones[i];
+		border[i] = zones[i]+StelGeodesicGrid::nrOfZones(i);
+		end[i] = border[i];
+	}
+}
+
+GeodesicSearchResult::GeodesicSearchResult(const GeodesicSearchResult &other)
+		:grid(other.grid),
+		zones(new int*[grid.getMaxLevel()+1]),
+		inside(new int*[grid.getMaxLevel()+1]),
+		border(new int*[grid.getMaxLevel()+1]),
+		end(new int*[grid.getMaxLevel()+1])
+{
+	for (int i=0;i<=grid.getMaxLevel();i++)
+	{
+		// The inside zones followed by the border zones, without the unused space between them
+		const int insideCount = other.inside[i]-other.zones[i];
+		const int borderCount = other.end[i]-other.border[i];
+		zones[i] = new int[insideCount+borderCount];
+		std::copy(other.zones[i], other.inside[i], zones[i]);
+		std::copy(other.border[i], other.end[i], zones[i]+insideCount);
+		inside[i] = zones[i]+insideCount;
+		border[i] = inside[i];
+		end[i] = border[i]+borderCount;
 	}
 }
 
@@ -484,19 +582,31 @@ GeodesicSearchResult::~GeodesicSearchResult(void)
 	{
 		delete[] zones[i];
 	}
+	delete[] end;
 	delete[] border;
 	delete[] inside;
 	delete[] zones;
 }
 
-void GeodesicSearchResult::search(const QVector<SphericalCap>& convex, int maxSearchLevel)
+int GeodesicSearchResult::getZoneCount(void) const
+{
+	int count = 0;
+	for (int i=0;i<=grid.getMaxLevel();i++)
+	{
+		count += (inside[i]-zones[i]) + (end[i]-border[i]);
+	}
+	return count;
+}
+
+void GeodesicSearchResult::search(const QVector<SphericalCap>& convex, int innerOffset, int maxSearchLevel)
 {
 	for (int i=grid.getMaxLevel();i>=0;i--)
 	{
 		inside[i] = zones[i];
 		border[i] = zones[i]+StelGeodesicGrid::nrOfZones(i);
+		end[i] = border[i];
 	}
-	grid.searchZones(convex,inside,border,maxSearchLevel);
+	grid.searchZones(convex,innerOffset,inside,border,maxSearchLevel);
 }
 
 void GeodesicSearchInsideIterator::reset(void)
@@ -37,6 +37,9 @@ Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
 
 #include "StelSphereGeometry.hpp"
 
+#include <QByteArray>
+#include <QCache>
+
 class GeodesicSearchResult;
 
 //! @class StelGeodesicGrid
@@ -77,10 +80,22 @@ public:
 	int getPartnerTriangle(int lev, int index) const;
 	
 	//! Return a search result matching the given spatial region
-	//! The result is cached, meaning that it is very fast to search the same region consecutively
-	//! @return a GeodesicSearchResult instance which must be used with GeodesicSearchBorderIterator and GeodesicSearchInsideIterator
+	//! The caps are quantized, and the result is computed for a region slightly larger than
+	//! the quantized caps, with inside zones taken from a region slightly smaller. It is therefore
+	//! valid for all the regions which quantize the same way, and the last results are cached.
+	//! Searching the same region again, or a region moved by less than the quantization step,
+	//! is thus very fast. The returned zones are a superset of the exact search.
+	//! @return a GeodesicSearchResult instance which must be used with GeodesicSearchBorderIterator and GeodesicSearchInsideIterator.
+	//! It remains valid until the next call to search().
 	const GeodesicSearchResult* search(const QVector<SphericalCap>& convex, int maxSearchLevel) const;
 
+	//! Return the number of calls to search() since the grid was created.
+	int getSearchCount() const {return searchCount;}
+	//! Return the number of calls to search() which were answered from the cache.
+	int getSearchCacheHits() const {return searchCacheHits;}
+	//! Return the duration of the last call to search() in milliseconds.
+	double getLastSearchTime() const {return lastSearchTime;}
+
 private:
 	friend class GeodesicSearchResult;
 	
@@ -99,7 +114,10 @@ private:
 	//! in inside[l1] for some l1 < l.
 	//! In order to restrict search depth set maxSearchLevel < maxLevel,
 	//! for full search depth set maxSearchLevel = maxLevel,
-	void searchZones(const QVector<SphericalCap>& convex,
+	//! When innerOffset is not 0, convex contains innerOffset outer caps followed by
+	//! the same number of inner caps, each inner cap lying inside the matching outer cap.
+	//! Zones are then rejected using the outer caps, and reported inside using the inner caps.
+	void searchZones(const QVector<SphericalCap>& convex, int innerOffset,
 					 int **inside,int **border,int maxSearchLevel) const;
 	
 	const Vec3f& getTriangleCorner(int lev, int index, int cornerNumber) const;
@@ -116,6 +134,7 @@ private:
 	                    void *context) const;
 	void searchZones(int lev,int index,
 	                 const QVector<SphericalCap>& convex,
+	                 const int innerOffset,
 	                 const int *indexOfUsedSphericalCaps,
 	                 const int halfSpacesUsed,
 	                 const bool *corner0_inside,
@@ -132,10 +151,17 @@ private:
 	// 20*(4^0+4^1+...+4^n)=20*(4*(4^n)-1)/3 triangles total
 	// 2+10*4^n corners
 	
-	//! A cached search result used to avoid doing twice the same search
-	mutable GeodesicSearchResult* cacheSearchResult;
-	mutable int lastMaxSearchlevel;
-	mutable QVector<SphericalCap> lastSearchRegion;
+	//! Compute the cache key of a search, and the outer and inner caps used for the search.
+	//! @return false if the caps can not be quantized.
+	static bool getSearchKey(const QVector<SphericalCap>& convex, int maxSearchLevel, QByteArray& key, QVector<SphericalCap>& caps);
+
+	//! Full size result used for the searches, before they are copied to the cache
+	mutable GeodesicSearchResult* searchBuffer;
+	//! The last search results, by quantized region, costing their number of zones
+	mutable QCache<QByteArray, GeodesicSearchResult> searchCache;
+	mutable int searchCount;
+	mutable int searchCacheHits;
+	mutable double lastSearchTime;
 };
 
 class GeodesicSearchResult
@@ -144,17 +170,25 @@ public:
 	GeodesicSearchResult(const StelGeodesicGrid &grid);
 	~GeodesicSearchResult(void);
 	void print(void) const;
+	//! Return the total number of zones found, at all levels.
+	int getZoneCount(void) const;
 private:
+	//! Copy the zones found by another result, allocating only the needed memory.
+	GeodesicSearchResult(const GeodesicSearchResult &other);
+
 	friend class GeodesicSearchInsideIterator;
 	friend class GeodesicSearchBorderIterator;
 	friend class StelGeodesicGrid;
 	
-	void search(const QVector<SphericalCap>& convex, int maxSearchLevel);
+	//! @param innerOffset see StelGeodesicGrid::searchZones().
+	void search(const QVector<SphericalCap>& convex, int innerOffset, int maxSearchLevel);
 	
 	const StelGeodesicGrid &grid;
 	int **const zones;
 	int **const inside;
 	int **const border;
+	//! One after the end of the zones of each level
+	int **const end;
 };
 
 class GeodesicSearchBorderIterator
@@ -163,8 +197,7 @@ public:
 	GeodesicSearchBorderIterator(const GeodesicSearchResult &ar,int alevel)
 		: r(ar),level((alevel<0)?0:(alevel>ar.grid.getMaxLevel())
 			             ?ar.grid.getMaxLevel():alevel),
-			end(ar.zones[GeodesicSearchBorderIterator::level]+
-			    StelGeodesicGrid::nrOfZones(GeodesicSearchBorderIterator::level))
+			end(ar.end[GeodesicSearchBorderIterator::level])
 	{reset();}
 	void reset(void) {index = r.border[level];}
 	int next(void) // returns -1 when finished
@@ -0,0 +1,272 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "StelGlyphAtlas.hpp"
+
+#include <QDebug>
+#include <QGlyphRun>
+#include <QImage>
+#include <QPainter>
+#include <QRawFont>
+#include <QTextLayout>
+
+#include <cmath>
+
+//! Maximum number of strings whose layout is cached
+static const int MAX_CACHED_LAYOUTS = 20000;
+//! Empty pixels around each glyph, avoiding bleeding between neighbours when filtering
+static const int GLYPH_PADDING = 1;
+
+void StelTextBatch::clear()
+{
+	for (QMap<int, Page>::iterator it = pages.begin(); it != pages.end(); ++it)
+	{
+		it.value().vertices.resize(0);
+		it.value().texCoords.resize(0);
+		it.value().colors.resize(0);
+	}
+	glyphCount = 0;
+}
+
+StelGlyphAtlas::StelGlyphAtlas() : layouts(MAX_CACHED_LAYOUTS), glInitialized(false)
+{
+}
+
+StelGlyphAtlas::~StelGlyphAtlas()
+{
+	if (glInitialized)
+	{
+		foreach (const Page& p, pages)
+		{
+			if (p.texture != 0)
+				glDeleteTextures(1, &p.texture);
+		}
+	}
+}
+
+void StelGlyphAtlas::addText(StelTextBatch& batch, const QFont& font, const QString& str, float x, float y, float angleDeg, const Vec4f& color)
+{
+	const QString key = font.key() + QChar('|') + str;
+	Layout* layout = layouts.object(key);
+	if (!layout)
+	{
+		layout = createLayout(font, str);
+		layouts.insert(key, layout, 1);
+	}
+
+	const bool rotated = std::fabs(angleDeg) > 1.f;
+	const float a = angleDeg*M_PI/180.;
+	const float c = rotated ? std::cos(a) : 1.f;
+	const float s = rotated ? std::sin(a) : 0.f;
+	if (!rotated)
+	{
+		// Keep unrotated text aligned on pixels for sharpness
+		x = std::floor(x + 0.5f);
+		y = std::floor(y + 0.5f);
+	}
+
+	for (int i=0; i<layout->size(); ++i)
+	{
+		const PlacedGlyph& g = layout->at(i);
+		if (g.glyph.page<0)
+			continue;
+
+		float left = g.pos.x() + g.glyph.rect.left();
+		float top = -(g.pos.y() + g.glyph.rect.top());
+		if (!rotated)
+		{
+			left = std::floor(left + 0.5f);
+			top = std::floor(top + 0.5f);
+		}
+		const float right = left + g.glyph.rect.width();
+		const float bottom = top - g.glyph.rect.height();
+
+		// Corners in window coordinates: top left, top right, bottom right, bottom left
+		const Vec3f tl(x + c*left - s*top, y + s*left + c*top, 0.f);
+		const Vec3f tr(x + c*right - s*top, y + s*right + c*top, 0.f);
+		const Vec3f br(x + c*right - s*bottom, y + s*right + c*bottom, 0.f);
+		const Vec3f bl(x + c*left - s*bottom, y + s*left + c*bottom, 0.f);
+		const QRectF& t = g.glyph.texRect;
+		const Vec2f ttl(t.left(), t.top()), ttr(t.right(), t.top()), tbr(t.right(), t.bottom()), tbl(t.left(), t.bottom());
+
+		StelTextBatch::Page& p = batch.pages[g.glyph.page];
+		p.vertices << tl << tr << br << tl << br << bl;
+		p.texCoords << ttl << ttr << tbr << ttl << tbr << tbl;
+		p.colors << color << color << color << color << color << color;
+		++batch.glyphCount;
+	}
+}
+
+StelGlyphAtlas::Layout* StelGlyphAtlas::createLayout(const QFont& font, const QString& str)
+{
+	Layout* layout = new Layout();
+
+	QTextLayout textLayout(str, font);
+	textLayout.setCacheEnabled(true);
+	textLayout.beginLayout();
+	QTextLine line = textLayout.createLine();
+	textLayout.endLayout();
+	if (!line.isValid())
+		return layout;
+	const qreal ascent = line.ascent();
+
+	foreach (const QGlyphRun& run, textLayout.glyphRuns())
+	{
+		const QRawFont rawFont = run.rawFont();
+		const QVector<quint32> indexes = run.glyphIndexes();
+		const QVector<QPointF> positions = run.positions();
+		for (int i=0; i<indexes.size(); ++i)
+		{
+			PlacedGlyph g;
+			if (!getGlyph(rawFont, indexes.at(i), g.glyph))
+				continue;
+			g.pos = QPointF(positions.at(i).x(), positions.at(i).y() - ascent);
+			layout->append(g);
+		}
+	}
+	return layout;
+}
+
+bool StelGlyphAtlas::getGlyph(const QRawFont& rawFont, quint32 glyphIndex, Glyph& glyph)
+{
+	const QString key = QString("%1|%2|%3|%4").arg(rawFont.familyName()).arg(rawFont.styleName()).arg(rawFont.pixelSize()).arg(glyphIndex);
+	QHash<QString, Glyph>::const_iterator it = glyphs.constFind(key);
+	if (it != glyphs.constEnd())
+	{
+		glyph = it.value();
+		return true;
+	}
+
+	const QRectF bounds = rawFont.boundingRect(glyphIndex);
+	if (bounds.isEmpty())
+	{
+		// Nothing to draw, e.g. a space
+		glyph.page = -1;
+		glyphs.insert(key, glyph);
+		return true;
+	}
+
+	const int width = (int)std::ceil(bounds.right()) - (int)std::floor(bounds.left()) + 2*GLYPH_PADDING;
+	const int height = (int)std::ceil(bounds.bottom()) - (int)std::floor(bounds.top()) + 2*GLYPH_PADDING;
+	if (width > pageSize || height > pageSize)
+	{
+		qWarning() << "StelGlyphAtlas: glyph too large for the atlas:" << width << "x" << height;
+		return false;
+	}
+
+	// Render the glyph in white, the color is given by the vertices
+	const QPointF origin(GLYPH_PADDING - std::floor(bounds.left()), GLYPH_PADDING - std::floor(bounds.top()));
+	QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::transparent);
+	{
+		QGlyphRun run;
+		run.setRawFont(rawFont);
+		run.setGlyphIndexes(QVector<quint32>() << glyphIndex);
+		run.setPositions(QVector<QPointF>() << QPointF(0., 0.));
+		QPainter painter(&image);
+		painter.setPen(Qt::white);
+		painter.drawGlyphRun(origin, run);
+	}
+
+	int x, y;
+	allocate(width, height, glyph.page, x, y);
+	Page& p = pages[glyph.page];
+	for (int j=0; j<height; ++j)
+	{
+		const QRgb* src = (const QRgb*)image.constScanLine(j);
+		char* dst = p.pixels.data() + 2*((y+j)*pageSize + x);
+		for (int i=0; i<width; ++i)
+			dst[2*i+1] = (char)qAlpha(src[i]);
+	}
+	p.dirty = true;
+
+	glyph.rect = QRectF(-origin.x(), -origin.y(), width, height);
+	glyph.texRect = QRectF((float)x/pageSize, (float)y/pageSize, (float)width/pageSize, (float)height/pageSize);
+	glyphs.insert(key, glyph);
+	return true;
+}
+
+void StelGlyphAtlas::allocate(int width, int height, int& page, int& x, int& y)
+{
+	if (!pages.isEmpty())
+	{
+		Page& p = pages.last();
+		if (p.shelfX + width > pageSize)
+		{
+			// Start a new shelf
+			p.shelfY += p.shelfHeight;
+			p.shelfX = 0;
+			p.shelfHeight = 0;
+		}
+		if (p.shelfY + height <= pageSize)
+		{
+			page = pages.size()-1;
+			x = p.shelfX;
+			y = p.shelfY;
+			p.shelfX += width;
+			p.shelfHeight = qMax(p.shelfHeight, height);
+			return;
+		}
+	}
+
+	// The glyphs already queued refer to the existing pages, so they are never reused
+	Page p;
+	p.pixels = QByteArray(2*pageSize*pageSize, (char)0);
+	for (int i=0; i<pageSize*pageSize; ++i)
+		p.pixels[2*i] = (char)255;
+	p.texture = 0;
+	p.dirty = true;
+	p.shelfX = width;
+	p.shelfY = 0;
+	p.shelfHeight = height;
+	pages.append(p);
+	page = pages.size()-1;
+	x = 0;
+	y = 0;
+}
+
+void StelGlyphAtlas::bindPage(int page)
+{
+	if (!glInitialized)
+	{
+		initializeOpenGLFunctions();
+		glInitialized = true;
+	}
+	Page& p = pages[page];
+	if (p.texture == 0)
+	{
+		glGenTextures(1, &p.texture);
+		glBindTexture(GL_TEXTURE_2D, p.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	else
+	{
+		glBindTexture(GL_TEXTURE_2D, p.texture);
+	}
+	if (p.dirty)
+	{
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, pageSize, pageSize, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, p.pixels.constData());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		p.dirty = false;
+	}
+}
@@ -0,0 +1,147 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _STELGLYPHATLAS_HPP_
+#define _STELGLYPHATLAS_HPP_
+
+#include "VecMath.hpp"
+
+#include <QByteArray>
+#include <QCache>
+#include <QFont>
+#include <QHash>
+#include <QMap>
+#include <QOpenGLFunctions>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+
+class QRawFont;
+
+//! Text quads waiting to be drawn, grouped by atlas page.
+//! Each glyph is made of 2 triangles, i.e. 6 vertices, in window coordinates.
+class StelTextBatch
+{
+public:
+	struct Page
+	{
+		QVector<Vec3f> vertices;
+		QVector<Vec2f> texCoords;
+		QVector<Vec4f> colors;
+	};
+
+	bool isEmpty() const {return glyphCount==0;}
+	//! Return the number of glyphs in the batch.
+	int size() const {return glyphCount;}
+	//! Empty the batch, keeping the allocated memory for the next frame.
+	void clear();
+	//! Return the quads, by atlas page.
+	const QMap<int, Page>& getPages() const {return pages;}
+
+	StelTextBatch() : glyphCount(0) {;}
+
+private:
+	friend class StelGlyphAtlas;
+	QMap<int, Page> pages;
+	int glyphCount;
+};
+
+//! @class StelGlyphAtlas
+//! Cache of rendered glyphs used to draw text with textured quads.
+//! The text is shaped once with QTextLayout, so that complex scripts and font
+//! fallbacks are handled by Qt, then each glyph of each font and pixel size is
+//! rendered once into a page of the atlas. The resulting layouts are cached by
+//! font and string, so that drawing a label already seen only costs a lookup
+//! and the computation of its quads.
+//! The pages are stored in memory as luminance/alpha textures and uploaded to
+//! OpenGL when they are bound after new glyphs were added.
+class StelGlyphAtlas : protected QOpenGLFunctions
+{
+public:
+	StelGlyphAtlas();
+	~StelGlyphAtlas();
+
+	//! Add the quads of a string to the batch.
+	//! @param batch the batch receiving the quads.
+	//! @param font the font, whose pixel size must be set.
+	//! @param str the text.
+	//! @param x horizontal position of the start of the baseline, in window coordinates.
+	//! @param y vertical position of the start of the baseline, in window coordinates (upward).
+	//! @param angleDeg counterclockwise rotation around x,y in degrees.
+	//! @param color the color of the text.
+	void addText(StelTextBatch& batch, const QFont& font, const QString& str, float x, float y, float angleDeg, const Vec4f& color);
+
+	//! Bind the OpenGL texture of a page, uploading it first if needed.
+	//! Requires a current OpenGL context.
+	void bindPage(int page);
+
+	//! Return the number of pages currently allocated.
+	int getPageCount() const {return pages.size();}
+	//! Return the number of different glyphs in the atlas.
+	int getGlyphCount() const {return glyphs.size();}
+
+	//! Size of the pages in pixels.
+	static const int pageSize = 1024;
+
+private:
+	//! A glyph rendered in the atlas.
+	struct Glyph
+	{
+		int page;
+		//! Position of the glyph image relative to the glyph origin, in pixels, y downward.
+		QRectF rect;
+		//! Texture coordinates of the glyph image in the page.
+		QRectF texRect;
+	};
+
+	//! A glyph of a shaped string.
+	struct PlacedGlyph
+	{
+		Glyph glyph;
+		//! Position of the glyph origin relative to the start of the baseline, in pixels, y downward.
+		QPointF pos;
+	};
+
+	typedef QVector<PlacedGlyph> Layout;
+
+	struct Page
+	{
+		//! 2 bytes per pixel: luminance, always 255, and alpha.
+		QByteArray pixels;
+		unsigned int texture;
+		bool dirty;
+		//! Shelf packing state
+		int shelfX, shelfY, shelfHeight;
+	};
+
+	//! Shape the string and render the glyphs which are not in the atlas yet.
+	Layout* createLayout(const QFont& font, const QString& str);
+	//! Find the glyph in the atlas, rendering it if needed.
+	//! @return false if the glyph is too large for a page.
+	bool getGlyph(const QRawFont& rawFont, quint32 glyphIndex, Glyph& glyph);
+	//! Reserve space for an image of the given size.
+	void allocate(int width, int height, int& page, int& x, int& y);
+
+	QVector<Page> pages;
+	QHash<QString, Glyph> glyphs;
+	QCache<QString, Layout> layouts;
+	bool glInitialized;
+};
+
+#endif // _STELGLYPHATLAS_HPP_
@@ -0,0 +1,181 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "StelJsonCatalog.hpp"
+#include "StelJsonParser.hpp"
+#include "StelFileMgr.hpp"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <stdexcept>
+
+//! Identifies the snapshot files, "SJCS"
+static const quint32 SNAPSHOT_MAGIC = 0x534a4353;
+//! To be incremented when the snapshot format changes
+static const quint32 SNAPSHOT_VERSION = 1;
+
+QByteArray StelJsonCatalog::memoryHash;
+QVariantMap StelJsonCatalog::memoryMap;
+
+QVariantMap StelJsonCatalog::load(const QString& path, bool* ok)
+{
+	if (ok)
+		*ok = false;
+
+	QFile jsonFile(path);
+	if (!jsonFile.open(QIODevice::ReadOnly))
+	{
+		qWarning() << "StelJsonCatalog: cannot open" << QDir::toNativeSeparators(path);
+		return QVariantMap();
+	}
+	const QByteArray data = jsonFile.readAll();
+	jsonFile.close();
+
+	// Hashing is much faster than parsing, so the file content is always checked
+	const QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Md5);
+	if (hash == memoryHash)
+	{
+		if (ok)
+			*ok = true;
+		return memoryMap;
+	}
+
+	QVariantMap map;
+	const QString snapshotPath = getSnapshotPath(path);
+	if (!readSnapshot(snapshotPath, hash, map))
+	{
+		try
+		{
+			map = StelJsonParser::parse(data).toMap();
+		}
+		catch (std::runtime_error& e)
+		{
+			qWarning() << "StelJsonCatalog: cannot parse" << QDir::toNativeSeparators(path) << "Error:" << e.what();
+			return QVariantMap();
+		}
+		writeSnapshot(snapshotPath, hash, map);
+	}
+
+	memoryHash = hash;
+	memoryMap = map;
+	if (ok)
+		*ok = true;
+	return map;
+}
+
+int StelJsonCatalog::getFormatVersion(const QString& path)
+{
+	bool ok;
+	const QVariantMap map = load(path, &ok);
+	if (!ok || !map.contains("version"))
+		return -1;
+	return map.value("version").toInt();
+}
+
+bool StelJsonCatalog::readRecords(const QString& path, StelJsonRecordVisitor& visitor)
+{
+	QFile jsonFile(path);
+	if (!jsonFile.open(QIODevice::ReadOnly))
+	{
+		qWarning() << "StelJsonCatalog: cannot open" << QDir::toNativeSeparators(path);
+		return false;
+	}
+
+	if (!memoryHash.isEmpty())
+	{
+		QCryptographicHash hash(QCryptographicHash::Md5);
+		hash.addData(&jsonFile);
+		if (hash.result() == memoryHash)
+		{
+			visitor.replay(memoryMap);
+			return true;
+		}
+		jsonFile.seek(0);
+	}
+
+	try
+	{
+		StelJsonParser::parse(&jsonFile, visitor);
+	}
+	catch (std::runtime_error& e)
+	{
+		qWarning() << "StelJsonCatalog: cannot parse" << QDir::toNativeSeparators(path) << "Error:" << e.what();
+		return false;
+	}
+	return true;
+}
+
+void StelJsonCatalog::clearMemoryCache()
+{
+	memoryHash.clear();
+	memoryMap.clear();
+}
+
+QString StelJsonCatalog::getSnapshotPath(const QString& path)
+{
+	// One snapshot per catalog file, so that updated catalogs replace their old snapshot
+	const QByteArray pathHash = QCryptographicHash::hash(QFileInfo(path).absoluteFilePath().toUtf8(), QCryptographicHash::Md5);
+	return StelFileMgr::getCacheDir() + "/jsoncatalogs/" + QString(pathHash.toHex()) + ".dat";
+}
+
+bool StelJsonCatalog::readSnapshot(const QString& snapshotPath, const QByteArray& hash, QVariantMap& map)
+{
+	QFile snapshotFile(snapshotPath);
+	if (!snapshotFile.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream in(&snapshotFile);
+	in.setVersion(QDataStream::Qt_5_1);
+	quint32 magic, version;
+	QByteArray snapshotHash;
+	in >> magic >> version >> snapshotHash;
+	if (in.status()!=QDataStream::Ok || magic!=SNAPSHOT_MAGIC || version!=SNAPSHOT_VERSION || snapshotHash!=hash)
+		return false;
+
+	in >> map;
+	if (in.status()!=QDataStream::Ok)
+	{
+		qWarning() << "StelJsonCatalog: ignoring corrupted snapshot" << QDir::toNativeSeparators(snapshotPath);
+		map.clear();
+		return false;
+	}
+	return true;
+}
+
+void StelJsonCatalog::writeSnapshot(const QString& snapshotPath, const QByteArray& hash, const QVariantMap& map)
+{
+	// The cache is only an optimization: failures are not errors
+	if (!QDir().mkpath(QFileInfo(snapshotPath).absolutePath()))
+		return;
+	QFile snapshotFile(snapshotPath);
+	if (!snapshotFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return;
+
+	QDataStream out(&snapshotFile);
+	out.setVersion(QDataStream::Qt_5_1);
+	out << SNAPSHOT_MAGIC << SNAPSHOT_VERSION << hash << map;
+	snapshotFile.close();
+	if (out.status()!=QDataStream::Ok)
+		snapshotFile.remove();
+}
@@ -0,0 +1,74 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _STELJSONCATALOG_HPP_
+#define _STELJSONCATALOG_HPP_
+
+#include <QByteArray>
+#include <QString>
+#include <QVariantMap>
+
+class StelJsonRecordVisitor;
+
+//! @class StelJsonCatalog
+//! Load the JSON catalog files of plugins, parsing each file at most once.
+//! The last parsed document is kept in memory, so that checking the format,
+//! reading the version and loading the objects share a single parse.
+//! A binary snapshot of the document is also saved in the cache directory,
+//! together with the MD5 hash of the JSON file it was made from. When the
+//! hash of the file still matches, the next starts deserialize the snapshot
+//! instead of parsing the JSON.
+//! All the methods must be called from the main thread.
+class StelJsonCatalog
+{
+public:
+	//! Load a JSON catalog file.
+	//! @param path the full path of the JSON file.
+	//! @param ok if not NULL, set to true if the file was read and parsed successfully.
+	//! @return the root object of the document, or an empty map in case of error.
+	static QVariantMap load(const QString& path, bool* ok=NULL);
+
+	//! Get the value of the "version" key of the root object of a JSON catalog file.
+	//! @return the version, or -1 if the file can not be loaded or has no version.
+	static int getFormatVersion(const QString& path);
+
+	//! Pass the records of a JSON catalog file to a visitor.
+	//! When the file is the document kept in memory, its content is replayed.
+	//! Otherwise the file is parsed progressively, without building the document,
+	//! so that the memory used does not depend on the size of the catalog.
+	//! @return true if the file was read and parsed successfully.
+	static bool readRecords(const QString& path, StelJsonRecordVisitor& visitor);
+
+	//! Release the document kept in memory.
+	//! Called once the plugins are initialized.
+	static void clearMemoryCache();
+
+private:
+	//! Get the path of the binary snapshot for the given JSON file.
+	static QString getSnapshotPath(const QString& path);
+	//! Read the snapshot if it was made from a file with the given hash.
+	static bool readSnapshot(const QString& snapshotPath, const QByteArray& hash, QVariantMap& map);
+	static void writeSnapshot(const QString& snapshotPath, const QByteArray& hash, const QVariantMap& map);
+
+	//! Hash of the file content of the document kept in memory.
+	static QByteArray memoryHash;
+	static QVariantMap memoryMap;
+};
+
+#endif // _STELJSONCATALOG_HPP_
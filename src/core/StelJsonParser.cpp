@@ -20,8 +20,257 @@
 #include <QDebug>
 #include <QBuffer>
 #include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QVector>
 #include <stdexcept>
 #include <stdio.h>
+#include <string.h>
+
+//! Characters ending the values which are not strings, objects or arrays
+static inline bool isValueDelimiter(char c)
+{
+	return c==' ' || c==',' || c=='\n' || c=='\r' || c==']' || c=='\t' || c=='}';
+}
+
+//! Find the first '"' or '\' character of a string.
+//! The characters are checked 8 at a time, see "Determine if a word has a byte equal to n" in Bit Twiddling Hacks.
+static inline const char* findQuoteOrBackslash(const char* p, const char* end)
+{
+	const quint64 ones = Q_UINT64_C(0x0101010101010101);
+	const quint64 highBits = Q_UINT64_C(0x8080808080808080);
+	const quint64 quotes = ones*'"';
+	const quint64 backslashes = ones*'\\';
+	while (end-p >= 8)
+	{
+		quint64 w;
+		memcpy(&w, p, 8);
+		const quint64 q = w ^ quotes;
+		const quint64 b = w ^ backslashes;
+		if ((((q-ones) & ~q) | ((b-ones) & ~b)) & highBits)
+			break;
+		p += 8;
+	}
+	while (p<end && *p!='"' && *p!='\\')
+		++p;
+	return p;
+}
+
+//! Convert the usual numbers without going through QByteArray conversions.
+//! Only the cases giving exactly the same result are handled: the integers fitting in 9 digits,
+//! and the decimal numbers of at most 15 significant digits multiplied by a power of ten
+//! which is exactly represented, for which a single rounding is done.
+//! @return 0 if the number must be converted by the general method, 1 for an int, 2 for a double.
+static inline int fastNumber(const char* s, int n, int& i, double& d)
+{
+	static const double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const char* p = s;
+	const char* end = s+n;
+	const bool negative = (p<end && *p=='-');
+	if (negative)
+		++p;
+	const char* digits = p;
+	qint64 mantissa = 0;
+	int significantDigits = 0;
+	while (p<end && *p>='0' && *p<='9')
+	{
+		mantissa = mantissa*10 + (*p-'0');
+		if (mantissa!=0 && ++significantDigits>15)
+			return 0;
+		++p;
+	}
+	const int intDigits = p-digits;
+	if (intDigits==0)
+		return 0;
+	if (p==end)
+	{
+		if (intDigits>9)
+			return 0;
+		i = negative ? -(int)mantissa : (int)mantissa;
+		return 1;
+	}
+
+	int exponent = 0;
+	if (*p=='.')
+	{
+		++p;
+		const char* decimals = p;
+		while (p<end && *p>='0' && *p<='9')
+		{
+			mantissa = mantissa*10 + (*p-'0');
+			if (mantissa!=0 && ++significantDigits>15)
+				return 0;
+			++p;
+		}
+		if (p==decimals)
+			return 0;
+		exponent = -(p-decimals);
+	}
+	if (p<end && (*p=='e' || *p=='E'))
+	{
+		++p;
+		const bool negativeExponent = (p<end && *p=='-');
+		if (p<end && (*p=='-' || *p=='+'))
+			++p;
+		const char* exponentDigits = p;
+		int e = 0;
+		while (p<end && *p>='0' && *p<='9' && e<1000)
+		{
+			e = e*10 + (*p-'0');
+			++p;
+		}
+		if (p==exponentDigits)
+			return 0;
+		exponent += negativeExponent ? -e : e;
+	}
+	if (p!=end || exponent<-22 || exponent>22)
+		return 0;
+	d = (double)mantissa;
+	d = exponent<0 ? d/powersOf10[-exponent] : d*powersOf10[exponent];
+	if (negative)
+		d = -d;
+	return 2;
+}
+
+//! Convert a value which is not a string, an object or an array, and pass it to the handler.
+template <class Handler>
+static void convertOther(const char* s, int size, Handler& handler)
+{
+	int i;
+	double d;
+	switch (fastNumber(s, size, i, d))
+	{
+		case 1:
+			handler.intValue(i);
+			return;
+		case 2:
+			handler.doubleValue(d);
+			return;
+	}
+
+	const QByteArray str = QByteArray::fromRawData(s, size);
+	bool ok;
+	i = str.toInt(&ok);
+	if (ok)
+	{
+		handler.intValue(i);
+		return;
+	}
+	d = str.toDouble(&ok);
+	if (ok)
+	{
+		handler.doubleValue(d);
+		return;
+	}
+	if (str=="true")
+	{
+		handler.boolValue(true);
+		return;
+	}
+	if (str=="false")
+	{
+		handler.boolValue(false);
+		return;
+	}
+	if (str=="null")
+	{
+		handler.nullValue();
+		return;
+	}
+	const QDateTime dt = QDateTime::fromString(QString::fromLatin1(s, size), Qt::ISODate);
+	if (dt.isValid())
+	{
+		handler.dateTimeValue(dt);
+		return;
+	}
+	throw std::runtime_error(qPrintable(QString("Invalid JSON value: \"")+QString::fromUtf8(s, size)+"\""));
+}
+
+//! Build the QVariant returned by StelJsonParser::parse() from the parsing events.
+class StelJsonVariantBuilder
+{
+public:
+	StelJsonVariantBuilder() : depth(0) {;}
+
+	//! Return the number of objects and arrays being built. The result is complete when it is 0.
+	int getDepth() const {return depth;}
+
+	void startObject()
+	{
+		push(true);
+	}
+	void endObject()
+	{
+		Container& c = containers[--depth];
+		const QVariant v(c.map);
+		// Release the map, so that the copy in the parent is not shared
+		c.map = QVariantMap();
+		addValue(v);
+	}
+	void startArray()
+	{
+		push(false);
+	}
+	void endArray()
+	{
+		Container& c = containers[--depth];
+		const QVariant v(c.list);
+		c.list = QVariantList();
+		addValue(v);
+	}
+	void key(const char* str, int size)
+	{
+		// The same names are used by all the objects of a file, so their QString is shared
+		QHash<QByteArray, QString>::const_iterator it = keys.constFind(QByteArray::fromRawData(str, size));
+		if (it==keys.constEnd())
+			it = keys.insert(QByteArray(str, size), QString::fromUtf8(str, size));
+		containers[depth-1].key = it.value();
+	}
+	void stringValue(const char* str, int size) {addValue(QString::fromUtf8(str, size));}
+	void intValue(int v) {addValue(v);}
+	void doubleValue(double v) {addValue(v);}
+	void boolValue(bool v) {addValue(QVariant(v));}
+	void nullValue() {addValue(QVariant());}
+	void dateTimeValue(const QDateTime& v) {addValue(QVariant(v));}
+
+	QVariant result;
+
+private:
+	struct Container
+	{
+		bool isObject;
+		QVariantMap map;
+		QVariantList list;
+		QString key;
+	};
+
+	void push(bool isObject)
+	{
+		// The containers are reused from a value to the next
+		if (depth==containers.size())
+			containers.append(Container());
+		containers[depth++].isObject = isObject;
+	}
+
+	void addValue(const QVariant& v)
+	{
+		if (depth==0)
+		{
+			result = v;
+			return;
+		}
+		Container& c = containers[depth-1];
+		if (c.isObject)
+			c.map.insert(c.key, v);
+		else
+			c.list.append(v);
+	}
+
+	QVector<Container> containers;
+	int depth;
+	QHash<QByteArray, QString> keys;
+};
 
 class StelJsonParserInstance
 {
@@ -35,8 +284,19 @@ public:
 	inline bool tryReadChar(char c);
 	inline bool skipAndConsumeChar(char r);
 	QByteArray readString();
-	QVariant readOther();
-	QVariant parse();
+
+	//! Read the next value, passing it to the handler.
+	//! Nothing is passed at the end of the input.
+	template <class Handler> void parse(Handler& handler);
+
+	//! Read the next value.
+	//! @return the value, or an invalid QVariant at the end of the input.
+	QVariant parse()
+	{
+		StelJsonVariantBuilder builder;
+		parse(builder);
+		return builder.result;
+	}
 
 private:
 	QIODevice* input;
@@ -103,6 +363,8 @@ private:
 	{
 		return cur==buffer-1;
 	}
+
+	template <class Handler> void readOther(Handler& handler);
 };
 
 void StelJsonParserInstance::skipJson()
@@ -220,56 +482,44 @@ QByteArray StelJsonParserInstance::readString()
 	return "";
 }
 
-QVariant StelJsonParserInstance::readOther()
+template <class Handler>
+void StelJsonParserInstance::readOther(Handler& handler)
 {
 	QByteArray str;
 	char c;
 	while (getChar(&c))
 	{
-		if (c==' ' || c==',' || c=='\n' || c=='\r' || c==']' || c=='\t' || c=='}')
+		if (isValueDelimiter(c))
 		{
 			ungetChar(c);
 			break;
 		}
 		str+=c;
 	}
-	bool ok;
-	const int i = str.toInt(&ok);
-	if (ok)
-		return i;
-	const double d = str.toDouble(&ok);
-	if (ok)
-		return d;
-	if (str=="true")
-		return QVariant(true);
-	if (str=="false")
-		return QVariant(false);
-	if (str=="null")
-		return QVariant();
-	QDateTime dt = QDateTime::fromString(str, Qt::ISODate);
-	if (dt.isValid())
-		return QVariant(dt);
-
-	throw std::runtime_error(qPrintable(QString("Invalid JSON value: \"")+str+"\""));
+	convertOther(str.constData(), str.size(), handler);
 }
 
 // Parse the given input stream
-QVariant StelJsonParserInstance::parse()
+template <class Handler>
+void StelJsonParserInstance::parse(Handler& handler)
 {
 	skipJson();
 
 	char r;
 	if (!getChar(&r))
-		return QVariant();
+		return;
 
 	switch (r)
 	{
 		case '{':
 		{
 			// We've got an object (a tuple)
-			QVariantMap map;
+			handler.startObject();
 			if (skipAndConsumeChar('}'))
-				return map;
+			{
+				handler.endObject();
+				return;
+			}
 			for (;;)
 			{
 				if (!skipAndConsumeChar('\"'))
@@ -279,29 +529,33 @@ QVariant StelJsonParserInstance::parse()
 					throw std::runtime_error(qPrintable(QString("Expected '\"' at beginning of string, found: '%1' (ASCII %2)").arg(cc).arg((int)(cc))));
 				}
 				const QByteArray& ar = readString();
-				const QString& key = QString::fromUtf8(ar.constData(), ar.size());
 				if (!skipAndConsumeChar(':'))
-					throw std::runtime_error(qPrintable(QString("Expected ':' after a member name: ")+key));
+					throw std::runtime_error(qPrintable(QString("Expected ':' after a member name: ")+QString::fromUtf8(ar.constData(), ar.size())));
+				handler.key(ar.constData(), ar.size());
 
 				skipJson();
-				map.insert(key, parse());
+				parse(handler);
 				if (!skipAndConsumeChar(','))
 					break;
 			}
 			if (!skipAndConsumeChar('}'))
 				throw std::runtime_error("Expected '}' to close an object");
-			return map;
+			handler.endObject();
+			return;
 		}
 		case '[':
 		{
 			// We've got an array (a vector)
-			QVariantList list;
+			handler.startArray();
 			if (skipAndConsumeChar(']'))
-				return list;
+			{
+				handler.endArray();
+				return;
+			}
 
 			for (;;)
 			{
-				list.append(parse());
+				parse(handler);
 				if (!skipAndConsumeChar(','))
 					break;
 			}
@@ -309,20 +563,262 @@ QVariant StelJsonParserInstance::parse()
 			if (!skipAndConsumeChar(']'))
 				throw std::runtime_error("Expected ']' to close an array");
 
-			return list;
+			handler.endArray();
+			return;
 		}
 		case '\"':
 		{
 			// We've got a string
 			const QByteArray& ar = readString();
-			return QString::fromUtf8(ar.constData(), ar.size());
+			handler.stringValue(ar.constData(), ar.size());
+			return;
 		}
 		default:
 		{
 			ungetChar(r);
-			return readOther();
+			readOther(handler);
+		}
+	}
+}
+
+//! Parse a JSON document held in memory, passing its content to a handler.
+//! The handler is either a StelJsonVisitor or a class with the same methods,
+//! so that building a QVariant does not go through virtual calls.
+//! The strings are only copied when they contain escape sequences.
+template <class Handler>
+class StelJsonBufferParser
+{
+public:
+	StelJsonBufferParser(const char* data, qint64 size, Handler& ahandler) : cur(data), end(data+size), handler(ahandler) {;}
+
+	//! Parse the first value of the buffer.
+	//! @return false if the buffer contains no value.
+	bool parseDocument()
+	{
+		skipWhitespace();
+		if (cur==end)
+			return false;
+		parseValue();
+		return true;
+	}
+
+	//! Return the position just after the parsed value.
+	const char* position() const {return cur;}
+
+private:
+	void skipWhitespace()
+	{
+		while (cur<end)
+		{
+			switch (*cur)
+			{
+				case ' ':
+				case '\t':
+				case '\n':
+				case '\r':
+					++cur;
+					break;
+				case '/':
+				{
+					if (cur+1==end || cur[1]!='/')
+						throw std::runtime_error(qPrintable(QString("Unexpected '/%1' in the JSON content").arg(cur+1==end ? ' ' : cur[1])));
+					const char* eol = (const char*)memchr(cur, '\n', end-cur);
+					cur = eol ? eol+1 : end;
+					break;
+				}
+				default:
+					return;
+			}
+		}
+	}
+
+	//! Skip the whitespace and consume the next character if it is c.
+	bool skipAndConsumeChar(char c)
+	{
+		skipWhitespace();
+		if (cur<end && *cur==c)
+		{
+			++cur;
+			return true;
+		}
+		return false;
+	}
+
+	void parseValue()
+	{
+		skipWhitespace();
+		if (cur==end)
+			throw std::runtime_error("Unexpected end of the JSON content");
+		switch (*cur)
+		{
+			case '{':
+				++cur;
+				parseObject();
+				break;
+			case '[':
+				++cur;
+				parseArray();
+				break;
+			case '"':
+			{
+				++cur;
+				const char* str;
+				int size;
+				readString(str, size);
+				handler.stringValue(str, size);
+				break;
+			}
+			default:
+				readOther();
+		}
+	}
+
+	void parseObject()
+	{
+		handler.startObject();
+		if (!skipAndConsumeChar('}'))
+		{
+			for (;;)
+			{
+				if (!skipAndConsumeChar('"'))
+				{
+					const char cc = cur<end ? *cur : 0;
+					throw std::runtime_error(qPrintable(QString("Expected '\"' at beginning of string, found: '%1' (ASCII %2)").arg(cc).arg((int)(cc))));
+				}
+				const char* str;
+				int size;
+				readString(str, size);
+				if (!skipAndConsumeChar(':'))
+					throw std::runtime_error(qPrintable(QString("Expected ':' after a member name: ")+QString::fromUtf8(str, size)));
+				handler.key(str, size);
+				parseValue();
+				if (!skipAndConsumeChar(','))
+					break;
+			}
+			if (!skipAndConsumeChar('}'))
+				throw std::runtime_error("Expected '}' to close an object");
 		}
+		handler.endObject();
 	}
+
+	void parseArray()
+	{
+		handler.startArray();
+		if (!skipAndConsumeChar(']'))
+		{
+			for (;;)
+			{
+				parseValue();
+				if (!skipAndConsumeChar(','))
+					break;
+			}
+			if (!skipAndConsumeChar(']'))
+				throw std::runtime_error("Expected ']' to close an array");
+		}
+		handler.endArray();
+	}
+
+	//! Read a string without the initial ".
+	//! @param str set to the string, which points either in the buffer, or in escapedString when it contains escape sequences.
+	void readString(const char*& str, int& size)
+	{
+		const char* start = cur;
+		const char* p = findQuoteOrBackslash(cur, end);
+		if (p<end && *p=='"')
+		{
+			str = start;
+			size = p-start;
+			cur = p+1;
+			return;
+		}
+
+		escapedString.resize(0);
+		escapedString.append(start, p-start);
+		cur = p;
+		while (cur<end)
+		{
+			char c = *cur++;
+			if (c=='"')
+			{
+				str = escapedString.constData();
+				size = escapedString.size();
+				return;
+			}
+			if (c=='\\')
+			{
+				if (cur==end)
+					break;
+				c = *cur++;
+				if (c=='b') c='\b';
+				if (c=='f') c='\f';
+				if (c=='n') c='\n';
+				if (c=='r') c='\r';
+				if (c=='t') c='\t';
+				if (c=='u') {qWarning() << "don't support \\uxxxx char"; continue;}
+			}
+			escapedString += c;
+		}
+		throw std::runtime_error(qPrintable(QString("End of file before end of string: ")+QString::fromUtf8(escapedString)));
+	}
+
+	void readOther()
+	{
+		const char* start = cur;
+		while (cur<end && !isValueDelimiter(*cur))
+			++cur;
+		convertOther(start, cur-start, handler);
+	}
+
+	const char* cur;
+	const char* end;
+	Handler& handler;
+	//! The last string containing escape sequences
+	QByteArray escapedString;
+};
+
+//! Parse the content of a device, in place when it is a buffer or a file which can be mapped in memory.
+//! The other devices are parsed progressively, so that only a part of their content is in memory.
+template <class Handler>
+static void parseDevice(QIODevice* input, Handler& handler)
+{
+	const qint64 pos = input->pos();
+	QBuffer* buffer = qobject_cast<QBuffer*>(input);
+	QFile* file = qobject_cast<QFile*>(input);
+	uchar* mapped = NULL;
+	const char* data;
+	qint64 size;
+	if (buffer)
+	{
+		data = buffer->data().constData() + pos;
+		size = buffer->data().size() - pos;
+	}
+	else if (file && !file->isSequential() && file->size()>pos && (mapped = file->map(pos, file->size()-pos)))
+	{
+		data = (const char*)mapped;
+		size = file->size() - pos;
+	}
+	else
+	{
+		StelJsonParserInstance parser(input);
+		parser.parse(handler);
+		return;
+	}
+
+	StelJsonBufferParser<Handler> parser(data, size, handler);
+	try
+	{
+		parser.parseDocument();
+	}
+	catch (std::runtime_error&)
+	{
+		if (mapped)
+			file->unmap(mapped);
+		throw;
+	}
+	if (mapped)
+		file->unmap(mapped);
+	if (!input->isSequential())
+		input->seek(pos + (parser.position()-data));
 }
 
 QHash<int, void (*)(const QVariant&, QIODevice*, int)> StelJsonParser::otherSerializer;
@@ -442,18 +938,28 @@ QByteArray StelJsonParser::write(const QVariant& jsonObject, int indentLevel)
 
 QVariant StelJsonParser::parse(QIODevice* input)
 {
-	StelJsonParserInstance parser(input);
-	return parser.parse();
+	StelJsonVariantBuilder builder;
+	parseDevice(input, builder);
+	return builder.result;
 }
 
-QVariant StelJsonParser::parse(const QByteArray& aar)
+QVariant StelJsonParser::parse(const QByteArray& input)
 {
-	QByteArray ar = aar;
-	QBuffer buf(&ar);
-	buf.open(QIODevice::ReadOnly);
-	QVariant v = StelJsonParser::parse(&buf);
-	buf.close();
-	return v;
+	StelJsonVariantBuilder builder;
+	StelJsonBufferParser<StelJsonVariantBuilder> parser(input.constData(), input.size(), builder);
+	parser.parseDocument();
+	return builder.result;
+}
+
+void StelJsonParser::parse(QIODevice* input, StelJsonVisitor& visitor)
+{
+	parseDevice(input, visitor);
+}
+
+void StelJsonParser::parse(const QByteArray& input, StelJsonVisitor& visitor)
+{
+	StelJsonBufferParser<StelJsonVisitor> parser(input.constData(), input.size(), visitor);
+	parser.parseDocument();
 }
 
 JsonListIterator::JsonListIterator(QIODevice* input)
@@ -476,11 +982,170 @@ JsonListIterator::~JsonListIterator()
 QVariant JsonListIterator::next()
 {
 	QVariant ret = parser->parse();
+	readSeparator();
+	return ret;
+}
+
+void JsonListIterator::next(StelJsonVisitor& visitor)
+{
+	parser->parse(visitor);
+	readSeparator();
+}
+
+void JsonListIterator::readSeparator()
+{
 	ahasNext = parser->skipAndConsumeChar(',');
 	if (!ahasNext)
 	{
 		if (!parser->skipAndConsumeChar(']'))
 			throw std::runtime_error("Expected ']' to end a list iterator");
 	}
-	return ret;
+}
+
+StelJsonRecordVisitor::StelJsonRecordVisitor(const QString& arecordsKey) : recordsKey(arecordsKey), level(0)
+{
+	builder = new StelJsonVariantBuilder();
+}
+
+StelJsonRecordVisitor::~StelJsonRecordVisitor()
+{
+	delete builder;
+	builder = NULL;
+}
+
+void StelJsonRecordVisitor::replay(const QVariantMap& document)
+{
+	for (QVariantMap::const_iterator it = document.constBegin(); it != document.constEnd(); ++it)
+	{
+		const QVariant& v = it.value();
+		if (it.key()==recordsKey && v.type()==QVariant::Map)
+		{
+			const QVariantMap records = v.toMap();
+			for (QVariantMap::const_iterator r = records.constBegin(); r != records.constEnd(); ++r)
+				record(r.key(), r.value());
+		}
+		else if (it.key()==recordsKey && v.type()==QVariant::List)
+		{
+			foreach (const QVariant& r, v.toList())
+				record(QString(), r);
+		}
+		else
+			member(it.key(), v);
+	}
+}
+
+void StelJsonRecordVisitor::beginValue()
+{
+	if (level==0)
+		throw std::runtime_error("Expected an object at the root of the catalog");
+}
+
+void StelJsonRecordVisitor::endValue()
+{
+	if (builder->getDepth()>0)
+		return;
+	const QVariant v = builder->result;
+	builder->result = QVariant();
+	if (level==2)
+		record(currentKey, v);
+	else
+		member(currentKey, v);
+}
+
+void StelJsonRecordVisitor::startObject()
+{
+	if (builder->getDepth()==0 && (level==0 || (level==1 && currentKey==recordsKey)))
+	{
+		++level;
+		currentKey.clear();
+		return;
+	}
+	builder->startObject();
+}
+
+void StelJsonRecordVisitor::endObject()
+{
+	if (builder->getDepth()==0)
+	{
+		--level;
+		return;
+	}
+	builder->endObject();
+	endValue();
+}
+
+void StelJsonRecordVisitor::startArray()
+{
+	if (builder->getDepth()==0)
+	{
+		if (level==1 && currentKey==recordsKey)
+		{
+			++level;
+			currentKey.clear();
+			return;
+		}
+		beginValue();
+	}
+	builder->startArray();
+}
+
+void StelJsonRecordVisitor::endArray()
+{
+	if (builder->getDepth()==0)
+	{
+		--level;
+		return;
+	}
+	builder->endArray();
+	endValue();
+}
+
+void StelJsonRecordVisitor::key(const char* str, int size)
+{
+	if (builder->getDepth()==0)
+		currentKey = QString::fromUtf8(str, size);
+	else
+		builder->key(str, size);
+}
+
+void StelJsonRecordVisitor::stringValue(const char* str, int size)
+{
+	beginValue();
+	builder->stringValue(str, size);
+	endValue();
+}
+
+void StelJsonRecordVisitor::intValue(int v)
+{
+	beginValue();
+	builder->intValue(v);
+	endValue();
+}
+
+void StelJsonRecordVisitor::doubleValue(double v)
+{
+	beginValue();
+	builder->doubleValue(v);
+	endValue();
+}
+
+void StelJsonRecordVisitor::boolValue(bool v)
+{
+	beginValue();
+	builder->boolValue(v);
+	endValue();
+}
+
+void StelJsonRecordVisitor::nullValue()
+{
+	beginValue();
+	builder->nullValue();
+	endValue();
+}
+
+void StelJsonRecordVisitor::dateTimeValue(const QDateTime& v)
+{
+	beginValue();
+	builder->dateTimeValue(v);
+	endValue();
 }
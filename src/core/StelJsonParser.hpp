@@ -23,6 +23,84 @@
 #include <QVariant>
 #include <QByteArray>
 
+class QDateTime;
+
+//! @class StelJsonVisitor
+//! Receive the content of a JSON document as a sequence of typed events, in the
+//! order of the document. Passed to StelJsonParser::parse(), it allows loaders to
+//! create their objects directly, without building a QVariant tree first.
+//! The default implementations do nothing, so that only the needed events are reimplemented.
+class StelJsonVisitor
+{
+public:
+	virtual ~StelJsonVisitor() {;}
+	virtual void startObject() {;}
+	virtual void endObject() {;}
+	virtual void startArray() {;}
+	virtual void endArray() {;}
+	//! The name of the next member of the current object.
+	//! @param str the UTF-8 name, only valid during the call. It is not null terminated.
+	//! @param size the size of the name in bytes.
+	virtual void key(const char* str, int size) {Q_UNUSED(str); Q_UNUSED(size);}
+	//! A string value, with its escape sequences already replaced.
+	//! @param str the UTF-8 string, only valid during the call. It is not null terminated.
+	//! @param size the size of the string in bytes.
+	virtual void stringValue(const char* str, int size) {Q_UNUSED(str); Q_UNUSED(size);}
+	virtual void intValue(int v) {Q_UNUSED(v);}
+	virtual void doubleValue(double v) {Q_UNUSED(v);}
+	virtual void boolValue(bool v) {Q_UNUSED(v);}
+	virtual void nullValue() {;}
+	//! An unquoted ISO 8601 date, as written by StelJsonParser::write().
+	virtual void dateTimeValue(const QDateTime& v) {Q_UNUSED(v);}
+};
+
+//! @class StelJsonRecordVisitor
+//! Visitor for the catalogs whose root object holds the records in one of its members,
+//! either as an object of named records or as an array.
+//! Each record is built as a QVariant, passed to record() and released before the next one,
+//! so that only one record is in memory at a time whatever the size of the catalog.
+//! The other members of the root object are passed to member().
+class StelJsonRecordVisitor : public StelJsonVisitor
+{
+public:
+	//! @param recordsKey the name of the member of the root object holding the records.
+	StelJsonRecordVisitor(const QString& recordsKey);
+	virtual ~StelJsonRecordVisitor();
+
+	//! Called for each record, in the order of the document.
+	//! @param name the name of the record, or an empty string when the records are in an array.
+	virtual void record(const QString& name, const QVariant& value) = 0;
+	//! Called for the other members of the root object, in the order of the document.
+	virtual void member(const QString& name, const QVariant& value) {Q_UNUSED(name); Q_UNUSED(value);}
+
+	//! Pass the content of an already parsed document, in the order of its keys.
+	void replay(const QVariantMap& document);
+
+	virtual void startObject();
+	virtual void endObject();
+	virtual void startArray();
+	virtual void endArray();
+	virtual void key(const char* str, int size);
+	virtual void stringValue(const char* str, int size);
+	virtual void intValue(int v);
+	virtual void doubleValue(double v);
+	virtual void boolValue(bool v);
+	virtual void nullValue();
+	virtual void dateTimeValue(const QDateTime& v);
+
+private:
+	//! Start a value of the root object or of the records container, or continue the current one.
+	void beginValue();
+	//! Pass the value to record() or member() once it is complete.
+	void endValue();
+
+	QString recordsKey;
+	//! 1 inside the root object, 2 inside the records container.
+	int level;
+	//! The name of the value being built.
+	QString currentKey;
+	class StelJsonVariantBuilder* builder;
+};
 
 //! Qt-style iterator over a JSON array. An actual list is not kept in memory,
 //! so only forward iteration is supported and all methods, including the constructor,
@@ -44,10 +122,18 @@ public:
 	//! @return the next object from the array
 	QVariant next();
 
+	//! Reads the next object from input, passing its content to the visitor.
+	//! Only the current object is read, so that arrays much larger than the
+	//! memory can be processed.
+	void next(StelJsonVisitor& visitor);
+
 	//! Returns true if the next non-whitespace character is not a ']' character.
 	bool hasNext() const {return ahasNext;}
 
 private:
+	//! Read the ',' before the next object, or the ']' ending the array.
+	void readSeparator();
+
 	bool ahasNext;
 	class StelJsonParserInstance* parser;
 };
@@ -73,9 +159,17 @@ public:
 	static JsonListIterator initListIterator(QIODevice* in) {return JsonListIterator(in);}
 
 	//! Parse the given input stream.
+	//! The content of QBuffer and QFile devices is parsed in place, mapping the files in memory,
+	//! and the device is left just after the parsed value. Other devices are parsed progressively,
+	//! only keeping a part of their content in memory.
 	static QVariant parse(QIODevice* input);
 	static QVariant parse(const QByteArray& input);
 
+	//! Parse the given input stream, passing its content to the visitor instead of building a QVariant.
+	//! The same values are accepted as by the other parse() methods.
+	static void parse(QIODevice* input, StelJsonVisitor& visitor);
+	static void parse(const QByteArray& input, StelJsonVisitor& visitor);
+
 	//! Serialize the passed QVariant as JSON into the output QIODevice.
 	static void write(const QVariant& jsonObject, QIODevice* output, int indentLevel=0);
 
@@ -82,6 +82,29 @@ public:
 	//! @param deltaTime the time increment in second since last call.
 	virtual void update(double deltaTime) = 0;
 
+	//! Return whether the module computes the state it draws in computeSnapshot().
+	//! Such modules only save in update() the inputs which they need from the core and the other modules.
+	//! The other modules do all their work in update(), before the frame is drawn.
+	virtual bool hasSnapshots() const {return false;}
+
+	//! Compute the state drawn in the next frame, for the modules whose hasSnapshots() returns true.
+	//! It is called on a worker thread while the current frame is drawn, after update(). It must not use
+	//! OpenGL, the core or the other modules, nor change any data read by draw(): the usual way is to
+	//! write the result in the back buffer of a StelDoubleBuffer.
+	//! @param deltaTime the time increment in second given to the last call of update().
+	virtual void computeSnapshot(double deltaTime) {Q_UNUSED(deltaTime);}
+
+	//! Make the state computed by the last call of computeSnapshot() the one used by draw().
+	//! It is called on the main thread before update(), when no snapshot is being computed.
+	virtual void publishSnapshot() {;}
+
+	//! Return whether the module has pending visible changes which require the sky to be redrawn.
+	//! This is used when redraw on demand is activated in StelMainView to skip frames identical to the
+	//! previous one. Modules running animations or fader transitions should return true while they last.
+	//! Changes due to the passage of simulation time are already handled by StelCore::getSkyDriftInPixels().
+	//! @param core the core, which can be used to measure the changes in pixels for the current projection.
+	virtual bool needsRedraw(const StelCore* core) const {Q_UNUSED(core); return false;}
+
 	//! Get the version of the module, default is stellarium main version
 	virtual QString getModuleVersion() const;
 
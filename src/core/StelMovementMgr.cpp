@@ -133,6 +133,11 @@ Vec3d StelMovementMgr::getViewUpVectorJ2000() const
 	return mountFrameToJ2000(upVectorMountFrame);
 }
 
+bool StelMovementMgr::needsRedraw(const StelCore*) const
+{
+	return flagAutoMove || flagAutoZoom || isDragging || deltaAz!=0. || deltaAlt!=0. || deltaFov!=0.;
+}
+
 bool StelMovementMgr::handleMouseMoves(int x, int y, Qt::MouseButtons)
 {
 	// Turn if the mouse is at the edge of the screen unless config asks otherwise
@@ -57,6 +57,8 @@ public:
 
 	//! Update time-dependent things (does nothing).
 	virtual void update(double) {;}
+	//! Return true while the view is moving or zooming.
+	virtual bool needsRedraw(const StelCore*) const;
 	//! Implement required draw function.  Does nothing.
 	virtual void draw(StelCore*) {;}
 	//! Handle keyboard events.
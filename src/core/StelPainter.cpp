@@ -25,18 +25,21 @@
 #include "StelProjectorClasses.hpp"
 #include "StelUtils.hpp"
 #include "PlanetShadows.hpp"
+#include "StelGlyphAtlas.hpp"
 
 #include <QDebug>
 #include <QString>
 #include <QSettings>
 #include <QLinkedList>
-#include <QPainter>
 #include <QMutex>
 #include <QVarLengthArray>
 #include <QPaintEngine>
 #include <QCache>
-#include <QOpenGLPaintDevice>
+#include <QDataStream>
 #include <QOpenGLShader>
+#include <QOpenGLBuffer>
+
+#include <algorithm>
 
 
 #ifndef NDEBUG
@@ -51,6 +54,54 @@ StelPainter::BasicShaderVars StelPainter::basicShaderVars;
 StelPainter::TexturesShaderVars StelPainter::texturesShaderVars;
 StelPainter::BasicShaderVars StelPainter::colorShaderVars;
 StelPainter::TexturesColorShaderVars StelPainter::texturesColorShaderVars;
+StelGlyphAtlas* StelPainter::glyphAtlas=NULL;
+StelTextBatch* StelPainter::textBatch=NULL;
+QHash<QByteArray, StelPainter::GpuProjectionShaderVars> StelPainter::gpuProjectionShaders;
+bool StelPainter::flagGpuProjection=false;
+
+// Fragment shaders, shared by the programs projecting the vertices on the CPU and on the GPU
+static const char* basicFragmentShaderSrc =
+	"uniform mediump vec4 color;\n"
+	"void main(void)\n"
+	"{\n"
+	"    gl_FragColor = color;\n"
+	"}\n";
+
+static const char* interpolatedColorFragmentShaderSrc =
+	"varying mediump vec4 fragcolor;\n"
+	"void main(void)\n"
+	"{\n"
+	"    gl_FragColor = fragcolor;\n"
+	"}\n";
+
+static const char* texturesFragmentShaderSrc =
+	"varying mediump vec2 texc;\n"
+	"uniform sampler2D tex;\n"
+	"uniform mediump vec4 texColor;\n"
+	"void main(void)\n"
+	"{\n"
+	"    gl_FragColor = texture2D(tex, texc)*texColor;\n"
+	"}\n";
+
+static const char* texturesColorFragmentShaderSrc =
+	"varying mediump vec2 texc;\n"
+	"varying mediump vec4 outColor;\n"
+	"uniform sampler2D tex;\n"
+	"void main(void)\n"
+	"{\n"
+	"    gl_FragColor = texture2D(tex, texc)*outColor;\n"
+	"}\n";
+
+// The meshes are only textured when the painter texture is enabled
+static const char* meshFragmentShaderSrc =
+	"varying mediump vec2 texc;\n"
+	"varying mediump vec4 outColor;\n"
+	"uniform sampler2D tex;\n"
+	"uniform bool textured;\n"
+	"void main(void)\n"
+	"{\n"
+	"    gl_FragColor = textured ? texture2D(tex, texc)*outColor : outColor;\n"
+	"}\n";
 
 StelPainter::GLState::GLState()
 {
@@ -88,7 +139,7 @@ void StelPainter::usePlanetShader(bool use)
 	planetShader = use;
 }
 
-StelPainter::StelPainter(const StelProjectorP& proj) : prj(proj), planetShader(false)
+StelPainter::StelPainter(const StelProjectorP& proj) : prj(proj), linesBatch(false), planetShader(false)
 {
 	Q_ASSERT(proj);
 
@@ -129,6 +180,7 @@ void StelPainter::setProjector(const StelProjectorP& p)
 
 StelPainter::~StelPainter()
 {
+	flushText();
 #ifndef NDEBUG
 	GLenum er = glGetError();
 	if (er!=GL_NO_ERROR)
@@ -427,91 +479,18 @@ void StelPainter::computeFanDisk(float radius, int innerFanSlices, int level, QV
 
 void StelPainter::sRing(const float rMin, const float rMax, int slices, const int stacks, const int orientInside)
 {
-	float x,y;
-	int j;
-
-	static Vec3f lightPos3;
-	static Vec4f ambientLight;
-	static Vec4f diffuseLight;
-	float c;
-	const bool isLightOn = light.isEnabled();
-	if (isLightOn)
-	{
-		lightPos3.set(light.getPosition()[0], light.getPosition()[1], light.getPosition()[2]);
-		Vec3f tmpv(0.f);
-		prj->getModelViewTransform()->forward(tmpv); // -posCenterEye
-		//lightPos3 -= tmpv;
-		//lightPos3 = prj->modelViewMatrixf.transpose().multiplyWithoutTranslation(lightPos3);
-		prj->getModelViewTransform()->getApproximateLinearTransfo().transpose().multiplyWithoutTranslation(Vec3d(lightPos3[0], lightPos3[1], lightPos3[2]));
-		prj->getModelViewTransform()->backward(lightPos3);
-		lightPos3.normalize();
-		ambientLight = light.getAmbient();
-		diffuseLight = light.getDiffuse();
-	}
-
-	const float nsign = orientInside?-1.f:1.f;
-
-	const float dr = (rMax-rMin) / stacks;
-	const float dtheta = 2.f * M_PI / slices;
-	if (slices < 0) slices = -slices;
-	Q_ASSERT(slices<=MAX_SLICES);
-	ComputeCosSinTheta(dtheta,slices);
-	float *cos_sin_theta_p;
-
-	static QVector<double> vertexArr;
-	static QVector<float> texCoordArr;
-	static QVector<float> colorArr;
-
+	Mesh* mesh = getRingMesh(rMin, rMax, slices, stacks, orientInside);
 	PlanetShadows* shadows = PlanetShadows::getInstance();
-
-	// draw intermediate stacks as quad strips
-	for (float r = rMin; r < rMax; r+=dr)
+	if(shadows->isActive())
 	{
-		const float tex_r0 = (r-rMin)/(rMax-rMin);
-		const float tex_r1 = (r+dr-rMin)/(rMax-rMin);
-		vertexArr.resize(0);
-		texCoordArr.resize(0);
-		colorArr.resize(0);
-		for (j=0,cos_sin_theta_p=cos_sin_theta; j<=slices; ++j,cos_sin_theta_p+=2)
-		{
-			x = r*cos_sin_theta_p[0];
-			y = r*cos_sin_theta_p[1];
-			if (isLightOn)
-			{
-				c = nsign * (lightPos3[0]*x + lightPos3[1]*y);
-				if (c<0) {c=0;}
-				colorArr << c*diffuseLight[0] + ambientLight[0] << c*diffuseLight[1] + ambientLight[1] << c*diffuseLight[2] + ambientLight[2];
-			}
-			texCoordArr << tex_r0 << 0.5f;
-			vertexArr << x << y << 0.f;
-			x = (r+dr)*cos_sin_theta_p[0];
-			y = (r+dr)*cos_sin_theta_p[1];
-			if (isLightOn)
-			{
-				c = nsign * (lightPos3[0]*x + lightPos3[1]*y);
-				if (c<0) {c=0;}
-				colorArr << c*diffuseLight[0] + ambientLight[0] << c*diffuseLight[1] + ambientLight[1] << c*diffuseLight[2] + ambientLight[2];
-			}
-			texCoordArr << tex_r1 << 0.5f;
-			vertexArr << x << y << 0.f;
-		}
-
-		if (isLightOn)
-			setArrays((Vec3d*)vertexArr.constData(), (Vec2f*)texCoordArr.constData(), (Vec3f*)colorArr.constData());
-		else
-			setArrays((Vec3d*)vertexArr.constData(), (Vec2f*)texCoordArr.constData());
-
-		if(shadows->isActive())
-		{
-			PlanetShadows::getInstance()->setupShading(this, 1, 1, true);
+		shadows->setupShading(this, 1, 1, true);
 
-			planetShader = true;
-			drawFromArray(TriangleStrip, vertexArr.size()/3);
-			planetShader = false;
-		}
-		else
-			drawFromArray(TriangleStrip, vertexArr.size()/3);
+		planetShader = true;
+		drawMesh(*mesh, 1.f);
+		planetShader = false;
 	}
+	else
+		drawMesh(*mesh, 1.f);
 }
 
 static void sSphereMapTexCoordFast(float rho_div_fov, const float costheta, const float sintheta, QVector<float>& out)
@@ -652,73 +631,72 @@ void StelPainter::drawText(const Vec3d& v, const QString& str, const float angle
 /*************************************************************************
  Draw the string at the given position and angle with the given font
 *************************************************************************/
-
-// Container for one cached string texture
-struct StringTexture
-{
-	GLuint texture;
-	int width;
-	int height;
-	int subTexWidth;
-	int subTexHeight;
-
-	StringTexture() : texture(0) {;}
-	~StringTexture()
-	{
-		if (texture != 0)
-			glDeleteTextures(1, &texture);
-	}
-};
-
 void StelPainter::drawText(float x, float y, const QString& str, float angleDeg, float xshift, float yshift, const bool noGravity)
 {
-	StelPainter::GLState state; // Will restore the opengl state at the end of the function.
 	if (prj->gravityLabels && !noGravity)
 	{
 		drawTextGravity180(x, y, str, xshift, yshift);
+		return;
 	}
-	else
-	{
-		QOpenGLPaintDevice device;
-		device.setSize(QSize(prj->getViewportWidth(), prj->getViewportHeight()));
-		// This doesn't seem to work correctly, so implement the hack below instead.
-		// Maybe check again later, or check on mac with retina..
-		// device.setDevicePixelRatio(prj->getDevicePixelsPerPixel());
-		// painter.setFont(currentFont);
-		
-		QPainter painter(&device);
-		painter.beginNativePainting();
-		
-		QFont tmpFont = currentFont;
-		tmpFont.setPixelSize(currentFont.pixelSize()*prj->getDevicePixelsPerPixel()*StelApp::getInstance().getGlobalScalingRatio());
-		painter.setFont(tmpFont);
-		painter.setPen(QColor(currentColor[0]*255, currentColor[1]*255, currentColor[2]*255, currentColor[3]*255));
-		
-		xshift*=StelApp::getInstance().getGlobalScalingRatio();
-		yshift*=StelApp::getInstance().getGlobalScalingRatio();
-		
-		y = prj->getViewportHeight()-y;
-		yshift = -yshift;
-
-		// Translate/rotate
-		if (!noGravity)
-			angleDeg += prj->defautAngleForGravityText;
-
-		if (std::fabs(angleDeg)>1.f)
-		{
-			QTransform m;
-			m.translate(x, y);
-			m.rotate(-angleDeg);
-			painter.setTransform(m);
-			painter.drawText(xshift, yshift, str);
-		}
-		else
-		{
-			painter.drawText(x+xshift, y+yshift, str);
-		}
-		
-		painter.endNativePainting();
-	}
+
+	// The glyphs are rendered at the size in device pixels.
+	// Maybe check again later on mac with retina..
+	QFont tmpFont = currentFont;
+	tmpFont.setPixelSize(currentFont.pixelSize()*prj->getDevicePixelsPerPixel()*StelApp::getInstance().getGlobalScalingRatio());
+
+	xshift*=StelApp::getInstance().getGlobalScalingRatio();
+	yshift*=StelApp::getInstance().getGlobalScalingRatio();
+
+	// Translate/rotate
+	if (!noGravity)
+		angleDeg += prj->defautAngleForGravityText;
+
+	// Small angles are ignored to keep the text sharp
+	const bool rotated = std::fabs(angleDeg)>1.f;
+	const float a = angleDeg*M_PI/180.;
+	const float c = rotated ? std::cos(a) : 1.f;
+	const float s = rotated ? std::sin(a) : 0.f;
+	glyphAtlas->addText(*textBatch, tmpFont, str, x + c*xshift - s*yshift, y + s*xshift + c*yshift, rotated ? angleDeg : 0.f, currentColor);
+}
+
+void StelPainter::flushText()
+{
+	if (!textBatch || textBatch->isEmpty())
+		return;
+
+	StelPainter::GLState state; // Will restore the opengl state at the end of the function.
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// The text is drawn in window coordinates, without changing the current arrays
+	const ArrayDesc savedVertexArray = vertexArray;
+	const ArrayDesc savedTexCoordArray = texCoordArray;
+	const ArrayDesc savedColorArray = colorArray;
+	const ArrayDesc savedNormalArray = normalArray;
+	const bool savedTexture2d = texture2dEnabled;
+	const bool savedPlanetShader = planetShader;
+	planetShader = false;
+	enableTexture2d(true);
+	for (QMap<int, StelTextBatch::Page>::const_iterator it = textBatch->getPages().constBegin(); it != textBatch->getPages().constEnd(); ++it)
+	{
+		const StelTextBatch::Page& page = it.value();
+		if (page.vertices.isEmpty())
+			continue;
+		glyphAtlas->bindPage(it.key());
+		setVertexPointer(3, GL_FLOAT, page.vertices.constData());
+		setTexCoordPointer(2, GL_FLOAT, page.texCoords.constData());
+		setColorPointer(4, GL_FLOAT, page.colors.constData());
+		enableClientStates(true, true, true);
+		drawFromArray(Triangles, page.vertices.size(), 0, false);
+	}
+	vertexArray = savedVertexArray;
+	texCoordArray = savedTexCoordArray;
+	colorArray = savedColorArray;
+	normalArray = savedNormalArray;
+	texture2dEnabled = savedTexture2d;
+	planetShader = savedPlanetShader;
+
+	textBatch->clear();
 }
 
 // Recursive method cutting a small circle in small segments
@@ -758,6 +736,7 @@ inline void fIter(const StelProjectorP& prj, const Vec3d& p1, const Vec3d& p2, V
 
 // Used by the method below
 QVector<Vec2f> StelPainter::smallCircleVertexArray;
+QVector<Vec2f> StelPainter::linesBatchVertexArray;
 
 void StelPainter::drawSmallCircleVertexArray()
 {
@@ -766,6 +745,15 @@ void StelPainter::drawSmallCircleVertexArray()
 
 	Q_ASSERT(smallCircleVertexArray.size()>1);
 
+	if (linesBatch)
+	{
+		// Convert the strip into independent segments, drawn later
+		for (int i=0;i<smallCircleVertexArray.size()-1;++i)
+			linesBatchVertexArray << smallCircleVertexArray.at(i) << smallCircleVertexArray.at(i+1);
+		smallCircleVertexArray.resize(0);
+		return;
+	}
+
 	enableClientStates(true);
 	setVertexPointer(2, GL_FLOAT, smallCircleVertexArray.constData());
 	drawFromArray(LineStrip, smallCircleVertexArray.size(), 0, false);
@@ -773,6 +761,54 @@ void StelPainter::drawSmallCircleVertexArray()
 	smallCircleVertexArray.resize(0);
 }
 
+void StelPainter::beginLinesBatch()
+{
+	Q_ASSERT(!linesBatch);
+	Q_ASSERT(linesBatchVertexArray.isEmpty());
+	linesBatch = true;
+}
+
+void StelPainter::endLinesBatch()
+{
+	Q_ASSERT(linesBatch);
+	linesBatch = false;
+	if (linesBatchVertexArray.isEmpty())
+		return;
+
+	enableClientStates(true);
+	setVertexPointer(2, GL_FLOAT, linesBatchVertexArray.constData());
+	drawFromArray(Lines, linesBatchVertexArray.size(), 0, false);
+	enableClientStates(false);
+	linesBatchVertexArray.resize(0);
+}
+
+void StelPainter::endLinesBatch(QVector<Vec2f>& segments)
+{
+	Q_ASSERT(linesBatch);
+	linesBatch = false;
+	// Swapping keeps the memory of the caller's array for the next batch
+	segments.swap(linesBatchVertexArray);
+	linesBatchVertexArray.resize(0);
+}
+
+void StelPainter::drawFromBuffer(QOpenGLBuffer& buffer, const DrawingMode mode, const int count)
+{
+	const Mat4f& m = getProjector()->getProjectionMatrix();
+	const QMatrix4x4 qMat(m[0], m[4], m[8], m[12], m[1], m[5], m[9], m[13], m[2], m[6], m[10], m[14], m[3], m[7], m[11], m[15]);
+
+	buffer.bind();
+	QOpenGLShaderProgram* pr = basicShaderProgram;
+	pr->bind();
+	pr->setUniformValue(basicShaderVars.projectionMatrix, qMat);
+	pr->setUniformValue(basicShaderVars.color, currentColor[0], currentColor[1], currentColor[2], currentColor[3]);
+	pr->setAttributeBuffer(basicShaderVars.vertex, GL_FLOAT, 0, 2);
+	pr->enableAttributeArray(basicShaderVars.vertex);
+	glDrawArrays(mode, 0, count);
+	pr->disableAttributeArray(basicShaderVars.vertex);
+	pr->release();
+	buffer.release();
+}
+
 static Vec3d pt1, pt2;
 void StelPainter::drawGreatCircleArc(const Vec3d& start, const Vec3d& stop, const SphericalCap* clippingCap,
 	void (*viewportEdgeIntersectCallback)(const Vec3d& screenPos, const Vec3d& direction, void* userData), void* userData)
@@ -1221,6 +1257,39 @@ static QVarLengthArray<Vec3f, 4096> polygonVertexArray;
 static QVarLengthArray<Vec2f, 4096> polygonTextureCoordArray;
 static QVarLengthArray<unsigned int, 4096> indexArray;
 
+//! Subdivided and projected triangles of a StelVertexArray, reused by drawSphericalTriangles() while the view does not change.
+struct ProjectedTriangles
+{
+	//! The source array. Holding its implicitly shared data keeps the addresses used in the key
+	//! from being reused by other arrays, and changing the caller's copy detaches it from this one.
+	StelVertexArray source;
+	//! The projector used to compute the triangles
+	StelProjectorP prj;
+	QVector<Vec3f> vertices;
+	QVector<Vec2f> texCoords;
+};
+
+//! Maximum number of cached vertices, i.e. about 20 MB
+static const int MAX_CACHED_PROJECTED_VERTICES = 1000000;
+//! The projected triangles, by data of the StelVertexArray and drawing parameters
+static QCache<QByteArray, ProjectedTriangles> projectedTrianglesCache(MAX_CACHED_PROJECTED_VERTICES);
+
+//! Compute the key of the projected triangles in projectedTrianglesCache.
+static QByteArray getProjectedTrianglesKey(const StelVertexArray& va, const bool textured, const SphericalCap* clippingCap, const double maxSqDistortion)
+{
+	// The regions return copies of the arrays they keep, which share their data: the address of
+	// the shared data identifies the content without reading it
+	QByteArray key;
+	QDataStream stream(&key, QIODevice::WriteOnly);
+	stream << (quint64)(quintptr)va.vertex.constData() << (quint64)(quintptr)va.indices.constData();
+	if (textured)
+		stream << (quint64)(quintptr)va.texCoords.constData();
+	stream << va.vertex.size() << va.indices.size() << va.texCoords.size() << (int)va.primitiveType << textured << maxSqDistortion;
+	if (clippingCap)
+		stream << clippingCap->n[0] << clippingCap->n[1] << clippingCap->n[2] << clippingCap->d;
+	return key;
+}
+
 void StelPainter::drawGreatCircleArcs(const StelVertexArray& va, const SphericalCap* clippingCap)
 {
 	Q_ASSERT(va.vertex.size()!=1);
@@ -1341,13 +1410,39 @@ void StelPainter::drawSphericalTriangles(const StelVertexArray& va, const bool t
 		return;
 	}
 
+	// The subdivision is only needed again when the view moved by more than a pixel
+	const QByteArray key = getProjectedTrianglesKey(va, textured, clippingCap, maxSqDistortion);
+	const ProjectedTriangles* cached = projectedTrianglesCache.object(key);
+	if (cached && cached->source.vertex.constData()==va.vertex.constData() && cached->source.indices.constData()==va.indices.constData()
+	    && (!textured || cached->source.texCoords.constData()==va.texCoords.constData()) && cached->prj->isApproximatelyEqual(*prj, 1.f))
+	{
+		setVertexPointer(3, GL_FLOAT, cached->vertices.constData());
+		if (textured)
+			setTexCoordPointer(2, GL_FLOAT, cached->texCoords.constData());
+		enableClientStates(true, textured);
+		drawFromArray(StelPainter::Triangles, cached->vertices.size(), 0, false);
+		enableClientStates(false);
+		return;
+	}
+
 	// the last case.  It is the slowest, it process the triangles one by one.
 	{
 		// Project all the triangles of the VertexArray into our buffer arrays.
 		VertexArrayProjector result = va.foreachTriangle(VertexArrayProjector(va, this, clippingCap, &polygonVertexArray, textured ? &polygonTextureCoordArray : NULL, maxSqDistortion));
 		result.drawResult();
-		return;
 	}
+
+	ProjectedTriangles* projected = new ProjectedTriangles();
+	projected->source = va;
+	projected->prj = prj;
+	projected->vertices.resize(polygonVertexArray.size());
+	std::copy(polygonVertexArray.constBegin(), polygonVertexArray.constEnd(), projected->vertices.begin());
+	if (textured)
+	{
+		projected->texCoords.resize(polygonTextureCoordArray.size());
+		std::copy(polygonTextureCoordArray.constBegin(), polygonTextureCoordArray.constEnd(), projected->texCoords.begin());
+	}
+	projectedTrianglesCache.insert(key, projected, qMax(1, polygonVertexArray.size()+va.vertex.size()));
 }
 
 // Draw the given SphericalPolygon.
@@ -1529,32 +1624,58 @@ void StelPainter::drawLine2d(const float x1, const float y1, const float x2, con
 	enableClientStates(false);
 }
 
-///////////////////////////////////////////////////////////////////////////
-// Drawing methods for general (non-linear) mode.
-// GZ This used to draw a full sphere. Now it's possible to have a spherical zone only.
-void StelPainter::sSphere(const float radius, const float oneMinusOblateness, const int slices, const int stacks, const int orientInside, const bool flipTexture, const float topAngle, const float bottomAngle)
+//! The triangles of a sphere or a ring. The vertices are kept in memory for the CPU projection,
+//! and uploaded once to the vertex buffers for the projection in the vertex shader.
+struct StelPainter::Mesh
 {
-	// It is really good for performance to have Vec4f,Vec3f objects
-	// static rather than on the stack. But why?
-	// Is the constructor/destructor so expensive?
-	static Vec3f lightPos3;
-	static Vec4f ambientLight;
-	static Vec4f diffuseLight;
-	float c;
-	const bool isLightOn = light.isEnabled();
-	if (isLightOn)
+	QVector<Vec3f> vertices;
+	//! The lit side of a vertex is where the dot product of its normal with the light direction is positive.
+	QVector<Vec3f> normals;
+	QVector<Vec2f> texCoords;
+	QVector<unsigned short> indices;
+	//! The vertices, normals and texture coordinates, one after the other.
+	QOpenGLBuffer vertexBuffer;
+	QOpenGLBuffer indexBuffer;
+
+	Mesh() : vertexBuffer(QOpenGLBuffer::VertexBuffer), indexBuffer(QOpenGLBuffer::IndexBuffer) {;}
+	~Mesh()
 	{
-		lightPos3.set(light.getPosition()[0], light.getPosition()[1], light.getPosition()[2]);
-		Vec3f tmpv(0.f);
-		prj->getModelViewTransform()->forward(tmpv); // -posCenterEye
-		//lightPos3 -= tmpv;
-		//lightPos3 = prj->modelViewMatrixf.transpose().multiplyWithoutTranslation(lightPos3);
-		prj->getModelViewTransform()->getApproximateLinearTransfo().transpose().multiplyWithoutTranslation(Vec3d(lightPos3[0], lightPos3[1], lightPos3[2]));
-		prj->getModelViewTransform()->backward(lightPos3);
-		lightPos3.normalize();
-		ambientLight = light.getAmbient();
-		diffuseLight = light.getDiffuse();
+		vertexBuffer.destroy();
+		indexBuffer.destroy();
 	}
+};
+
+//! Maximum number of cached mesh vertices, i.e. about 10 MB with their buffers
+static const int MAX_CACHED_MESH_VERTICES = 200000;
+QCache<QByteArray, StelPainter::Mesh> StelPainter::meshCache(MAX_CACHED_MESH_VERTICES);
+//! Maximum number of vertices of a mesh, whose indices are unsigned short.
+//! QCache::insert() deletes the objects costing more than the cache size: every mesh must fit in the cache.
+static const int MAX_MESH_VERTICES = 65536;
+Q_STATIC_ASSERT(MAX_MESH_VERTICES<=MAX_CACHED_MESH_VERTICES);
+
+//! @return the number of stacks of a mesh, reduced if needed so that its vertices can be indexed by unsigned short.
+static int getMeshStacks(const int slices, const int stacks)
+{
+	const int maxStacks = MAX_MESH_VERTICES/(2*(qAbs(slices)+1));
+	if (stacks<=maxStacks)
+		return stacks;
+	qWarning() << "StelPainter: mesh with" << slices << "slices and" << stacks << "stacks reduced to" << maxStacks << "stacks";
+	return maxStacks;
+}
+//! The float model view matrix used by the shader shifts the meshes by about 1e-7 radians.
+//! Beyond this zoom level, the shift would exceed 0.1 pixel and the meshes are projected by the CPU.
+static const float MAX_GPU_MESH_PIXEL_PER_RAD = 1e6f;
+
+StelPainter::Mesh* StelPainter::getSphereMesh(const float oneMinusOblateness, const int slices, const int astacks, const int orientInside,
+					      const bool flipTexture, const float topAngle, const float bottomAngle)
+{
+	QByteArray key;
+	QDataStream stream(&key, QIODevice::WriteOnly);
+	stream << (qint8)'S' << oneMinusOblateness << slices << astacks << orientInside << flipTexture << topAngle << bottomAngle;
+	Mesh* mesh = meshCache.object(key);
+	if (mesh)
+		return mesh;
+	const int stacks = getMeshStacks(slices, astacks);
 
 	GLfloat x, y, z;
 	GLfloat s=0.f, t=0.f;
@@ -1572,7 +1693,6 @@ void StelPainter::sSphere(const float radius, const float oneMinusOblateness, co
 		t=1.f;
 	}
 
-	Q_ASSERT(topAngle<bottomAngle); // don't forget: These are opening angles counted from top.
 	const float drho = (bottomAngle-topAngle) / stacks; // deltaRho:  originally just 180degrees/stacks, now the range clamped.
 	Q_ASSERT(stacks<=MAX_STACKS);
 	//if ((bottomAngle==M_PI) && (topAngle==0))
@@ -1595,17 +1715,14 @@ void StelPainter::sSphere(const float radius, const float oneMinusOblateness, co
 	const GLfloat ds = (flipTexture ? -1.f : 1.f) / slices;
 	const GLfloat dt = nsign / stacks; // from inside texture is reversed
 
-	// draw intermediate  as quad strips
-	static QVector<double> vertexArr;
-	static QVector<float> texCoordArr;
-	static QVector<float> colorArr;
-	static QVector<unsigned short> indiceArr;
-
-	texCoordArr.resize(0);
-	vertexArr.resize(0);
-	colorArr.resize(0);
-	indiceArr.resize(0);
+	mesh = new Mesh();
+	const int vertexCount = stacks*(slices+1)*2;
+	mesh->vertices.reserve(vertexCount);
+	mesh->normals.reserve(vertexCount);
+	mesh->texCoords.reserve(vertexCount);
+	mesh->indices.reserve(stacks*slices*6);
 
+	// draw intermediate  as quad strips
 	for (i = 0,cos_sin_rho_p = cos_sin_rho; i < stacks; ++i,cos_sin_rho_p+=2)
 	{
 		s = !flipTexture ? 0.f : 1.f;
@@ -1614,43 +1731,141 @@ void StelPainter::sSphere(const float radius, const float oneMinusOblateness, co
 			x = -cos_sin_theta_p[1] * cos_sin_rho_p[1];
 			y = cos_sin_theta_p[0] * cos_sin_rho_p[1];
 			z = nsign * cos_sin_rho_p[0];
-			texCoordArr << s << t;
-			if (isLightOn)
-			{
-				c = nsign * (lightPos3[0]*x*oneMinusOblateness + lightPos3[1]*y*oneMinusOblateness + lightPos3[2]*z);
-				if (c<0) {c=0;}
-				colorArr << c*diffuseLight[0] + ambientLight[0] << c*diffuseLight[1] + ambientLight[1] << c*diffuseLight[2] + ambientLight[2];
-			}
-			vertexArr << x * radius << y * radius << z * oneMinusOblateness * radius;
+			mesh->texCoords << Vec2f(s, t);
+			mesh->normals << Vec3f(nsign*x*oneMinusOblateness, nsign*y*oneMinusOblateness, nsign*z);
+			mesh->vertices << Vec3f(x, y, z*oneMinusOblateness);
 			x = -cos_sin_theta_p[1] * cos_sin_rho_p[3];
 			y = cos_sin_theta_p[0] * cos_sin_rho_p[3];
 			z = nsign * cos_sin_rho_p[2];
-			texCoordArr << s << t - dt;
-			if (isLightOn)
-			{
-				c = nsign * (lightPos3[0]*x*oneMinusOblateness + lightPos3[1]*y*oneMinusOblateness + lightPos3[2]*z);
-				if (c<0) {c=0;}
-				colorArr << c*diffuseLight[0] + ambientLight[0] << c*diffuseLight[1] + ambientLight[1] << c*diffuseLight[2] + ambientLight[2];
-			}
-			vertexArr << x * radius << y * radius << z * oneMinusOblateness * radius;
+			mesh->texCoords << Vec2f(s, t-dt);
+			mesh->normals << Vec3f(nsign*x*oneMinusOblateness, nsign*y*oneMinusOblateness, nsign*z);
+			mesh->vertices << Vec3f(x, y, z*oneMinusOblateness);
 			s += ds;
 		}
 		unsigned int offset = i*(slices+1)*2;
 		for (j = 2;j<slices*2+2;j+=2)
 		{
-			indiceArr << offset+j-2 << offset+j-1 << offset+j;
-			indiceArr << offset+j << offset+j-1 << offset+j+1;
+			mesh->indices << offset+j-2 << offset+j-1 << offset+j;
+			mesh->indices << offset+j << offset+j-1 << offset+j+1;
 		}
 		t -= dt;
 	}
 
-	// Draw the array now
+	meshCache.insert(key, mesh, qMax(1, vertexCount));
+	return mesh;
+}
+
+StelPainter::Mesh* StelPainter::getRingMesh(const float rMin, const float rMax, const int slices, const int astacks, const int orientInside)
+{
+	QByteArray key;
+	QDataStream stream(&key, QIODevice::WriteOnly);
+	stream << (qint8)'R' << rMin << rMax << slices << astacks << orientInside;
+	Mesh* mesh = meshCache.object(key);
+	if (mesh)
+		return mesh;
+	const int stacks = getMeshStacks(slices, astacks);
+
+	const float nsign = orientInside?-1.f:1.f;
+
+	const float dr = (rMax-rMin) / stacks;
+	// A negative number of slices reverses the direction of the ring
+	const float dtheta = 2.f * M_PI / slices;
+	const int absSlices = slices<0 ? -slices : slices;
+	Q_ASSERT(absSlices<=MAX_SLICES);
+	ComputeCosSinTheta(dtheta,absSlices);
+	float *cos_sin_theta_p;
+
+	mesh = new Mesh();
+	const int vertexCount = stacks*(absSlices+1)*2;
+	mesh->vertices.reserve(vertexCount);
+	mesh->normals.reserve(vertexCount);
+	mesh->texCoords.reserve(vertexCount);
+	mesh->indices.reserve(stacks*absSlices*6);
+
+	// intermediate stacks as quad strips
+	for (int i=0; i<stacks; ++i)
+	{
+		const float r = rMin + i*dr;
+		const float tex_r0 = (r-rMin)/(rMax-rMin);
+		const float tex_r1 = (r+dr-rMin)/(rMax-rMin);
+		int j;
+		for (j=0,cos_sin_theta_p=cos_sin_theta; j<=absSlices; ++j,cos_sin_theta_p+=2)
+		{
+			float x = r*cos_sin_theta_p[0];
+			float y = r*cos_sin_theta_p[1];
+			mesh->texCoords << Vec2f(tex_r0, 0.5f);
+			mesh->normals << Vec3f(nsign*x, nsign*y, 0.f);
+			mesh->vertices << Vec3f(x, y, 0.f);
+			x = (r+dr)*cos_sin_theta_p[0];
+			y = (r+dr)*cos_sin_theta_p[1];
+			mesh->texCoords << Vec2f(tex_r1, 0.5f);
+			mesh->normals << Vec3f(nsign*x, nsign*y, 0.f);
+			mesh->vertices << Vec3f(x, y, 0.f);
+		}
+		unsigned int offset = i*(absSlices+1)*2;
+		for (j = 2;j<absSlices*2+2;j+=2)
+		{
+			mesh->indices << offset+j-2 << offset+j-1 << offset+j;
+			mesh->indices << offset+j << offset+j-1 << offset+j+1;
+		}
+	}
+
+	meshCache.insert(key, mesh, qMax(1, vertexCount));
+	return mesh;
+}
+
+void StelPainter::drawMesh(Mesh& mesh, const float scale)
+{
+	const bool isLightOn = light.isEnabled();
+	Vec3f lightDirection(0.f);
 	if (isLightOn)
-		setArrays((Vec3d*)vertexArr.constData(), (Vec2f*)texCoordArr.constData(), (Vec3f*)colorArr.constData());
+	{
+		// The light direction in the coordinates of the mesh
+		lightDirection.set(light.getPosition()[0], light.getPosition()[1], light.getPosition()[2]);
+		prj->getModelViewTransform()->backward(lightDirection);
+		lightDirection.normalize();
+	}
+
+	if (flagGpuProjection && !planetShader && drawMeshGpuProjection(mesh, scale, isLightOn ? &lightDirection : NULL))
+		return;
+
+	// The geometry is cached, only the scaling and the lighting are computed at each frame
+	static QVector<Vec3d> vertexArr;
+	static QVector<Vec3f> colorArr;
+	const int n = mesh.vertices.size();
+	vertexArr.resize(n);
+	const Vec3f* v = mesh.vertices.constData();
+	for (int i=0; i<n; ++i)
+		vertexArr[i].set(v[i][0]*scale, v[i][1]*scale, v[i][2]*scale);
+
+	if (isLightOn)
+	{
+		const Vec4f& ambientLight = light.getAmbient();
+		const Vec4f& diffuseLight = light.getDiffuse();
+		const Vec3f* normal = mesh.normals.constData();
+		colorArr.resize(n);
+		for (int i=0; i<n; ++i)
+		{
+			float c = lightDirection.dot(normal[i]);
+			if (c<0) {c=0;}
+			colorArr[i].set(c*diffuseLight[0] + ambientLight[0], c*diffuseLight[1] + ambientLight[1], c*diffuseLight[2] + ambientLight[2]);
+		}
+		setArrays(vertexArr.constData(), texture2dEnabled ? mesh.texCoords.constData() : NULL, colorArr.constData());
+	}
 	else
-		setArrays((Vec3d*)vertexArr.constData(), (Vec2f*)texCoordArr.constData());
+		setArrays(vertexArr.constData(), texture2dEnabled ? mesh.texCoords.constData() : NULL);
 
-	drawFromArray(Triangles, indiceArr.size(), 0, true, indiceArr.constData());
+	drawFromArray(Triangles, mesh.indices.size(), 0, true, mesh.indices.constData());
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Drawing methods for general (non-linear) mode.
+// GZ This used to draw a full sphere. Now it's possible to have a spherical zone only.
+void StelPainter::sSphere(const float radius, const float oneMinusOblateness, const int slices, const int stacks, const int orientInside, const bool flipTexture, const float topAngle, const float bottomAngle)
+{
+	Q_ASSERT(topAngle<bottomAngle); // don't forget: These are opening angles counted from top.
+	Mesh* mesh = getSphereMesh(oneMinusOblateness, slices, stacks, orientInside, flipTexture, topAngle, bottomAngle);
+	drawMesh(*mesh, radius);
 }
 
 StelVertexArray StelPainter::computeSphereNoLight(const float radius, const float oneMinusOblateness, const int slices, const int stacks, const int orientInside, const bool flipTexture)
@@ -1770,13 +1985,7 @@ void StelPainter::initGLShaders()
 	vshader3.compileSourceCode(vsrc3);
 	if (!vshader3.log().isEmpty()) { qWarning() << "StelPainter: Warnings while compiling vshader3: " << vshader3.log(); }
 	QOpenGLShader fshader3(QOpenGLShader::Fragment);
-	const char *fsrc3 =
-		"uniform mediump vec4 color;\n"
-		"void main(void)\n"
-		"{\n"
-		"    gl_FragColor = color;\n"
-		"}\n";
-	fshader3.compileSourceCode(fsrc3);
+	fshader3.compileSourceCode(basicFragmentShaderSrc);
 	if (!fshader3.log().isEmpty()) { qWarning() << "StelPainter: Warnings while compiling fshader3: " << fshader3.log(); }
 	basicShaderProgram = new QOpenGLShaderProgram(QOpenGLContext::currentContext());
 	basicShaderProgram->addShader(&vshader3);
@@ -1804,13 +2013,7 @@ void StelPainter::initGLShaders()
 	  qWarning() << "StelPainter: Warnings while compiling vshaderInterpolatedColor: " << vshaderInterpolatedColor.log();
 	}
 	QOpenGLShader fshaderInterpolatedColor(QOpenGLShader::Fragment);
-	const char *fshaderInterpolatedColorSrc =
-		"varying mediump vec4 fragcolor;\n"
-		"void main(void)\n"
-		"{\n"
-		"    gl_FragColor = fragcolor;\n"
-		"}\n";
-	fshaderInterpolatedColor.compileSourceCode(fshaderInterpolatedColorSrc);
+	fshaderInterpolatedColor.compileSourceCode(interpolatedColorFragmentShaderSrc);
 	if (!fshaderInterpolatedColor.log().isEmpty()) {
 	  qWarning() << "StelPainter: Warnings while compiling fshaderInterpolatedColor: " << fshaderInterpolatedColor.log();
 	}
@@ -1838,15 +2041,7 @@ void StelPainter::initGLShaders()
 	if (!vshader2.log().isEmpty()) { qWarning() << "StelPainter: Warnings while compiling vshader2: " << vshader2.log(); }
 
 	QOpenGLShader fshader2(QOpenGLShader::Fragment);
-	const char *fsrc2 =
-		"varying mediump vec2 texc;\n"
-		"uniform sampler2D tex;\n"
-		"uniform mediump vec4 texColor;\n"
-		"void main(void)\n"
-		"{\n"
-		"    gl_FragColor = texture2D(tex, texc)*texColor;\n"
-		"}\n";
-	fshader2.compileSourceCode(fsrc2);
+	fshader2.compileSourceCode(texturesFragmentShaderSrc);
 	if (!fshader2.log().isEmpty()) { qWarning() << "StelPainter: Warnings while compiling fshader2: " << fshader2.log(); }
 
 	texturesShaderProgram = new QOpenGLShaderProgram(QOpenGLContext::currentContext());
@@ -1878,15 +2073,7 @@ void StelPainter::initGLShaders()
 	if (!vshader4.log().isEmpty()) { qWarning() << "StelPainter: Warnings while compiling vshader4: " << vshader4.log(); }
 
 	QOpenGLShader fshader4(QOpenGLShader::Fragment);
-	const char *fsrc4 =
-		"varying mediump vec2 texc;\n"
-		"varying mediump vec4 outColor;\n"
-		"uniform sampler2D tex;\n"
-		"void main(void)\n"
-		"{\n"
-		"    gl_FragColor = texture2D(tex, texc)*outColor;\n"
-		"}\n";
-	fshader4.compileSourceCode(fsrc4);
+	fshader4.compileSourceCode(texturesColorFragmentShaderSrc);
 	if (!fshader4.log().isEmpty()) { qWarning() << "StelPainter: Warnings while compiling fshader4: " << fshader4.log(); }
 
 	texturesColorShaderProgram = new QOpenGLShaderProgram(QOpenGLContext::currentContext());
@@ -1899,6 +2086,9 @@ void StelPainter::initGLShaders()
 	texturesColorShaderVars.color = texturesColorShaderProgram->attributeLocation("color");
 	texturesColorShaderVars.texture = texturesColorShaderProgram->uniformLocation("tex");
 
+	glyphAtlas = new StelGlyphAtlas();
+	textBatch = new StelTextBatch();
+
 	qWarning() << "StelPainter: initGLShaders()... done";
 
 }
@@ -1906,6 +2096,10 @@ void StelPainter::initGLShaders()
 
 void StelPainter::deinitGLShaders()
 {
+	delete glyphAtlas;
+	glyphAtlas = NULL;
+	delete textBatch;
+	textBatch = NULL;
 	PlanetShadows::cleanup();
 	delete basicShaderProgram;
 	basicShaderProgram = NULL;
@@ -1915,6 +2109,12 @@ void StelPainter::deinitGLShaders()
 	texturesShaderProgram = NULL;
 	delete texturesColorShaderProgram;
 	texturesColorShaderProgram = NULL;
+	projectedTrianglesCache.clear();
+	// The buffers of the meshes are released while the context is current
+	meshCache.clear();
+	foreach (const GpuProjectionShaderVars& vars, gpuProjectionShaders)
+		delete vars.program;
+	gpuProjectionShaders.clear();
 }
 
 
@@ -1946,6 +2146,9 @@ void StelPainter::enableClientStates(const bool vertex, const bool texture, cons
 
 void StelPainter::drawFromArray(const DrawingMode mode, const int count, const int offset, const bool doProj, const unsigned short* indices)
 {
+	if (doProj && flagGpuProjection && !planetShader && drawFromArrayGpuProjection(mode, count, offset, indices))
+		return;
+
 	ArrayDesc projectedVertexArray = vertexArray;
 	if (doProj)
 	{
@@ -2062,6 +2265,322 @@ void StelPainter::drawFromArray(const DrawingMode mode, const int count, const i
 }
 
 
+const StelPainter::GpuProjectionShaderVars& StelPainter::getGpuProjectionShader(ShaderVariant variant, const QByteArray& projectionShader)
+{
+	const QByteArray key = QByteArray::number((int)variant) + projectionShader;
+	QHash<QByteArray, GpuProjectionShaderVars>::const_iterator it = gpuProjectionShaders.constFind(key);
+	if (it != gpuProjectionShaders.constEnd())
+		return it.value();
+
+	QByteArray vsrc = projectionShader;
+	vsrc +=	"attribute highp vec3 vertex;\n"
+		"uniform mediump mat4 projectionMatrix;\n";
+	QByteArray mainSrc =
+		"void main(void)\n"
+		"{\n"
+		"    gl_Position = projectionMatrix*vec4(projectVertex(vertex), 1.);\n";
+	const char* fsrc = basicFragmentShaderSrc;
+	if (variant==ColorShader)
+	{
+		vsrc += "attribute mediump vec4 color;\n"
+			"varying mediump vec4 fragcolor;\n";
+		mainSrc += "    fragcolor = color;\n";
+		fsrc = interpolatedColorFragmentShaderSrc;
+	}
+	else if (variant==TexturesShader || variant==TexturesColorShader)
+	{
+		vsrc += "attribute mediump vec2 texCoord;\n"
+			"varying mediump vec2 texc;\n";
+		mainSrc += "    texc = texCoord;\n";
+		fsrc = texturesFragmentShaderSrc;
+		if (variant==TexturesColorShader)
+		{
+			vsrc += "attribute mediump vec4 color;\n"
+				"varying mediump vec4 outColor;\n";
+			mainSrc += "    outColor = color;\n";
+			fsrc = texturesColorFragmentShaderSrc;
+		}
+	}
+	else if (variant==MeshShader)
+	{
+		// Without light, the ambient color is the painter color and the diffuse color is null
+		vsrc += "attribute mediump vec3 normal;\n"
+			"attribute mediump vec2 texCoord;\n"
+			"uniform highp float vertexScale;\n"
+			"uniform mediump vec3 lightDirection;\n"
+			"uniform mediump vec4 ambientColor;\n"
+			"uniform mediump vec4 diffuseColor;\n"
+			"varying mediump vec2 texc;\n"
+			"varying mediump vec4 outColor;\n";
+		mainSrc =
+			"void main(void)\n"
+			"{\n"
+			"    gl_Position = projectionMatrix*vec4(projectVertex(vertexScale*vertex), 1.);\n"
+			"    texc = texCoord;\n"
+			"    outColor = vec4(ambientColor.rgb + max(dot(normal, lightDirection), 0.)*diffuseColor.rgb, ambientColor.a);\n";
+		fsrc = meshFragmentShaderSrc;
+	}
+	else if (variant==FadingLineShader)
+	{
+		vsrc += "attribute highp float time;\n"
+			"uniform mediump vec4 color;\n"
+			"uniform highp float currentTime;\n"
+			"uniform highp float timeExtent;\n"
+			"varying mediump vec4 fragcolor;\n";
+		mainSrc += "    fragcolor = vec4(color.rgb, color.a*(1.-(currentTime-time)/timeExtent));\n";
+		fsrc = interpolatedColorFragmentShaderSrc;
+	}
+	vsrc += mainSrc + "}\n";
+
+	GpuProjectionShaderVars vars;
+	vars.program = new QOpenGLShaderProgram(QOpenGLContext::currentContext());
+	bool ok = vars.program->addShaderFromSourceCode(QOpenGLShader::Vertex, vsrc);
+	ok = ok && vars.program->addShaderFromSourceCode(QOpenGLShader::Fragment, fsrc);
+	ok = ok && linkProg(vars.program, QString("gpuProjectionShader%1").arg((int)variant));
+	if (!ok)
+	{
+		// Remember the failure, so that the CPU projection is used without trying again
+		qWarning() << "StelPainter: cannot build the projection shader, the vertices are projected by the CPU";
+		delete vars.program;
+		vars.program = NULL;
+	}
+	else
+	{
+		vars.projectionMatrix = vars.program->uniformLocation("projectionMatrix");
+		vars.modelViewMatrix = vars.program->uniformLocation("modelViewMatrix");
+		vars.viewportCenter = vars.program->uniformLocation("viewportCenter");
+		vars.projectionScale = vars.program->uniformLocation("projectionScale");
+		vars.depthParams = vars.program->uniformLocation("depthParams");
+		vars.vertex = vars.program->attributeLocation("vertex");
+		vars.color = (variant==BasicShader || variant==FadingLineShader) ? vars.program->uniformLocation("color") : vars.program->attributeLocation("color");
+		vars.texCoord = vars.program->attributeLocation("texCoord");
+		vars.texColor = vars.program->uniformLocation("texColor");
+		vars.normal = vars.program->attributeLocation("normal");
+		vars.vertexScale = vars.program->uniformLocation("vertexScale");
+		vars.lightDirection = vars.program->uniformLocation("lightDirection");
+		vars.ambientColor = vars.program->uniformLocation("ambientColor");
+		vars.diffuseColor = vars.program->uniformLocation("diffuseColor");
+		vars.textured = vars.program->uniformLocation("textured");
+		vars.time = vars.program->attributeLocation("time");
+		vars.currentTime = vars.program->uniformLocation("currentTime");
+		vars.timeExtent = vars.program->uniformLocation("timeExtent");
+	}
+	return gpuProjectionShaders.insert(key, vars).value();
+}
+
+bool StelPainter::drawFromArrayGpuProjection(const DrawingMode mode, const int count, const int offset, const unsigned short* indices)
+{
+	if (vertexArray.size!=3 || normalArray.enabled)
+		return false;
+	ShaderVariant variant;
+	if (!texCoordArray.enabled)
+		variant = colorArray.enabled ? ColorShader : BasicShader;
+	else
+		variant = colorArray.enabled ? TexturesColorShader : TexturesShader;
+
+	StelProjector::GlslProjectionParams params;
+	if (!prj->getGlslProjectionParams(params))
+		return false;
+	// The vertices are converted to float before the model view transformation instead of after it:
+	// this is only accurate enough for directions, i.e. when the transformation is a rotation.
+	if (vertexArray.type==GL_DOUBLE && (params.modelViewMatrix[12]!=0.f || params.modelViewMatrix[13]!=0.f || params.modelViewMatrix[14]!=0.f))
+		return false;
+
+	const GpuProjectionShaderVars& vars = getGpuProjectionShader(variant, prj->getProjectionShader());
+	if (!vars.program)
+		return false;
+
+	const void* vertices = vertexArray.pointer;
+	if (vertexArray.type==GL_DOUBLE)
+	{
+		// Convert the used vertices without modifying the caller's array
+		int first = offset;
+		int last = offset + count;
+		if (indices)
+		{
+			unsigned short max = 0;
+			for (int i = offset; i < offset + count; ++i)
+				max = std::max(max, indices[i]);
+			first = 0;
+			last = max + 1;
+		}
+		polygonVertexArray.resize(last);
+		const Vec3d* in = (const Vec3d*)vertexArray.pointer;
+		Vec3f* out = polygonVertexArray.data();
+		for (int i = first; i < last; ++i)
+			out[i].set(in[i][0], in[i][1], in[i][2]);
+		vertices = polygonVertexArray.constData();
+	}
+
+	const Mat4f& m = prj->getProjectionMatrix();
+	const QMatrix4x4 qMat(m[0], m[4], m[8], m[12], m[1], m[5], m[9], m[13], m[2], m[6], m[10], m[14], m[3], m[7], m[11], m[15]);
+	const Mat4f& mv = params.modelViewMatrix;
+	const QMatrix4x4 qModelView(mv[0], mv[4], mv[8], mv[12], mv[1], mv[5], mv[9], mv[13], mv[2], mv[6], mv[10], mv[14], mv[3], mv[7], mv[11], mv[15]);
+
+	QOpenGLShaderProgram* pr = vars.program;
+	pr->bind();
+	pr->setUniformValue(vars.projectionMatrix, qMat);
+	pr->setUniformValue(vars.modelViewMatrix, qModelView);
+	pr->setUniformValue(vars.viewportCenter, params.viewportCenter[0], params.viewportCenter[1]);
+	pr->setUniformValue(vars.projectionScale, params.projectionScale[0], params.projectionScale[1]);
+	pr->setUniformValue(vars.depthParams, params.depthParams[0], params.depthParams[1]);
+	pr->setAttributeArray(vars.vertex, (const GLfloat*)vertices, 3);
+	pr->enableAttributeArray(vars.vertex);
+	if (variant==BasicShader)
+		pr->setUniformValue(vars.color, currentColor[0], currentColor[1], currentColor[2], currentColor[3]);
+	if (variant==TexturesShader)
+		pr->setUniformValue(vars.texColor, currentColor[0], currentColor[1], currentColor[2], currentColor[3]);
+	if (variant==TexturesShader || variant==TexturesColorShader)
+	{
+		pr->setAttributeArray(vars.texCoord, (const GLfloat*)texCoordArray.pointer, 2);
+		pr->enableAttributeArray(vars.texCoord);
+	}
+	if (variant==ColorShader || variant==TexturesColorShader)
+	{
+		pr->setAttributeArray(vars.color, (const GLfloat*)colorArray.pointer, colorArray.size);
+		pr->enableAttributeArray(vars.color);
+	}
+
+	if (indices)
+		glDrawElements(mode, count, GL_UNSIGNED_SHORT, indices + offset);
+	else
+		glDrawArrays(mode, offset, count);
+
+	pr->disableAttributeArray(vars.vertex);
+	if (variant==TexturesShader || variant==TexturesColorShader)
+		pr->disableAttributeArray(vars.texCoord);
+	if (variant==ColorShader || variant==TexturesColorShader)
+		pr->disableAttributeArray(vars.color);
+	pr->release();
+	return true;
+}
+
+bool StelPainter::drawMeshGpuProjection(Mesh& mesh, const float scale, const Vec3f* lightDirection)
+{
+	StelProjector::GlslProjectionParams params;
+	if (!prj->getGlslProjectionParams(params))
+		return false;
+	const Mat4f& mv = params.modelViewMatrix;
+	if ((mv[12]!=0.f || mv[13]!=0.f || mv[14]!=0.f) && prj->getPixelPerRadAtCenter()>MAX_GPU_MESH_PIXEL_PER_RAD)
+		return false;
+
+	const GpuProjectionShaderVars& vars = getGpuProjectionShader(MeshShader, prj->getProjectionShader());
+	if (!vars.program)
+		return false;
+
+	const int n = mesh.vertices.size();
+	if (!mesh.vertexBuffer.isCreated())
+	{
+		// First use of the mesh by the GPU: upload it once and for all
+		if (!mesh.vertexBuffer.create() || !mesh.indexBuffer.create())
+			return false;
+		mesh.vertexBuffer.bind();
+		mesh.vertexBuffer.allocate(n*(2*sizeof(Vec3f)+sizeof(Vec2f)));
+		mesh.vertexBuffer.write(0, mesh.vertices.constData(), n*sizeof(Vec3f));
+		mesh.vertexBuffer.write(n*sizeof(Vec3f), mesh.normals.constData(), n*sizeof(Vec3f));
+		mesh.vertexBuffer.write(2*n*sizeof(Vec3f), mesh.texCoords.constData(), n*sizeof(Vec2f));
+		mesh.indexBuffer.bind();
+		mesh.indexBuffer.allocate(mesh.indices.constData(), mesh.indices.size()*sizeof(unsigned short));
+	}
+	else
+	{
+		mesh.vertexBuffer.bind();
+		mesh.indexBuffer.bind();
+	}
+
+	const Mat4f& m = prj->getProjectionMatrix();
+	const QMatrix4x4 qMat(m[0], m[4], m[8], m[12], m[1], m[5], m[9], m[13], m[2], m[6], m[10], m[14], m[3], m[7], m[11], m[15]);
+	const QMatrix4x4 qModelView(mv[0], mv[4], mv[8], mv[12], mv[1], mv[5], mv[9], mv[13], mv[2], mv[6], mv[10], mv[14], mv[3], mv[7], mv[11], mv[15]);
+
+	QOpenGLShaderProgram* pr = vars.program;
+	pr->bind();
+	pr->setUniformValue(vars.projectionMatrix, qMat);
+	pr->setUniformValue(vars.modelViewMatrix, qModelView);
+	pr->setUniformValue(vars.viewportCenter, params.viewportCenter[0], params.viewportCenter[1]);
+	pr->setUniformValue(vars.projectionScale, params.projectionScale[0], params.projectionScale[1]);
+	pr->setUniformValue(vars.depthParams, params.depthParams[0], params.depthParams[1]);
+	pr->setUniformValue(vars.vertexScale, scale);
+	pr->setUniformValue(vars.textured, (GLint)texture2dEnabled);
+	if (lightDirection)
+	{
+		const Vec4f& ambientLight = light.getAmbient();
+		const Vec4f& diffuseLight = light.getDiffuse();
+		pr->setUniformValue(vars.lightDirection, (*lightDirection)[0], (*lightDirection)[1], (*lightDirection)[2]);
+		pr->setUniformValue(vars.ambientColor, ambientLight[0], ambientLight[1], ambientLight[2], 1.f);
+		pr->setUniformValue(vars.diffuseColor, diffuseLight[0], diffuseLight[1], diffuseLight[2], 1.f);
+	}
+	else
+	{
+		pr->setUniformValue(vars.lightDirection, 0.f, 0.f, 0.f);
+		pr->setUniformValue(vars.ambientColor, currentColor[0], currentColor[1], currentColor[2], currentColor[3]);
+		pr->setUniformValue(vars.diffuseColor, 0.f, 0.f, 0.f, 0.f);
+	}
+	pr->setAttributeBuffer(vars.vertex, GL_FLOAT, 0, 3);
+	pr->enableAttributeArray(vars.vertex);
+	pr->setAttributeBuffer(vars.normal, GL_FLOAT, n*sizeof(Vec3f), 3);
+	pr->enableAttributeArray(vars.normal);
+	pr->setAttributeBuffer(vars.texCoord, GL_FLOAT, 2*n*sizeof(Vec3f), 2);
+	pr->enableAttributeArray(vars.texCoord);
+
+	glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_SHORT, 0);
+
+	pr->disableAttributeArray(vars.vertex);
+	pr->disableAttributeArray(vars.normal);
+	pr->disableAttributeArray(vars.texCoord);
+	pr->release();
+	// The other arrays are drawn from client memory
+	mesh.vertexBuffer.release();
+	mesh.indexBuffer.release();
+	return true;
+}
+
+bool StelPainter::drawFadingLineStripsGpuProjection(QOpenGLBuffer& buffer, const int timeOffset, const QVector<int>& vertexOffsets, const QVector<Vec4f>& colors,
+						     const int first, const int count, const float currentTime, const float timeExtent, const int stride)
+{
+	Q_ASSERT(vertexOffsets.size()==colors.size());
+	StelProjector::GlslProjectionParams params;
+	if (!prj->getGlslProjectionParams(params))
+		return false;
+	// The coordinates are stored as float, which is only accurate enough for directions
+	const Mat4f& mv = params.modelViewMatrix;
+	if (mv[12]!=0.f || mv[13]!=0.f || mv[14]!=0.f)
+		return false;
+
+	const GpuProjectionShaderVars& vars = getGpuProjectionShader(FadingLineShader, prj->getProjectionShader());
+	if (!vars.program)
+		return false;
+
+	const Mat4f& m = prj->getProjectionMatrix();
+	const QMatrix4x4 qMat(m[0], m[4], m[8], m[12], m[1], m[5], m[9], m[13], m[2], m[6], m[10], m[14], m[3], m[7], m[11], m[15]);
+	const QMatrix4x4 qModelView(mv[0], mv[4], mv[8], mv[12], mv[1], mv[5], mv[9], mv[13], mv[2], mv[6], mv[10], mv[14], mv[3], mv[7], mv[11], mv[15]);
+
+	buffer.bind();
+	QOpenGLShaderProgram* pr = vars.program;
+	pr->bind();
+	pr->setUniformValue(vars.projectionMatrix, qMat);
+	pr->setUniformValue(vars.modelViewMatrix, qModelView);
+	pr->setUniformValue(vars.viewportCenter, params.viewportCenter[0], params.viewportCenter[1]);
+	pr->setUniformValue(vars.projectionScale, params.projectionScale[0], params.projectionScale[1]);
+	pr->setUniformValue(vars.depthParams, params.depthParams[0], params.depthParams[1]);
+	pr->setUniformValue(vars.currentTime, currentTime);
+	pr->setUniformValue(vars.timeExtent, timeExtent);
+	pr->setAttributeBuffer(vars.time, GL_FLOAT, timeOffset, 1, stride);
+	pr->enableAttributeArray(vars.time);
+	pr->enableAttributeArray(vars.vertex);
+	for (int i=0; i<vertexOffsets.size(); ++i)
+	{
+		const Vec4f& c = colors.at(i);
+		pr->setUniformValue(vars.color, c[0], c[1], c[2], c[3]);
+		pr->setAttributeBuffer(vars.vertex, GL_FLOAT, vertexOffsets.at(i), 3, stride);
+		glDrawArrays(GL_LINE_STRIP, first, count);
+	}
+	pr->disableAttributeArray(vars.vertex);
+	pr->disableAttributeArray(vars.time);
+	pr->release();
+	buffer.release();
+	return true;
+}
+
 StelPainter::ArrayDesc StelPainter::projectArray(const StelPainter::ArrayDesc& array, int offset, int count, const unsigned short* indices)
 {
 	// XXX: we should use a more generic way to test whether or not to do the projection.
@@ -24,11 +24,15 @@
 #include "StelProjectorType.hpp"
 #include "StelProjector.hpp"
 #include <QString>
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
 #include <QVarLengthArray>
 #include <QFontMetrics>
 #include <QOpenGLFunctions>
 
 class QOpenGLShaderProgram;
+class QOpenGLBuffer;
 
 class StelPainterLight
 {
@@ -105,6 +109,8 @@ public:
 
 	//! Draw the string at the given position and angle with the given font.
 	//! If the gravity label flag is set, uses drawTextGravity180.
+	//! The text is queued and drawn with the other labels when the painter is destroyed
+	//! or flushText() is called, so it appears above everything else drawn with this painter.
 	//! @param x horizontal position of the lower left corner of the first character of the text in pixel.
 	//! @param y horizontal position of the lower left corner of the first character of the text in pixel.
 	//! @param str the text to print.
@@ -118,6 +124,11 @@ public:
 	void drawText(const Vec3d& v, const QString& str, const float angleDeg=0.f,
 			  const float xshift=0.f, const float yshift=0.f, const bool noGravity=true);
 
+	//! Draw the queued text now, in one draw call per page of the glyph atlas.
+	//! Only needed when something must be drawn above the text with the same painter.
+	//! Note that this changes the bound texture.
+	void flushText();
+
 	//! Draw the given SphericalRegion.
 	//! @param region The SphericalRegion to draw.
 	//! @param drawMode define whether to draw the outline or the fill or both.
@@ -146,6 +157,23 @@ public:
 	//! @param clippingCap if not set to NULL, tells the painter to try to clip part of the region outside the cap.
 	void drawGreatCircleArc(const Vec3d& start, const Vec3d& stop, const SphericalCap* clippingCap=NULL, void (*viewportEdgeIntersectCallback)(const Vec3d& screenPos, const Vec3d& direction, void* userData)=NULL, void* userData=NULL);
 
+	//! Start collecting the line segments drawn by drawGreatCircleArc() and drawSmallCircleArc() instead of drawing them.
+	//! This allows to draw many arcs of the same color in a single call.
+	void beginLinesBatch();
+
+	//! Draw the line segments collected since beginLinesBatch() in a single call, with the current color.
+	void endLinesBatch();
+
+	//! Stop collecting the line segments, and move them to the given array instead of drawing them.
+	//! @param segments receive the segments in window coordinates, 2 vertices per segment.
+	void endLinesBatch(QVector<Vec2f>& segments);
+
+	//! Draw vertices stored in a vertex buffer with the current color.
+	//! @param buffer the vertex buffer, holding 2 float window coordinates per vertex.
+	//! @param mode the type of primitives to draw.
+	//! @param count the number of vertices to draw.
+	void drawFromBuffer(QOpenGLBuffer& buffer, const DrawingMode mode, const int count);
+
 	//! Draw a simple circle, 2d viewport coordinates in pixel
 	void drawCircle(const float x, const float y, float r);
 
@@ -205,6 +233,7 @@ public:
 	//!        region around the bottom pole, like for a spherical equirectangular horizon panorama (SphericalLandscape class).
 	//!        Example: your light pollution image (pano photo) goes down to just -5 degrees altitude (lowest street lamps below you):
 	//!        bottomAngle = 95 degrees = 95*M_PI/180.0f
+	//! The mesh is computed once for a given set of parameters other than the radius, then reused by the next calls.
 	void sSphere(const float radius, const float oneMinusOblateness, const int slices, const int stacks, const int orientInside = 0, const bool flipTexture = false,
 				 const float topAngle=0.0f, const float bottomAngle=M_PI);
 
@@ -226,6 +255,7 @@ public:
 	static void computeFanDisk(float radius, int innerFanSlices, int level, QVector<double>& vertexArr, QVector<float>& texCoordArr);
 
 	//! Draw a ring with a radial texturing.
+	//! As for sSphere(), the mesh is reused by the next calls with the same parameters.
 	void sRing(const float rMin, const float rMax, int slices, const int stacks, const int orientInside);
 
 	//! Draw a fisheye texture in a sphere.
@@ -307,6 +337,26 @@ public:
 	//! Sets whether the special planet shader should be used.
 	void usePlanetShader(bool use);
 
+	//! Set whether drawFromArray() projects the vertices in the vertex shader when the projection allows it.
+	//! The vertices are otherwise projected on the CPU, which remains the reference implementation.
+	static void setFlagGpuProjection(bool b) {flagGpuProjection=b;}
+	//! Get whether drawFromArray() projects the vertices in the vertex shader when the projection allows it.
+	static bool getFlagGpuProjection() {return flagGpuProjection;}
+
+	//! Draw line strips stored in a vertex buffer, projecting the vertices in the vertex shader.
+	//! The alpha of each vertex decreases linearly with its age, from the strip color at currentTime
+	//! to 0 at currentTime-timeExtent. All the strips share the same vertex times and range of vertices.
+	//! @param buffer the vertex buffer, holding the float coordinates and times of the vertices.
+	//! @param timeOffset the offset in bytes of the vertex times in the buffer.
+	//! @param vertexOffsets the offset in bytes of the vertex coordinates of each strip in the buffer.
+	//! @param colors the color of each strip.
+	//! @param first the index of the first vertex drawn in each strip.
+	//! @param count the number of vertices drawn in each strip.
+	//! @param stride the offset in bytes between consecutive vertices, the same for the times and the coordinates. 0 if they are tightly packed.
+	//! @return false if nothing was drawn because the current projection can not be handled by the GPU.
+	bool drawFadingLineStripsGpuProjection(QOpenGLBuffer& buffer, const int timeOffset, const QVector<int>& vertexOffsets, const QVector<Vec4f>& colors,
+					       const int first, const int count, const float currentTime, const float timeExtent, const int stride=0);
+
 private:
 
 	friend class StelTextureMgr;
@@ -340,6 +390,25 @@ private:
 	//! Converts an array from double to float.
 	void convertArrayToFloat(StelPainter::ArrayDesc& array, int offset, int count, const unsigned short *indices=NULL);
 
+	//! Draw the arrays projecting the vertices in the vertex shader.
+	//! @return false if nothing was drawn because the current projection or arrays can not be handled by the GPU.
+	bool drawFromArrayGpuProjection(const DrawingMode mode, const int count, const int offset, const unsigned short* indices);
+
+	//! The triangles of a sphere or a ring, kept in meshCache. Defined in StelPainter.cpp.
+	//! The meshes are indexed by unsigned short: the stacks of the bigger meshes are reduced to fit.
+	struct Mesh;
+	//! Get the mesh of a sphere of radius 1, computing it if it is not in the cache.
+	static Mesh* getSphereMesh(const float oneMinusOblateness, const int slices, const int stacks, const int orientInside,
+				   const bool flipTexture, const float topAngle, const float bottomAngle);
+	//! Get the mesh of a ring, computing it if it is not in the cache.
+	static Mesh* getRingMesh(const float rMin, const float rMax, const int slices, const int stacks, const int orientInside);
+	//! Draw a mesh scaled by the given factor, lit by the light if it is enabled.
+	void drawMesh(Mesh& mesh, const float scale);
+	//! Draw a mesh from its vertex buffers, projecting and lighting the vertices in the vertex shader.
+	//! @param lightDirection the direction of the light in the mesh coordinates, or NULL if the light is disabled.
+	//! @return false if nothing was drawn because the current projection can not be handled by the GPU.
+	bool drawMeshGpuProjection(Mesh& mesh, const float scale, const Vec3f* lightDirection);
+
 	//! Project the passed triangle on the screen ensuring that it will look smooth, even for non linear distortion
 	//! by splitting it into subtriangles. The resulting vertex arrays are appended to the passed out* ones.
 	//! The size of each edge must be < 180 deg.
@@ -356,6 +425,11 @@ private:
 	static QVector<Vec2f> smallCircleVertexArray;
 	void drawSmallCircleVertexArray();
 
+	//! Whether the small circle segments are collected in linesBatchVertexArray instead of being drawn.
+	bool linesBatch;
+	//! The segments waiting to be drawn by endLinesBatch(), 2 vertices per segment.
+	static QVector<Vec2f> linesBatchVertexArray;
+
 	//! The associated instance of projector
 	StelProjectorP prj;
 
@@ -367,6 +441,11 @@ private:
 	//! The used for text drawing
 	QFont currentFont;
 
+	//! Glyphs used to draw the text, shared by all the painters.
+	static class StelGlyphAtlas* glyphAtlas;
+	//! The text waiting to be drawn. Only one painter exists at a time, so it is shared too.
+	static class StelTextBatch* textBatch;
+
 	//! Whether the special planet shader is used.
 	bool planetShader;
 
@@ -403,6 +482,46 @@ private:
 	};
 	static TexturesColorShaderVars texturesColorShaderVars;
 
+	//! The shaders drawing the arrays, matching the combinations of enabled arrays handled by drawFromArray()
+	enum ShaderVariant
+	{
+		BasicShader,
+		ColorShader,
+		TexturesShader,
+		TexturesColorShader,
+		MeshShader,	// Textured and lit meshes drawn by drawMeshGpuProjection()
+		FadingLineShader	// Line strips fading with age drawn by drawFadingLineStripsGpuProjection()
+	};
+	//! A shader program projecting the vertices with a given projection type.
+	struct GpuProjectionShaderVars {
+		QOpenGLShaderProgram* program;	// NULL if the program could not be built
+		int projectionMatrix;
+		int modelViewMatrix;
+		int viewportCenter;
+		int projectionScale;
+		int depthParams;
+		int vertex;
+		int color;
+		int texCoord;
+		int texColor;
+		int normal;
+		int vertexScale;
+		int lightDirection;
+		int ambientColor;
+		int diffuseColor;
+		int textured;
+		int time;
+		int currentTime;
+		int timeExtent;
+	};
+	//! Get the program for the given shader variant and projection shader source, building it the first time.
+	static const GpuProjectionShaderVars& getGpuProjectionShader(ShaderVariant variant, const QByteArray& projectionShader);
+	//! The programs, by shader variant and projection shader source.
+	static QHash<QByteArray, GpuProjectionShaderVars> gpuProjectionShaders;
+	static bool flagGpuProjection;
+	//! The meshes of the spheres and rings, by parameters.
+	static QCache<QByteArray, Mesh> meshCache;
+
 
 	//! The descriptor for the current opengl vertex array
 	ArrayDesc vertexArray;
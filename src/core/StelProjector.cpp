@@ -26,6 +26,8 @@
 #include <QDebug>
 #include <QString>
 
+#include <typeinfo>
+
 StelProjector::Mat4dTransform::Mat4dTransform(const Mat4d& m)
     : transfoMat(m),
       transfoMatf(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8], m[9], m[10], m[11], m[12], m[13], m[14], m[15])
@@ -67,6 +69,59 @@ void StelProjector::Mat4dTransform::backward(Vec3f& v) const
 	v[2] = transfoMatf.r[8]*x + transfoMatf.r[9]*y + transfoMatf.r[10]*z;
 }
 
+void StelProjector::ModelViewTranform::forwardArray(int n, const Vec3d* in, Vec3f* out) const
+{
+	Vec3d v;
+	for (int i = 0; i < n; ++i)
+	{
+		v = in[i];
+		forward(v);
+		out[i].set(v[0], v[1], v[2]);
+	}
+}
+
+void StelProjector::ModelViewTranform::forwardArray(int n, const Vec3f* in, Vec3f* out) const
+{
+	for (int i = 0; i < n; ++i)
+	{
+		out[i] = in[i];
+		forward(out[i]);
+	}
+}
+
+void StelProjector::Mat4dTransform::forwardArray(int n, const Vec3d* in, Vec3f* out) const
+{
+	// Same computation as Vec3d::transfo4d(), with the coefficients kept in registers
+	const double* r = transfoMat.r;
+	const double m0 = r[0], m1 = r[1], m2 = r[2], m4 = r[4], m5 = r[5], m6 = r[6];
+	const double m8 = r[8], m9 = r[9], m10 = r[10], m12 = r[12], m13 = r[13], m14 = r[14];
+	for (int i = 0; i < n; ++i)
+	{
+		const double x = in[i][0];
+		const double y = in[i][1];
+		const double z = in[i][2];
+		out[i][0] = m0*x + m4*y + m8*z + m12;
+		out[i][1] = m1*x + m5*y + m9*z + m13;
+		out[i][2] = m2*x + m6*y + m10*z + m14;
+	}
+}
+
+void StelProjector::Mat4dTransform::forwardArray(int n, const Vec3f* in, Vec3f* out) const
+{
+	const float* r = transfoMatf.r;
+	const float m0 = r[0], m1 = r[1], m2 = r[2], m4 = r[4], m5 = r[5], m6 = r[6];
+	const float m8 = r[8], m9 = r[9], m10 = r[10], m12 = r[12], m13 = r[13], m14 = r[14];
+	for (int i = 0; i < n; ++i)
+	{
+		const float x = in[i][0];
+		const float y = in[i][1];
+		const float z = in[i][2];
+		out[i][0] = m0*x + m4*y + m8*z + m12;
+		out[i][1] = m1*x + m5*y + m9*z + m13;
+		out[i][2] = m2*x + m6*y + m10*z + m14;
+	}
+}
+
 void StelProjector::Mat4dTransform::combine(const Mat4d& m)
 {
 	Mat4f mf(m[0],  m[1] ,  m[2],  m[3],
@@ -87,6 +142,19 @@ StelProjector::ModelViewTranformP StelProjector::Mat4dTransform::clone() const
 	return ModelViewTranformP(new Mat4dTransform(transfoMat));
 }
 
+bool StelProjector::Mat4dTransform::isApproximatelyEqual(const ModelViewTranform& other, double tolerance) const
+{
+	const Mat4dTransform* m = dynamic_cast<const Mat4dTransform*>(&other);
+	if (!m)
+		return false;
+	for (int i=0; i<16; ++i)
+	{
+		if (std::fabs(transfoMat.r[i] - m->transfoMat.r[i]) > tolerance)
+			return false;
+	}
+	return true;
+}
+
 const QString StelProjector::maskTypeToString(StelProjectorMaskType type)
 {
 	if (type == MaskDisk )
@@ -298,31 +366,64 @@ bool StelProjector::project(const Vec3f& v, Vec3f& win) const
 	return projectInPlace(win);
 }
 
-void StelProjector::project(int n, const Vec3d* in, Vec3f* out)
+void StelProjector::project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags) const
 {
-	Vec3d v;
-	for (int i = 0; i < n; ++i, ++out)
+	modelViewTransform->forwardArray(n, in, out);
+	for (int i = 0; i < n; ++i)
 	{
-		v = in[i];
-		modelViewTransform->forward(v);
-		out->set(v[0], v[1], v[2]);
-		forward(*out);
-		out->set(viewportCenter[0] + flipHorz * pixelPerRad * (*out)[0],
-			viewportCenter[1] + flipVert * pixelPerRad * (*out)[1],
-			((*out)[2] - zNear) * oneOverZNearMinusZFar);
+		const bool rval = forward(out[i]);
+		if (flags)
+			flags[i] = rval ? ProjectedValid : 0;
+	}
+	viewportTransformArray(n, out, flags);
+}
+
+void StelProjector::project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags) const
+{
+	modelViewTransform->forwardArray(n, in, out);
+	for (int i = 0; i < n; ++i)
+	{
+		const bool rval = forward(out[i]);
+		if (flags)
+			flags[i] = rval ? ProjectedValid : 0;
 	}
+	viewportTransformArray(n, out, flags);
 }
 
-void StelProjector::project(int n, const Vec3f* in, Vec3f* out)
+void StelProjector::viewportTransformArray(int n, Vec3f* v, unsigned char* flags) const
 {
-	for (int i = 0; i < n; ++i, ++out)
+	// Same operations as in projectInPlace()
+	const float cx = viewportCenter[0];
+	const float cy = viewportCenter[1];
+	const float sx = flipHorz * pixelPerRad;
+	const float sy = flipVert * pixelPerRad;
+	const float zn = zNear;
+	const float zf = oneOverZNearMinusZFar;
+	for (int i = 0; i < n; ++i)
 	{
-		*out=in[i];
-		modelViewTransform->forward(*out);
-		forward(*out);
-		out->set(viewportCenter[0] + flipHorz * pixelPerRad * (*out)[0],
-			viewportCenter[1] + flipVert * pixelPerRad * (*out)[1],
-			((*out)[2] - zNear) * oneOverZNearMinusZFar);
+		v[i][0] = cx + sx * v[i][0];
+		v[i][1] = cy + sy * v[i][1];
+		v[i][2] = (v[i][2] - zn) * zf;
+	}
+	if (!flags)
+		return;
+
+	const float xMin = viewportXywh[0];
+	const float yMin = viewportXywh[1];
+	const float xMax = viewportXywh[0] + viewportXywh[2];
+	const float yMax = viewportXywh[1] + viewportXywh[3];
+	const bool disk = maskType == MaskDisk;
+	const float r2 = 0.25f * viewportFovDiameter * viewportFovDiameter;
+	for (int i = 0; i < n; ++i)
+	{
+		const float x = v[i][0];
+		const float y = v[i][1];
+		if (y>=yMin && x>=xMin && y<=yMax && x<=xMax)
+		{
+			flags[i] |= ProjectedInViewport;
+			if (!disk || (x-cx)*(x-cx) + (y-cy)*(y-cy) <= r2)
+				flags[i] |= ProjectedInMask;
+		}
 	}
 }
 
@@ -469,6 +570,54 @@ Mat4f StelProjector::getProjectionMatrix() const
 	return Mat4f(2.f/viewportXywh[2], 0, 0, 0, 0, 2.f/viewportXywh[3], 0, 0, 0, 0, -1., 0., -(2.f*viewportXywh[0] + viewportXywh[2])/viewportXywh[2], -(2.f*viewportXywh[1] + viewportXywh[3])/viewportXywh[3], 0, 1);
 }
 
+QByteArray StelProjector::getProjectionShader() const
+{
+	const QByteArray forwardSource = getForwardTransformShader();
+	if (forwardSource.isEmpty())
+		return QByteArray();
+	return QByteArray(
+		"uniform highp mat4 modelViewMatrix;\n"
+		"uniform highp vec2 viewportCenter;\n"
+		"uniform highp vec2 projectionScale;\n"
+		"uniform highp vec2 depthParams;\n")
+		+ forwardSource +
+		"highp vec3 projectVertex(highp vec3 v)\n"
+		"{\n"
+		"    highp vec3 p = projectorForward((modelViewMatrix*vec4(v, 1.)).xyz);\n"
+		"    return vec3(viewportCenter + projectionScale*p.xy, (p.z - depthParams.x)*depthParams.y);\n"
+		"}\n";
+}
+
+bool StelProjector::isApproximatelyEqual(const StelProjector& other, float pixelTolerance) const
+{
+	if (typeid(*this)!=typeid(other) || viewportXywh!=other.viewportXywh || flipHorz!=other.flipHorz || flipVert!=other.flipVert
+		|| zNear!=other.zNear || oneOverZNearMinusZFar!=other.oneOverZNearMinusZFar)
+		return false;
+	if (std::fabs(viewportCenter[0]-other.viewportCenter[0]) > pixelTolerance || std::fabs(viewportCenter[1]-other.viewportCenter[1]) > pixelTolerance)
+		return false;
+	// A zoom moves the most the points at the corners of the viewport
+	const float maxRadius = 0.5f*std::sqrt((float)(viewportXywh[2]*viewportXywh[2] + viewportXywh[3]*viewportXywh[3]));
+	if (std::fabs(pixelPerRad-other.pixelPerRad)*maxRadius > pixelTolerance*pixelPerRad)
+		return false;
+	// A rotation by a small angle changes the coefficients of the matrix by about this angle. The projections
+	// magnify angles up to about 4 times at the edges of the usual fields of view.
+	return modelViewTransform->isApproximatelyEqual(*other.modelViewTransform, pixelTolerance/(4.f*pixelPerRad));
+}
+
+bool StelProjector::getGlslProjectionParams(GlslProjectionParams& params) const
+{
+	// Refraction is not linear, and there is no point in porting it as it is only used for the horizontal frame
+	if (getForwardTransformShader().isEmpty() || !dynamic_cast<const Mat4dTransform*>(modelViewTransform.data()))
+		return false;
+	const Mat4d m = modelViewTransform->getApproximateLinearTransfo();
+	for (int i=0; i<16; ++i)
+		params.modelViewMatrix[i] = m[i];
+	params.viewportCenter = viewportCenter;
+	params.projectionScale.set(flipHorz*pixelPerRad, flipVert*pixelPerRad);
+	params.depthParams.set(zNear, oneOverZNearMinusZFar);
+	return true;
+}
+
 StelProjector::StelProjectorMaskType StelProjector::getMaskType(void) const
 {
 	return maskType;
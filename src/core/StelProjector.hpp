@@ -25,6 +25,8 @@
 #include "VecMath.hpp"
 #include "StelSphereGeometry.hpp"
 
+#include <QByteArray>
+
 //! @class StelProjector
 //! Provide the main interface to all operations of projecting coordinates from sky to screen.
 //! The StelProjector also defines the viewport size and position.
@@ -39,6 +41,7 @@ class StelProjector
 public:
 	friend class StelPainter;
 	friend class StelCore;
+	friend class TestStelProjector;
 
 	class ModelViewTranform;
 	//! @typedef ModelViewTranformP
@@ -57,10 +60,20 @@ public:
 		virtual void forward(Vec3f&) const =0;
 		virtual void backward(Vec3f&) const =0;
 
+		//! Apply the forward transformation to an array of vectors, writing the results as floats.
+		//! The default implementation calls forward() for each vector.
+		virtual void forwardArray(int n, const Vec3d* in, Vec3f* out) const;
+		virtual void forwardArray(int n, const Vec3f* in, Vec3f* out) const;
+
 		virtual void combine(const Mat4d&)=0;
 		virtual ModelViewTranformP clone() const=0;
 
 		virtual Mat4d getApproximateLinearTransfo() const=0;
+
+		//! Return whether the transformation gives the same results as another one, with a given tolerance
+		//! on the coefficients of their matrices. Used to reuse computations made for previous frames.
+		//! The default implementation considers the transformations always different.
+		virtual bool isApproximatelyEqual(const ModelViewTranform&, double) const {return false;}
 	};
 
 	class Mat4dTransform: public ModelViewTranform
@@ -71,9 +84,12 @@ public:
         void backward(Vec3d& v) const;
         void forward(Vec3f& v) const;
         void backward(Vec3f& v) const;
+        void forwardArray(int n, const Vec3d* in, Vec3f* out) const;
+        void forwardArray(int n, const Vec3f* in, Vec3f* out) const;
         void combine(const Mat4d& m);
         Mat4d getApproximateLinearTransfo() const;
         ModelViewTranformP clone() const;
+        bool isApproximatelyEqual(const ModelViewTranform& other, double tolerance) const;
 
 	private:
 		//! transfo matrix and invert
@@ -89,6 +105,15 @@ public:
 		MaskDisk	//!< For disk viewport mode (circular mask to seem like bins/telescope)
 	};
 
+	//! @enum ProjectedFlag
+	//! Flags set for each vector by the array project() methods.
+	enum ProjectedFlag
+	{
+		ProjectedValid=1,		//!< The projected coordinate is valid, as returned by forward()
+		ProjectedInViewport=2,	//!< The projected point is inside the viewport, see checkInViewport()
+		ProjectedInMask=4		//!< The projected point is inside the viewport and inside the disk of the viewport mask, if any
+	};
+
 	//! @struct StelProjectorParams
 	//! Contains all the param needed to initialize a StelProjector
 	struct StelProjectorParams
@@ -218,9 +243,15 @@ public:
 	//! @return true if the projected coordinate is valid.
 	bool project(const Vec3f& v, Vec3f& win) const;
 
-	virtual void project(int n, const Vec3d* in, Vec3f* out);
-
-	virtual void project(int n, const Vec3f* in, Vec3f* out);
+	//! Project an array of vectors from the current frame into the viewport.
+	//! The projection classes reimplement it so that the model view transformation, the projection
+	//! and the viewport transformation are each done in a loop over all the vectors, without virtual calls.
+	//! @param n the number of vectors.
+	//! @param in the vectors in the current frame.
+	//! @param out the projected vectors in the viewport 2D frame.
+	//! @param flags if not NULL, receives the combination of ProjectedFlag of each vector.
+	virtual void project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags=NULL) const;
+	virtual void project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags=NULL) const;
 
 	//! Project the vector v from the current frame into the viewport.
 	//! @param vd the vector in the current frame.
@@ -265,6 +296,35 @@ public:
 	//! Get the current projection matrix.
 	Mat4f getProjectionMatrix() const;
 
+	//! Parameters of the projection used by the vertex shader function returned by getProjectionShader().
+	struct GlslProjectionParams
+	{
+		Mat4f modelViewMatrix;	//!< uniform modelViewMatrix
+		Vec2f viewportCenter;	//!< uniform viewportCenter
+		Vec2f projectionScale;	//!< uniform projectionScale: the flips multiplied by pixelPerRad
+		Vec2f depthParams;	//!< uniform depthParams: zNear and 1/(zNear-zFar)
+	};
+
+	//! Get the GLSL source of the function "highp vec3 projectorForward(highp vec3 v)",
+	//! which does the same as forward() in a shader. Points which can not be projected are sent far away.
+	//! @return an empty array if the projection has no GLSL implementation.
+	virtual QByteArray getForwardTransformShader() const {return QByteArray();}
+
+	//! Get the GLSL source of the uniforms and of the function "highp vec3 projectVertex(highp vec3 v)",
+	//! to be included in a vertex shader. It returns the same window coordinates as project(),
+	//! using the uniforms described in GlslProjectionParams.
+	//! @return an empty array if the projection has no GLSL implementation.
+	QByteArray getProjectionShader() const;
+
+	//! Return whether the projection gives the same window coordinates as another one, within a tolerance in pixels.
+	//! The parameters of the projections are compared, so that it is much faster than projecting points.
+	bool isApproximatelyEqual(const StelProjector& other, float pixelTolerance) const;
+
+	//! Get the values of the uniforms used by the source returned by getProjectionShader().
+	//! @return false if the projection can not be done in a shader, i.e. if it has no GLSL implementation
+	//! or if the model view transform is not a matrix, as when refraction is applied.
+	bool getGlslProjectionParams(GlslProjectionParams& params) const;
+
 	///////////////////////////////////////////////////////////////////////////
 	//! Get a string description of a StelProjectorMaskType.
 	static const QString maskTypeToString(StelProjectorMaskType type);
@@ -291,6 +351,29 @@ protected:
 	//! Initialize the bounding cap.
 	virtual void computeBoundingCap();
 
+	//! Implementation of the array project() methods for the projection class P.
+	//! Its forward() method is called without virtual dispatch, so that it can be inlined.
+	template <class P, class V> void projectArray(int n, const V* in, Vec3f* out, unsigned char* flags) const
+	{
+		modelViewTransform->forwardArray(n, in, out);
+		const P* prj = static_cast<const P*>(this);
+		if (flags)
+		{
+			for (int i=0;i<n;++i)
+				flags[i] = prj->P::forward(out[i]) ? ProjectedValid : 0;
+		}
+		else
+		{
+			for (int i=0;i<n;++i)
+				prj->P::forward(out[i]);
+		}
+		viewportTransformArray(n, out, flags);
+	}
+
+	//! Apply the viewport transformation to the vectors returned by forward().
+	//! @param flags if not NULL, the viewport flags are added to the given flags.
+	void viewportTransformArray(int n, Vec3f* v, unsigned char* flags) const;
+
 	ModelViewTranformP modelViewTransform;	// Operator to apply (if not NULL) before the modelview projection step
 
 	float flipHorz,flipVert;            // Whether to flip in horizontal or vertical directions
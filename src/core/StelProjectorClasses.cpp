@@ -30,6 +30,18 @@ QString StelProjectorPerspective::getDescriptionI18() const
 	return q_("Perspective projection keeps the horizon a straight line. The mathematical name for this projection method is <i>gnomonic projection</i>.");
 }
 
+QByteArray StelProjectorPerspective::getForwardTransformShader() const
+{
+	return
+		"highp vec3 projectorForward(highp vec3 v)\n"
+		"{\n"
+		"    highp float r = length(v);\n"
+		"    if (v.z == 0.)\n"
+		"        return vec3(1.0e30, 1.0e30, r);\n"
+		"    return vec3(v.xy/abs(v.z), r);\n"
+		"}\n";
+}
+
 bool StelProjectorPerspective::backward(Vec3d &v) const
 {
 	v[2] = std::sqrt(1.0/(1.0+v[0]*v[0]+v[1]*v[1]));
@@ -39,6 +51,16 @@ bool StelProjectorPerspective::backward(Vec3d &v) const
 	return true;
 }
 
+void StelProjectorPerspective::project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorPerspective>(n, in, out, flags);
+}
+
+void StelProjectorPerspective::project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorPerspective>(n, in, out, flags);
+}
+
 float StelProjectorPerspective::fovToViewScalingFactor(float fov) const
 {
 	return std::tan(fov);
@@ -68,6 +90,19 @@ QString StelProjectorEqualArea::getDescriptionI18() const
 	return q_("The full name of this projection method is, <i>Lambert azimuthal equal-area projection</i>. It preserves the area but not the angle.");
 }
 
+QByteArray StelProjectorEqualArea::getForwardTransformShader() const
+{
+	return
+		"highp vec3 projectorForward(highp vec3 v)\n"
+		"{\n"
+		"    highp float r = length(v);\n"
+		"    highp float d = r*(r-v.z);\n"
+		"    if (d <= 0.)\n"
+		"        return vec3(1.0e30, 1.0e30, r);\n"
+		"    return vec3(v.xy*sqrt(2./d), r);\n"
+		"}\n";
+}
+
 bool StelProjectorEqualArea::backward(Vec3d &v) const
 {
 	const double dq = v[0]*v[0] + v[1]*v[1];
@@ -88,6 +123,16 @@ bool StelProjectorEqualArea::backward(Vec3d &v) const
 	return true;
 }
 
+void StelProjectorEqualArea::project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorEqualArea>(n, in, out, flags);
+}
+
+void StelProjectorEqualArea::project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorEqualArea>(n, in, out, flags);
+}
+
 float StelProjectorEqualArea::fovToViewScalingFactor(float fov) const
 {
 	return 2.f * std::sin(0.5f * fov);
@@ -113,6 +158,19 @@ QString StelProjectorStereographic::getDescriptionI18() const
 	return q_("Stereographic projection is known since the antiquity and was originally known as the planisphere projection. It preserves the angles at which curves cross each other but it does not preserve area.");
 }
 
+QByteArray StelProjectorStereographic::getForwardTransformShader() const
+{
+	return
+		"highp vec3 projectorForward(highp vec3 v)\n"
+		"{\n"
+		"    highp float r = length(v);\n"
+		"    highp float h = 0.5*(r-v.z);\n"
+		"    if (h <= 0.)\n"
+		"        return vec3(1.0e30, 1.0e30, 0.);\n"
+		"    return vec3(v.xy/h, r);\n"
+		"}\n";
+}
+
 bool StelProjectorStereographic::backward(Vec3d &v) const
 {
   const double lqq = 0.25*(v[0]*v[0] + v[1]*v[1]);
@@ -121,6 +179,16 @@ bool StelProjectorStereographic::backward(Vec3d &v) const
   return true;
 }
 
+void StelProjectorStereographic::project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorStereographic>(n, in, out, flags);
+}
+
+void StelProjectorStereographic::project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorStereographic>(n, in, out, flags);
+}
+
 float StelProjectorStereographic::fovToViewScalingFactor(float fov) const
 {
 	return 2.f * std::tan(0.5f * fov);
@@ -150,6 +218,23 @@ QString StelProjectorFisheye::getDescriptionI18() const
 	return q_("In fish-eye projection, or <i>azimuthal equidistant projection</i>, straight lines become curves when they appear a large angular distance from the centre of the field of view (like the distortions seen with very wide angle camera lenses).");
 }
 
+QByteArray StelProjectorFisheye::getForwardTransformShader() const
+{
+	return
+		"highp vec3 projectorForward(highp vec3 v)\n"
+		"{\n"
+		"    highp float rq1 = dot(v.xy, v.xy);\n"
+		"    if (rq1 > 0.)\n"
+		"    {\n"
+		"        highp float h = sqrt(rq1);\n"
+		"        return vec3(v.xy*(atan(h, -v.z)/h), sqrt(rq1 + v.z*v.z));\n"
+		"    }\n"
+		"    if (v.z < 0.)\n"
+		"        return vec3(0., 0., 1.);\n"
+		"    return vec3(1.0e30, 1.0e30, 0.);\n"
+		"}\n";
+}
+
 bool StelProjectorFisheye::backward(Vec3d &v) const
 {
 	const double a = std::sqrt(v[0]*v[0]+v[1]*v[1]);
@@ -160,6 +245,16 @@ bool StelProjectorFisheye::backward(Vec3d &v) const
 	return (a < M_PI);
 }
 
+void StelProjectorFisheye::project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorFisheye>(n, in, out, flags);
+}
+
+void StelProjectorFisheye::project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorFisheye>(n, in, out, flags);
+}
+
 float StelProjectorFisheye::fovToViewScalingFactor(float fov) const
 {
 	return fov;
@@ -187,6 +282,19 @@ QString StelProjectorHammer::getDescriptionI18() const
 	return q_("The Hammer projection is an equal-area map projection, described by Ernst Hammer in 1892 and directly inspired by the Aitoff projection.");
 }
 
+QByteArray StelProjectorHammer::getForwardTransformShader() const
+{
+	return
+		"highp vec3 projectorForward(highp vec3 v)\n"
+		"{\n"
+		"    highp float r = length(v);\n"
+		"    highp float alpha = atan(v.x, -v.z);\n"
+		"    highp float cosDelta = sqrt(max(0., 1.-v.y*v.y/(r*r)));\n"
+		"    highp float z = sqrt(1.+cosDelta*cos(alpha/2.));\n"
+		"    return vec3(2.*1.41421356*cosDelta*sin(alpha/2.)/z, 1.41421356*v.y/r/z, r);\n"
+		"}\n";
+}
+
 bool StelProjectorHammer::backward(Vec3d &v) const
 {
 	const double zsq = 1.-0.25*0.25*v[0]*v[0]-0.5*0.5*v[1]*v[1];
@@ -201,6 +309,16 @@ bool StelProjectorHammer::backward(Vec3d &v) const
 	return ret;
 }
 
+void StelProjectorHammer::project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorHammer>(n, in, out, flags);
+}
+
+void StelProjectorHammer::project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorHammer>(n, in, out, flags);
+}
+
 float StelProjectorHammer::fovToViewScalingFactor(float fov) const
 {
 	return fov;
@@ -228,6 +346,16 @@ QString StelProjectorCylinder::getDescriptionI18() const
 	return q_("The full name of this projection mode is <i>cylindrical equidistant projection</i>. With this projection all parallels are equally spaced.");
 }
 
+QByteArray StelProjectorCylinder::getForwardTransformShader() const
+{
+	return
+		"highp vec3 projectorForward(highp vec3 v)\n"
+		"{\n"
+		"    highp float r = length(v);\n"
+		"    return vec3(atan(v.x, -v.z), asin(clamp(v.y/r, -1., 1.)), r);\n"
+		"}\n";
+}
+
 bool StelProjectorCylinder::forward(Vec3f &v) const
 {
 	const float r = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
@@ -250,6 +378,16 @@ bool StelProjectorCylinder::backward(Vec3d &v) const
 	return rval;
 }
 
+void StelProjectorCylinder::project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorCylinder>(n, in, out, flags);
+}
+
+void StelProjectorCylinder::project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorCylinder>(n, in, out, flags);
+}
+
 float StelProjectorCylinder::fovToViewScalingFactor(float fov) const
 {
 	return fov;
@@ -275,6 +413,19 @@ QString StelProjectorMercator::getDescriptionI18() const
 	return q_("The mercator projection is one of the most used world map projection. It preserves direction and shapes but distorts size, in an increasing degree away from the equator.");
 }
 
+QByteArray StelProjectorMercator::getForwardTransformShader() const
+{
+	return
+		"highp vec3 projectorForward(highp vec3 v)\n"
+		"{\n"
+		"    highp float r = length(v);\n"
+		"    highp float sinDelta = v.y/r;\n"
+		"    if (abs(sinDelta) >= 1.)\n"
+		"        return vec3(atan(v.x, -v.z), sign(sinDelta)*1.0e30, r);\n"
+		"    return vec3(atan(v.x, -v.z), 0.5*log((1.+sinDelta)/(1.-sinDelta)), r);\n"
+		"}\n";
+}
+
 bool StelProjectorMercator::forward(Vec3f &v) const
 {
 	const float r = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
@@ -301,6 +452,16 @@ bool StelProjectorMercator::backward(Vec3d &v) const
 	return rval;
 }
 
+void StelProjectorMercator::project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorMercator>(n, in, out, flags);
+}
+
+void StelProjectorMercator::project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorMercator>(n, in, out, flags);
+}
+
 float StelProjectorMercator::fovToViewScalingFactor(float fov) const
 {
 	return fov;
@@ -327,6 +488,16 @@ QString StelProjectorOrthographic::getDescriptionI18() const
 	return q_("Orthographic projection is related to perspective projection, but the point of perspective is set to an infinite distance.");
 }
 
+QByteArray StelProjectorOrthographic::getForwardTransformShader() const
+{
+	return
+		"highp vec3 projectorForward(highp vec3 v)\n"
+		"{\n"
+		"    highp float r = length(v);\n"
+		"    return vec3(v.xy/r, r);\n"
+		"}\n";
+}
+
 bool StelProjectorOrthographic::forward(Vec3f &v) const
 {
 	const float r = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
@@ -353,6 +524,16 @@ bool StelProjectorOrthographic::backward(Vec3d &v) const
 	return true;
 }
 
+void StelProjectorOrthographic::project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorOrthographic>(n, in, out, flags);
+}
+
+void StelProjectorOrthographic::project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags) const
+{
+	projectArray<StelProjectorOrthographic>(n, in, out, flags);
+}
+
 float StelProjectorOrthographic::fovToViewScalingFactor(float fov) const
 {
 	return std::sin(fov);
@@ -51,6 +51,9 @@ public:
 		v[2] = r;
 		return false;
 	}
+	virtual QByteArray getForwardTransformShader() const;
+	virtual void project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags=NULL) const;
+	virtual void project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags=NULL) const;
 	bool backward(Vec3d &v) const;
 	float fovToViewScalingFactor(float fov) const;
 	float viewScalingFactorToFov(float vsf) const;
@@ -77,6 +80,9 @@ public:
 		v[2] = r;
 		return true;
 	}
+	virtual QByteArray getForwardTransformShader() const;
+	virtual void project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags=NULL) const;
+	virtual void project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags=NULL) const;
 	bool backward(Vec3d &v) const;
 	float fovToViewScalingFactor(float fov) const;
 	float viewScalingFactorToFov(float vsf) const;
@@ -111,21 +117,9 @@ public:
 		return true;
 	}
 
-	virtual void project(int n, const Vec3d* in, Vec3f* out)
-	{
-		Vec3d v;
-		for (int i = 0; i < n; ++i, ++out)
-		{
-			v = in[i];
-			modelViewTransform->forward(v);
-			out->set(v[0], v[1], v[2]);
-			StelProjectorStereographic::forward(*out);
-			out->set(viewportCenter[0] + flipHorz * pixelPerRad * (*out)[0],
-				viewportCenter[1] + flipVert * pixelPerRad * (*out)[1],
-				((*out)[2] - zNear) * oneOverZNearMinusZFar);
-		}
-	}
-
+	virtual QByteArray getForwardTransformShader() const;
+	virtual void project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags=NULL) const;
+	virtual void project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags=NULL) const;
 	bool backward(Vec3d &v) const;
 	float fovToViewScalingFactor(float fov) const;
 	float viewScalingFactorToFov(float vsf) const;
@@ -165,6 +159,9 @@ public:
 		v[2] = std::numeric_limits<float>::min();
 		return false;
 	}
+	virtual QByteArray getForwardTransformShader() const;
+	virtual void project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags=NULL) const;
+	virtual void project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags=NULL) const;
 	bool backward(Vec3d &v) const;
 	float fovToViewScalingFactor(float fov) const;
 	float viewScalingFactorToFov(float vsf) const;
@@ -182,20 +179,6 @@ public:
 	virtual QString getNameI18() const;
 	virtual QString getDescriptionI18() const;
 	virtual float getMaxFov() const {return 360.f;}
-	virtual void project(int n, const Vec3d* in, Vec3f* out)
-	{
-		Vec3d v;
-		for (int i = 0; i < n; ++i)
-		{
-			v = in[i];
-			modelViewTransform->forward(v);
-			out[i].set(v[0], v[1], v[2]);
-			StelProjectorHammer::forward(out[i]);
-			out[i][0] = viewportCenter[0] + flipHorz * pixelPerRad * out[i][0];
-			out[i][1] = viewportCenter[1] + flipVert * pixelPerRad * out[i][1];
-			out[i][2] = (out[i][2] - zNear) * oneOverZNearMinusZFar;
-		}
-	}
 	bool forward(Vec3f &v) const
 	{
 		// Hammer Aitoff
@@ -208,6 +191,9 @@ public:
 		v[2] = r;
 		return true;
 	}
+	virtual QByteArray getForwardTransformShader() const;
+	virtual void project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags=NULL) const;
+	virtual void project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags=NULL) const;
 	bool backward(Vec3d &v) const;
 	float fovToViewScalingFactor(float fov) const;
 	float viewScalingFactorToFov(float vsf) const;
@@ -233,6 +219,9 @@ public:
 	virtual QString getDescriptionI18() const;
 	virtual float getMaxFov() const {return 175.f * 4.f/3.f;} // assume aspect ration of 4/3 for getting a full 360 degree horizon
 	bool forward(Vec3f &win) const;
+	virtual QByteArray getForwardTransformShader() const;
+	virtual void project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags=NULL) const;
+	virtual void project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags=NULL) const;
 	bool backward(Vec3d &v) const;
 	float fovToViewScalingFactor(float fov) const;
 	float viewScalingFactorToFov(float vsf) const;
@@ -261,6 +250,9 @@ public:
 	virtual QString getDescriptionI18() const;
 	virtual float getMaxFov() const {return 175.f * 4.f/3.f;} // assume aspect ration of 4/3 for getting a full 360 degree horizon
 	bool forward(Vec3f &win) const;
+	virtual QByteArray getForwardTransformShader() const;
+	virtual void project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags=NULL) const;
+	virtual void project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags=NULL) const;
 	bool backward(Vec3d &v) const;
 	float fovToViewScalingFactor(float fov) const;
 	float viewScalingFactorToFov(float vsf) const;
@@ -289,6 +281,9 @@ public:
 	virtual QString getDescriptionI18() const;
 	virtual float getMaxFov() const {return 179.9999f;}
 	bool forward(Vec3f &win) const;
+	virtual QByteArray getForwardTransformShader() const;
+	virtual void project(int n, const Vec3d* in, Vec3f* out, unsigned char* flags=NULL) const;
+	virtual void project(int n, const Vec3f* in, Vec3f* out, unsigned char* flags=NULL) const;
 	bool backward(Vec3d &v) const;
 	float fovToViewScalingFactor(float fov) const;
 	float viewScalingFactorToFov(float vsf) const;
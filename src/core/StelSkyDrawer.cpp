@@ -421,6 +421,14 @@ bool StelSkyDrawer::drawPointSource(StelPainter* sPainter, const Vec3f& v, const
 	if (!(checkInScreen ? sPainter->getProjector()->projectCheck(v, win) : sPainter->getProjector()->project(v, win)))
 		return false;
 
+	return drawProjectedPointSource(sPainter, win, rcMag, color);
+}
+
+bool StelSkyDrawer::drawProjectedPointSource(StelPainter* sPainter, const Vec3f& win, const RCMag& rcMag, const Vec3f& color)
+{
+	if (rcMag.radius<=0.f)
+		return false;
+
 	const float radius = rcMag.radius;
 	// Random coef for star twinkling
 	const float tw = (flagStarTwinkle && flagHasAtmosphere) ? (1.f-twinkleAmount*rand()/RAND_MAX)*rcMag.luminance : rcMag.luminance;
@@ -78,6 +78,14 @@ public:
 
 	bool drawPointSource(StelPainter* sPainter, const Vec3f& v, const RCMag &rcMag, const Vec3f& bcolor, bool checkInScreen=false);
 
+	//! Draw the halo of a point source already projected, e.g. with the array StelProjector::project() method.
+	//! @param win the projected position of the source in the viewport 2D frame.
+	//! @return true if the source was drawn, i.e. if its radius is not null.
+	bool drawProjectedPointSource(StelPainter* sPainter, const Vec3f& win, const RCMag &rcMag, unsigned int bV)
+		{return drawProjectedPointSource(sPainter, win, rcMag, colorTable[bV]);}
+
+	bool drawProjectedPointSource(StelPainter* sPainter, const Vec3f& win, const RCMag &rcMag, const Vec3f& bcolor);
+
 	//! Terminate drawing of a 3D model, draw the halo
 	//! @param p the StelPainter instance to use for this drawing operation
 	//! @param v the 3d position of the source in J2000 reference frame
@@ -18,22 +18,251 @@
  */
 
 #include "StelSphericalIndex.hpp"
-#include <QVector>
 
-StelSphericalIndex::StelSphericalIndex(int maxObjPerNode, int maxLevel) : maxObjectsPerNode(maxObjPerNode)
+#include <QtAlgorithms>
+#include <QtConcurrent>
+
+//! Number of levels of the space filling curve, each using 2 bits after the 3 bits of the octant
+static const int KEY_LEVELS = 13;
+//! Below this number of objects, starting the threads costs more than the queries
+static const int PARALLEL_QUERY_MIN_ELEMENTS = 1000;
+
+static const Vec3d octahedronVertice[6] =
+{
+	Vec3d(0,0,1), Vec3d(1,0,0), Vec3d(0,1,0), Vec3d(-1,0,0), Vec3d(0,-1,0), Vec3d(0,0,-1)
+};
+
+static const int octahedronVerticeIndice[8][3] =
+{
+	{0,2,1}, {0,1,4}, {0,4,3}, {0,3,2}, {5,1,2}, {5,4,1}, {5,3,4}, {5,2,3}
+};
+
+//! Return the octahedron triangle containing the given point, as in octahedronVerticeIndice.
+static int getOctant(const Vec3d& v)
+{
+	static const int octants[2][2][2] = {{{6,7},{5,4}},{{2,3},{1,0}}};
+	return octants[v[2]>=0.][v[0]>=0.][v[1]>=0.];
+}
+
+//! Split a triangle in 4, in the same order for the tree and the keys.
+static void splitTriangle(const Vec3d& c0, const Vec3d& c1, const Vec3d& c2, Vec3d children[4][3])
+{
+	Vec3d e0(c1[0]+c2[0], c1[1]+c2[1], c1[2]+c2[2]);
+	e0.normalize();
+	Vec3d e1(c2[0]+c0[0], c2[1]+c0[1], c2[2]+c0[2]);
+	e1.normalize();
+	Vec3d e2(c0[0]+c1[0], c0[1]+c1[1], c0[2]+c1[2]);
+	e2.normalize();
+
+	children[0][0] = e1; children[0][1] = c0; children[0][2] = e2;
+	children[1][0] = e0; children[1][1] = e2; children[1][2] = c1;
+	children[2][0] = c2; children[2][1] = e1; children[2][2] = e0;
+	children[3][0] = e2; children[3][1] = e0; children[3][2] = e1;
+}
+
+//! The vertices of the edge of each corner subtriangle shared with the middle one, in the contour order.
+static const int innerEdges[3][2] = {{2,0}, {0,1}, {1,2}};
+
+//! A query run by getIntersectingRegions().
+struct IntersectingRegionsTask
+{
+	const StelSphericalIndex* index;
+	SphericalRegionP region;
+	QVector<StelRegionObject*> result;
+};
+
+struct AppendFuncObject
+{
+	AppendFuncObject(QVector<StelRegionObject*>& aresult) : result(aresult) {;}
+	void operator()(StelRegionObject* obj)
+	{
+		result.append(obj);
+	}
+	QVector<StelRegionObject*>& result;
+};
+
+static void runIntersectingRegionsTask(IntersectingRegionsTask& task)
+{
+	AppendFuncObject func(task.result);
+	task.index->processIntersectingRegions(task.region.data(), func);
+}
+
+StelSphericalIndex::StelSphericalIndex(int maxObjPerNode, int amaxLevel) : maxObjectsPerNode(maxObjPerNode), maxLevel(amaxLevel)
+{
+	nodes.append(Node());
+}
+
+StelSphericalIndex::StelSphericalIndex(const QVector<StelRegionObjectP>& objects, int maxObjPerNode, int amaxLevel)
+	: maxObjectsPerNode(maxObjPerNode), maxLevel(amaxLevel)
 {
-	rootNode = new RootNode(maxObjectsPerNode, maxLevel);
+	nodes.append(Node());
+	bulkLoad(objects);
 }
 
 StelSphericalIndex::~StelSphericalIndex()
 {
-	delete rootNode;
 }
 
 void StelSphericalIndex::insert(StelRegionObjectP regObj)
 {
-	NodeElem el(regObj);
-	rootNode->insert(el, 0);
+	pending.append(NodeElem(regObj));
 }
 
+void StelSphericalIndex::bulkLoad(const QVector<StelRegionObjectP>& objects)
+{
+	clear();
+	pending.reserve(objects.size());
+	foreach (const StelRegionObjectP& obj, objects)
+		pending.append(NodeElem(obj));
+	build();
+}
+
+void StelSphericalIndex::clear()
+{
+	nodes.clear();
+	nodes.append(Node());
+	elements.clear();
+	pending.clear();
+}
+
+QVector<QVector<StelRegionObject*> > StelSphericalIndex::getIntersectingRegions(const QVector<SphericalRegionP>& regions) const
+{
+	// The tree must be complete before the threads start reading it
+	build();
+
+	QVector<IntersectingRegionsTask> tasks(regions.size());
+	for (int i=0;i<regions.size();++i)
+	{
+		tasks[i].index = this;
+		tasks[i].region = regions.at(i);
+	}
+	if (tasks.size()>1 && elements.size()>=PARALLEL_QUERY_MIN_ELEMENTS)
+		QtConcurrent::blockingMap(tasks, runIntersectingRegionsTask);
+	else
+	{
+		for (int i=0;i<tasks.size();++i)
+			runIntersectingRegionsTask(tasks[i]);
+	}
+
+	QVector<QVector<StelRegionObject*> > results;
+	results.reserve(tasks.size());
+	foreach (const IntersectingRegionsTask& task, tasks)
+		results.append(task.result);
+	return results;
+}
 
+quint32 StelSphericalIndex::computeKey(const Vec3d& v)
+{
+	const int octant = getOctant(v);
+	quint32 key = octant << (2*KEY_LEVELS);
+	Vec3d c0 = octahedronVertice[octahedronVerticeIndice[octant][0]];
+	Vec3d c1 = octahedronVertice[octahedronVerticeIndice[octant][1]];
+	Vec3d c2 = octahedronVertice[octahedronVerticeIndice[octant][2]];
+	for (int level=1;level<=KEY_LEVELS;++level)
+	{
+		Vec3d children[4][3];
+		splitTriangle(c0, c1, c2, children);
+		// The point is in a corner triangle if it is inside its inner edge, else in the middle one
+		int i = 3;
+		for (int j=0;j<3;++j)
+		{
+			const Vec3d& a = children[j][innerEdges[j][0]];
+			const Vec3d& b = children[j][innerEdges[j][1]];
+			if ((b^a)*v>=0.)
+			{
+				i = j;
+				break;
+			}
+		}
+		key |= i << (2*(KEY_LEVELS-level));
+		c0 = children[i][0];
+		c1 = children[i][1];
+		c2 = children[i][2];
+	}
+	return key;
+}
+
+void StelSphericalIndex::build() const
+{
+	if (pending.isEmpty())
+		return;
+
+	QVector<NodeElem> elems = elements;
+	elems << pending;
+	pending.clear();
+	for (int i=0;i<elems.size();++i)
+		elems[i].key = computeKey(elems.at(i).cap.n);
+	qStableSort(elems.begin(), elems.end(), keyLessThan);
+
+	nodes.clear();
+	nodes.append(Node());
+	elements.clear();
+	elements.reserve(elems.size());
+	buildNode(0, elems, 0);
+}
+
+void StelSphericalIndex::buildNode(int nodeIndex, const QVector<NodeElem>& elems, int level) const
+{
+	nodes[nodeIndex].elemBegin = elements.size();
+	if (level>=maxLevel || elems.size()<=maxObjectsPerNode)
+	{
+		elements << elems;
+		nodes[nodeIndex].elemEnd = elements.size();
+		nodes[nodeIndex].subtreeEnd = elements.size();
+		return;
+	}
+
+	// Create the children: the 8 triangles of the octahedron for the root node, else 4 subtriangles
+	const int childCount = (level==0) ? 8 : 4;
+	Vec3d triangles[8][3];
+	if (level==0)
+	{
+		for (int i=0;i<8;++i)
+			for (int j=0;j<3;++j)
+				triangles[i][j] = octahedronVertice[octahedronVerticeIndice[i][j]];
+	}
+	else
+	{
+		const QVector<Vec3d>& c = nodes.at(nodeIndex).triangle.getConvexContour();
+		Q_ASSERT(c.size()==3);
+		Q_ASSERT((c.at(1)^c.at(0))*c.at(2) >= 0.0);
+		splitTriangle(c.at(0), c.at(1), c.at(2), triangles);
+	}
+	const int firstChild = nodes.size();
+	nodes[nodeIndex].firstChild = firstChild;
+	nodes[nodeIndex].childCount = childCount;
+	for (int i=0;i<childCount;++i)
+	{
+		Node child;
+		child.triangle = SphericalConvexPolygon(triangles[i][0], triangles[i][1], triangles[i][2]);
+		Q_ASSERT(child.triangle.checkValid());
+		nodes.append(child);
+	}
+
+	// Move each element in the child containing it, trying first the one containing its center
+	const int shift = (level==0) ? 2*KEY_LEVELS : 2*(KEY_LEVELS-level);
+	const quint32 mask = (level==0) ? 7 : 3;
+	QVector<NodeElem> childElems[8];
+	for (QVector<NodeElem>::ConstIterator iter=elems.constBegin();iter!=elems.constEnd();++iter)
+	{
+		const SphericalRegionP region = iter->obj->getRegion();
+		const int hint = (shift>=0) ? (int)((iter->key >> shift) & mask) : 0;
+		int found = -1;
+		if (((SphericalRegion*)&(nodes.at(firstChild+hint).triangle))->contains(region.data()))
+			found = hint;
+		for (int i=0;i<childCount && found<0;++i)
+		{
+			if (i!=hint && ((SphericalRegion*)&(nodes.at(firstChild+i).triangle))->contains(region.data()))
+				found = i;
+		}
+		if (found>=0)
+			childElems[found].append(*iter);
+		else
+			elements.append(*iter);
+	}
+	nodes[nodeIndex].elemEnd = elements.size();
+
+	for (int i=0;i<childCount;++i)
+		buildNode(firstChild+i, childElems[i], level+1);
+	nodes[nodeIndex].subtreeEnd = elements.size();
+}
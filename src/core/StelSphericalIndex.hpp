@@ -22,320 +22,219 @@
 
 #include "StelRegionObject.hpp"
 
+#include <QVector>
+
 //! @class StelSphericalIndex
 //! Container allowing to store and query SphericalRegion.
+//! The sphere is split in the 8 triangles of an octahedron, each triangle being recursively
+//! split in 4 when it contains too many objects. The nodes and the objects are stored in two
+//! flat arrays, the objects of a node being followed by those of its descendants, so that the
+//! queries read contiguous memory.
+//! The tree is built in one pass from the objects sorted along the space filling curve defined
+//! by the subdivision. Objects inserted one by one are kept aside and the tree is rebuilt on the
+//! next query, so that the whole catalog should be inserted before querying.
+//! The queries must not be called concurrently from several threads, use getIntersectingRegions()
+//! to run many queries in parallel.
 class StelSphericalIndex
 {
 public:
 	StelSphericalIndex(int maxObjectsPerNode = 100, int maxLevel=7);
+	//! Create an index containing the given objects.
+	StelSphericalIndex(const QVector<StelRegionObjectP>& objects, int maxObjectsPerNode = 100, int maxLevel=7);
 	virtual ~StelSphericalIndex();
 
 	//! Insert the given object in the StelSphericalIndex.
 	void insert(StelRegionObjectP obj);
 
+	//! Replace the content of the StelSphericalIndex by the given objects.
+	//! This is much faster than inserting the objects one by one.
+	void bulkLoad(const QVector<StelRegionObjectP>& objects);
+
 	//! Process all the objects intersecting the given region using the passed function object.
 	template<class FuncObject> void processIntersectingRegions(const SphericalRegion* region, FuncObject& func) const
 	{
-		rootNode->processIntersectingRegions(region, func);
+		build();
+		processIntersectingRegions(0, region, func);
 	}
 
 	//! Process all the objects intersecting the given region using the passed function object.
 	template<class FuncObject> void processIntersectingPointInRegions(const SphericalRegion* region, FuncObject& func) const
 	{
-		rootNode->processIntersectingPointInRegions(region, func);
+		build();
+		processIntersectingPointInRegions(0, region, func);
 	}
 	
 	//! Process all the objects intersecting the given region using the passed function object.
 	template<class FuncObject> void processBoundingCapIntersectingRegions(const SphericalCap& cap, FuncObject& func) const
 	{
-		rootNode->processBoundingCapIntersectingRegions(cap, func);
+		build();
+		processBoundingCapIntersectingRegions(0, cap, func);
 	}
 	
 	//! Process all the objects contained in the given region using the passed function object.
 	template<class FuncObject> void processContainedRegions(const SphericalRegion* region, FuncObject& func) const
 	{
-		rootNode->processContainedRegions(region, func);
+		build();
+		processContainedRegions(0, region, func);
 	}
 
 	//! Process all the objects intersecting the given region using the passed function object.
 	template<class FuncObject> void processAll(FuncObject& func) const
 	{
-		rootNode->processAll(func);
+		build();
+		processAll(0, func);
 	}
 
+	//! Find the objects intersecting each of the given regions.
+	//! When there are several regions and many objects, the regions are processed in parallel.
+	//! @return for each region, the objects intersecting it.
+	QVector<QVector<StelRegionObject*> > getIntersectingRegions(const QVector<SphericalRegionP>& regions) const;
+
 	//! Remove all the elements in the container.
-	void clear()
-	{
-		rootNode->clear();
-	}
+	void clear();
 
 	//! Return the total number of elements in the container.
 	unsigned int count()
 	{
-		CountFunc func;
-		processAll<CountFunc>(func);
-		return func.nb;
+		build();
+		return elements.size();
 	}
 
 private:
-	struct CountFunc
-	{
-		CountFunc() : nb(0) {;}
-		void operator()(const StelRegionObject*)
-		{
-			++nb;
-		}
-		unsigned int nb;
-	};
-
 	//! The elements stored in the container.
 	struct NodeElem
 	{
-		NodeElem() {;}
-		NodeElem(StelRegionObjectP aobj) : obj(aobj), cap(obj->getRegion()->getBoundingCap()) {;}
+		NodeElem() : key(0) {;}
+		NodeElem(StelRegionObjectP aobj) : obj(aobj), cap(obj->getRegion()->getBoundingCap()), key(0) {;}
 		StelRegionObjectP obj;
 		SphericalCap cap;
+		//! Position of the center of the bounding cap along the space filling curve
+		quint32 key;
 	};
 
-	//! @class Node
-	//! The base node class. Final nodes contain a list of NodeElem, other
-	//! nodes link to child nodes subdivising it spatially.
+	//! @struct Node
+	//! Final nodes only contain elements, other nodes also have 4 child nodes
+	//! subdivising them spatially, or 8 for the root node.
 	struct Node
 	{
-		virtual ~Node() {;}
-		QVector<NodeElem> elements;
-		QVector<Node> children;
+		Node() : firstChild(0), childCount(0), elemBegin(0), elemEnd(0), subtreeEnd(0) {;}
+		//! The triangle covered by the node, unused for the root node which covers the whole sphere.
 		SphericalConvexPolygon triangle;
-		//! Split each triangles in to 4 subtriangles.
-		virtual void split()
-		{
-			// Default implementation for HTM triangle more than level 0
-			Q_ASSERT(children.empty());
-			Q_ASSERT(triangle.getConvexContour().size() == 3);
-
-			const Vec3d& c0 = triangle.getConvexContour().at(0);
-			const Vec3d& c1 = triangle.getConvexContour().at(1);
-			const Vec3d& c2 = triangle.getConvexContour().at(2);
+		//! Index of the first child node, the children being contiguous.
+		int firstChild;
+		int childCount;
+		//! Range of the elements stored in this node, i.e. not contained in a single child.
+		int elemBegin, elemEnd;
+		//! End of the elements of the node and all its descendants, starting at elemBegin.
+		int subtreeEnd;
+	};
 
-			Q_ASSERT((c1^c0)*c2 >= 0.0);
-			Vec3d e0(c1[0]+c2[0], c1[1]+c2[1], c1[2]+c2[2]);
-			e0.normalize();
-			Vec3d e1(c2[0]+c0[0], c2[1]+c0[1], c2[2]+c0[2]);
-			e1.normalize();
-			Vec3d e2(c0[0]+c1[0], c0[1]+c1[1], c0[2]+c1[2]);
-			e2.normalize();
+	//! Rebuild the tree if objects were inserted since the last build.
+	void build() const;
+	//! Fill the given node and its descendants with the given elements, sorted by key.
+	void buildNode(int nodeIndex, const QVector<NodeElem>& elems, int level) const;
+	//! Compute the key of an element from the center of its bounding cap.
+	static quint32 computeKey(const Vec3d& v);
+	static bool keyLessThan(const NodeElem& e1, const NodeElem& e2) {return e1.key < e2.key;}
 
-			children.resize(4);
-			children[0].triangle = SphericalConvexPolygon(e1,c0,e2);
-			Q_ASSERT(children[0].triangle.checkValid());
-			children[1].triangle = SphericalConvexPolygon(e0,e2,c1);
-			Q_ASSERT(children[1].triangle.checkValid());
-			children[2].triangle = SphericalConvexPolygon(c2,e1,e0);
-			Q_ASSERT(children[2].triangle.checkValid());
-			children[3].triangle = SphericalConvexPolygon(e2,e0,e1);
-			Q_ASSERT(children[3].triangle.checkValid());
+	//! Process all the objects intersecting the given region using the passed function object.
+	template<class FuncObject> void processIntersectingRegions(int nodeIndex, const SphericalRegion* region, FuncObject& func) const
+	{
+		const Node& node = nodes.at(nodeIndex);
+		for (int i=node.elemBegin;i<node.elemEnd;++i)
+		{
+			const NodeElem& el = elements.at(i);
+			if (region->intersects(el.obj->getRegion().data()))
+				func(el.obj.data());
 		}
-
-		//! Suppress everything
-		void clear()
+		for (int c=node.firstChild;c<node.firstChild+node.childCount;++c)
 		{
-			elements.clear();
-			children.clear();
+			const Node& child = nodes.at(c);
+			if (region->contains(child.triangle))
+				processAll(c, func);
+			else if (region->intersects(child.triangle))
+				processIntersectingRegions(c, region, func);
 		}
-	};
+	}
 
-	//! @class RootNode
-	//! The first Node of a tree. It has a special subdivision of the sphere in an octahedron.
-	class RootNode : public Node
+	//! Process all the objects with point intersecting the given region using the passed function object.
+	template<class FuncObject> void processIntersectingPointInRegions(int nodeIndex, const SphericalRegion* region, FuncObject& func) const
 	{
-		public:
-			RootNode(int amaxObjectsPerNode, int amaxLevel) : maxObjectsPerNode(amaxObjectsPerNode), maxLevel(amaxLevel)
-			{
-			}
-
-			virtual ~RootNode() {}
-			
-			//! Create the 8 triangles of the octahedron.
-			virtual void split()
-			{
-				static const Vec3d vertice[6] =
-				{
-					Vec3d(0,0,1), Vec3d(1,0,0), Vec3d(0,1,0), Vec3d(-1,0,0), Vec3d(0,-1,0), Vec3d(0,0,-1)
-				};
-
-				static const int verticeIndice[8][3] =
-				{
-					{0,2,1}, {0,1,4}, {0,4,3}, {0,3,2}, {5,1,2}, {5,4,1}, {5,3,4}, {5,2,3}
-				};
-
-				// Create the 8 base triangles
-				Node node;
-				for (int i=0;i<8;++i)
-				{
-					node.triangle = SphericalConvexPolygon(vertice[verticeIndice[i][0]], vertice[verticeIndice[i][1]], vertice[verticeIndice[i][2]]);
-					Q_ASSERT(node.triangle.checkValid());
-					children.append(node);
-				}
-			}
-
-			//! Insert the given element in the StelSphericalIndex.
-			void insert(const NodeElem& el, int level)
-			{
-				insert(*this, el, level);
-			}
-
-			//! Process all the objects intersecting the given region using the passed function object.
-			template<class FuncObject> void processIntersectingRegions(const SphericalRegion* region, FuncObject& func) const
-			{
-				processIntersectingRegions(*this, region, func);
-			}
-			
-			//! Process all the objects intersecting the given region using the passed function object.
-			template<class FuncObject> void processIntersectingPointInRegions(const SphericalRegion* region, FuncObject& func) const
-			{
-				processIntersectingPointInRegions(*this, region, func);
-			}
-			
-			template<class FuncObject> void processBoundingCapIntersectingRegions(const SphericalCap& cap, FuncObject& func) const
-			{
-				processBoundingCapIntersectingRegions(*this, cap, func);
-			}
-
-			//! Process all the objects contained the given region using the passed function object.
-			template<class FuncObject> void processContainedRegions(const SphericalRegion* region, FuncObject& func) const
-			{
-				processContainedRegions(*this, region, func);
-			}
-
-			//! Process all the objects intersecting the given region using the passed function object.
-			template<class FuncObject> void processAll(FuncObject& func) const
-			{
-				processAll(*this, func);
-			}
-
-		private:
-			//! Insert the given element in the given node.
-			void insert(Node& node, const NodeElem& el, int level)
-			{
-				if (node.children.isEmpty())
-				{
-					node.elements.append(el);
-					// If we have too many objects in the node, we split it.
-					if (level<maxLevel && node.elements.size() > maxObjectsPerNode)
-					{
-						node.split();
-						const QVector<NodeElem> nodeElems = node.elements;
-						node.elements.clear();
-						// Re-insert the elements
-						for (QVector<NodeElem>::ConstIterator iter = nodeElems.constBegin();iter != nodeElems.constEnd(); ++iter)
-						{
-							insert(node, *iter, level);
-						}
-					}
-					return;
-				}
-
-				// If we have children and one of them contains the element, store it in a sub-level
-				for (QVector<Node>::iterator iter = node.children.begin(); iter!=node.children.end(); ++iter)
-				{
-					if (((SphericalRegion*)&(iter->triangle))->contains(el.obj->getRegion().data()))
-					{
-						insert(*iter, el, level+1);
-						return;
-					}
-				}
-				// Else store it here
-				node.elements.append(el);
-			}
-
-			//! Process all the objects intersecting the given region using the passed function object.
-			template<class FuncObject> void processIntersectingRegions(const Node& node, const SphericalRegion* region, FuncObject& func) const
-			{
-				foreach (const NodeElem& el, node.elements)
-				{
-					if (region->intersects(el.obj->getRegion().data()))
-						func(&(*el.obj));
-				}
-				foreach (const Node& child, node.children)
-				{
-					if (region->contains(child.triangle))
-						processAll(child, func);
-					else if (region->intersects(child.triangle))
-						processIntersectingRegions(child, region, func);
-				}
-			}
-			
-			//! Process all the objects with point intersecting the given region using the passed function object.
-			template<class FuncObject> void processIntersectingPointInRegions(const Node& node, const SphericalRegion* region, FuncObject& func) const
-			{
-				foreach (const NodeElem& el, node.elements)
-				{
-					if (region->contains(el.obj->getPointInRegion()))
-						func(&(*el.obj));
-				}
-				foreach (const Node& child, node.children)
-				{
-					if (region->contains(child.triangle))
-						processAll(child, func);
-					else if (region->intersects(child.triangle))
-						processIntersectingPointInRegions(child, region, func);
-				}
-			}
-			
-			template<class FuncObject> void processBoundingCapIntersectingRegions(const Node& node, const SphericalCap& cap, FuncObject& func) const
-			{
-				foreach (const NodeElem& el, node.elements)
-				{
-					if (cap.intersects(el.cap))
-						func(&(*el.obj));
-				}
-				foreach (const Node& child, node.children)
-				{
-					if (cap.contains(child.triangle))
-						processAll(child, func);
-					else if (cap.intersects(child.triangle))
-						processBoundingCapIntersectingRegions(child, cap, func);
-				}
-			}
+		const Node& node = nodes.at(nodeIndex);
+		for (int i=node.elemBegin;i<node.elemEnd;++i)
+		{
+			const NodeElem& el = elements.at(i);
+			if (region->contains(el.obj->getPointInRegion()))
+				func(el.obj.data());
+		}
+		for (int c=node.firstChild;c<node.firstChild+node.childCount;++c)
+		{
+			const Node& child = nodes.at(c);
+			if (region->contains(child.triangle))
+				processAll(c, func);
+			else if (region->intersects(child.triangle))
+				processIntersectingPointInRegions(c, region, func);
+		}
+	}
 
-			//! Process all the objects contained the given region using the passed function object.
-			template<class FuncObject> void processContainedRegions(const Node& node, const SphericalRegion* region, FuncObject& func) const
-			{
-				foreach (const NodeElem& el, node.elements)
-				{
-					if (region->contains(el.obj->getRegion().data()))
-						func(&(*el.obj));
-				}
-				foreach (const Node& child, node.children)
-				{
-					if (region->contains(child.triangle))
-						processAll(child, func);
-					else if (region->intersects(child.triangle))
-						processContainedRegions(child, region, func);
-				}
-			}
+	template<class FuncObject> void processBoundingCapIntersectingRegions(int nodeIndex, const SphericalCap& cap, FuncObject& func) const
+	{
+		const Node& node = nodes.at(nodeIndex);
+		for (int i=node.elemBegin;i<node.elemEnd;++i)
+		{
+			const NodeElem& el = elements.at(i);
+			if (cap.intersects(el.cap))
+				func(el.obj.data());
+		}
+		for (int c=node.firstChild;c<node.firstChild+node.childCount;++c)
+		{
+			const Node& child = nodes.at(c);
+			if (cap.contains(child.triangle))
+				processAll(c, func);
+			else if (cap.intersects(child.triangle))
+				processBoundingCapIntersectingRegions(c, cap, func);
+		}
+	}
 
-			//! Process all the objects intersecting the given region using the passed function object.
-			template<class FuncObject> void processAll(const Node& node, FuncObject& func) const
-			{
-				foreach (const NodeElem& el, node.elements)
-					func(&(*el.obj));
-				foreach (const Node& child, node.children)
-					processAll(child, func);
-			}
+	//! Process all the objects contained the given region using the passed function object.
+	template<class FuncObject> void processContainedRegions(int nodeIndex, const SphericalRegion* region, FuncObject& func) const
+	{
+		const Node& node = nodes.at(nodeIndex);
+		for (int i=node.elemBegin;i<node.elemEnd;++i)
+		{
+			const NodeElem& el = elements.at(i);
+			if (region->contains(el.obj->getRegion().data()))
+				func(el.obj.data());
+		}
+		for (int c=node.firstChild;c<node.firstChild+node.childCount;++c)
+		{
+			const Node& child = nodes.at(c);
+			if (region->contains(child.triangle))
+				processAll(c, func);
+			else if (region->intersects(child.triangle))
+				processContainedRegions(c, region, func);
+		}
+	}
 
-			//! The maximum number of objects per node.
-			int maxObjectsPerNode;
-			//! The maximum level of the grid. Prevents grid split into too small triangles if unecessary.
-			int maxLevel;
-	};
+	//! Process all the objects of the node and its descendants, which are contiguous.
+	template<class FuncObject> void processAll(int nodeIndex, FuncObject& func) const
+	{
+		const Node& node = nodes.at(nodeIndex);
+		for (int i=node.elemBegin;i<node.subtreeEnd;++i)
+			func(elements.at(i).obj.data());
+	}
 
-	//! The maximum allowed number of object per node.
+	//! The maximum number of objects per node.
 	int maxObjectsPerNode;
-
-	RootNode* rootNode;
+	//! The maximum level of the grid. Prevents grid split into too small triangles if unecessary.
+	int maxLevel;
+
+	//! The nodes of the tree, the root node first.
+	mutable QVector<Node> nodes;
+	//! The elements of all the nodes, in depth first order.
+	mutable QVector<NodeElem> elements;
+	//! The elements inserted since the last build.
+	mutable QVector<NodeElem> pending;
 };
 
 #endif // _STELSPHERICALINDEX_HPP_
-
-
@@ -161,6 +161,17 @@ bool StelTexture::loadFromMemory(const char *data, int width, int height, GLint
 	return true;
 }
 
+bool StelTexture::updateFromMemory(const char *data, int x, int y, int awidth, int aheight, GLint format, GLint type)
+{
+	if (id==0 || x<0 || y<0 || x+awidth>width || y+aheight>height)
+		return false;
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, id);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, awidth, aheight, format, type, data);
+	return true;
+}
+
 void StelTexture::onNetworkReply()
 {
 	Q_ASSERT(loader == NULL);
@@ -270,7 +281,9 @@ void StelTexture::loadData(const char *data, int width, int height, GLint format
 	this->width = width;
 	this->height = height;
 	glActiveTexture(GL_TEXTURE0);
-	glGenTextures(1, &id);
+	// Memory textures may be loaded several times: keep the same texture object
+	if (id==0)
+		glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D, id);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, loadParams.filtering);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, loadParams.filtering);
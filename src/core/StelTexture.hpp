@@ -69,6 +69,10 @@ public:
 	//! Load image data from in memory data.
 	bool loadFromMemory(const char *data, int width, int height, GLint format, GLint type, GLint internalFormat = 0);
 
+	//! Replace a rectangle of a texture previously loaded with loadFromMemory().
+	//! @return false if the texture is not loaded or the rectangle is not inside it.
+	bool updateFromMemory(const char *data, int x, int y, int width, int height, GLint format, GLint type);
+
 	//! Return whether the texture can be binded, i.e. it is fully loaded
 	bool canBind() const {return id!=0;}
 
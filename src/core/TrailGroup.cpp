@@ -24,67 +24,213 @@
 #include "StelObject.hpp"
 #include "Planet.hpp"
 
-TrailGroup::TrailGroup(float te) : timeExtent(te), opacity(1.f)
+#include <cmath>
+
+//! Distance in days from the time origin beyond which the times are shifted, keeping them accurate as floats
+static const double MAX_TIME_ORIGIN_OFFSET = 1000.;
+
+TrailGroup::TrailGroup(float te, int maxPts) : timeExtent(te), maxPoints(qMax(2, maxPts)), firstPoint(0), nbPoints(0), timeOrigin(0.),
+	vertexBuffer(QOpenGLBuffer::VertexBuffer), uploadAll(true), opacity(1.f)
 {
 	j2000ToTrailNative=Mat4d::identity();
 	j2000ToTrailNativeInverted=Mat4d::identity();
 }
 
-static QVector<Vec3d> vertexArray;
+TrailGroup::~TrailGroup()
+{
+	vertexBuffer.destroy();
+}
+
 static QVector<Vec4f> colorArray;
 void TrailGroup::draw(StelCore* core, StelPainter* sPainter)
 {
+	if (nbPoints<2)
+		return;
+
+	// Avoid drawing the trails if the object is the home planet
+	const QString& planetName = core->getCurrentLocation().planetName;
+	if (planetName!=homePlanetName)
+	{
+		homePlanetName = planetName;
+		for (QList<Trail>::Iterator iter=allTrails.begin();iter!=allTrails.end();++iter)
+		{
+			Planet* hpl = dynamic_cast<Planet*>(iter->stelObject.data());
+			iter->isHomePlanet = hpl!=NULL && hpl->getEnglishName()==homePlanetName;
+		}
+	}
+
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	float currentTime = core->getJDay();
+	const float currentTime = core->getJDay()-timeOrigin;
 	StelProjector::ModelViewTranformP transfo = core->getJ2000ModelViewTransform();
 	transfo->combine(j2000ToTrailNativeInverted);
 	sPainter->setProjector(core->getProjection(transfo));
-	foreach (const Trail& trail, allTrails)
+
+	if (StelPainter::getFlagGpuProjection())
 	{
-		Planet* hpl = dynamic_cast<Planet*>(trail.stelObject.data());
-		if (hpl!=NULL)
+		uploadPoints();
+		if (vertexBuffer.isCreated())
 		{
-			// Avoid drawing the trails if the object is the home planet
-			QString homePlanetName = hpl==NULL ? "" : hpl->getEnglishName();
-			if (homePlanetName==StelApp::getInstance().getCore()->getCurrentLocation().planetName)
-				continue;
+			QVector<int> vertexOffsets;
+			QVector<Vec4f> colors;
+			for (int k=0;k<allTrails.size();++k)
+			{
+				const Trail& trail = allTrails.at(k);
+				if (trail.isHomePlanet)
+					continue;
+				vertexOffsets.append(sizeof(float) + k*sizeof(Vec3f));
+				colors.append(Vec4f(trail.color[0], trail.color[1], trail.color[2], opacity));
+			}
+			const int stride = sizeof(float) + allTrails.size()*sizeof(Vec3f);
+			if (sPainter->drawFadingLineStripsGpuProjection(vertexBuffer, 0, vertexOffsets, colors, firstPoint, nbPoints, currentTime, timeExtent, stride))
+				return;
 		}
-		const QList<Vec3d>& posHistory = trail.posHistory;
-		vertexArray.resize(posHistory.size());
-		colorArray.resize(posHistory.size());
-		for (int i=0;i<posHistory.size();++i)
+	}
+
+	colorArray.resize(nbPoints);
+	const float* pointTimes = times.constData()+firstPoint;
+	for (int k=0;k<allTrails.size();++k)
+	{
+		const Trail& trail = allTrails.at(k);
+		if (trail.isHomePlanet)
+			continue;
+		for (int i=0;i<nbPoints;++i)
 		{
-			float colorRatio = 1.f-(currentTime-times.at(i))/timeExtent;
+			float colorRatio = 1.f-(currentTime-pointTimes[i])/timeExtent;
 			colorArray[i].set(trail.color[0], trail.color[1], trail.color[2], colorRatio*opacity);
-			vertexArray[i]=posHistory.at(i);
 		}
-		sPainter->setVertexPointer(3, GL_DOUBLE, vertexArray.constData());
+		sPainter->setVertexPointer(3, GL_DOUBLE, positions.constData()+2*k*maxPoints+firstPoint);
 		sPainter->setColorPointer(4, GL_FLOAT, colorArray.constData());
 		sPainter->enableClientStates(true, false, true);
-		sPainter->drawFromArray(StelPainter::LineStrip, vertexArray.size(), 0, true);
+		sPainter->drawFromArray(StelPainter::LineStrip, nbPoints, 0, true);
 		sPainter->enableClientStates(false);
 	}
 }
 
-// Add 1 point to all the curves at current time and suppress too old points
-void TrailGroup::update()
+void TrailGroup::uploadPoints()
 {
-	times.append(StelApp::getInstance().getCore()->getJDay());
-	for (QList<Trail>::Iterator iter=allTrails.begin();iter!=allTrails.end();++iter)
+	if (!vertexBuffer.isCreated())
 	{
-		iter->posHistory.append(j2000ToTrailNative*iter->stelObject->getJ2000EquatorialPos(StelApp::getInstance().getCore()));
+		if (!vertexBuffer.create())
+			return;
+		uploadAll = true;
 	}
-	if (StelApp::getInstance().getCore()->getJDay()-times.at(0)>timeExtent)
+	vertexBuffer.bind();
+	const int vertexSize = (1+3*allTrails.size())*sizeof(float);
+	QVector<float> vertices;
+	if (uploadAll)
 	{
-		times.pop_front();
-		for (QList<Trail>::Iterator iter=allTrails.begin();iter!=allTrails.end();++iter)
+		getVertices(0, 2*maxPoints, vertices);
+		vertexBuffer.allocate(vertices.constData(), 2*maxPoints*vertexSize);
+	}
+	else
+	{
+		// Each run of consecutive slots is written at once, in both copies of the ring buffers
+		qSort(dirtySlots);
+		int i = 0;
+		while (i<dirtySlots.size())
+		{
+			const int first = dirtySlots.at(i);
+			int count = 1;
+			while (i+count<dirtySlots.size() && dirtySlots.at(i+count)==first+count)
+				++count;
+			getVertices(first, count, vertices);
+			vertexBuffer.write(first*vertexSize, vertices.constData(), count*vertexSize);
+			vertexBuffer.write((first+maxPoints)*vertexSize, vertices.constData(), count*vertexSize);
+			i += count;
+		}
+	}
+	vertexBuffer.release();
+	uploadAll = false;
+	dirtySlots.clear();
+}
+
+void TrailGroup::getVertices(int first, int count, QVector<float>& vertices) const
+{
+	const int nbTrails = allTrails.size();
+	vertices.resize(count*(1+3*nbTrails));
+	float* v = vertices.data();
+	for (int i=first;i<first+count;++i)
+	{
+		*v++ = times.at(i);
+		for (int k=0;k<nbTrails;++k)
 		{
-			iter->posHistory.pop_front();
+			const Vec3d& p = positions.at(2*k*maxPoints+i);
+			*v++ = p[0];
+			*v++ = p[1];
+			*v++ = p[2];
 		}
 	}
 }
 
+void TrailGroup::setPoint(int slot, double jd)
+{
+	StelCore* core = StelApp::getInstance().getCore();
+	times[slot] = times[slot+maxPoints] = jd-timeOrigin;
+	for (int k=0;k<allTrails.size();++k)
+	{
+		const int index = 2*k*maxPoints+slot;
+		positions[index] = positions[index+maxPoints] = j2000ToTrailNative*allTrails.at(k).stelObject->getJ2000EquatorialPos(core);
+	}
+
+	if (uploadAll || dirtySlots.contains(slot))
+		return;
+	if (dirtySlots.size()<maxPoints/4)
+		dirtySlots.append(slot);
+	else
+		uploadAll = true;
+}
+
+// Add 1 point to all the curves at current time and suppress too old points
+void TrailGroup::update()
+{
+	const double jd = StelApp::getInstance().getCore()->getJDay();
+	// Most trail groups are never shown: the ring buffers are allocated when they are used
+	if (times.isEmpty())
+		times.resize(2*maxPoints);
+	if (positions.size()!=2*maxPoints*allTrails.size())
+	{
+		positions.resize(2*maxPoints*allTrails.size());
+		reset();
+	}
+	if (nbPoints==0)
+	{
+		firstPoint = 0;
+		timeOrigin = jd;
+	}
+	else if (std::fabs(jd-timeOrigin)>MAX_TIME_ORIGIN_OFFSET)
+	{
+		const float shift = jd-timeOrigin;
+		for (int i=0;i<times.size();++i)
+			times[i] -= shift;
+		timeOrigin = jd;
+		uploadAll = true;
+	}
+
+	// Suppress too old points
+	const float t = jd-timeOrigin;
+	while (nbPoints>0 && t-times.at(firstPoint)>timeExtent)
+	{
+		firstPoint = (firstPoint+1)%maxPoints;
+		--nbPoints;
+	}
+
+	// The last point follows the objects until it is far enough in time from the previous one
+	const float minStep = timeExtent/(maxPoints-1);
+	if (nbPoints>=2 && std::fabs(t-times.at((firstPoint+nbPoints-2)%maxPoints))<minStep)
+	{
+		setPoint((firstPoint+nbPoints-1)%maxPoints, jd);
+		return;
+	}
+	if (nbPoints==maxPoints)
+	{
+		firstPoint = (firstPoint+1)%maxPoints;
+		--nbPoints;
+	}
+	setPoint((firstPoint+nbPoints)%maxPoints, jd);
+	++nbPoints;
+}
+
 // Set the matrix to use to post process J2000 positions before storing in the trail
 void TrailGroup::setJ2000ToTrailNative(const Mat4d& m)
 {
@@ -95,13 +241,17 @@ void TrailGroup::setJ2000ToTrailNative(const Mat4d& m)
 void TrailGroup::addObject(const StelObjectP& obj, const Vec3f* col)
 {
 	allTrails.append(TrailGroup::Trail(obj, col==NULL ? obj->getInfoColor() : *col));
+	// The ring buffers are resized at the next update
+	positions.clear();
+	// The home planet flags must be set for the new trail
+	homePlanetName.clear();
+	reset();
 }
 
 void TrailGroup::reset()
 {
-	times.clear();
-	for (QList<Trail>::Iterator iter=allTrails.begin();iter!=allTrails.end();++iter)
-	{
-		iter->posHistory.clear();
-	}
+	firstPoint = 0;
+	nbPoints = 0;
+	uploadAll = true;
+	dirtySlots.clear();
 }
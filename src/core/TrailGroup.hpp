@@ -24,12 +24,30 @@
 #include "StelCore.hpp"
 #include "StelObjectType.hpp"
 
+#include <QOpenGLBuffer>
+#include <QString>
+#include <QVector>
+
 class StelPainter;
 
+//! @class TrailGroup
+//! The trails left by a group of objects, sampled at the same times.
+//! The points of the trails are kept in fixed size ring buffers, and are spaced
+//! by at least timeExtent divided by the maximum number of points. The last point
+//! of each trail always follows the current position of its object.
+//! Each ring buffer is stored twice in a row, so that the points of a trail are
+//! always contiguous, from the oldest to the newest. The buffers are allocated at
+//! the first update. All the trails share a single OpenGL vertex buffer, where only
+//! the changed points are uploaded. When the projection allows it, the fading of
+//! the trails is computed in the vertex shader from the time of each point.
 class TrailGroup
 {
 public:
-	TrailGroup(float atimeExtent);
+	//! @param atimeExtent the maximum age of the points in days.
+	//! @param maxPoints the maximum number of points of each trail. The default spaces the
+	//! points of yearly trails by about 8.5 hours, during which the Moon moves by less than 5 degrees.
+	TrailGroup(float atimeExtent, int maxPoints=1024);
+	~TrailGroup();
 
 	void draw(StelCore* core, StelPainter*);
 
@@ -39,6 +57,7 @@ public:
 	// Set the matrix to use to post process J2000 positions before storing in the trail
 	void setJ2000ToTrailNative(const Mat4d& m);
 
+	//! Add the trail of an object. All the trails are reset.
 	void addObject(const StelObjectP&, const Vec3f* col=NULL);
 
 	void setOpacity(float op) {opacity=op;}
@@ -50,19 +69,48 @@ private:
 	class Trail
 	{
 	public:
-		Trail(const StelObjectP& obj, const Vec3f& col) : stelObject(obj), color(col) {;}
+		Trail(const StelObjectP& obj, const Vec3f& col) : stelObject(obj), color(col), isHomePlanet(false) {;}
 		StelObjectP stelObject;
-		// All previous positions
-		QList<Vec3d> posHistory;
 		Vec3f color;
+		// Whether the object is the planet of the observer, whose trail is not drawn
+		bool isHomePlanet;
 	};
 
+	//! Store a point for all the trails in the given slot of the ring buffers.
+	void setPoint(int slot, double jd);
+	//! Update the vertex buffer with the points changed since the last upload.
+	void uploadPoints();
+	//! Convert count consecutive points, from the index first of the ring buffers, to the layout of the vertex buffer.
+	void getVertices(int first, int count, QVector<float>& vertices) const;
+
 	QList<Trail> allTrails;
 
 	// Maximum time extent in days
 	float timeExtent;
 
-	QList<float> times;
+	//! Maximum number of points of each trail
+	int maxPoints;
+	//! Slot of the oldest point in the ring buffers, and number of points
+	int firstPoint;
+	int nbPoints;
+	//! The times of the points in days since timeOrigin. The point stored in
+	//! slot i is at index i and i+maxPoints.
+	QVector<float> times;
+	double timeOrigin;
+	//! The positions of the points, with the same layout as the times.
+	//! The ring buffer of the trail k starts at index 2*k*maxPoints.
+	QVector<Vec3d> positions;
+
+	//! Holds one vertex per index of the ring buffers: the time, followed by the
+	//! positions of all the trails converted to float. The changes of one slot are contiguous.
+	QOpenGLBuffer vertexBuffer;
+	//! Whether the whole vertex buffer must be uploaded.
+	bool uploadAll;
+	//! The slots changed since the last upload.
+	QVector<int> dirtySlots;
+
+	//! The planet of the observer for which the isHomePlanet flags were set.
+	QString homePlanetName;
 
 	Mat4d j2000ToTrailNative;
 	Mat4d j2000ToTrailNativeInverted;
@@ -47,6 +47,8 @@ public:
 		float temperature = 15.f, float relativeHumidity = 40.f);
 	void draw(StelCore* core);
 	void update(double deltaTime) {fader.update((int)(deltaTime*1000));}
+	//! Return whether the atmosphere is fading in or out.
+	bool isFading() const {return fader.isFading();}
 
 	//! Set fade in/out duration in seconds
 	void setFadeDuration(float duration) {fader.setDuration((int)(duration*1000.f));}
@@ -39,6 +39,16 @@
 // for compute tail shape
 #define COMET_TAIL_SLICES 16 // segments around the perimeter
 #define COMET_TAIL_STACKS 16 // cuts along the rotational axis
+// relative change of the tail or coma size below which the cached meshes are kept
+#define COMET_MESH_TOLERANCE 0.02f
+// comets whose tail and coma cover less pixels than this are only drawn as a point source
+#define COMET_MIN_TAIL_SCREEN_SIZE 3.f
+
+//! @return true if value differs from the cached value by more than COMET_MESH_TOLERANCE.
+static bool changedBeyondTolerance(const float cached, const float value)
+{
+	return std::fabs(value-cached) > COMET_MESH_TOLERANCE*std::fabs(cached);
+}
 
 Comet::Comet(const QString& englishName,
 		 int flagLighting,
@@ -91,6 +101,13 @@ Comet::Comet(const QString& englishName,
 	//dusttailIndices.clear();
 	comaVertexArr.clear();
 	comaTexCoordArr.clear();
+	gasTailParameter = 0.f;
+	gasTailEndRadius = 0.f;
+	dustTailParameter = 0.f;
+	dustTailBend = 0.f;
+	comaDiameter = 0.f;
+	tailLength = 0.f;
+	dustTailRotation = Mat4d::identity();
 
 	comaTexture = StelApp::getInstance().getTextureManager().createTextureThread(StelFileMgr::getInstallationDir()+"/textures/cometComa.png", StelTexture::StelTextureParams(true, GL_LINEAR, GL_CLAMP_TO_EDGE));
 	//GZ: tail textures. We use a paraboloid tail body, textured like a fisheye sphere, i.e. center=head. The texture should be something like a mottled star to give some structure.
@@ -295,23 +312,7 @@ void Comet::draw(StelCore* core, float maxMagLabels, const QFont& planetNameFont
 
 	if (orbit->getUpdateTails()){
 		// Compute lengths and orientations from orbit object, but only if required.
-		// TODO: This part should possibly be moved to another thread to keep draw() free from too much computation.
-
-		Vec2f tailFactors=getComaDiameterAndTailLengthAU();
-		float gasTailEndRadius=qMax(tailFactors[0], 0.025f*tailFactors[1]) ; // This avoids too slim gas tails for bright comets like Hale-Bopp.
-		float gasparameter=gasTailEndRadius*gasTailEndRadius/(2.0f*tailFactors[1]); // parabola formula: z=r²/2p, so p=r²/2z
-		// The dust tail is thicker and usually shorter. The factors can be configured in the elements.
-		float dustparameter=gasTailEndRadius*gasTailEndRadius*dustTailWidthFactor*dustTailWidthFactor/(2.0f*dustTailLengthFactor*tailFactors[1]);
-
-		// Find valid parameters to create paraboloid vertex arrays: dustTail, gasTail.
-		computeParabola(gasparameter, gasTailEndRadius, -0.5f*gasparameter, gastailVertexArr,  gastailTexCoordArr, gastailIndices);
-		// This was for a rotated straight parabola:
-		//computeParabola(dustparameter, 2.0f*tailFactors[0], -0.5f*dustparameter, dusttailVertexArr, dusttailTexCoordArr, dusttailIndices);
-		// Now we make a skewed parabola. Skew factor 15 (last arg) ad-hoc/empirical. TBD later: Find physically correct solution.
-		computeParabola(dustparameter, dustTailWidthFactor*gasTailEndRadius, -0.5f*dustparameter, dusttailVertexArr, gastailTexCoordArr, gastailIndices, 25.0f*orbit->getVelocity().length());
-
-		// Note that we use a diameter larger than what the formula returns. A scale factor of 1.2 is ad-hoc/empirical (GZ), but may look better.
-		computeComa(1.0f*tailFactors[0]);
+		updateTailMeshes(orbit);
 		orbit->setUpdateTails(false); // don't update until position has been recalculated elsewhere
 	}
 
@@ -358,41 +359,88 @@ void Comet::draw(StelCore* core, float maxMagLabels, const QFont& planetNameFont
 		draw3dModel(core,transfo,screenSz);
 	}
 	// tails should also be drawn if core is off-screen...
-	drawTail(core,transfo,true);  // gas tail
-	drawTail(core,transfo,false); // dust tail
-
-	//Coma: this is just a fan disk tilted towards the observer;-)
-	drawComa(core, transfo);
-	return;
-}
-
-void Comet::drawTail(StelCore* core, StelProjector::ModelViewTranformP transfo, bool gas)
-{
+	// But when the whole comet only covers a few pixels, the head drawn as a point source is enough.
+	const float tailScreenSz = qMax(tailLength, comaDiameter)/getEquinoxEquatorialPos(core).length()*prj->getPixelPerRadAtCenter();
+	if (tailScreenSz<COMET_MIN_TAIL_SCREEN_SIZE || gastailVertexArr.isEmpty())
+		return;
 
 	// Find rotation matrix from 0/0/1 to eclipticPosition: crossproduct for axis (normal vector), dotproduct for angle.
+	// The same antisolar rotation is used by both tails.
 	Vec3d eclposNrm=eclipticPos; eclposNrm.normalize();
 	Mat4d tailrot=Mat4d::rotation(Vec3d(0.0, 0.0, 1.0)^(eclposNrm), std::acos(Vec3d(0.0, 0.0, 1.0).dot(eclposNrm)) );
+	StelProjector::ModelViewTranformP tailTransfo = transfo->clone();
+	tailTransfo->combine(tailrot);
 
-	StelProjector::ModelViewTranformP transfo2 = transfo->clone();
-	transfo2->combine(tailrot);
-	if (!gas) {
-		CometOrbit* orbit=(CometOrbit*)userDataPtr;
-		Vec3d velocity=orbit->getVelocity(); // [AU/d]
-		// This was a try to rotate a straight parabola somewhat away from the antisolar direction.
-		//Mat4d dustTailRot=Mat4d::rotation(eclposNrm^(-velocity), 0.15f*std::acos(eclposNrm.dot(-velocity))); // GZ: This scale factor of 0.15 is empirical from photos of Halley and Hale-Bopp.
-		// The curved tail is curved towards positive X. We first rotate around the Z axis into a direction opposite of the motion vector, then again the antisolar rotation applies.
-		Mat4d dustTailRot=Mat4d::zrotation(atan2(velocity[1], velocity[0]) + M_PI);
-		transfo2->combine(dustTailRot);
-		// In addition, we let the dust tail already start with a light tilt.
-		Mat4d dustTailYrot=Mat4d::yrotation(5.0f*velocity.length()); // again, this is pretty ad-hoc, feel free to improve!
-		transfo2->combine(dustTailYrot);
-	}
-	StelPainter* sPainter = new StelPainter(core->getProjection(transfo2));
-	sPainter->getLight().disable();
+	StelPainter sPainter(core->getProjection(tailTransfo));
+	sPainter.getLight().disable();
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_ONE, GL_ONE);
 	glDisable(GL_CULL_FACE);
 
+	drawTail(core, &sPainter, tailTransfo, true);  // gas tail
+	drawTail(core, &sPainter, tailTransfo, false); // dust tail
+
+	//Coma: this is just a fan disk tilted towards the observer;-)
+	drawComa(core, &sPainter, transfo);
+
+	glDisable(GL_BLEND);
+}
+
+void Comet::updateTailMeshes(const CometOrbit* orbit)
+{
+	// TODO: This part should possibly be moved to another thread to keep draw() free from too much computation.
+	Vec2f tailFactors=getComaDiameterAndTailLengthAU();
+	float gasEndRadius=qMax(tailFactors[0], 0.025f*tailFactors[1]) ; // This avoids too slim gas tails for bright comets like Hale-Bopp.
+	float gasparameter=gasEndRadius*gasEndRadius/(2.0f*tailFactors[1]); // parabola formula: z=r²/2p, so p=r²/2z
+	// The dust tail is thicker and usually shorter. The factors can be configured in the elements.
+	float dustparameter=gasEndRadius*gasEndRadius*dustTailWidthFactor*dustTailWidthFactor/(2.0f*dustTailLengthFactor*tailFactors[1]);
+	const Vec3d velocity=orbit->getVelocity(); // [AU/d]
+	// Skew factor 25 ad-hoc/empirical. TBD later: Find physically correct solution.
+	float dustbend=25.0f*velocity.length();
+	tailLength=tailFactors[1];
+
+	// In time lapse the tails change a bit every frame: keep the meshes as long as the change cannot be seen.
+	if (gastailVertexArr.isEmpty() || changedBeyondTolerance(gasTailParameter, gasparameter) || changedBeyondTolerance(gasTailEndRadius, gasEndRadius)
+	    || changedBeyondTolerance(dustTailParameter, dustparameter) || changedBeyondTolerance(dustTailBend, dustbend))
+	{
+		gasTailParameter=gasparameter;
+		gasTailEndRadius=gasEndRadius;
+		dustTailParameter=dustparameter;
+		dustTailBend=dustbend;
+		// Find valid parameters to create paraboloid vertex arrays: dustTail, gasTail.
+		computeParabola(gasparameter, gasEndRadius, -0.5f*gasparameter, gastailVertexArr,  gastailTexCoordArr, gastailIndices);
+		// This was for a rotated straight parabola:
+		//computeParabola(dustparameter, 2.0f*tailFactors[0], -0.5f*dustparameter, dusttailVertexArr, dusttailTexCoordArr, dusttailIndices);
+		// Now we make a skewed parabola.
+		computeParabola(dustparameter, dustTailWidthFactor*gasEndRadius, -0.5f*dustparameter, dusttailVertexArr, gastailTexCoordArr, gastailIndices, dustbend);
+	}
+
+	// The direction of motion changes faster than the shape of the tails near perihelion: the rotation is not kept with the meshes.
+	// The curved tail is curved towards positive X. We first rotate around the Z axis into a direction opposite of the motion vector, then again the antisolar rotation applies.
+	// In addition, we let the dust tail already start with a light tilt. Again, this is pretty ad-hoc, feel free to improve!
+	// This was a try to rotate a straight parabola somewhat away from the antisolar direction.
+	//Mat4d dustTailRot=Mat4d::rotation(eclposNrm^(-velocity), 0.15f*std::acos(eclposNrm.dot(-velocity))); // GZ: This scale factor of 0.15 is empirical from photos of Halley and Hale-Bopp.
+	dustTailRotation=Mat4d::zrotation(atan2(velocity[1], velocity[0]) + M_PI) * Mat4d::yrotation(5.0f*velocity.length());
+
+	// Note that we use a diameter larger than what the formula returns. A scale factor of 1.2 is ad-hoc/empirical (GZ), but may look better.
+	if (comaVertexArr.isEmpty() || changedBeyondTolerance(comaDiameter, tailFactors[0]))
+	{
+		comaDiameter=tailFactors[0];
+		computeComa(1.0f*comaDiameter);
+	}
+}
+
+void Comet::drawTail(StelCore* core, StelPainter* sPainter, StelProjector::ModelViewTranformP transfo, bool gas)
+{
+	if (gas)
+		sPainter->setProjector(core->getProjection(transfo));
+	else
+	{
+		StelProjector::ModelViewTranformP transfo2 = transfo->clone();
+		transfo2->combine(dustTailRotation);
+		sPainter->setProjector(core->getProjection(transfo2));
+	}
+
 	// GZ: If we use getVMagnitudeWithExtinction(), a head extincted in the horizon mist can completely hide an otherwise frighteningly long tail.
 	// we must use unextincted mag, but mix/dim with atmosphere/sky brightness.
 	// In addition, light falloff is a bit reduced for better visibility. Power basis should be 0.4, we use 0.6.
@@ -428,29 +476,16 @@ void Comet::drawTail(StelCore* core, StelProjector::ModelViewTranformP transfo,
 		sPainter->setArrays((Vec3d*)dusttailVertexArr.constData(), (Vec2f*)gastailTexCoordArr.constData());
 		sPainter->drawFromArray(StelPainter::Triangles, gastailIndices.size(), 0, true, gastailIndices.constData());
 	}
-	glDisable(GL_BLEND);
-
-
-
-	if (sPainter)
-		delete sPainter;
-	sPainter=NULL;
 }
 
-void Comet::drawComa(StelCore* core, StelProjector::ModelViewTranformP transfo)
+void Comet::drawComa(StelCore* core, StelPainter* sPainter, StelProjector::ModelViewTranformP transfo)
 {
-
 	// Find rotation matrix from 0/0/1 to viewdirection! crossproduct for axis (normal vector), dotproduct for angle.
 	Vec3d eclposNrm=eclipticPos - core->getObserverHeliocentricEclipticPos()  ; eclposNrm.normalize();
 	Mat4d comarot=Mat4d::rotation(Vec3d(0.0, 0.0, 1.0)^(eclposNrm), std::acos(Vec3d(0.0, 0.0, 1.0).dot(eclposNrm)) );
 	StelProjector::ModelViewTranformP transfo2 = transfo->clone();
 	transfo2->combine(comarot);
-	StelPainter* sPainter = new StelPainter(core->getProjection(transfo2));
-	sPainter->getLight().disable();
-
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE);
-	glDisable(GL_CULL_FACE);
+	sPainter->setProjector(core->getProjection(transfo2));
 
 	// GZ: For the coma, we can use extinction via atmosphere.
 	// In addition, light falloff is a bit reduced for better visibility. Power basis should be 0.4, we use 0.6.
@@ -460,17 +495,10 @@ void Comet::drawComa(StelCore* core, StelProjector::ModelViewTranformP transfo)
 	float magFactor=std::pow(0.6f , magDrop);
 	magFactor=qMin(magFactor, 2.0f); // Limit excessively bright display.
 
-
 	comaTexture->bind();
 	sPainter->setColor(magFactor,magFactor,0.6f*magFactor);
 	sPainter->setArrays((Vec3d*)comaVertexArr.constData(), (Vec2f*)comaTexCoordArr.constData());
 	sPainter->drawFromArray(StelPainter::Triangles, comaVertexArr.size()/3);
-
-	glDisable(GL_BLEND);
-
-	if (sPainter)
-		delete sPainter;
-	sPainter=NULL;
 }
 
 // Formula found at http://www.projectpluto.com/update7b.htm#comet_tail_formula
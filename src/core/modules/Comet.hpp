@@ -22,6 +22,8 @@
 
 #include "Planet.hpp"
 
+class CometOrbit;
+
 /*! \class Comet
 	\author Bogdan Marinov, Georg Zotti (orbit computation enhancements, tails)
 
@@ -94,8 +96,11 @@ private:
 	//! @returns estimates for (Coma diameter [AU], gas tail length [AU]).
 	//! Using the formula from Guide found by the GSoC2012 initiative at http://www.projectpluto.com/update7b.htm#comet_tail_formula
 	Vec2f getComaDiameterAndTailLengthAU() const;
-	void drawTail(StelCore* core, StelProjector::ModelViewTranformP transfo, bool gas);
-	void drawComa(StelCore* core, StelProjector::ModelViewTranformP transfo);
+	//! Recompute the tail and coma meshes, unless their shape is within a small relative tolerance of the cached one.
+	void updateTailMeshes(const CometOrbit* orbit);
+	//! @param transfo the model view transformation of the comet, already rotated to the antisolar direction.
+	void drawTail(StelCore* core, StelPainter* sPainter, StelProjector::ModelViewTranformP transfo, bool gas);
+	void drawComa(StelCore* core, StelPainter* sPainter, StelProjector::ModelViewTranformP transfo);
 
 	//! compute a coma, faked as simple disk to be tilted towards the observer.
 	//! @param diameter Diameter of Coma [AU]
@@ -131,6 +136,14 @@ private:
 	//QVector<unsigned short> dusttailIndices; // actually no longer required. Re-use gas tail indices.
 	QVector<double> comaVertexArr;
 	QVector<float> comaTexCoordArr;
+	// Shape parameters of the cached meshes. The meshes are rebuilt only when one of them changes by more than COMET_MESH_TOLERANCE.
+	float gasTailParameter;
+	float gasTailEndRadius;
+	float dustTailParameter;
+	float dustTailBend;
+	float comaDiameter;
+	float tailLength;     //!< gas tail length [AU], the largest extent of the comet, used for the level of detail.
+	Mat4d dustTailRotation; //!< turns the bent dust tail away from the direction of motion. Updated with the meshes.
 	StelTextureSP comaTexture;
 	StelTextureSP gasTailTexture;
 	//StelTextureSP dusttailTexture;  // it seems not really necessary to have different textures.
@@ -27,7 +27,6 @@
 #include "StelTextureTypes.hpp"
 #include "StelSphereGeometry.hpp"
 
-#include <vector>
 #include <QString>
 #include <QFont>
 
@@ -81,8 +80,6 @@ private:
 	void drawName(StelPainter& sPainter) const;
 	//! Draw the constellation art
 	void drawArt(StelPainter& sPainter) const;
-	//! Draw the constellation boundary
-	void drawBoundaryOptim(StelPainter& sPainter) const;
 
 	//! Test if a star is part of a Constellation.
 	//! This member tests to see if a star is one of those which make up
@@ -103,10 +100,6 @@ private:
 	QString getEnglishName() const {return abbreviation;}
 	//! Get the short name for the Constellation (returns the abbreviation).
 	QString getShortName() const {return abbreviation;}
-	//! Draw the lines for the Constellation.
-	//! This method uses the coords of the stars (optimized for use thru
-	//! the class ConstellationMgr only).
-	void drawOptim(StelPainter& sPainter, const StelCore* core, const SphericalCap& viewportHalfspace) const;
 	//! Draw the art texture, optimized function to be called thru a constellation manager only.
 	void drawArtOptim(StelPainter& sPainter, const SphericalRegion& region) const;
 	//! Update fade levels according to time since various events.
@@ -151,6 +144,10 @@ private:
 	unsigned int numberOfSegments;
 	//! List of stars forming the segments
 	StelObjectP* asterism;
+	//! Index of the first vertex of the lines in ConstellationMgr::lineVertices, followed by 2*numberOfSegments vertices
+	int firstLineVertex;
+	//! Cap containing all the lines
+	SphericalCap linesCap;
 
 	StelTextureSP artTexture;
 	StelVertexArray artPolygon;
@@ -158,8 +155,12 @@ private:
 
 	//! Define whether art, lines, names and boundary must be drawn
 	LinearFader artFader, lineFader, nameFader, boundaryFader;
-	std::vector<std::vector<Vec3f> *> isolatedBoundarySegments;
-	std::vector<std::vector<Vec3f> *> sharedBoundarySegments;
+	//! Range of the vertices of all the boundaries of the constellation in ConstellationMgr::isolatedBoundaryVertices
+	int isolatedBoundaryBegin, isolatedBoundaryEnd;
+	//! Range of the vertices in ConstellationMgr::sharedBoundaryVertices, where each boundary belongs to one of the constellations it separates
+	int sharedBoundaryBegin, sharedBoundaryEnd;
+	//! Cap containing all the boundaries
+	SphericalCap boundaryCap;
 
 	//! Currently we only need one color for all constellations, this may change at some point
 	static Vec3f lineColor;
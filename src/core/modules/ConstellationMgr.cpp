@@ -43,9 +43,71 @@
 #include <QString>
 #include <QStringList>
 #include <QDir>
+#include <QHash>
+#include <QTextStream>
+#include <QVector>
+#include <cmath>
 
 using namespace std;
 
+//! Maximum difference between the date of the packed constellation lines and the current date, in days
+static const double LINE_VERTICES_MAX_AGE = 365.25;
+
+//! Great circle arcs of a constellation waiting to be drawn.
+struct ArcsRange
+{
+	ArcsRange(const Vec3d* avertices, int acount, float aintensity, bool ainside)
+		: vertices(avertices), count(acount), intensity(aintensity), inside(ainside) {;}
+	ArcsRange() : vertices(NULL), count(0), intensity(0.f), inside(false) {;}
+	//! The start and end points of the arcs
+	const Vec3d* vertices;
+	int count;
+	float intensity;
+	//! Whether the bounding cap of the arcs is inside the viewport, so that they need no clipping
+	bool inside;
+};
+
+//! Compute a cap containing the great circle arcs between the given pairs of vertices.
+static SphericalCap computeArcsCap(const Vec3d* vertices, int count)
+{
+	Vec3d center(0.);
+	for (int i=0;i<count;++i)
+		center += vertices[i];
+	if (center.lengthSquared()<0.000001)
+		return SphericalCap(Vec3d(1.,0.,0.), -1.);
+	center.normalize();
+	double d = 1.;
+	for (int i=0;i<count;++i)
+		d = qMin(d, center*vertices[i]);
+	// A cap larger than a hemisphere may not contain the arcs between its points
+	return SphericalCap(center, d<0. ? -1. : d);
+}
+
+//! Draw the arcs, with a single call for all the arcs of a given intensity.
+static void drawArcsBatches(StelPainter& sPainter, QVector<ArcsRange>& ranges, const Vec3f& color, const SphericalCap& viewportHalfspace)
+{
+	while (!ranges.isEmpty())
+	{
+		const float intensity = ranges.first().intensity;
+		sPainter.beginLinesBatch();
+		for (int i=0;i<ranges.size();)
+		{
+			const ArcsRange& r = ranges.at(i);
+			if (r.intensity!=intensity)
+			{
+				++i;
+				continue;
+			}
+			const SphericalCap* clippingCap = r.inside ? NULL : &viewportHalfspace;
+			for (int j=0;j<r.count;j+=2)
+				sPainter.drawGreatCircleArc(r.vertices[j], r.vertices[j+1], clippingCap);
+			ranges.remove(i);
+		}
+		sPainter.setColor(color[0], color[1], color[2], intensity);
+		sPainter.endLinesBatch();
+	}
+}
+
 // constructor which loads all data from appropriate files
 ConstellationMgr::ConstellationMgr(StarMgr *_hip_stars)
 	: hipStarMgr(_hip_stars),
@@ -54,7 +116,8 @@ ConstellationMgr::ConstellationMgr(StarMgr *_hip_stars)
 	  artDisplayed(0),
 	  boundariesDisplayed(0),
 	  linesDisplayed(0),
-	  namesDisplayed(0)
+	  namesDisplayed(0),
+	  lineVerticesJDay(0.)
 {
 	setObjectName("ConstellationMgr");
 	Q_ASSERT(hipStarMgr);
@@ -70,13 +133,6 @@ ConstellationMgr::~ConstellationMgr()
 	{
 		delete(*iter);
 	}
-
-	vector<vector<Vec3f> *>::iterator iter1;
-	for (iter1 = allBoundarySegments.begin(); iter1 != allBoundarySegments.end(); ++iter1)
-	{
-		delete (*iter1);
-	}
-	allBoundarySegments.clear();
 }
 
 void ConstellationMgr::init()
@@ -367,6 +423,7 @@ void ConstellationMgr::loadLinesAndArt(const QString &fileName, const QString &a
 	}
 	in.close();
 	qDebug() << "Loaded" << readOk << "/" << totalRecords << "constellation records successfully for culture" << cultureName;
+	updateLineVertices(StelApp::getInstance().getCore());
 
 	// Set current states
 	setFlagArt(artDisplayed);
@@ -512,6 +569,9 @@ void ConstellationMgr::draw(StelCore* core)
 	const StelProjectorP prj = core->getProjection(StelCore::FrameJ2000);
 	StelPainter sPainter(prj);
 	sPainter.setFont(asterFont);
+	// The proper motions of the stars are too slow to be visible from one day to the next
+	if (std::fabs(core->getJDay()-lineVerticesJDay)>LINE_VERTICES_MAX_AGE)
+		updateLineVertices(core);
 	drawLines(sPainter, core);
 	drawNames(sPainter);
 	drawArt(sPainter);
@@ -537,17 +597,24 @@ void ConstellationMgr::drawArt(StelPainter& sPainter) const
 }
 
 // Draw constellations lines
-void ConstellationMgr::drawLines(StelPainter& sPainter, const StelCore* core) const
+void ConstellationMgr::drawLines(StelPainter& sPainter, const StelCore*) const
 {
 	sPainter.enableTexture2d(false);
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	const SphericalCap& viewportHalfspace = sPainter.getProjector()->getBoundingCap();
+	QVector<ArcsRange> ranges;
 	vector < Constellation * >::const_iterator iter;
 	for (iter = asterisms.begin(); iter != asterisms.end(); ++iter)
 	{
-		(*iter)->drawOptim(sPainter, core, viewportHalfspace);
+		const Constellation* cons = *iter;
+		if (cons->lineFader.getInterstate()<=0.0001f || cons->numberOfSegments==0 || !viewportHalfspace.intersects(cons->linesCap))
+			continue;
+		ArcsRange r(lineVertices.constData()+cons->firstLineVertex, 2*cons->numberOfSegments,
+			    cons->lineFader.getInterstate(), viewportHalfspace.contains(cons->linesCap));
+		ranges.append(r);
 	}
+	drawArcsBatches(sPainter, ranges, Constellation::lineColor, viewportHalfspace);
 }
 
 // Draw the names of all the constellations
@@ -1008,16 +1075,15 @@ void ConstellationMgr::unsetSelectedConst(Constellation * c)
 
 bool ConstellationMgr::loadBoundaries(const QString& boundaryFile)
 {
-	Constellation *cons = NULL;
-	unsigned int i, j;
-
 	// delete existing boundaries if any exist
-	vector<vector<Vec3f> *>::iterator iter;
-	for (iter = allBoundarySegments.begin(); iter != allBoundarySegments.end(); ++iter)
+	isolatedBoundaryVertices.clear();
+	sharedBoundaryVertices.clear();
+	vector < Constellation * >::const_iterator iter;
+	for (iter = asterisms.begin(); iter != asterisms.end(); ++iter)
 	{
-		delete (*iter);
+		(*iter)->isolatedBoundaryBegin = (*iter)->isolatedBoundaryEnd = 0;
+		(*iter)->sharedBoundaryBegin = (*iter)->sharedBoundaryEnd = 0;
 	}
-	allBoundarySegments.clear();
 
 	qDebug() << "Loading constellation boundary data ... ";
 
@@ -1030,21 +1096,24 @@ bool ConstellationMgr::loadBoundaries(const QString& boundaryFile)
 		return false;
 	}
 
+	// The segments of each boundary, as pairs of start and end points
+	QVector<QVector<Vec3d> > boundaries;
+	// The boundaries of each constellation, and those drawn with the other constellations selected
+	QHash<const Constellation*, QVector<int> > isolatedBoundaries, sharedBoundaries;
+
 	QTextStream istr(&dataFile);
 	float DE, RA;
 	Vec3f XYZ;
-	unsigned num, numc;
-	vector<Vec3f> *points = NULL;
+	unsigned int num, numc, j;
 	QString consname;
-	i = 0;
+	Constellation *cons = NULL;
 	while (!istr.atEnd())
 	{
-		points = new vector<Vec3f>;
-
 		num = 0;
 		istr >> num;
 		if(num == 0) continue;  // empty line
 
+		QVector<Vec3f> points;
 		for (j=0;j<num;j++)
 		{
 			istr >> RA >> DE;
@@ -1054,11 +1123,21 @@ bool ConstellationMgr::loadBoundaries(const QString& boundaryFile)
 
 			// Calc the Cartesian coord with RA and DE
 			StelUtils::spheToRect(RA,DE,XYZ);
-			points->push_back(XYZ);
+			points.append(XYZ);
 		}
 
-		// this list is for the de-allocation
-		allBoundarySegments.push_back(points);
+		// Keep only the segments which are long enough to be drawn
+		QVector<Vec3d> segments;
+		for (j=1;j<num;j++)
+		{
+			const Vec3f& pt1 = points.at(j-1);
+			const Vec3f& pt2 = points.at(j);
+			if (pt1*pt2>0.9999999f)
+				continue;
+			segments << Vec3d(pt1[0], pt1[1], pt1[2]) << Vec3d(pt2[0], pt2[1], pt2[2]);
+		}
+		const int boundary = boundaries.size();
+		boundaries.append(segments);
 
 		istr >> numc;
 		// there are 2 constellations per boundary
@@ -1073,29 +1152,72 @@ bool ConstellationMgr::loadBoundaries(const QString& boundaryFile)
 			if (!cons)
 				qWarning() << "ERROR while processing boundary file - cannot find constellation: " << consname;
 			else
-				cons->isolatedBoundarySegments.push_back(points);
+				isolatedBoundaries[cons].append(boundary);
 		}
 
-		if (cons) cons->sharedBoundarySegments.push_back(points);
-		i++;
-
+		if (cons) sharedBoundaries[cons].append(boundary);
 	}
 	dataFile.close();
-	qDebug() << "Loaded" << i << "constellation boundary segments";
-	delete points;
+
+	// Pack the segments by constellation
+	for (iter = asterisms.begin(); iter != asterisms.end(); ++iter)
+	{
+		Constellation* c = *iter;
+		c->isolatedBoundaryBegin = isolatedBoundaryVertices.size();
+		foreach (int boundary, isolatedBoundaries.value(c))
+			isolatedBoundaryVertices << boundaries.at(boundary);
+		c->isolatedBoundaryEnd = isolatedBoundaryVertices.size();
+		c->sharedBoundaryBegin = sharedBoundaryVertices.size();
+		foreach (int boundary, sharedBoundaries.value(c))
+			sharedBoundaryVertices << boundaries.at(boundary);
+		c->sharedBoundaryEnd = sharedBoundaryVertices.size();
+		// The shared boundaries of a constellation are part of its isolated boundaries
+		c->boundaryCap = computeArcsCap(isolatedBoundaryVertices.constData()+c->isolatedBoundaryBegin, c->isolatedBoundaryEnd-c->isolatedBoundaryBegin);
+	}
+	qDebug() << "Loaded" << boundaries.size() << "constellation boundary segments";
 
 	return true;
 }
 
+void ConstellationMgr::updateLineVertices(const StelCore* core)
+{
+	lineVertices.clear();
+	vector < Constellation * >::const_iterator iter;
+	for (iter = asterisms.begin(); iter != asterisms.end(); ++iter)
+	{
+		Constellation* cons = *iter;
+		cons->firstLineVertex = lineVertices.size();
+		for (unsigned int i=0;i<2*cons->numberOfSegments;++i)
+		{
+			Vec3d star = cons->asterism[i]->getJ2000EquatorialPos(core);
+			star.normalize();
+			lineVertices.append(star);
+		}
+		cons->linesCap = computeArcsCap(lineVertices.constData()+cons->firstLineVertex, 2*cons->numberOfSegments);
+	}
+	lineVerticesJDay = core->getJDay();
+}
+
 void ConstellationMgr::drawBoundaries(StelPainter& sPainter) const
 {
 	sPainter.enableTexture2d(false);
-	glDisable(GL_BLEND);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Normal transparency mode
+	const SphericalCap& viewportHalfspace = sPainter.getProjector()->getBoundingCap();
+	QVector<ArcsRange> ranges;
 	vector < Constellation * >::const_iterator iter;
 	for (iter = asterisms.begin(); iter != asterisms.end(); ++iter)
 	{
-		(*iter)->drawBoundaryOptim(sPainter);
+		const Constellation* cons = *iter;
+		const int begin = Constellation::singleSelected ? cons->isolatedBoundaryBegin : cons->sharedBoundaryBegin;
+		const int end = Constellation::singleSelected ? cons->isolatedBoundaryEnd : cons->sharedBoundaryEnd;
+		if (!cons->boundaryFader.getInterstate() || begin==end || !viewportHalfspace.intersects(cons->boundaryCap))
+			continue;
+		const Vec3d* vertices = Constellation::singleSelected ? isolatedBoundaryVertices.constData() : sharedBoundaryVertices.constData();
+		ArcsRange r(vertices+begin, end-begin, cons->boundaryFader.getInterstate(), viewportHalfspace.contains(cons->boundaryCap));
+		ranges.append(r);
 	}
+	drawArcsBatches(sPainter, ranges, Constellation::boundaryColor, viewportHalfspace);
 }
 
 StelObjectP ConstellationMgr::searchByNameI18n(const QString& nameI18n) const
@@ -24,11 +24,13 @@
 #include "StelObjectType.hpp"
 #include "StelObjectModule.hpp"
 #include "StelProjectorType.hpp"
+#include "VecMath.hpp"
 
 #include <vector>
 #include <QString>
 #include <QStringList>
 #include <QFont>
+#include <QVector>
 
 class StelToneReproducer;
 class StarMgr;
@@ -270,6 +272,8 @@ private:
 	//!    the boundary separates.
 	//! @param conCatFile the path to the file which contains the constellation boundary data.
 	bool loadBoundaries(const QString& conCatFile);
+	//! Pack the lines of all the constellations in lineVertices, with the star positions at the epoch given by the StelCore.
+	void updateLineVertices(const StelCore* core);
         //! Draw the constellation lines at the epoch given by the StelCore.
 	void drawLines(StelPainter& sPainter, const StelCore* core) const;
 	//! Draw the constellation art.
@@ -306,7 +310,17 @@ private:
 	StarMgr* hipStarMgr;
 
 	bool isolateSelected;
-	std::vector<std::vector<Vec3f> *> allBoundarySegments;
+
+	//! The start and end points of the segments of the lines of all the constellations,
+	//! grouped by constellation, see Constellation::firstLineVertex.
+	QVector<Vec3d> lineVertices;
+	//! The date of the star positions in lineVertices
+	double lineVerticesJDay;
+	//! The start and end points of the boundary segments, grouped by constellation.
+	//! Each boundary is stored once for each constellation it separates.
+	QVector<Vec3d> isolatedBoundaryVertices;
+	//! The same boundary segments, each stored once.
+	QVector<Vec3d> sharedBoundaryVertices;
 
 	QString lastLoadedSkyCulture;	// Store the last loaded sky culture directory name
 
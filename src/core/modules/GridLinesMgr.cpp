@@ -35,6 +35,16 @@
 #include <QSettings>
 #include <QDebug>
 #include <QFontMetrics>
+#include <QOpenGLBuffer>
+
+//! A label at the intersection of a grid line with the edge of the viewport
+struct SkyGridLabel
+{
+	Vec3d pos;
+	QString text;
+	float angleDeg;
+	float xshift;
+};
 
 //! @class SkyGrid
 //! Class which manages a grid to display in the sky.
@@ -54,10 +64,23 @@ public:
 	void setDisplayed(const bool displayed){fader = displayed;}
 	bool isDisplayed(void) const {return fader;}
 private:
+	//! Compute the line segments and labels of the grid visible with the projection of the painter.
+	void computeLines(StelPainter& sPainter) const;
+
 	Vec3f color;
 	StelCore::FrameType frameType;
 	QFont font;
 	LinearFader fader;
+
+	// The lines and labels only depend on the projection, so they are kept until the view changes
+	//! The projection for which the lines and labels were computed
+	mutable StelProjectorP linesPrj;
+	//! The line segments in window coordinates, 2 vertices per segment
+	mutable QVector<Vec2f> segments;
+	mutable QVector<SkyGridLabel> labels;
+	//! Holds the segments, uploaded when they are computed
+	mutable QOpenGLBuffer segmentsBuffer;
+	mutable bool segmentsBufferDirty;
 };
 
 
@@ -97,20 +120,26 @@ private:
 };
 
 // rms added color as parameter
-SkyGrid::SkyGrid(StelCore::FrameType frame) : color(0.2,0.2,0.2), frameType(frame)
+SkyGrid::SkyGrid(StelCore::FrameType frame) : color(0.2,0.2,0.2), frameType(frame), segmentsBufferDirty(true)
 {
 	font.setPixelSize(12);
 }
 
 SkyGrid::~SkyGrid()
 {
+	segmentsBuffer.destroy();
 }
 
 void SkyGrid::setFontSize(double newFontSize)
 {
 	font.setPixelSize(newFontSize);
+	// The position of the labels depends on their width
+	linesPrj.clear();
 }
 
+//! Maximum error in pixels of the grid lines and labels kept from a previous frame
+static const float MAX_GRID_PIXEL_ERROR = 0.5f;
+
 // Conversion into mas = milli arcsecond
 static const double RADIAN_MAS = 180./M_PI*1000.*60.*60.;
 static const double DEGREE_MAS = 1000.*60.*60.;
@@ -147,22 +176,20 @@ static double getClosestResolutionHMS(double pixelPerRad)
 
 struct ViewportEdgeIntersectCallbackData
 {
-	ViewportEdgeIntersectCallbackData(StelPainter* p) : sPainter(p) {;}
+	ViewportEdgeIntersectCallbackData(StelPainter* p, QVector<SkyGridLabel>* l) : sPainter(p), labels(l) {;}
 	StelPainter* sPainter;
-	Vec4f textColor;
+	QVector<SkyGridLabel>* labels;	// Receive the labels
 	QString text;		// Label to display at the intersection of the lines and screen side
 	double raAngle;		// Used for meridians
 	StelCore::FrameType frameType;
 };
 
-// Callback which draws the label of the grid
+// Callback which computes the label of the grid
 void viewportEdgeIntersectCallback(const Vec3d& screenPos, const Vec3d& direction, void* userData)
 {
 	ViewportEdgeIntersectCallbackData* d = static_cast<ViewportEdgeIntersectCallbackData*>(userData);
 	Vec3d direc(direction);
 	direc.normalize();
-	const Vec4f tmpColor = d->sPainter->getColor();
-	d->sPainter->setColor(d->textColor[0], d->textColor[1], d->textColor[2], d->textColor[3]);
 
 	QString text;
 	if (d->text.isEmpty())
@@ -267,11 +294,12 @@ void viewportEdgeIntersectCallback(const Vec3d& screenPos, const Vec3d& directio
 		xshift=-d->sPainter->getFontMetrics().width(text)-6.f;
 	}
 
-	d->sPainter->drawText(screenPos[0], screenPos[1], text, angleDeg, xshift, 3);
-	d->sPainter->setColor(tmpColor[0], tmpColor[1], tmpColor[2], tmpColor[3]);
-	glDisable(GL_TEXTURE_2D);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	SkyGridLabel label;
+	label.pos = screenPos;
+	label.text = text;
+	label.angleDeg = angleDeg;
+	label.xshift = xshift;
+	d->labels->append(label);
 }
 
 //! Draw the sky grid in the current frame
@@ -281,6 +309,52 @@ void SkyGrid::draw(const StelCore* core) const
 	if (!fader.getInterstate())
 		return;
 
+	StelPainter sPainter(prj);
+	if (!linesPrj || !linesPrj->isApproximatelyEqual(*prj, MAX_GRID_PIXEL_ERROR))
+	{
+		computeLines(sPainter);
+		linesPrj = prj;
+		segmentsBufferDirty = true;
+	}
+
+	// Initialize openGL state
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Normal transparency mode
+	sPainter.setColor(color[0],color[1],color[2], fader.getInterstate());
+	if (!segments.isEmpty())
+	{
+		if (!segmentsBuffer.isCreated())
+			segmentsBuffer.create();
+		if (segmentsBufferDirty && segmentsBuffer.isCreated())
+		{
+			segmentsBuffer.bind();
+			segmentsBuffer.allocate(segments.constData(), segments.size()*sizeof(Vec2f));
+			segmentsBuffer.release();
+			segmentsBufferDirty = false;
+		}
+		if (segmentsBuffer.isCreated())
+			sPainter.drawFromBuffer(segmentsBuffer, StelPainter::Lines, segments.size());
+		else
+		{
+			sPainter.enableClientStates(true);
+			sPainter.setVertexPointer(2, GL_FLOAT, segments.constData());
+			sPainter.drawFromArray(StelPainter::Lines, segments.size(), 0, false);
+			sPainter.enableClientStates(false);
+		}
+	}
+
+	Vec4f textColor(color[0], color[1], color[2], 0);
+	textColor*=2;
+	textColor[3]=fader.getInterstate();
+	sPainter.setColor(textColor[0], textColor[1], textColor[2], textColor[3]);
+	sPainter.setFont(font);
+	foreach (const SkyGridLabel& label, labels)
+		sPainter.drawText(label.pos[0], label.pos[1], label.text, label.angleDeg, label.xshift, 3);
+}
+
+void SkyGrid::computeLines(StelPainter& sPainter) const
+{
+	const StelProjectorP prj = sPainter.getProjector();
 	// Look for all meridians and parallels intersecting with the disk bounding the viewport
 	// Check whether the pole are in the viewport
 	bool northPoleInViewport = false;
@@ -319,19 +393,11 @@ void SkyGrid::draw(const StelCore* core) const
 
 	// Q_ASSERT(viewPortSphericalCap.contains(firstPoint));
 
-	// Initialize a painter and set openGL state
-	StelPainter sPainter(prj);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Normal transparency mode
-	Vec4f textColor(color[0], color[1], color[2], 0);
-	sPainter.setColor(color[0],color[1],color[2], fader.getInterstate());
-
-	textColor*=2;
-	textColor[3]=fader.getInterstate();
-
+	// The painter collects the segments instead of drawing them
 	sPainter.setFont(font);
-	ViewportEdgeIntersectCallbackData userData(&sPainter);
-	userData.textColor = textColor;
+	sPainter.beginLinesBatch();
+	labels.resize(0);
+	ViewportEdgeIntersectCallbackData userData(&sPainter, &labels);
 	userData.frameType = frameType;
 
 	/////////////////////////////////////////////////
@@ -514,6 +580,8 @@ void SkyGrid::draw(const StelCore* core) const
 			fpt.transfo4d(rotLon);
 		}
 	}
+
+	sPainter.endLinesBatch(segments);
 }
 
 
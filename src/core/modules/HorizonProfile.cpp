@@ -0,0 +1,114 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "HorizonProfile.hpp"
+
+#include <cmath>
+
+//! Number of azimuths of the horizon profile
+static const int HORIZON_PROFILE_SIZE = 2048;
+//! [radians] Step of the search of the horizon from the zenith, i.e. 0.5 degrees.
+//! Thinner features, like poles or wires, may be missed.
+static const double HORIZON_PROFILE_SCAN_STEP = M_PI/360.;
+//! Number of bisections refining the horizon altitude
+static const int HORIZON_PROFILE_BISECTIONS = 16;
+//! [radians] Margin of the cap above the horizon, about 2 degrees
+static const float HORIZON_CAP_MARGIN = 0.035f;
+
+//! Return the "diamond angle" of a horizontal direction, in 0..4.
+//! It is monotonic with the angle, like atan2, but much faster to compute.
+static inline double diamondAngle(const double x, const double y)
+{
+	if (y>=0.)
+		return x>=0. ? (x+y>0. ? y/(x+y) : 0.) : 1.-x/(-x+y);
+	return x<0. ? 2.-y/(-x-y) : 3.+x/(x-y);
+}
+
+void HorizonProfile::compute(const OpacitySource& source, bool singleTransition)
+{
+	sines.resize(HORIZON_PROFILE_SIZE);
+	minAltitude = M_PI/2.;
+	for (int i=0; i<HORIZON_PROFILE_SIZE; ++i)
+	{
+		// Horizontal direction at the middle of the diamond angle bin
+		const double d = (i+0.5)*4./HORIZON_PROFILE_SIZE;
+		double x, y;
+		if (d<1.)      {x = 1.-d; y = d;}
+		else if (d<2.) {x = 1.-d; y = 2.-d;}
+		else if (d<3.) {x = d-3.; y = 2.-d;}
+		else           {x = d-3.; y = d-4.;}
+		const double h = std::sqrt(x*x + y*y);
+		x /= h;
+		y /= h;
+
+		// Altitudes known to be in the free sky and on the ground
+		double sky = M_PI/2.;
+		double ground = -M_PI/2.;
+		if (!singleTransition)
+		{
+			// There may be several transitions, e.g. between leaves: scan down from the zenith,
+			// so that the highest opaque altitude is found
+			for (double alt = sky-HORIZON_PROFILE_SCAN_STEP; alt>ground; alt-=HORIZON_PROFILE_SCAN_STEP)
+			{
+				if (source.getOpacity(Vec3d(std::cos(alt)*x, std::cos(alt)*y, std::sin(alt)))>=0.5f)
+				{
+					ground = alt;
+					break;
+				}
+				sky = alt;
+			}
+		}
+		for (int j=0; j<HORIZON_PROFILE_BISECTIONS; ++j)
+		{
+			const double alt = 0.5*(sky+ground);
+			if (source.getOpacity(Vec3d(std::cos(alt)*x, std::cos(alt)*y, std::sin(alt)))>=0.5f)
+				ground = alt;
+			else
+				sky = alt;
+		}
+		const double alt = 0.5*(sky+ground);
+		sines[i] = std::sin(alt);
+		minAltitude = qMin(minAltitude, (float)alt);
+	}
+}
+
+void HorizonProfile::clear()
+{
+	sines.clear();
+	minAltitude = 0.f;
+}
+
+float HorizonProfile::getSine(const double x, const double y) const
+{
+	if (sines.isEmpty())
+		return 0.f;
+	// Linear interpolation between the middles of the bins
+	const double f = diamondAngle(x, y)*HORIZON_PROFILE_SIZE/4. - 0.5;
+	int i = (int)std::floor(f);
+	const float t = f - i;
+	const int j = (i+1)%HORIZON_PROFILE_SIZE;
+	if (i<0)
+		i += HORIZON_PROFILE_SIZE;
+	return (1.f-t)*sines.at(i) + t*sines.at(j);
+}
+
+SphericalCap HorizonProfile::getCapAboveHorizon(const Vec3d& zenith, const float minAltitude)
+{
+	return SphericalCap(zenith, std::sin(qMax(minAltitude-HORIZON_CAP_MARGIN, (float)-M_PI/2.)));
+}
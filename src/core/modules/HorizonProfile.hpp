@@ -0,0 +1,77 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _HORIZONPROFILE_HPP_
+#define _HORIZONPROFILE_HPP_
+
+#include "VecMath.hpp"
+#include "StelSphereGeometry.hpp"
+
+#include <QVector>
+
+//! @class HorizonProfile
+//! The altitude of the visible horizon of a landscape, by azimuth.
+//! It is computed once by sampling the opacity of the landscape, and then gives
+//! the horizon altitude in any azimuth much faster than sampling the landscape.
+//! The azimuths are sampled regularly in "diamond angle", which is faster to compute than atan2.
+//! All the directions are in the frame of the landscape.
+class HorizonProfile
+{
+public:
+	//! The opacity sampled by compute().
+	class OpacitySource
+	{
+	public:
+		virtual ~OpacitySource() {;}
+		//! @return the opacity of the landscape in a direction, in 0..1.
+		virtual float getOpacity(const Vec3d& v) const = 0;
+	};
+
+	//! Create an empty profile, i.e. the mathematical horizon.
+	HorizonProfile() : minAltitude(0.f) {;}
+
+	//! Compute the profile. The horizon is the highest altitude where the opacity reaches 0.5.
+	//! @param singleTransition true if the opacity changes only once from the zenith to the nadir,
+	//! as for a horizon polygon. The horizon is then found by bisection only, instead of scanning
+	//! down from the zenith to find the highest opaque part, e.g. tree tops.
+	void compute(const OpacitySource& source, bool singleTransition);
+	//! Reset to the mathematical horizon.
+	void clear();
+	//! Get whether the profile is empty, i.e. the mathematical horizon.
+	bool isEmpty() const {return sines.isEmpty();}
+
+	//! Get the sine of the altitude of the horizon in the azimuth of a horizontal direction.
+	//! @return 0 if the profile is empty.
+	float getSine(const double x, const double y) const;
+	//! Get the lowest altitude of the horizon [radians]. 0 if the profile is empty.
+	float getMinAltitude() const {return minAltitude;}
+
+	//! Get a cap containing all the directions above a horizon, with a margin of about 2 degrees.
+	//! @param zenith the normalized direction of the zenith.
+	//! @param minAltitude the lowest altitude of the horizon [radians], see getMinAltitude().
+	static SphericalCap getCapAboveHorizon(const Vec3d& zenith, const float minAltitude);
+
+private:
+	//! Sine of the altitude of the horizon, by azimuth.
+	QVector<float> sines;
+	//! [radians] lowest altitude in sines
+	float minAltitude;
+};
+
+#endif // _HORIZONPROFILE_HPP_
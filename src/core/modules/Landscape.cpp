@@ -34,6 +34,23 @@
 #include <QDir>
 #include <QtAlgorithms>
 
+//! Samples the opacity of a landscape in its own frame, i.e. without its runtime rotation.
+class LandscapeOpacity : public HorizonProfile::OpacitySource
+{
+public:
+	LandscapeOpacity(const Landscape* alandscape, float angleRotateZOffset)
+		: landscape(alandscape), unrotate(Mat4d::zrotation(-angleRotateZOffset)) {;}
+	virtual float getOpacity(const Vec3d& v) const
+	{
+		Vec3d w(v);
+		w.transfo4d(unrotate);
+		return landscape->getOpacity(w);
+	}
+private:
+	const Landscape* landscape;
+	const Mat4d unrotate;
+};
+
 Landscape::Landscape(float _radius)
 	: radius(_radius)
 	, minBrightness(-1.)
@@ -49,6 +66,8 @@ Landscape::Landscape(float _radius)
 	, defaultTemperature(-1000.)
 	, defaultPressure(-2.)
 	, horizonPolygon(NULL)
+	, cosRotateZOffset(1.)
+	, sinRotateZOffset(0.)
 {
 	validLandscape = 0;
 }
@@ -213,6 +232,19 @@ void Landscape::createPolygonalHorizon(const QString& lineFileName, const float
 	horizonPolygon = allskyRegion.getSubtraction(aboveHorizonPolygon);
 }
 
+void Landscape::computeHorizonProfile()
+{
+	// getOpacity() applies the runtime rotation, which is undone so that the profile is in the frame of the landscape.
+	// A horizon polygon has a single transition, the images may have several.
+	horizonProfile.compute(LandscapeOpacity(this, angleRotateZOffset), !horizonPolygon.isNull());
+}
+
+float Landscape::getHorizonProfileSine(const Vec3d& azalt) const
+{
+	// Direction in the frame of the landscape, as in getOpacity()
+	return horizonProfile.getSine(cosRotateZOffset*azalt[0] - sinRotateZOffset*azalt[1], sinRotateZOffset*azalt[0] + cosRotateZOffset*azalt[1]);
+}
+
 #include <iostream>
 const QString Landscape::getTexturePath(const QString& basename, const QString& landscapeId) const
 {
@@ -260,6 +292,9 @@ void LandscapeOldStyle::load(const QSettings& landscapeIni, const QString& lands
 		return;
 	}
 
+	// Needed to know whether the images of the sides are kept
+	calibrated = landscapeIni.value("landscape/calibrated", false).toBool();
+
 	// Load sides textures
 	nbSideTexs = landscapeIni.value("landscape/nbsidetex", 0).toInt();
 	sideTexs = new StelTextureSP[nbSideTexs];
@@ -295,6 +330,7 @@ void LandscapeOldStyle::load(const QSettings& landscapeIni, const QString& lands
 		QString textureName = parameters.value(0);
 		texnum = textureName.right(textureName.length() - 3).toInt();
 		sides[i].tex = sideTexs[texnum];
+		sides[i].texNum = texnum;
 		sides[i].texCoords[0] = parameters.at(1).toFloat();
 		sides[i].texCoords[1] = parameters.at(2).toFloat();
 		sides[i].texCoords[2] = parameters.at(3).toFloat();
@@ -346,7 +382,6 @@ void LandscapeOldStyle::load(const QSettings& landscapeIni, const QString& lands
 	groundAngleRotateZ = landscapeIni.value("landscape/ground_angle_rotatez", 0.).toFloat() * M_PI/180.f;
 	drawGroundFirst    = landscapeIni.value("landscape/draw_ground_first", 0).toInt();
 	tanMode            = landscapeIni.value("landscape/tan_mode", false).toBool();
-	calibrated         = landscapeIni.value("landscape/calibrated", false).toBool();
 
 	// Precompute the vertex arrays for ground display
 	// Make slices_per_side=(3<<K) so that the innermost polygon of the fandisk becomes a triangle:
@@ -464,6 +499,19 @@ void LandscapeOldStyle::load(const QSettings& landscapeIni, const QString& lands
 			precomputedSides.append(precompSide);
 		}
 	}
+
+	if (horizonPolygon)
+		computeHorizonProfile();
+	else if (calibrated)
+	{
+		bool imagesLoaded = true;
+		foreach (const QImage* image, sidesImages)
+			imagesLoaded = imagesLoaded && !image->isNull();
+		if (imagesLoaded)
+			computeHorizonProfile();
+		else
+			qWarning() << "Landscape" << landscapeId << ": cannot read the side textures, the horizon profile is the mathematical horizon.";
+	}
 }
 
 void LandscapeOldStyle::draw(StelCore* core)
@@ -593,9 +641,12 @@ float LandscapeOldStyle::getOpacity(Vec3d azalt) const
 	float az_panel =  nbSide*nbDecorRepeat * az_phot; // azimuth in "panel space". Ex for nbS=4, nbDR=3: [0..[12, say 11.4
 	float x_in_panel=fmodf(az_panel, 1.0f);
 	int currentSide = (int) floor(fmodf(az_panel, nbSide)); // must become 3
-	Q_ASSERT(currentSide<=nbSideTexs);
-	int x= (sides[currentSide].texCoords[0] + x_in_panel*(sides[currentSide].texCoords[2]-sides[currentSide].texCoords[0]))
-			* sidesImages[currentSide]->width(); // pixel X from left.
+	// The side is drawn with this texture, see the precomputation of the sides in load()
+	const int ti = sides[currentSide].texNum;
+	Q_ASSERT(ti<nbSideTexs);
+	const QImage* sideImage = sidesImages[ti];
+	int x= (sides[ti].texCoords[0] + x_in_panel*(sides[ti].texCoords[2]-sides[ti].texCoords[0]))
+			* sideImage->width(); // pixel X from left.
 
 	// QImage has pixel 0/0 in top left corner. We must find image Y for optionally cropped images.
 	// It should no longer be possible that sample position is outside cropped texture. in this case, assert(0) but again assume full transparency and exit early.
@@ -620,16 +671,17 @@ float LandscapeOldStyle::getOpacity(Vec3d azalt) const
 	}
 
 	// x0/y0 is lower left, x1/y1 upper right corner.
-	float y_baseImg_1 = sides[currentSide].texCoords[1]+ y_img_1*(sides[currentSide].texCoords[3]-sides[currentSide].texCoords[1]);
-	int y=(1.0-y_baseImg_1)*sidesImages[currentSide]->height();           // pixel Y from top.
+	float y_baseImg_1 = sides[ti].texCoords[1]+ y_img_1*(sides[ti].texCoords[3]-sides[ti].texCoords[1]);
+	int y=(1.0-y_baseImg_1)*sideImage->height();           // pixel Y from top.
 
-	QRgb pixVal=sidesImages[currentSide]->pixel(x, y);
+	QRgb pixVal=sideImage->pixel(qBound(0, x, sideImage->width()-1), qBound(0, y, sideImage->height()-1));
 	// GZ: please leave the comment available for further development!
-	qDebug() << "Oldstyle Landscape sampling: az=" << az*180.0 << "° alt=" << alt_rad*180.0f/M_PI
-			 << "°, xShift[-1..+1]=" << xShift << " az_phot[0..1]=" << az_phot
-			 << " --> current side panel " << currentSide
-			 << ", w=" << sidesImages[currentSide]->width() << " h=" << sidesImages[currentSide]->height()
-			 << " --> x:" << x << " y:" << y << " alpha:" << qAlpha(pixVal)/255.0f;
+	// (Commented out, as computeHorizonProfile() samples many directions.)
+	//qDebug() << "Oldstyle Landscape sampling: az=" << az*180.0 << "° alt=" << alt_rad*180.0f/M_PI
+	//		 << "°, xShift[-1..+1]=" << xShift << " az_phot[0..1]=" << az_phot
+	//		 << " --> current side panel " << currentSide
+	//		 << ", w=" << sideImage->width() << " h=" << sideImage->height()
+	//		 << " --> x:" << x << " y:" << y << " alpha:" << qAlpha(pixVal)/255.0f;
 	return qAlpha(pixVal)/255.0f;
 }
 
@@ -660,6 +712,7 @@ void LandscapePolygonal::load(const QSettings& landscapeIni, const QString& land
 	}
 	groundColor=StelUtils::strToVec3f( landscapeIni.value("landscape/ground_color", "0,0,0" ).toString() );
 	validLandscape = 1;  // assume ok...
+	computeHorizonProfile();
 }
 
 void LandscapePolygonal::draw(StelCore* core)
@@ -699,7 +752,7 @@ float LandscapePolygonal::getOpacity(Vec3d azalt) const
 // LandscapeFisheye
 //
 
-LandscapeFisheye::LandscapeFisheye(float _radius) : Landscape(_radius)
+LandscapeFisheye::LandscapeFisheye(float _radius) : Landscape(_radius), mapImage(NULL)
 {}
 
 LandscapeFisheye::~LandscapeFisheye()
@@ -743,6 +796,8 @@ void LandscapeFisheye::create(const QString _name, float _texturefov, const QStr
 	if (_maptexFog.length())
 		mapTexFog = StelApp::getInstance().getTextureManager().createTexture(_maptexFog, StelTexture::StelTextureParams(true));
 
+	if (horizonPolygon || !mapImage->isNull())
+		computeHorizonProfile();
 }
 
 
@@ -812,11 +867,12 @@ float LandscapeFisheye::getOpacity(Vec3d azalt) const
 	int x= mapImage->height()/2*(1 + radius*std::sin(az));
 	int y= mapImage->height()/2*(1 + radius*std::cos(az));
 
-	QRgb pixVal=mapImage->pixel(x, y);
+	QRgb pixVal=mapImage->pixel(qBound(0, x, mapImage->width()-1), qBound(0, y, mapImage->height()-1));
 	// GZ: please leave the comment available for further development!
-	qDebug() << "Landscape sampling: az=" << (az+angleRotateZ)/M_PI*180.0f << "° alt=" << alt_rad/M_PI*180.f
-			 << "°, w=" << mapImage->width() << " h=" << mapImage->height()
-			 << " --> x:" << x << " y:" << y << " alpha:" << qAlpha(pixVal)/255.0f;
+	// (Commented out, as computeHorizonProfile() samples many directions.)
+	//qDebug() << "Landscape sampling: az=" << (az+angleRotateZ)/M_PI*180.0f << "° alt=" << alt_rad/M_PI*180.f
+	//		 << "°, w=" << mapImage->width() << " h=" << mapImage->height()
+	//		 << " --> x:" << x << " y:" << y << " alpha:" << qAlpha(pixVal)/255.0f;
 	return qAlpha(pixVal)/255.0f;
 
 
@@ -824,7 +880,7 @@ float LandscapeFisheye::getOpacity(Vec3d azalt) const
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // spherical panoramas
 
-LandscapeSpherical::LandscapeSpherical(float _radius) : Landscape(_radius)
+LandscapeSpherical::LandscapeSpherical(float _radius) : Landscape(_radius), mapImage(NULL)
 {}
 
 LandscapeSpherical::~LandscapeSpherical()
@@ -888,6 +944,9 @@ void LandscapeSpherical::create(const QString _name, const QString& _maptex, con
 		mapTexIllum = StelApp::getInstance().getTextureManager().createTexture(_maptexIllum, StelTexture::StelTextureParams(true));
 	if (_maptexFog.length())
 		mapTexFog = StelApp::getInstance().getTextureManager().createTexture(_maptexFog, StelTexture::StelTextureParams(true));
+
+	if (horizonPolygon || !mapImage->isNull())
+		computeHorizonProfile();
 }
 
 void LandscapeSpherical::draw(StelCore* core)
@@ -988,12 +1047,13 @@ float LandscapeSpherical::getOpacity(Vec3d azalt) const
 
 	int x=(az_phot/2.0f) * mapImage->width(); // pixel X from left.
 
-	QRgb pixVal=mapImage->pixel(x, y);
+	QRgb pixVal=mapImage->pixel(qBound(0, x, mapImage->width()-1), qBound(0, y, mapImage->height()-1));
 	// GZ: please leave the comment available for further development!
-	qDebug() << "Landscape sampling: az=" << az*180.0 << "° alt=" << alt_pm1*90.0f
-			 << "°, xShift[-2..+2]=" << xShift << " az_phot[0..2]=" << az_phot
-			 << ", w=" << mapImage->width() << " h=" << mapImage->height()
-			 << " --> x:" << x << " y:" << y << " alpha:" << qAlpha(pixVal)/255.0f;
+	// (Commented out, as computeHorizonProfile() samples many directions.)
+	//qDebug() << "Landscape sampling: az=" << az*180.0 << "° alt=" << alt_pm1*90.0f
+	//		 << "°, xShift[-2..+2]=" << xShift << " az_phot[0..2]=" << az_phot
+	//		 << ", w=" << mapImage->width() << " h=" << mapImage->height()
+	//		 << " --> x:" << x << " y:" << y << " alpha:" << qAlpha(pixVal)/255.0f;
 	return qAlpha(pixVal)/255.0f;
 
 }
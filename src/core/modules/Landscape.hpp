@@ -28,6 +28,7 @@
 #include "StelUtils.hpp"
 #include "StelTextureTypes.hpp"
 #include "StelLocation.hpp"
+#include "HorizonProfile.hpp"
 
 #include <QMap>
 #include <QImage>
@@ -72,6 +73,8 @@ public:
 		landFader.update((int)(deltaTime*1000));
 		fogFader.update((int)(deltaTime*1000));
 	}
+	//! Return whether the landscape or the fog is fading in or out.
+	bool isFading() const {return landFader.isFading() || fogFader.isFading();}
 
 	//! Set the brightness of the landscape plus brightness of optional add-on night lightscape.
 	//! This is called in each draw().
@@ -117,7 +120,12 @@ public:
 	//! e.g. by the LandscapeMgr. Contrary to that, the purpose of the azimuth rotation
 	//! (landscape/[decor_]angle_rotatez) in landscape.ini is to orient the pano.
 	//! @param d the rotation angle in degrees.
-	void setZRotation(float d) {angleRotateZOffset = d * M_PI/180.0f;}
+	void setZRotation(float d)
+	{
+		angleRotateZOffset = d * M_PI/180.0f;
+		cosRotateZOffset = std::cos(angleRotateZOffset);
+		sinRotateZOffset = std::sin(angleRotateZOffset);
+	}
 
 	//! Get whether the landscape is currently fully visible (i.e. opaque).
 	bool getIsFullyVisible() const {return landFader.getInterstate() >= 0.999f;}
@@ -135,6 +143,18 @@ public:
 		azGrad_altGrad = 4, //! azimuth[new_degrees] altitude[new_degrees] (may be found on theodolites)
 		azGrad_zdGrad  = 5  //! azimuth[new_degrees] zenithDistance[new_degrees] (may be found on theodolites)
 	};
+
+	//! Return the altitude of the visible horizon in the azimuth of a direction.
+	//! It is read from the horizon profile computed when the landscape is loaded, which is much faster than sampling getOpacity().
+	//! @param azalt a direction in alt-az frame. Only its azimuth is used.
+	//! @return the altitude [radians] above which the landscape is transparent. 0 if the landscape has no horizon profile.
+	float getHorizonAltitude(const Vec3d& azalt) const {return std::asin(getHorizonProfileSine(azalt));}
+	//! Return whether a direction is below the visible horizon, as given by the horizon profile.
+	//! This is cheap enough to cull many objects hidden by the terrain.
+	//! @param azalt normalized direction in alt-az frame.
+	bool isBelowHorizon(const Vec3d& azalt) const {return azalt[2] < getHorizonProfileSine(azalt);}
+	//! Return the lowest altitude [radians] of the visible horizon. 0 if the landscape has no horizon profile.
+	float getMinimalHorizonAltitude() const {return horizonProfile.getMinAltitude();}
 	
 protected:
 	//! Load attributes common to all landscapes
@@ -146,6 +166,10 @@ protected:
 	//! @param _lineFileName A text file with lines that are either empty or comment lines starting with # or azimuth altitude [degrees]
 	//! @param _polyAngleRotateZ possibility to set some final calibration offset like meridian convergence correction.
 	void createPolygonalHorizon(const QString& lineFileName, const float polyAngleRotateZ=0.0f, const QString &listMode="azDeg_altDeg");
+	//! Compute the horizon profile, i.e. the altitude of the visible horizon by azimuth, by sampling getOpacity().
+	//! To be called by the subclasses at the end of their loading, once getOpacity() can be used.
+	//! Without profile, the horizon is the mathematical horizon.
+	void computeHorizonProfile();
 
 	//! search for a texture in landscape directory, else global textures directory
 	//! @param basename The name of a texture file, e.g. "fog.png"
@@ -182,6 +206,14 @@ protected:
 									   //! For LandscapePolygonal, this is the only horizon data item.
 	Vec3f horizonPolygonLineColor ;    //! for all horizon types, the horizonPolygon line, if specified, will be drawn in this color
 									   //! specified in landscape.ini[landscape]horizon_line_color. Negative red (default) indicated "don't draw".
+
+private:
+	//! Return the sine of the altitude of the visible horizon in the azimuth of a direction.
+	float getHorizonProfileSine(const Vec3d& azalt) const;
+
+	float cosRotateZOffset;  //! cosine of angleRotateZOffset
+	float sinRotateZOffset;  //! sine of angleRotateZOffset
+	HorizonProfile horizonProfile;   //! Altitude of the visible horizon, by azimuth. Empty for the mathematical horizon.
 };
 
 //! @class LandscapeOldStyle
@@ -210,6 +242,7 @@ protected:
 	typedef struct
 	{
 		StelTextureSP tex;
+		int texNum;       //! index of the texture in sideTexs and sidesImages
 		float texCoords[4];
 	} landscapeTexCoord;
 
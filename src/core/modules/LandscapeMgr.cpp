@@ -59,6 +59,7 @@ public:
 	Vec3f get_color() {return color;}
 	void updateI18n();
 	void update(double deltaTime) {fader.update((int)(deltaTime*1000));}
+	bool isFading() const {return fader.isFading();}
 	void set_fade_duration(float duration) {fader.setDuration((int)(duration*1000.f));}
 	void setFlagShow(bool b){fader = b;}
 	bool getFlagShow() const {return fader;}
@@ -198,6 +199,11 @@ double LandscapeMgr::getCallOrder(StelModuleActionName actionName) const
 	return 0;
 }
 
+bool LandscapeMgr::needsRedraw(const StelCore*) const
+{
+	return landscape->isFading() || atmosphere->isFading() || cardinalsPoints->isFading();
+}
+
 void LandscapeMgr::update(double deltaTime)
 {
 	atmosphere->update(deltaTime);
@@ -483,6 +489,20 @@ bool LandscapeMgr::getIsLandscapeFullyVisible() const
 	return landscape->getIsFullyVisible();
 }
 
+bool LandscapeMgr::isHiddenByLandscape(const Vec3d& altAz, double margin) const
+{
+	if (!landscape->getIsFullyVisible())
+		return false;
+	if (margin<=0.)
+		return landscape->isBelowHorizon(altAz);
+	return std::asin(qBound(-1., altAz[2], 1.)) + margin < landscape->getHorizonAltitude(altAz);
+}
+
+float LandscapeMgr::getMinimalHorizonAltitude() const
+{
+	return landscape->getMinimalHorizonAltitude();
+}
+
 bool LandscapeMgr::getFlagUseLightPollutionFromDatabase() const
 {
 	return flagLightPollutionFromDatabase;
@@ -85,6 +85,9 @@ public:
 	//! - updates adaptation lumenescence lased on visible bright objects.
 	virtual void update(double deltaTime);
 
+	//! Return true while the landscape, atmosphere or cardinal points are fading in or out.
+	virtual bool needsRedraw(const StelCore* core) const;
+
 	//! Get the order in which this module will draw it's objects relative to other modules.
 	virtual double getCallOrder(StelModuleActionName actionName) const;
 
@@ -112,6 +115,17 @@ public:
 	//! @return A pointer to the newly created landscape object.
 	Landscape* createFromFile(const QString& landscapeFile, const QString& landscapeId);
 
+	//! Return whether a direction is hidden by the current landscape, i.e. whether the landscape
+	//! is fully visible and the direction is below its visible horizon.
+	//! This uses the horizon profile of the landscape, and is fast enough to cull objects before drawing them.
+	//! @param altAz normalized direction in alt-az frame.
+	//! @param margin [radians] the direction is only hidden if it is more than this angle below the horizon,
+	//! e.g. the angular radius of an extended object.
+	bool isHiddenByLandscape(const Vec3d& altAz, double margin=0.) const;
+	//! Return the lowest altitude [radians] of the visible horizon of the current landscape,
+	//! or 0 if its horizon is the mathematical horizon.
+	float getMinimalHorizonAltitude() const;
+
 	// GZ: implement StelModule's method. For test purposes only, we implement a manual transparency sampler.
 	// TODO: comment this away for final builds
 	// virtual void handleMouseClicks(class QMouseEvent*);
@@ -22,13 +22,13 @@
 #include "MeteorMgr.hpp"
 #include "StelApp.hpp"
 #include "StelCore.hpp"
-#include "Meteor.hpp"
 #include "LandscapeMgr.hpp"
 #include "StelModuleMgr.hpp"
+#include "StelMovementMgr.hpp"
 #include "StelPainter.hpp"
+#include "StelToneReproducer.hpp"
 
-#include <functional>
-#include <cstdlib>
+#include <QDateTime>
 #include <QSettings>
 
 MeteorMgr::MeteorMgr(int zhr, int maxv ) : flagShow(true)
@@ -49,16 +49,26 @@ MeteorMgr::MeteorMgr(int zhr, int maxv ) : flagShow(true)
 
 MeteorMgr::~MeteorMgr()
 {
-	for(std::vector<Meteor*>::iterator iter = active.begin(); iter != active.end(); ++iter)
-	{
-		delete *iter;
-	}
-	active.clear();
 }
 
 void MeteorMgr::init()
 {
-	setZHR(StelApp::getInstance().getSettings()->value("astro/meteor_rate", 10).toInt());
+	QSettings* conf = StelApp::getInstance().getSettings();
+	setZHR(conf->value("astro/meteor_rate", 10).toInt());
+	setMaxMeteors(conf->value("astro/meteor_max_count", 100000).toInt());
+	// A fixed seed gives reproducible meteors, e.g. for benchmarks
+	if (conf->contains("astro/meteor_random_seed"))
+		setRandomSeed(conf->value("astro/meteor_random_seed").toInt());
+	else
+		setRandomSeed((int)QDateTime::currentMSecsSinceEpoch());
+}
+
+//! @return whether new meteors are created at the given time rate, in sky seconds per actual second.
+//! This only makes sense given lifetimes of meteors to draw when the time rate is realtime,
+//! otherwise high overhead of large numbers of meteors.
+static bool isSpawningTimeSpeed(const double tspeed)
+{
+	return tspeed>0 && fabs(tspeed)<=1.;
 }
 
 /*************************************************************************
@@ -71,6 +81,13 @@ double MeteorMgr::getCallOrder(StelModuleActionName actionName) const
 	return 0;
 }
 
+bool MeteorMgr::needsRedraw(const StelCore* core) const
+{
+	if (!flagShow)
+		return false;
+	return pool.size()>0 || (ZHR>0 && isSpawningTimeSpeed(core->getTimeRate()*86400));
+}
+
 void MeteorMgr::setZHR(int zhr)
 {
 	ZHR = zhr;
@@ -89,65 +106,70 @@ void MeteorMgr::setMaxVelocity(int maxv)
 
 void MeteorMgr::update(double deltaTime)
 {
+	Q_UNUSED(deltaTime);
+	inputs.flagShow = flagShow;
+	if (!flagShow)
+		return;
+
+	StelCore* core = StelApp::getInstance().getCore();
+	inputs.timeSpeed = core->getTimeRate()*86400;
+	inputs.observerEqu = core->altAzToEquinoxEqu(Vec3d(0,0,EARTH_RADIUS));
+	inputs.eye = *core->getToneReproducer();
+	inputs.fov = core->getMovementMgr()->getCurrentFov();
+
+	// The columns of the rotation from equatorial to local coordinates
+	const Vec3d ex = core->equinoxEquToAltAz(Vec3d(1,0,0), StelCore::RefractionOff);
+	const Vec3d ey = core->equinoxEquToAltAz(Vec3d(0,1,0), StelCore::RefractionOff);
+	const Vec3d ez = core->equinoxEquToAltAz(Vec3d(0,0,1), StelCore::RefractionOff);
+	inputs.equToAltAz.set(ex[0], ex[1], ex[2], 0., ey[0], ey[1], ey[2], 0., ez[0], ez[1], ez[2], 0., 0., 0., 0., 1.);
+}
+
+void MeteorMgr::computeSnapshot(double deltaTime)
+{
+	DrawArrays& arrays = drawArrays.back();
 #ifdef _MSC_BUILD
 	return;
 #endif
-	if (!flagShow)
+	if (!inputs.flagShow)
+	{
+		arrays.trainVertices.resize(0);
+		arrays.trainColors.resize(0);
+		arrays.heads.resize(0);
 		return;
+	}
 	
 	deltaTime*=1000;
-	StelCore* core = StelApp::getInstance().getCore();
 
-	// step through and update all active meteors
-	for (std::vector<Meteor*>::iterator iter = active.begin(); iter != active.end(); ++iter)
+	// update all active meteors, removing the dead ones
+	pool.update(deltaTime);
+
+	if (isSpawningTimeSpeed(inputs.timeSpeed) && ZHR>0)
 	{
-		if (!(*iter)->update(deltaTime))
+		// if stellarium has been suspended, don't create huge number of meteors to
+		// make up for lost time!
+		if (deltaTime > 500)
 		{
-			// remove dead meteor
-			//      qDebug("Meteor \tdied\n");
-
-			delete *iter;
-			active.erase(iter);
-			iter--;  // important!
+			deltaTime = 500;
 		}
-	}
 
-	// only makes sense given lifetimes of meteors to draw when timeSpeed is realtime
-	// otherwise high overhead of large numbers of meteors
-	double tspeed = core->getTimeRate()*86400;  // sky seconds per actual second
-	if (tspeed<=0 || fabs(tspeed)>1.)
-	{
-		// don't start any more meteors
-		return;
-	}
+		// determine average meteors per frame needing to be created
+		int mpf = (int)((double)ZHR*zhrToWsr*deltaTime/1000.0 + 0.5);
+		if (mpf<1)
+			mpf = 1;
 
-	// if stellarium has been suspended, don't create huge number of meteors to
-	// make up for lost time!
-	if (deltaTime > 500)
-	{
-		deltaTime = 500;
-	}
-
-	// determine average meteors per frame needing to be created
-	int mpf = (int)((double)ZHR*zhrToWsr*deltaTime/1000.0 + 0.5);
-	if (mpf<1)
-		mpf = 1;
-
-	int mlaunch = 0;
-	for (int i=0; i<mpf; ++i)
-	{
-		// start new meteor based on ZHR time probability
-		double prob = ((double)rand())/RAND_MAX;
-		if (ZHR>0 && prob<((double)ZHR*zhrToWsr*deltaTime/1000.0/(double)mpf) )
+		const double launchProbability = (double)ZHR*zhrToWsr*deltaTime/1000.0/(double)mpf;
+		int mlaunch = 0;
+		for (int i=0; i<mpf; ++i)
 		{
-			Meteor *m = new Meteor(StelApp::getInstance().getCore(), maxVelocity);
-			active.push_back(m);
-			mlaunch++;
+			// start new meteor based on ZHR time probability
+			if (pool.randomUniform()<launchProbability && pool.spawn(inputs.observerEqu, maxVelocity, inputs.eye, inputs.fov))
+				mlaunch++;
 		}
+		//  qDebug("mpf: %d\tm launched: %d\t(mps: %f)\t%d\n", mpf, mlaunch, ZHR*zhrToWsr, deltaTime);
 	}
-	//  qDebug("mpf: %d\tm launched: %d\t(mps: %f)\t%d\n", mpf, mlaunch, ZHR*zhrToWsr, deltaTime);
-}
 
+	pool.fillDrawArrays(inputs.equToAltAz, arrays.trainVertices, arrays.trainColors, arrays.heads);
+}
 
 void MeteorMgr::draw(StelCore* core)
 {
@@ -158,14 +180,45 @@ void MeteorMgr::draw(StelCore* core)
 	if (landmgr->getFlagAtmosphere() && landmgr->getLuminance()>5)
 		return;
 
+	const DrawArrays& arrays = drawArrays.front();
+	const QVector<Vec3d>& trainVertices = arrays.trainVertices;
+	const QVector<Vec4f>& trainColors = arrays.trainColors;
+	const QVector<Vec3d>& heads = arrays.heads;
+	if (trainVertices.isEmpty() && heads.isEmpty())
+		return;
+
 	StelPainter sPainter(core->getProjection(StelCore::FrameAltAz));
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_BLEND);
 	sPainter.enableTexture2d(false);
 
-	// step through and draw all active meteors
-	for (std::vector<Meteor*>::iterator iter = active.begin(); iter != active.end(); ++iter)
+	// All the trains in one call
+	if (!trainVertices.isEmpty())
+	{
+		sPainter.setColorPointer(4, GL_FLOAT, trainColors.constData());
+		sPainter.setVertexPointer(3, GL_DOUBLE, trainVertices.constData());
+		sPainter.enableClientStates(true, false, true);
+		sPainter.drawFromArray(StelPainter::Lines, trainVertices.size(), 0, true);
+		sPainter.enableClientStates(false);
+	}
+
+	// The meteors just created are a single point
+	if (!heads.isEmpty())
 	{
-		(*iter)->draw(core, sPainter);
+		const StelProjectorP prj = sPainter.getProjector();
+		headPoints.resize(0);
+		Vec3d win;
+		foreach (const Vec3d& h, heads)
+		{
+			if (prj->project(h, win))
+				headPoints.append(Vec3f(win[0], win[1], 0.f));
+		}
+		if (!headPoints.isEmpty())
+		{
+			sPainter.setVertexPointer(3, GL_FLOAT, headPoints.constData());
+			sPainter.enableClientStates(true);
+			sPainter.drawFromArray(StelPainter::Points, headPoints.size(), 0, false);
+			sPainter.enableClientStates(false);
+		}
 	}
 }
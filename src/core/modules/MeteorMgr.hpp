@@ -20,13 +20,17 @@
 #ifndef _METEORMGR_HPP_
 #define _METEORMGR_HPP_
 
-#include <vector>
 #include "StelModule.hpp"
+#include "MeteorPool.hpp"
+#include "StelDoubleBuffer.hpp"
+#include "StelToneReproducer.hpp"
 
-class Meteor;
+#include <QVector>
 
 //! @class MeteorMgr
 //! Simulates a meteor shower.
+//! The meteors are simulated in computeSnapshot(), on a worker thread while the
+//! previous frame is drawn, so that they are drawn with one frame of delay.
 class MeteorMgr : public StelModule
 {
 	Q_OBJECT
@@ -51,14 +55,27 @@ public:
 	//! Draw meteors.
 	virtual void draw(StelCore* core);
 	
+	//! Save the state of the core used to simulate the meteors in computeSnapshot().
+	virtual void update(double deltaTime);
+
+	//! The meteors are simulated in computeSnapshot().
+	virtual bool hasSnapshots() const {return true;}
+
 	//! Update time-dependent parts of the module.
 	//! This function adds new meteors to the list of currently visiable
-	//! ones based on the current rate, and removes those which have run their 
-	//! course.
-	virtual void update(double deltaTime);
+	//! ones based on the current rate, removes those which have run their
+	//! course, and computes the vertices of the next frame.
+	virtual void computeSnapshot(double deltaTime);
+
+	//! Draw the vertices computed by the last call of computeSnapshot().
+	virtual void publishSnapshot() {drawArrays.swap();}
 	
 	//! Defines the order in which the various modules are drawn.
 	virtual double getCallOrder(StelModuleActionName actionName) const;
+
+	//! Return true while meteors are shown and may be visible, as they move
+	//! much faster than the sky drift measured by the core.
+	virtual bool needsRedraw(const StelCore* core) const;
 	
 public slots:
 	///////////////////////////////////////////////////////////////////////////
@@ -75,12 +92,46 @@ public slots:
 	
 	//! Set the maximum velocity in km/s
 	void setMaxVelocity(int maxv);
+
+	//! Set the maximum number of simultaneous meteors.
+	void setMaxMeteors(int n) { pool.setCapacity(n); }
+	//! Get the maximum number of simultaneous meteors.
+	int getMaxMeteors(void) const { return pool.getCapacity(); }
+	//! Get the number of meteors currently visible.
+	int getMeteorCount(void) const { return pool.size(); }
+
+	//! Restart the meteor generation from the given seed, so that the same
+	//! meteors are produced in the same conditions, e.g. for benchmarks.
+	void setRandomSeed(int seed) { pool.setRandomSeed((quint32)seed); }
 	
 signals:
 	void zhrChanged(int);
 	
 private:
-	std::vector<Meteor*> active;		// Vector containing all active meteors
+	//! The vertices of a frame, kept to avoid allocations
+	struct DrawArrays
+	{
+		QVector<Vec3d> trainVertices;
+		QVector<Vec4f> trainColors;
+		QVector<Vec3d> heads;
+	};
+
+	//! The state of the core at the last update, used by computeSnapshot()
+	struct SimulationInputs
+	{
+		SimulationInputs() : flagShow(false), timeSpeed(0.), fov(0.f) {;}
+		bool flagShow;
+		double timeSpeed;       // sky seconds per actual second
+		Vec3d observerEqu;
+		StelToneReproducer eye;
+		float fov;
+		Mat4d equToAltAz;
+	};
+
+	MeteorPool pool;		// all active meteors
+	SimulationInputs inputs;
+	StelDoubleBuffer<DrawArrays> drawArrays;
+	QVector<Vec3f> headPoints;
 	int ZHR;
 	int maxVelocity;
 	double zhrToWsr;  // factor to convert from zhr to whole earth per second rate
@@ -0,0 +1,294 @@
+/*
+ * Stellarium
+ * This file Copyright (C) 2004 Robert Spearman
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+// This is an ad hoc meteor model
+// Could use a simple ablation physics model in the future
+
+/*
+NOTE: Here the radiant is always along the ecliptic at the apex of the Earth's way.
+In reality, individual meteor streams have varying velocity vectors and therefore radiants
+which are generally not at the apex of the Earth's way, such as the Perseids shower.
+*/
+
+// Improved realism and efficiency 2004-12
+
+#include "MeteorPool.hpp"
+#include "StelToneReproducer.hpp"
+
+#include <cmath>
+
+//! Number of meteors allocated when the pool is first used
+static const int MIN_POOL_SIZE = 256;
+
+MeteorPool::MeteorPool(int c) : capacity(c), count(0)
+{
+	setRandomSeed(1);
+}
+
+void MeteorPool::setCapacity(int c)
+{
+	capacity = qMax(0, c);
+	count = qMin(count, capacity);
+}
+
+void MeteorPool::setRandomSeed(quint32 seed)
+{
+	// The xorshift state must not be zero
+	randomState = seed ? seed : 0x9e3779b9;
+}
+
+bool MeteorPool::reserveOne()
+{
+	if (count < base.size())
+		return true;
+	if (count >= capacity)
+		return false;
+
+	const int newSize = qMin(capacity, qMax(MIN_POOL_SIZE, 2*base.size()));
+	base.resize(newSize);
+	direction.resize(newSize);
+	z.resize(newSize);
+	trainZ.resize(newSize);
+	startH.resize(newSize);
+	endH.resize(newSize);
+	observerZ.resize(newSize);
+	velocity.resize(newSize);
+	mag.resize(newSize);
+	xyDistance2.resize(newSize);
+	minDist2.resize(newSize);
+	distMultiplier.resize(newSize);
+	train.resize(newSize);
+	return true;
+}
+
+void MeteorPool::move(int from, int to)
+{
+	base[to] = base.at(from);
+	direction[to] = direction.at(from);
+	z[to] = z.at(from);
+	trainZ[to] = trainZ.at(from);
+	startH[to] = startH.at(from);
+	endH[to] = endH.at(from);
+	observerZ[to] = observerZ.at(from);
+	velocity[to] = velocity.at(from);
+	mag[to] = mag.at(from);
+	xyDistance2[to] = xyDistance2.at(from);
+	minDist2[to] = minDist2.at(from);
+	distMultiplier[to] = distMultiplier.at(from);
+	train[to] = train.at(from);
+}
+
+bool MeteorPool::spawn(const Vec3d& observerEqu, double maxVelocity, const StelToneReproducer& eye, float fov)
+{
+	if (count >= capacity)
+		return false;
+
+	const double v = 11+randomUniform()*(maxVelocity-11);  // abs range 11-72 km/s by default (see line 427 in StelApp.cpp)
+
+	// view matrix of sporadic meteors model
+	const double alpha = randomUniform()*2*M_PI;
+	const double delta = M_PI_2 - randomUniform()*M_PI;
+	const Mat4d mmat = Mat4d::zrotation(alpha) * Mat4d::yrotation(delta);
+
+	// select random trajectory using polar coordinates in XY plane, centered on observer
+	const double xydistance = randomUniform()*(VISIBLE_RADIUS);
+	const double angle = randomUniform()*2*M_PI;
+
+	// find observer position in meteor coordinate system
+	const Vec3d obs = mmat.transpose().multiplyWithoutTranslation(observerEqu);
+
+	// meteor start x,y
+	const double x = xydistance*std::cos(angle) + obs[0];
+	const double y = xydistance*std::sin(angle) + obs[1];
+
+	// determine life of meteor (start and end z value based on atmosphere burn altitudes)
+
+	// D is distance from center of earth
+	const double D2 = x*x + y*y;
+	if (D2 > (EARTH_RADIUS+HIGH_ALTITUDE)*(EARTH_RADIUS+HIGH_ALTITUDE))
+	{
+		// won't be visible
+		return false;
+	}
+
+	const double start = std::sqrt((EARTH_RADIUS+HIGH_ALTITUDE)*(EARTH_RADIUS+HIGH_ALTITUDE) - D2);
+
+	// determine end of burn point, and nearest point to observer for distance mag calculation
+	// mag should be max at nearest point still burning
+	double end, minDist;
+	if (D2 > (EARTH_RADIUS+LOW_ALTITUDE)*(EARTH_RADIUS+LOW_ALTITUDE))
+	{
+		end = -start;  // earth grazing
+		minDist = xydistance;
+	}
+	else
+	{
+		end = std::sqrt((EARTH_RADIUS+LOW_ALTITUDE)*(EARTH_RADIUS+LOW_ALTITUDE) - D2);
+		minDist = std::sqrt(xydistance*xydistance + (end-obs[2])*(end-obs[2]));
+	}
+
+	if (minDist > VISIBLE_RADIUS)
+	{
+		// on average, not visible (although if were zoomed ...)
+		return false;
+	}
+
+	// Determine drawing color given magnitude and eye
+	// (won't be visible during daylight)
+
+	// *** color varies somewhat based on velocity, plus atmosphere reddening
+
+	// determine intensity
+	const float Mag1 = randomUniform()*6.75f - 3;
+	const float Mag2 = randomUniform()*6.75f - 3;
+	const float Mag = (Mag1 + Mag2)/2.0f;
+	const float term1 = std::exp(-0.92103f*((5.f + Mag)/256.f + 12.12331f)) * 108064.73f;
+
+	// Compute the equivalent star luminance for a 5 arc min circle and convert it
+	// in function of the eye adaptation
+	const float rmag = eye.adaptLuminanceScaled(term1)/std::pow(fov, 0.85f)*500.f;
+
+	// if size of star is too small (blink) we put its size to 1.2 --> no more blink
+	// And we compensate the difference of brighteness with cmag
+	float m = 1.f;  // assumes white
+	if (rmag<1.2f)
+		m = rmag*rmag/1.44f;
+
+	// most visible meteors are under about 180km distant
+	// scale max mag down if outside this range
+	if (minDist>180.)
+		m *= 180*180/(minDist*minDist);
+
+	if (!reserveOne())
+		return false;
+	const int i = count++;
+	base[i] = mmat.multiplyWithoutTranslation(Vec3d(x, y, 0.));
+	direction[i] = mmat.multiplyWithoutTranslation(Vec3d(0., 0., 1.));
+	z[i] = start;
+	trainZ[i] = start;
+	startH[i] = start;
+	endH[i] = end;
+	observerZ[i] = obs[2];
+	velocity[i] = v;
+	mag[i] = m;
+	xyDistance2[i] = xydistance*xydistance;
+	minDist2[i] = minDist*minDist;
+	distMultiplier[i] = 1.f;
+	train[i] = 0;
+	return true;
+}
+
+void MeteorPool::update(double deltaTime)
+{
+	// Work on the raw arrays: this is the inner loop of meteor storms
+	double* pz = z.data();
+	double* ptrainZ = trainZ.data();
+	const double* pstartH = startH.constData();
+	const double* pendH = endH.constData();
+	const double* pobserverZ = observerZ.constData();
+	const float* pvelocity = velocity.constData();
+	float* pmag = mag.data();
+	const float* pxyDistance2 = xyDistance2.constData();
+	const float* pminDist2 = minDist2.constData();
+	float* pdistMultiplier = distMultiplier.data();
+
+	const float fade = deltaTime/500.0f;
+	int i = 0;
+	while (i<count)
+	{
+		bool alive = true;
+		if (pz[i] < pendH[i])
+		{
+			// burning has stopped so magnitude fades out
+			// assume linear fade out
+			pmag[i] -= fade;
+			alive = pmag[i] >= 0.f;  // no longer visible
+		}
+		if (!alive)
+		{
+			// The last meteor takes the place of the dead one, and is updated next
+			--count;
+			if (i<count)
+				move(count, i);
+			continue;
+		}
+
+		// *** would need time direction multiplier to allow reverse time replay
+		const double step = pvelocity[i]*deltaTime/1000.0;
+		pz[i] -= step;
+
+		// train doesn't extend beyond start of burn
+		if (pz[i] + pvelocity[i]*0.5f > pstartH[i])
+			ptrainZ[i] = pstartH[i];
+		else
+			ptrainZ[i] -= step;
+
+		// determine visual magnitude based on distance to observer
+		const double dz = pz[i]-pobserverZ[i];
+		double dist2 = pxyDistance2[i] + dz*dz;
+		if (dist2 == 0.)
+			dist2 = .0001;  // just to be cautious (meteor hits observer!)
+		pdistMultiplier[i] = pminDist2[i]/dist2;
+		++i;
+	}
+}
+
+void MeteorPool::fillDrawArrays(const Mat4d& equToAltAz, QVector<Vec3d>& trainVertices, QVector<Vec4f>& trainColors, QVector<Vec3d>& heads)
+{
+	trainVertices.resize(4*count);
+	trainColors.resize(4*count);
+	heads.resize(0);
+	Vec3d* v = trainVertices.data();
+	Vec4f* c = trainColors.data();
+	const Vec3d earthCenter(0., 0., -EARTH_RADIUS);
+
+	for (int i=0; i<count; ++i)
+	{
+		// convert to local and correct for earth radius [since equ and local coordinates in stellarium use same 0 point!]
+		// 1216 is to scale down under 1 for desktop version
+		const Vec3d b = (equToAltAz.multiplyWithoutTranslation(base.at(i)) + earthCenter)/1216.;
+		const Vec3d d = equToAltAz.multiplyWithoutTranslation(direction.at(i))/1216.;
+		const Vec3d spos = b + d*z.at(i);
+		if (!train.at(i))
+		{
+			heads.append(spos);
+			train[i] = 1;
+			continue;
+		}
+
+		// connect this point with last drawn point
+		const float tmag = mag.at(i)*distMultiplier.at(i);
+
+		// compute an intermediate point so can curve slightly along projection distortions
+		const Vec3d posi = b + d*((z.at(i) + trainZ.at(i))/2);
+
+		// draw dark to light
+		*v++ = b + d*trainZ.at(i);
+		*v++ = posi;
+		*v++ = posi;
+		*v++ = spos;
+		(c++)->set(0,0,0,0);
+		(c++)->set(1,1,1,tmag*0.5f);
+		(c++)->set(1,1,1,tmag*0.5f);
+		(c++)->set(1,1,1,tmag);
+	}
+
+	trainVertices.resize(v-trainVertices.constData());
+	trainColors.resize(c-trainColors.constData());
+}
@@ -0,0 +1,125 @@
+/*
+ * Stellarium
+ * This file Copyright (C) 2004 Robert Spearman
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _METEORPOOL_HPP_
+#define _METEORPOOL_HPP_
+
+#include "VecMath.hpp"
+
+#include <QVector>
+
+class StelToneReproducer;
+
+// all in km - altitudes make up meteor range
+#define EARTH_RADIUS 6369.f
+#define HIGH_ALTITUDE 115.f
+#define LOW_ALTITUDE 70.f
+#define VISIBLE_RADIUS 457.8f
+
+//! @class MeteorPool
+//! Models all the active meteors.
+//! Control of the meteor rate is performed in the MeteorMgr class. Once
+//! created, a meteor only lasts for some amount of time, and then "dies",
+//! after which it is removed from the pool by update().
+//! The meteors are stored as a structure of arrays: each field has its own
+//! array, and the live meteors always occupy the first size() elements. The
+//! arrays grow up to the capacity of the pool and are never shrunk, so that
+//! creating and removing meteors does not allocate memory once the pool has
+//! reached its working size. A dead meteor is replaced by the last one.
+//! The random numbers come from a private generator, so that a given seed
+//! always produces the same meteors.
+class MeteorPool
+{
+public:
+	//! Create an empty pool.
+	//! @param capacity the maximum number of simultaneous meteors.
+	MeteorPool(int capacity=100000);
+
+	//! Set the maximum number of simultaneous meteors.
+	//! Meteors beyond the new capacity are removed.
+	void setCapacity(int capacity);
+	int getCapacity() const {return capacity;}
+
+	//! Return the number of live meteors.
+	int size() const {return count;}
+	//! Remove all the meteors.
+	void clear() {count=0;}
+
+	//! Restart the random number generator from the given seed.
+	void setRandomSeed(quint32 seed);
+	//! Return a uniform random number in [0, 1).
+	double randomUniform()
+	{
+		// Marsaglia xorshift generator
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+		return randomState*(1./4294967296.);
+	}
+
+	//! Create a random meteor.
+	//! @param observerEqu the observer position in equatorial coordinates, in km from the center of the Earth.
+	//! @param maxVelocity the maximum velocity of the meteor in km/s.
+	//! @param eye the tone reproducer used to compute the brightness of the meteor.
+	//! @param fov the current field of view in degrees.
+	//! @return false if the meteor would not be visible or if the pool is full.
+	bool spawn(const Vec3d& observerEqu, double maxVelocity, const StelToneReproducer& eye, float fov);
+
+	//! Update the positions of all the meteors and remove the ones which burned out.
+	//! @param deltaTime the time step in milliseconds.
+	void update(double deltaTime);
+
+	//! Compute the vertices to draw all the meteors, in the local frame.
+	//! The meteors which were just created are drawn as a point at their head,
+	//! the others as a train, made of 2 segments going from dark to light.
+	//! @param equToAltAz the transformation from equatorial to altazimuthal coordinates.
+	//! @param trainVertices receive the line segments of the trains.
+	//! @param trainColors receive the color of each vertex of the trains.
+	//! @param heads receive the position of the new meteors.
+	void fillDrawArrays(const Mat4d& equToAltAz, QVector<Vec3d>& trainVertices, QVector<Vec4f>& trainColors, QVector<Vec3d>& heads);
+
+private:
+	//! Make the arrays large enough for one more meteor.
+	//! @return false if the pool is full.
+	bool reserveOne();
+	//! Copy the meteor at index from to index to.
+	void move(int from, int to);
+
+	int capacity;
+	int count;
+	quint32 randomState;
+
+	// Start of the path and direction of travel in equatorial coordinates, the meteor
+	// position being base + z*direction
+	QVector<Vec3d> base;
+	QVector<Vec3d> direction;
+	QVector<double> z;           // position of the head along the path
+	QVector<double> trainZ;      // position of the end of train
+	QVector<double> startH;      // start height above center of earth
+	QVector<double> endH;        // end height
+	QVector<double> observerZ;   // observer position along the path
+	QVector<float> velocity;     // km/s
+	QVector<float> mag;          // apparent magnitude at head, 0-1
+	QVector<float> xyDistance2;  // squared distance from observer to meteor path
+	QVector<float> minDist2;     // squared nearest distance to observer along path
+	QVector<float> distMultiplier;  // scale magnitude due to changes in distance
+	QVector<char> train;         // point or train visible?
+};
+
+#endif // _METEORPOOL_HPP_
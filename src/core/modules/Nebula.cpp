@@ -30,11 +30,9 @@
 #include "StelPainter.hpp"
 
 #include <QTextStream>
-#include <QFile>
 #include <QString>
 
 #include <QDebug>
-#include <QBuffer>
 
 StelTextureSP Nebula::texCircle;
 StelTextureSP Nebula::texGalaxy;
@@ -47,15 +45,24 @@ float Nebula::circleScale = 1.f;
 float Nebula::hintsBrightness = 0;
 Vec3f Nebula::labelColor = Vec3f(0.4,0.3,0.5);
 Vec3f Nebula::circleColor = Vec3f(0.8,0.8,0.1);
-
-Nebula::Nebula() :
-		M_nb(0),
-		NGC_nb(0),
-		IC_nb(0),
-		C_nb(0)
+QVector<Vec2f> Nebula::hintsPositions[Nebula::NebUnknown+1];
+QVector<Vec2f> Nebula::hintsVertices;
+QVector<Vec2f> Nebula::hintsTexCoords;
+
+Nebula::Nebula(const NebulaCatalog::Record& record, const QString& aenglishName, const QString& nameI18n) :
+		M_nb(record.M_nb),
+		NGC_nb(record.NGC_nb),
+		IC_nb(record.IC_nb),
+		C_nb(record.C_nb),
+		englishName(aenglishName),
+		nameI18(nameI18n),
+		mag(record.mag),
+		angularSize(record.angularSize),
+		XYZ(record.XYZ[0], record.XYZ[1], record.XYZ[2])
 {
-	nameI18 = "";
-	angularSize = -1;
+	XYZ.normalize();
+	nType = record.type<=NebUnknown ? (NebulaType)record.type : NebUnknown;
+	pointRegion = SphericalRegionP(new SphericalPoint(getJ2000EquatorialPos(NULL)));
 }
 
 Nebula::~Nebula()
@@ -176,187 +183,88 @@ float Nebula::getSurfaceBrightnessWithExtinction(const StelCore* core) const
 		return 99;
 }
 
-void Nebula::drawHints(StelPainter& sPainter, float maxMagHints)
+void Nebula::drawHint(const Vec3d& XY, int type)
 {
-	float lim = mag;
-	if (lim > 50) lim = 15.f;
-
-	// temporary workaround of this bug: https://bugs.launchpad.net/stellarium/+bug/1115035 --AW
-	if (getEnglishName().contains("Pleiades"))
-		lim = 5.f;
-
-	if (lim>maxMagHints)
-		return;
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE);
-	float lum = 1.f;//qMin(1,4.f/getOnScreenSize(core))*0.8;
-	Vec3f col(circleColor[0]*lum*hintsBrightness, circleColor[1]*lum*hintsBrightness, circleColor[2]*lum*hintsBrightness);
+	if (type<0 || type>NebUnknown)
+		type = NebUnknown;
+	hintsPositions[type].append(Vec2f(XY[0], XY[1]));
+}
 
-	sPainter.setColor(col[0], col[1], col[2], 1);
-	switch (nType)
+StelTextureSP Nebula::getHintTexture(NebulaType type)
+{
+	switch (type)
 	{
 		case NebGx:
-			Nebula::texGalaxy->bind();
-			break;
+			return Nebula::texGalaxy;
 		case NebOc:
-			Nebula::texOpenCluster->bind();
-			break;
+			return Nebula::texOpenCluster;
 		case NebGc:
-			Nebula::texGlobularCluster->bind();
-			break;
+			return Nebula::texGlobularCluster;
 		case NebN:
-			Nebula::texDiffuseNebula->bind();
-			break;
+			return Nebula::texDiffuseNebula;
 		case NebPn:
-			Nebula::texPlanetaryNebula->bind();
-			break;
+			return Nebula::texPlanetaryNebula;
 		case NebCn:
-			Nebula::texOpenClusterWithNebulosity->bind();
-			break;
+			return Nebula::texOpenClusterWithNebulosity;
 		default:
-			Nebula::texCircle->bind();
+			return Nebula::texCircle;
 	}
-
-	sPainter.drawSprite2dMode(XY[0], XY[1], 6);
 }
 
-void Nebula::drawLabel(StelPainter& sPainter, float maxMagLabel)
+void Nebula::drawHintsBatch(StelPainter& sPainter)
 {
-	float lim = mag;
-	if (lim > 50) lim = 15.f;
-
-	// temporary workaround of this bug: https://bugs.launchpad.net/stellarium/+bug/1115035 --AW
-	if (getEnglishName().contains("Pleiades"))
-		lim = 5.f;
-
-	if (lim>maxMagLabel)
-		return;
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	float lum = 1.f;//qMin(1,4.f/getOnScreenSize(core))*0.8;
+	Vec3f col(circleColor[0]*lum*hintsBrightness, circleColor[1]*lum*hintsBrightness, circleColor[2]*lum*hintsBrightness);
+	sPainter.setColor(col[0], col[1], col[2], 1);
 
-	Vec3f col(labelColor[0], labelColor[1], labelColor[2]);
+	// Same size as StelPainter::drawSprite2dMode(x, y, 6)
+	const float radius = 6.f*sPainter.getProjector()->getDevicePixelsPerPixel()*StelApp::getInstance().getGlobalScalingRatio();
 
-	sPainter.setColor(col[0], col[1], col[2], hintsBrightness);
-	float size = getAngularSize(NULL)*M_PI/180.*sPainter.getProjector()->getPixelPerRadAtCenter();
-	float shift = 4.f + size/1.8f;
-	QString str;
-	if (!nameI18.isEmpty())
-		str = getNameI18n();
-	else
+	sPainter.enableClientStates(true, true);
+	for (int type=0; type<=NebUnknown; ++type)
 	{
-		if (M_nb > 0)
-			str = QString("M %1").arg(M_nb);
-		else if (C_nb > 0)
-			str = QString("C %1").arg(C_nb);
-		else if (NGC_nb > 0)
-			str = QString("NGC %1").arg(NGC_nb);
-		else if (IC_nb > 0)
-			str = QString("IC %1").arg(IC_nb);		
-	}
-
-	sPainter.drawText(XY[0]+shift, XY[1]+shift, str, 0, 0, 0, false);
-}
-
+		QVector<Vec2f>& positions = hintsPositions[type];
+		if (positions.isEmpty())
+			continue;
+
+		const int count = 6*positions.size();
+		while (hintsTexCoords.size()<count)
+			hintsTexCoords << Vec2f(0.f, 0.f) << Vec2f(1.f, 0.f) << Vec2f(0.f, 1.f)
+				       << Vec2f(1.f, 0.f) << Vec2f(1.f, 1.f) << Vec2f(0.f, 1.f);
+		hintsVertices.resize(count);
+		Vec2f* v = hintsVertices.data();
+		foreach (const Vec2f& pos, positions)
+		{
+			const float x = pos[0], y = pos[1];
+			(v++)->set(x-radius, y-radius);
+			(v++)->set(x+radius, y-radius);
+			(v++)->set(x-radius, y+radius);
+			(v++)->set(x+radius, y-radius);
+			(v++)->set(x+radius, y+radius);
+			(v++)->set(x-radius, y+radius);
+		}
 
-void Nebula::readNGC(QDataStream& in)
-{
-	bool isIc;
-	int nb;
-	float ra, dec;
-	unsigned int type;
-	in >> isIc >> nb >> ra >> dec >> mag >> angularSize >> type;
-	if (isIc)
-	{
-		IC_nb = nb;
-	}
-	else
-	{
-		NGC_nb = nb;
-	}
-	StelUtils::spheToRect(ra,dec,XYZ);
-	Q_ASSERT(fabs(XYZ.lengthSquared()-1.)<0.000000001);
-	nType = (Nebula::NebulaType)type;
-	// GZ: Trace the undefined entries...
-	//if (type >= 5) {
-	//	qDebug()<< (isIc?"IC" : "NGC") << nb << " type " << type ;
-	//}
-	if (type == 5) {
-		qDebug()<< (isIc?"IC" : "NGC") << nb << " type " << type ;
+		getHintTexture((NebulaType)type)->bind();
+		sPainter.setVertexPointer(2, GL_FLOAT, hintsVertices.constData());
+		sPainter.setTexCoordPointer(2, GL_FLOAT, hintsTexCoords.constData());
+		sPainter.drawFromArray(StelPainter::Triangles, count, 0, false);
+		positions.resize(0);
 	}
-	pointRegion = SphericalRegionP(new SphericalPoint(getJ2000EquatorialPos(NULL)));
+	sPainter.enableClientStates(false);
 }
 
-#if 0
-QFile filess("filess.dat");
-QDataStream out;
-out.setVersion(QDataStream::Qt_4_5);
-bool Nebula::readNGC(char *recordstr)
+void Nebula::drawLabel(StelPainter& sPainter, const Vec3d& XY, float angularSize, const QString& text)
 {
-	int rahr;
-	float ramin;
-	int dedeg;
-	float demin;
-	int nb;
-
-	sscanf(&recordstr[1],"%d",&nb);
-
-	if (recordstr[0] == 'I')
-	{
-		IC_nb = nb;
-	}
-	else
-	{
-		NGC_nb = nb;
-	}
+	Vec3f col(labelColor[0], labelColor[1], labelColor[2]);
 
-	sscanf(&recordstr[12],"%d %f",&rahr, &ramin);
-	sscanf(&recordstr[22],"%d %f",&dedeg, &demin);
-	float RaRad = (double)rahr+ramin/60;
-	float DecRad = (float)dedeg+demin/60;
-	if (recordstr[21] == '-') DecRad *= -1.;
-
-	RaRad*=M_PI/12.;     // Convert from hours to rad
-	DecRad*=M_PI/180.;    // Convert from deg to rad
-
-	// Calc the Cartesian coord with RA and DE
-	StelUtils::spheToRect(RaRad,DecRad,XYZ);
-
-	sscanf(&recordstr[47],"%f",&mag);
-	if (mag < 1) mag = 99;
-
-	// Calc the angular size in radian : TODO this should be independant of tex_angular_size
-	float size;
-	sscanf(&recordstr[40],"%f",&size);
-
-	angularSize = size/60;
-	if (angularSize<0)
-		angularSize=0;
-
-	// this is a huge performance drag if called every frame, so cache here
-	if (!strncmp(&recordstr[8],"Gx",2)) { nType = NebGx;}
-	else if (!strncmp(&recordstr[8],"OC",2)) { nType = NebOc;}
-	else if (!strncmp(&recordstr[8],"Gb",2)) { nType = NebGc;}
-	else if (!strncmp(&recordstr[8],"Nb",2)) { nType = NebN;}
-	else if (!strncmp(&recordstr[8],"Pl",2)) { nType = NebPn;}
-	else if (!strncmp(&recordstr[8],"  ",2)) { return false;}
-	else if (!strncmp(&recordstr[8]," -",2)) { return false;}
-	else if (!strncmp(&recordstr[8]," *",2)) { return false;}
-	else if (!strncmp(&recordstr[8],"D*",2)) { return false;}
-	else if (!strncmp(&recordstr[7],"***",3)) { return false;}
-	else if (!strncmp(&recordstr[7],"C+N",3)) { nType = NebCn;}
-	else if (!strncmp(&recordstr[8]," ?",2)) { nType = NebUnknown;}
-	else { nType = NebUnknown;}
-
-	if (!filess.isOpen())
-	{
-		filess.open(QIODevice::WriteOnly);
-		out.setDevice(&filess);
-	}
-	out << ((bool)(recordstr[0] == 'I')) << nb << RaRad << DecRad << mag << angularSize << ((unsigned int)nType);
-	if (nb==5369 && recordstr[0] == 'I')
-		filess.close();
+	sPainter.setColor(col[0], col[1], col[2], hintsBrightness);
+	float size = angularSize*0.5f*M_PI/180.*sPainter.getProjector()->getPixelPerRadAtCenter();
+	float shift = 4.f + size/1.8f;
 
-	return true;
+	sPainter.drawText(XY[0]+shift, XY[1]+shift, text, 0, 0, 0, false);
 }
-#endif
 
 QString Nebula::getTypeString(void) const
 {
@@ -24,17 +24,19 @@
 #include "StelObject.hpp"
 #include "StelTranslator.hpp"
 #include "StelTextureTypes.hpp"
+#include "NebulaCatalog.hpp"
 
 #include <QString>
+#include <QVector>
 
 class StelPainter;
-class QDataStream;
 
 class Nebula : public StelObject
 {
 friend class NebulaMgr;
 public:
-	Nebula();
+	//! Create the object for a record of the catalog.
+	Nebula(const NebulaCatalog::Record& record, const QString& englishName, const QString& nameI18n);
 	~Nebula();
 
 	//! Nebula support the following InfoStringGroup flags:
@@ -93,11 +95,15 @@ private:
 	//! Translate nebula name using the passed translator
 	void translateName(const StelTranslator& trans) {nameI18 = trans.qtranslate(englishName);}
 
-	bool readNGC(char *record);
-	void readNGC(QDataStream& in);
-			
-	void drawLabel(StelPainter& sPainter, float maxMagLabel);
-	void drawHints(StelPainter& sPainter, float maxMagHints);
+	//! Draw the label of an object at the given screen position.
+	static void drawLabel(StelPainter& sPainter, const Vec3d& XY, float angularSize, const QString& text);
+	//! Queue the hint of an object at the given screen position, which is drawn by
+	//! drawHintsBatch() with the other hints of the same type.
+	static void drawHint(const Vec3d& XY, int type);
+	//! Draw the hints queued by drawHints(), in one draw call per nebula type.
+	static void drawHintsBatch(StelPainter& sPainter);
+	//! Get the texture used to draw the hints of the given type.
+	static StelTextureSP getHintTexture(NebulaType type);
 
 	unsigned int M_nb;              // Messier Catalog number
 	unsigned int NGC_nb;            // New General Catalog number
@@ -108,7 +114,6 @@ private:
 	float mag;                      // Apparent magnitude
 	float angularSize;              // Angular size in degree
 	Vec3d XYZ;                      // Cartesian equatorial position
-	Vec3d XY;                       // Store temporary 2D position
 	NebulaType nType;
 
 	SphericalRegionP pointRegion;
@@ -122,6 +127,10 @@ private:
 	static StelTextureSP texOpenClusterWithNebulosity;
 	static float hintsBrightness;
 
+	static QVector<Vec2f> hintsPositions[NebUnknown+1]; // Screen positions of the queued hints of each type
+	static QVector<Vec2f> hintsVertices;  // The quads of the hints of one type, 2 triangles per hint
+	static QVector<Vec2f> hintsTexCoords; // The matching texture coordinates, which are the same for all the hints
+
 	static Vec3f labelColor, circleColor;
 	static float circleScale;       // Define the scaling of the hints circle
 };
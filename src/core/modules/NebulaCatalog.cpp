@@ -0,0 +1,488 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "NebulaCatalog.hpp"
+#include "StelGeodesicGrid.hpp"
+#include "StelSphereGeometry.hpp"
+#include "StelFileMgr.hpp"
+#include "StelUtils.hpp"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegExp>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//! Identifies the compiled catalog files, "SNGC"
+static const quint32 CATALOG_MAGIC = 0x534e4743;
+//! To be incremented when the compiled format changes
+static const quint32 CATALOG_VERSION = 1;
+
+struct NebulaCatalog::Header
+{
+	quint32 magic;
+	quint32 version;
+	char sourceHash[16];
+	quint32 recordSize;
+	qint32 zoneLevel;
+	qint32 nbRecords;
+	qint32 nbIndexEntries;
+	qint32 stringsSize;
+};
+
+struct NebulaCatalog::IndexEntry
+{
+	quint32 key;    // catalog type in the high 16 bits, catalog number in the low 16 bits
+	qint32 record;
+};
+
+static quint32 makeIndexKey(NebulaCatalog::CatalogType catalog, unsigned int number)
+{
+	return ((quint32)catalog << 16) | (number & 0xffff);
+}
+
+template <class T> struct LessKey
+{
+	bool operator()(const T& e, quint32 key) const {return e.key < key;}
+	bool operator()(const T& e1, const T& e2) const {return e1.key < e2.key;}
+};
+
+//! Orders record indices by zone, keeping the catalog order inside a zone.
+struct LessZone
+{
+	LessZone(const QVector<int>& z) : zones(z) {}
+	bool operator()(int i1, int i2) const {return zones.at(i1) < zones.at(i2);}
+	const QVector<int>& zones;
+};
+
+NebulaCatalog::NebulaCatalog() : mappedData(NULL)
+{
+	clear();
+}
+
+NebulaCatalog::~NebulaCatalog()
+{
+	clear();
+}
+
+void NebulaCatalog::clear()
+{
+	if (mappedData)
+		mappedFile.unmap(mappedData);
+	mappedData = NULL;
+	mappedFile.close();
+	memoryData.clear();
+	nbRecords = 0;
+	nbIndexEntries = 0;
+	stringsSize = 0;
+	zones = NULL;
+	records = NULL;
+	index = NULL;
+	strings = NULL;
+}
+
+bool NebulaCatalog::load(const QString& ngcPath, const QString& namesPath)
+{
+	clear();
+
+	QFile ngcFile(ngcPath);
+	if (!ngcFile.open(QIODevice::ReadOnly))
+	{
+		qWarning() << "NGC data file" << QDir::toNativeSeparators(ngcPath) << "not found.";
+		return false;
+	}
+	QFile namesFile(namesPath);
+	if (!namesFile.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		qWarning() << "NGC name data file" << QDir::toNativeSeparators(namesPath) << "not found.";
+		return false;
+	}
+
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	hash.addData(&ngcFile);
+	hash.addData(&namesFile);
+	const QByteArray sourceHash = hash.result();
+	ngcFile.seek(0);
+	namesFile.seek(0);
+
+	// One compiled file per catalog file, so that updated catalogs replace their old compiled file
+	const QByteArray pathHash = QCryptographicHash::hash(QFileInfo(ngcPath).absoluteFilePath().toUtf8(), QCryptographicHash::Md5);
+	const QString catalogPath = StelFileMgr::getCacheDir() + "/nebulae/" + QString(pathHash.toHex()) + ".cat";
+	mappedFile.setFileName(catalogPath);
+
+	bool compiled = false;
+	if (!mappedFile.open(QIODevice::ReadOnly) || readSourceHash(mappedFile)!=sourceHash)
+	{
+		mappedFile.close();
+		if (QDir().mkpath(QFileInfo(catalogPath).absolutePath()) && mappedFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			compiled = compile(ngcFile, namesFile, sourceHash, mappedFile);
+			mappedFile.close();
+			if (!compiled)
+				mappedFile.remove();
+		}
+		compiled = compiled && mappedFile.open(QIODevice::ReadOnly);
+		if (!compiled)
+		{
+			// The cache directory is not writable: keep the compiled catalog in memory
+			ngcFile.seek(0);
+			namesFile.seek(0);
+			QByteArray data;
+			QBuffer buffer(&data);
+			buffer.open(QIODevice::WriteOnly);
+			if (!compile(ngcFile, namesFile, sourceHash, buffer))
+				return false;
+			buffer.close();
+			return loadData(data);
+		}
+	}
+
+	mappedData = mappedFile.map(0, mappedFile.size());
+	if (!mappedData || !setData(mappedData, mappedFile.size()))
+	{
+		qWarning() << "NebulaCatalog: cannot use" << QDir::toNativeSeparators(catalogPath);
+		clear();
+		return false;
+	}
+	qDebug() << "Loaded" << nbRecords << "NGC records from" << QDir::toNativeSeparators(catalogPath);
+	return true;
+}
+
+bool NebulaCatalog::loadData(const QByteArray& data)
+{
+	clear();
+	memoryData = data;
+	if (!setData(reinterpret_cast<const uchar*>(memoryData.constData()), memoryData.size()))
+	{
+		qWarning() << "NebulaCatalog: invalid compiled catalog";
+		clear();
+		return false;
+	}
+	return true;
+}
+
+QByteArray NebulaCatalog::readSourceHash(QFile& file)
+{
+	Header header;
+	if (file.read(reinterpret_cast<char*>(&header), sizeof(Header))!=sizeof(Header)
+	    || header.magic!=CATALOG_MAGIC || header.version!=CATALOG_VERSION)
+		return QByteArray();
+	return QByteArray(header.sourceHash, sizeof(header.sourceHash));
+}
+
+bool NebulaCatalog::setData(const uchar* data, qint64 dataSize)
+{
+	if (dataSize < (qint64)sizeof(Header))
+		return false;
+	const Header* header = reinterpret_cast<const Header*>(data);
+	if (header->magic!=CATALOG_MAGIC || header->version!=CATALOG_VERSION || header->recordSize!=sizeof(Record)
+	    || header->zoneLevel!=ZONE_LEVEL || header->nbRecords<0 || header->nbIndexEntries<0 || header->stringsSize<0)
+		return false;
+
+	const int nbZones = StelGeodesicGrid::nrOfZones(ZONE_LEVEL);
+	const qint64 zonesOffset = sizeof(Header);
+	const qint64 recordsOffset = zonesOffset + (nbZones+1)*sizeof(quint32);
+	const qint64 indexOffset = recordsOffset + (qint64)header->nbRecords*sizeof(Record);
+	const qint64 stringsOffset = indexOffset + (qint64)header->nbIndexEntries*sizeof(IndexEntry);
+	if (dataSize != stringsOffset + header->stringsSize)
+		return false;
+
+	nbRecords = header->nbRecords;
+	nbIndexEntries = header->nbIndexEntries;
+	stringsSize = header->stringsSize;
+	zones = reinterpret_cast<const quint32*>(data + zonesOffset);
+	records = reinterpret_cast<const Record*>(data + recordsOffset);
+	index = reinterpret_cast<const IndexEntry*>(data + indexOffset);
+	strings = reinterpret_cast<const char*>(data + stringsOffset);
+	return zones[nbZones]==(quint32)nbRecords && (stringsSize==0 || strings[stringsSize-1]=='\0');
+}
+
+QString NebulaCatalog::getEnglishName(int i) const
+{
+	const qint32 offset = at(i).nameOffset;
+	if (offset<0 || offset>=stringsSize)
+		return QString();
+	return QString::fromUtf8(strings + offset);
+}
+
+int NebulaCatalog::find(CatalogType catalog, unsigned int number) const
+{
+	const quint32 key = makeIndexKey(catalog, number);
+	const IndexEntry* end = index + nbIndexEntries;
+	const IndexEntry* entry = std::lower_bound(index, end, key, LessKey<IndexEntry>());
+	if (entry==end || entry->key!=key)
+		return -1;
+	return entry->record;
+}
+
+QVector<int> NebulaCatalog::searchAround(const StelGeodesicGrid& grid, const Vec3d& v, double limitFov) const
+{
+	// The grid search only works with half-spaces through the origin: as in StarMgr::searchAround(),
+	// search a square around v whose inscribed circle is the search radius
+	int axis = 0;
+	if (std::fabs(v[1])<std::fabs(v[axis])) axis = 1;
+	if (std::fabs(v[2])<std::fabs(v[axis])) axis = 2;
+	Vec3d h0(0.,0.,0.);
+	h0[axis] = 1.;
+	Vec3d h1 = h0 ^ v;
+	h1.normalize();
+	h0 = h1 ^ v;
+	h0.normalize();
+	double f = 1.4142136 * tan(limitFov * M_PI/180.);
+	h0 *= f;
+	h1 *= f;
+	Vec3d e0 = v + h0;
+	Vec3d e1 = v + h1;
+	Vec3d e2 = v - h0;
+	Vec3d e3 = v - h1;
+	f = 1./e0.length();
+	e0 *= f;
+	e1 *= f;
+	e2 *= f;
+	e3 *= f;
+	const SphericalConvexPolygon square(e3, e2, e1, e0);
+	const GeodesicSearchResult* zones = grid.search(square.getBoundingSphericalCaps(), ZONE_LEVEL);
+
+	QVector<int> result;
+	const double cosLimFov = cos(limitFov * M_PI/180.);
+	int zone;
+	for (int inside=0; inside<2; ++inside)
+	{
+		GeodesicSearchInsideIterator insideIt(*zones, ZONE_LEVEL);
+		GeodesicSearchBorderIterator borderIt(*zones, ZONE_LEVEL);
+		while ((zone = inside ? insideIt.next() : borderIt.next()) >= 0)
+		{
+			for (int i=getZoneBegin(zone); i<getZoneBegin(zone+1); ++i)
+			{
+				Vec3d equPos(records[i].XYZ[0], records[i].XYZ[1], records[i].XYZ[2]);
+				equPos.normalize();
+				if (equPos*v>=cosLimFov)
+					result.append(i);
+			}
+		}
+	}
+	return result;
+}
+
+bool NebulaCatalog::compile(QIODevice& ngc, QIODevice& names, const QByteArray& sourceHash, QIODevice& out)
+{
+	QVector<Record> recs;
+	QVector<QString> englishNames;
+	QHash<unsigned int, int> ngcRecords;
+	QHash<unsigned int, int> icRecords;
+
+	// Read the positions
+	QDataStream ins(&ngc);
+	ins.setVersion(QDataStream::Qt_4_5);
+	while (!ins.atEnd())
+	{
+		bool isIc;
+		int nb;
+		float ra, dec, mag, angularSize;
+		unsigned int type;
+		ins >> isIc >> nb >> ra >> dec >> mag >> angularSize >> type;
+		if (ins.status()!=QDataStream::Ok)
+		{
+			qWarning() << "NebulaCatalog: cannot read NGC record" << recs.size()+1;
+			return false;
+		}
+
+		Record r;
+		memset(&r, 0, sizeof(Record));
+		Vec3d XYZ;
+		StelUtils::spheToRect(ra, dec, XYZ);
+		r.XYZ[0] = XYZ[0];
+		r.XYZ[1] = XYZ[1];
+		r.XYZ[2] = XYZ[2];
+		r.mag = mag;
+		r.angularSize = angularSize;
+		r.nameOffset = -1;
+		r.type = type;
+		// Of several objects with the same number, the names are set to and the searches find
+		// the first one for an IC number, the last one for an NGC number
+		if (isIc)
+		{
+			r.IC_nb = nb;
+			if (!icRecords.contains(nb))
+				icRecords.insert(nb, recs.size());
+		}
+		else
+		{
+			r.NGC_nb = nb;
+			ngcRecords.insert(nb, recs.size());
+		}
+		recs.append(r);
+		englishNames.append(QString());
+	}
+
+	// Read the names of the NGC objects
+	QString name, record;
+	int totalRecords=0;
+	int lineNumber=0;
+	int readOk=0;
+	QRegExp commentRx("^(\\s*#.*|\\s*)$");
+	QRegExp transRx("_[(]\"(.*)\"[)]");
+	while (!names.atEnd())
+	{
+		record = QString::fromUtf8(names.readLine());
+		lineNumber++;
+		if (commentRx.exactMatch(record))
+			continue;
+
+		totalRecords++;
+		const unsigned int nb = record.mid(38,4).toInt();
+		const int e = (record[37] == 'I') ? icRecords.value(nb, -1) : ngcRecords.value(nb, -1);
+
+		// get name, trimmed of whitespace
+		name = record.left(36).trimmed();
+
+		if (e<0)
+		{
+			qWarning() << "no position data for " << name << "at line" << lineNumber << "of the NGC names";
+			continue;
+		}
+
+		// If the name is not a messier number perhaps one is already
+		// defined for this object
+		if (name.left(2).toUpper() != "M " && name.left(2).toUpper() != "C ")
+		{
+			if (transRx.exactMatch(name))
+				englishNames[e] = transRx.capturedTexts().at(1).trimmed();
+			else
+				englishNames[e] = name;
+		}
+		else
+		{
+			// If it's a Messier or Caldwell number, we will call it so if there is no better name
+			const bool isMessier = name.left(2).toUpper() == "M ";
+			name = name.mid(2); // remove "M " or "C "
+
+			QTextStream istr(&name);
+			int num;
+			istr >> num;
+			if (istr.status()!=QTextStream::Ok)
+			{
+				qWarning() << "cannot read" << (isMessier ? "Messier" : "Caldwell") << "number at line" << lineNumber << "of the NGC names";
+				continue;
+			}
+
+			if (isMessier)
+			{
+				recs[e].M_nb = num;
+				englishNames[e] = QString("M%1").arg(num);
+			}
+			else
+			{
+				recs[e].C_nb = num;
+				englishNames[e] = QString("C%1").arg(num);
+			}
+		}
+		readOk++;
+	}
+	qDebug() << "Loaded" << readOk << "/" << totalRecords << "NGC name records successfully";
+
+	// Sort the records by zone
+	StelGeodesicGrid grid(ZONE_LEVEL);
+	const int nbZones = StelGeodesicGrid::nrOfZones(ZONE_LEVEL);
+	QVector<int> recordZones(recs.size());
+	QVector<int> order(recs.size());
+	for (int i=0; i<recs.size(); ++i)
+	{
+		const Record& r = recs.at(i);
+		recordZones[i] = grid.getZoneNumberForPoint(Vec3f(r.XYZ[0], r.XYZ[1], r.XYZ[2]), ZONE_LEVEL);
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), LessZone(recordZones));
+
+	QVector<quint32> zoneBegins(nbZones+1, 0);
+	QVector<Record> sortedRecords(recs.size());
+	QVector<IndexEntry> entries;
+	QByteArray stringTable;
+	for (int i=0; i<order.size(); ++i)
+	{
+		Record r = recs.at(order.at(i));
+		const QString& englishName = englishNames.at(order.at(i));
+
+		++zoneBegins[recordZones.at(order.at(i))+1];
+
+		float lim = r.mag;
+		if (lim > 50) lim = 15.f;
+		// temporary workaround of this bug: https://bugs.launchpad.net/stellarium/+bug/1115035 --AW
+		if (englishName.contains("Pleiades"))
+			lim = 5.f;
+		r.hintsMag = lim;
+
+		if (!englishName.isEmpty())
+		{
+			r.nameOffset = stringTable.size();
+			stringTable.append(englishName.toUtf8());
+			stringTable.append('\0');
+		}
+
+		// Only the record which received the names is found by its NGC or IC number
+		const int source = order.at(i);
+		const unsigned int numbers[4] = {r.M_nb,
+		                                 ngcRecords.value(r.NGC_nb, -1)==source ? r.NGC_nb : 0u,
+		                                 icRecords.value(r.IC_nb, -1)==source ? r.IC_nb : 0u,
+		                                 r.C_nb};
+		const CatalogType catalogs[4] = {CatalogM, CatalogNGC, CatalogIC, CatalogC};
+		for (int c=0; c<4; ++c)
+		{
+			if (numbers[c]==0)
+				continue;
+			IndexEntry entry;
+			entry.key = makeIndexKey(catalogs[c], numbers[c]);
+			entry.record = i;
+			entries.append(entry);
+		}
+		sortedRecords[i] = r;
+	}
+	for (int z=0; z<nbZones; ++z)
+		zoneBegins[z+1] += zoneBegins.at(z);
+	std::stable_sort(entries.begin(), entries.end(), LessKey<IndexEntry>());
+
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	header.magic = CATALOG_MAGIC;
+	header.version = CATALOG_VERSION;
+	memcpy(header.sourceHash, sourceHash.constData(), qMin((int)sizeof(header.sourceHash), sourceHash.size()));
+	header.recordSize = sizeof(Record);
+	header.zoneLevel = ZONE_LEVEL;
+	header.nbRecords = sortedRecords.size();
+	header.nbIndexEntries = entries.size();
+	header.stringsSize = stringTable.size();
+
+	bool ok = out.write(reinterpret_cast<const char*>(&header), sizeof(Header))==sizeof(Header);
+	ok = ok && out.write(reinterpret_cast<const char*>(zoneBegins.constData()), zoneBegins.size()*sizeof(quint32))==(qint64)(zoneBegins.size()*sizeof(quint32));
+	ok = ok && out.write(reinterpret_cast<const char*>(sortedRecords.constData()), sortedRecords.size()*sizeof(Record))==(qint64)(sortedRecords.size()*sizeof(Record));
+	ok = ok && out.write(reinterpret_cast<const char*>(entries.constData()), entries.size()*sizeof(IndexEntry))==(qint64)(entries.size()*sizeof(IndexEntry));
+	ok = ok && out.write(stringTable)==stringTable.size();
+	if (!ok)
+		qWarning() << "NebulaCatalog: cannot write the compiled catalog:" << out.errorString();
+	return ok;
+}
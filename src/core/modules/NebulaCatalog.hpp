@@ -0,0 +1,146 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _NEBULACATALOG_HPP_
+#define _NEBULACATALOG_HPP_
+
+#include "VecMath.hpp"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+class StelGeodesicGrid;
+
+//! @class NebulaCatalog
+//! Compact binary form of the NGC/IC catalog, used in place from a memory mapped file.
+//! The catalog is compiled from ngc2000.dat and ngc2000names.dat into the cache directory,
+//! on the first start or when the source files change. The next starts only map the
+//! compiled file, so that neither the load time nor the memory used depend on the number
+//! of objects: the records are read directly from the mapped file.
+//! The compiled file contains, in the native byte order of the machine which wrote it:
+//! - the header, with the MD5 hash of the source files
+//! - the index of the first record of each zone of the geodesic grid at ZONE_LEVEL,
+//!   followed by the total number of records
+//! - the records, sorted by zone
+//! - the catalog numbers index, sorted by key, to find the objects by M, NGC, IC or C number
+//! - the string table, with the UTF-8 English names terminated by a NUL character
+class NebulaCatalog
+{
+public:
+	//! Level of the geodesic grid used to sort the records (1280 zones).
+	static const int ZONE_LEVEL = 3;
+
+	//! The catalogs which can be searched with find().
+	enum CatalogType
+	{
+		CatalogM=1,
+		CatalogNGC=2,
+		CatalogIC=3,
+		CatalogC=4
+	};
+
+	//! The data of one object, as stored in the compiled file.
+	struct Record
+	{
+		float XYZ[3];        //!< Cartesian equatorial position (J2000), normalized
+		float mag;           //!< Apparent magnitude, 99 if unknown
+		float hintsMag;      //!< Magnitude used to decide whether the hint and the label are drawn
+		float angularSize;   //!< Angular size in degree
+		qint32 nameOffset;   //!< Offset of the English name in the string table, -1 if the object has no name
+		quint16 M_nb;        //!< Messier catalog number, 0 if none
+		quint16 NGC_nb;      //!< New General Catalog number, 0 if none
+		quint16 IC_nb;       //!< Index Catalog number, 0 if none
+		quint16 C_nb;        //!< Caldwell catalog number, 0 if none
+		quint8 type;         //!< Nebula type, as in Nebula::NebulaType
+		quint8 reserved[3];
+	};
+
+	NebulaCatalog();
+	~NebulaCatalog();
+
+	//! Load the catalog compiled from the given files, compiling it first if needed.
+	//! When the compiled catalog can not be written in the cache directory, it is kept in memory.
+	//! @return false if the catalog can not be compiled.
+	bool load(const QString& ngcPath, const QString& namesPath);
+
+	//! Compile a catalog.
+	//! @param ngc the positions of the objects, as in ngc2000.dat.
+	//! @param names the names and Messier/Caldwell numbers of the objects, as in ngc2000names.dat.
+	//! @param sourceHash the hash saved in the header, to check later if the sources changed.
+	//! @param out receives the compiled catalog.
+	//! @return false if the compiled catalog can not be written.
+	static bool compile(QIODevice& ngc, QIODevice& names, const QByteArray& sourceHash, QIODevice& out);
+
+	//! Use a compiled catalog in memory.
+	//! @return false if data is not a valid compiled catalog.
+	bool loadData(const QByteArray& data);
+
+	//! Release the catalog.
+	void clear();
+
+	//! Get the number of objects.
+	int size() const {return nbRecords;}
+	//! Get an object. The reference stays valid until the catalog is cleared.
+	const Record& at(int i) const {Q_ASSERT(i>=0 && i<nbRecords); return records[i];}
+	//! Get the English name of an object, empty if the object has no name.
+	QString getEnglishName(int i) const;
+	//! Get whether an object has an English name.
+	bool hasName(int i) const {return at(i).nameOffset>=0;}
+
+	//! Get the index of the first object in a zone of the geodesic grid at ZONE_LEVEL.
+	//! The objects of a zone are those from getZoneBegin(zone) to getZoneBegin(zone+1)-1.
+	int getZoneBegin(int zone) const {return zones ? (int)zones[zone] : 0;}
+
+	//! Find an object by catalog number.
+	//! @return the index of the object, or -1 if there is none.
+	int find(CatalogType catalog, unsigned int number) const;
+
+	//! Find the objects around a direction.
+	//! @param grid the geodesic grid used to select the zones, with at least ZONE_LEVEL levels.
+	//! @param v the normalized direction.
+	//! @param limitFov the radius of the search in degree.
+	//! @return the indices of the objects closer to v than limitFov.
+	QVector<int> searchAround(const StelGeodesicGrid& grid, const Vec3d& v, double limitFov) const;
+
+private:
+	struct Header;
+	struct IndexEntry;
+
+	//! Point the members to the content of a compiled catalog.
+	bool setData(const uchar* data, qint64 dataSize);
+	//! Read the source hash from a compiled catalog file.
+	static QByteArray readSourceHash(QFile& file);
+
+	QFile mappedFile;
+	uchar* mappedData;
+	QByteArray memoryData;
+
+	int nbRecords;
+	int nbIndexEntries;
+	int stringsSize;
+	const quint32* zones;
+	const Record* records;
+	const IndexEntry* index;
+	const char* strings;
+};
+
+#endif // _NEBULACATALOG_HPP_
@@ -38,15 +38,17 @@
 #include "StelPainter.hpp"
 #include "RefractionExtinction.hpp"
 #include "StelActionMgr.hpp"
+#include "StelGeodesicGrid.hpp"
 
 #include <algorithm>
 #include <QDebug>
-#include <QFile>
 #include <QSettings>
 #include <QString>
 #include <QStringList>
 #include <QRegExp>
-#include <QDir>
+
+//! Size of the table of the objects in use above which the released objects are forgotten
+static const int MIN_NEBULAE_PRUNE_SIZE = 256;
 
 void NebulaMgr::setLabelsColor(const Vec3f& c) {Nebula::labelColor = c;}
 const Vec3f &NebulaMgr::getLabelsColor(void) const {return Nebula::labelColor;}
@@ -57,7 +59,7 @@ float NebulaMgr::getCircleScale(void) const {return Nebula::circleScale;}
 
 
 NebulaMgr::NebulaMgr(void)
-	: nebGrid(200),
+	: nebulaePruneSize(MIN_NEBULAE_PRUNE_SIZE),
 	  hintsAmount(0),
 	  labelsAmount(0)
 {
@@ -128,31 +130,56 @@ void NebulaMgr::init()
 
 struct DrawNebulaFuncObject
 {
-	DrawNebulaFuncObject(float amaxMagHints, float amaxMagLabels, StelPainter* p, StelCore* aCore, bool acheckMaxMagHints) : maxMagHints(amaxMagHints), maxMagLabels(amaxMagLabels), sPainter(p), core(aCore), checkMaxMagHints(acheckMaxMagHints)
+	DrawNebulaFuncObject(const NebulaCatalog& acatalog, const QHash<int, QString>& anamesI18n, float amaxMagHints, float amaxMagLabels, StelPainter* p, StelCore* aCore, bool acheckMaxMagHints) : catalog(acatalog), namesI18n(anamesI18n), maxMagHints(amaxMagHints), maxMagLabels(amaxMagLabels), sPainter(p), core(aCore), checkMaxMagHints(acheckMaxMagHints)
 	{
 		angularSizeLimit = 5.f/sPainter->getProjector()->getPixelPerRadAtCenter()*180.f/M_PI;
+		StelSkyDrawer *drawer = core->getSkyDrawer();
+		flagMagnitudeLimit = drawer->getFlagNebulaMagnitudeLimit();
+		magnitudeLimit = drawer->getCustomNebulaMagnitudeLimit();
 	}
-	void operator()(StelRegionObject* obj)
+	void operator()(int i)
 	{
-		Nebula* n = static_cast<Nebula*>(obj);
-		StelSkyDrawer *drawer = core->getSkyDrawer();
+		const NebulaCatalog::Record& n = catalog.at(i);
 		// filter out DSOs which are too dim to be seen (e.g. for bino observers)
-		if ((drawer->getFlagNebulaMagnitudeLimit()) && (n->mag > drawer->getCustomNebulaMagnitudeLimit())) return;
+		if (flagMagnitudeLimit && (n.mag > magnitudeLimit)) return;
 
-		if (n->angularSize>angularSizeLimit || (checkMaxMagHints && n->mag <= maxMagHints))
+		if (n.angularSize>angularSizeLimit || (checkMaxMagHints && n.mag <= maxMagHints))
 		{
 			float refmag_add=0; // value to adjust hints visibility threshold.
-			sPainter->getProjector()->project(n->XYZ,n->XY);
-			n->drawLabel(*sPainter, maxMagLabels-refmag_add);
-			n->drawHints(*sPainter, maxMagHints -refmag_add);
+			Vec3d XY;
+			sPainter->getProjector()->project(Vec3d(n.XYZ[0], n.XYZ[1], n.XYZ[2]), XY);
+			if (n.hintsMag <= maxMagLabels-refmag_add)
+				Nebula::drawLabel(*sPainter, XY, n.angularSize, getLabel(i));
+			if (n.hintsMag <= maxMagHints-refmag_add)
+				Nebula::drawHint(XY, n.type);
 		}
 	}
+	QString getLabel(int i) const
+	{
+		const QString nameI18n = namesI18n.value(i);
+		if (!nameI18n.isEmpty())
+			return nameI18n;
+		const NebulaCatalog::Record& n = catalog.at(i);
+		if (n.M_nb > 0)
+			return QString("M %1").arg(n.M_nb);
+		else if (n.C_nb > 0)
+			return QString("C %1").arg(n.C_nb);
+		else if (n.NGC_nb > 0)
+			return QString("NGC %1").arg(n.NGC_nb);
+		else if (n.IC_nb > 0)
+			return QString("IC %1").arg(n.IC_nb);
+		return QString();
+	}
+	const NebulaCatalog& catalog;
+	const QHash<int, QString>& namesI18n;
 	float maxMagHints;
 	float maxMagLabels;
 	StelPainter* sPainter;
 	StelCore* core;
 	float angularSizeLimit;
 	bool checkMaxMagHints;
+	bool flagMagnitudeLimit;
+	float magnitudeLimit;
 };
 
 float NebulaMgr::computeMaxMagHint(const StelSkyDrawer* skyDrawer) const
@@ -182,8 +209,28 @@ void NebulaMgr::draw(StelCore* core)
 	float maxMagHints  = computeMaxMagHint(skyDrawer);
 	float maxMagLabels = skyDrawer->getLimitMagnitude()     -2.f+(labelsAmount*1.2f)-2.f;
 	sPainter.setFont(nebulaFont);
-	DrawNebulaFuncObject func(maxMagHints, maxMagLabels, &sPainter, core, hintsFader.getInterstate()>0.0001);
-	nebGrid.processIntersectingPointInRegions(p.data(), func);
+	DrawNebulaFuncObject func(catalog, namesI18n, maxMagHints, maxMagLabels, &sPainter, core, hintsFader.getInterstate()>0.0001);
+	// The records are sorted by zone: all the objects of the zones inside the viewport
+	// are drawn, only the ones of the border zones need to be tested
+	const int level = NebulaCatalog::ZONE_LEVEL;
+	const GeodesicSearchResult* zones = core->getGeodesicGrid(level)->search(p->getBoundingSphericalCaps(), level);
+	int zone;
+	for (GeodesicSearchInsideIterator it(*zones, level); (zone = it.next()) >= 0;)
+	{
+		for (int i=catalog.getZoneBegin(zone); i<catalog.getZoneBegin(zone+1); ++i)
+			func(i);
+	}
+	for (GeodesicSearchBorderIterator it(*zones, level); (zone = it.next()) >= 0;)
+	{
+		for (int i=catalog.getZoneBegin(zone); i<catalog.getZoneBegin(zone+1); ++i)
+		{
+			const NebulaCatalog::Record& n = catalog.at(i);
+			if (p->contains(Vec3d(n.XYZ[0], n.XYZ[1], n.XYZ[2])))
+				func(i);
+		}
+	}
+	// The labels are queued in the painter, and drawn above the hints when it is destroyed
+	Nebula::drawHintsBatch(sPainter);
 
 	if (GETSTELMODULE(StelObjectMgr)->getFlagSelectedObjectPointer())
 		drawPointer(core, sPainter);
@@ -235,13 +282,20 @@ NebulaP NebulaMgr::search(const QString& name)
 {
 	QString uname = name.toUpper();
 
-	foreach (const NebulaP& n, nebArray)
+	for (int i=0; i<catalog.size(); ++i)
 	{
-		QString testName = n->getEnglishName().toUpper();
-		if (testName==uname) return n;
+		if (!catalog.hasName(i))
+			continue;
+		QString testName = catalog.getEnglishName(i).toUpper();
+		if (testName==uname) return getNebula(i);
 	}
 
 	// If no match found, try search by catalog reference
+	return searchCatalogNumber(uname);
+}
+
+NebulaP NebulaMgr::searchCatalogNumber(const QString& uname) const
+{
 	static QRegExp catNumRx("^(M|NGC|IC|C)\\s*(\\d+)$");
 	if (catNumRx.exactMatch(uname))
 	{
@@ -256,6 +310,30 @@ NebulaP NebulaMgr::search(const QString& name)
 	return NebulaP();
 }
 
+NebulaP NebulaMgr::getNebula(int i) const
+{
+	if (i<0)
+		return NebulaP();
+	NebulaP n = nebulae.value(i).toStrongRef();
+	if (!n)
+	{
+		n = NebulaP(new Nebula(catalog.at(i), catalog.getEnglishName(i), namesI18n.value(i)));
+		nebulae.insert(i, n.toWeakRef());
+		if (nebulae.size()>=nebulaePruneSize)
+		{
+			// Forget the objects which were released
+			QMutableHashIterator<int, QWeakPointer<Nebula> > it(nebulae);
+			while (it.hasNext())
+			{
+				if (it.next().value().isNull())
+					it.remove();
+			}
+			nebulaePruneSize = qMax(MIN_NEBULAE_PRUNE_SIZE, 2*nebulae.size());
+		}
+	}
+	return n;
+}
+
 void NebulaMgr::loadNebulaSet(const QString& setName)
 {
 	QString ngcPath = StelFileMgr::findFile("nebulae/" + setName + "/ngc2000.dat");
@@ -265,8 +343,7 @@ void NebulaMgr::loadNebulaSet(const QString& setName)
 		qWarning() << "ERROR while loading nebula data set " << setName;
 		return;
 	}
-	loadNGC(ngcPath);
-	loadNGCNames(ngcNamesPath);
+	catalog.load(ngcPath, ngcNamesPath);
 }
 
 // Look for a nebulae by XYZ coords
@@ -274,25 +351,27 @@ NebulaP NebulaMgr::search(const Vec3d& apos)
 {
 	Vec3d pos = apos;
 	pos.normalize();
-	NebulaP plusProche;
+	int plusProche = -1;
 	float anglePlusProche=0.;
-	foreach (const NebulaP& n, nebArray)
+	for (int i=0; i<catalog.size(); ++i)
 	{
-		if (n->XYZ*pos>anglePlusProche)
+		const NebulaCatalog::Record& n = catalog.at(i);
+		const float angle = Vec3f(n.XYZ[0], n.XYZ[1], n.XYZ[2])*Vec3f(pos[0], pos[1], pos[2]);
+		if (angle>anglePlusProche)
 		{
-			anglePlusProche=n->XYZ*pos;
-			plusProche=n;
+			anglePlusProche=angle;
+			plusProche=i;
 		}
 	}
 	if (anglePlusProche>0.999)
 	{
-		return plusProche;
+		return getNebula(plusProche);
 	}
 	else return NebulaP();
 }
 
 
-QList<StelObjectP> NebulaMgr::searchAround(const Vec3d& av, double limitFov, const StelCore*) const
+QList<StelObjectP> NebulaMgr::searchAround(const Vec3d& av, double limitFov, const StelCore* core) const
 {
 	QList<StelObjectP> result;
 	if (!getFlagShow())
@@ -300,239 +379,47 @@ QList<StelObjectP> NebulaMgr::searchAround(const Vec3d& av, double limitFov, con
 
 	Vec3d v(av);
 	v.normalize();
-	double cosLimFov = cos(limitFov * M_PI/180.);
-	Vec3d equPos;
-	foreach (const NebulaP& n, nebArray)
-	{
-		equPos = n->XYZ;
-		equPos.normalize();
-		if (equPos*v>=cosLimFov)
-		{
-			result.push_back(qSharedPointerCast<StelObject>(n));
-		}
-	}
+	foreach (int i, catalog.searchAround(*core->getGeodesicGrid(NebulaCatalog::ZONE_LEVEL), v, limitFov))
+		result.push_back(qSharedPointerCast<StelObject>(getNebula(i)));
 	return result;
 }
 
-NebulaP NebulaMgr::searchM(unsigned int M)
-{
-	foreach (const NebulaP& n, nebArray)
-		if (n->M_nb == M)
-			return n;
-	return NebulaP();
-}
-
-NebulaP NebulaMgr::searchNGC(unsigned int NGC)
+NebulaP NebulaMgr::searchM(unsigned int M) const
 {
-	if (ngcIndex.contains(NGC))
-		return ngcIndex[NGC];
-	return NebulaP();
+	return getNebula(catalog.find(NebulaCatalog::CatalogM, M));
 }
 
-NebulaP NebulaMgr::searchIC(unsigned int IC)
+NebulaP NebulaMgr::searchNGC(unsigned int NGC) const
 {
-	foreach (const NebulaP& n, nebArray)
-		if (n->IC_nb == IC) return n;
-	return NebulaP();
+	return getNebula(catalog.find(NebulaCatalog::CatalogNGC, NGC));
 }
 
-NebulaP NebulaMgr::searchC(unsigned int C)
+NebulaP NebulaMgr::searchIC(unsigned int IC) const
 {
-	foreach (const NebulaP& n, nebArray)
-		if (n->C_nb == C)
-			return n;
-	return NebulaP();
+	return getNebula(catalog.find(NebulaCatalog::CatalogIC, IC));
 }
 
-
-#if 0
-// read from stream
-bool NebulaMgr::loadNGCOld(const QString& catNGC)
+NebulaP NebulaMgr::searchC(unsigned int C) const
 {
-	QFile in(catNGC);
-	if (!in.open(QIODevice::ReadOnly | QIODevice::Text))
-		return false;
-
-	int totalRecords=0;
-	QString record;
-	while (!in.atEnd())
-	{
-		in.readLine();
-		++totalRecords;
-	}
-
-	// rewind the file to the start
-	in.seek(0);
-
-	int currentLineNumber = 0;	// what input line we are on
-	int currentRecordNumber = 0;	// what record number we are on
-	int readOk = 0;			// how many records weree rad without problems
-	while (!in.atEnd())
-	{
-		record = QString::fromUtf8(in.readLine());
-		++currentLineNumber;
-
-		// skip comments
-		if (record.startsWith("//") || record.startsWith("#"))
-			continue;
-		++currentRecordNumber;
-
-		// Create a new Nebula record
-		NebulaP e = NebulaP(new Nebula);
-		if (!e->readNGC((char*)record.toLocal8Bit().data())) // reading error
-		{
-			e.clear();
-		}
-		else
-		{
-			nebArray.append(e);
-			nebGrid.insert(qSharedPointerCast<StelRegionObject>(e));
-			if (e->NGC_nb!=0)
-				ngcIndex.insert(e->NGC_nb, e);
-			++readOk;
-		}
-	}
-	in.close();
-	qDebug() << "Loaded" << readOk << "/" << totalRecords << "NGC records";
-	return true;
+	return getNebula(catalog.find(NebulaCatalog::CatalogC, C));
 }
-#endif
 
-bool NebulaMgr::loadNGC(const QString& catNGC)
-{
-	QFile in(catNGC);
-	if (!in.open(QIODevice::ReadOnly))
-		return false;
-	QDataStream ins(&in);
-	ins.setVersion(QDataStream::Qt_4_5);
-
-	int totalRecords=0;
-	while (!ins.atEnd())
-	{
-		// Create a new Nebula record
-		NebulaP e = NebulaP(new Nebula);
-		e->readNGC(ins);
-
-		nebArray.append(e);
-		nebGrid.insert(qSharedPointerCast<StelRegionObject>(e));
-		if (e->NGC_nb!=0)
-			ngcIndex.insert(e->NGC_nb, e);
-		++totalRecords;
-	}
-	in.close();
-	qDebug() << "Loaded" << totalRecords << "NGC records";
-	return true;
-}
 
-bool NebulaMgr::loadNGCNames(const QString& catNGCNames)
+void NebulaMgr::updateI18n()
 {
-	qDebug() << "Loading NGC name data ...";
-	QFile ngcNameFile(catNGCNames);
-	if (!ngcNameFile.open(QIODevice::ReadOnly | QIODevice::Text))
+	const StelTranslator& trans = StelApp::getInstance().getLocaleMgr().getSkyTranslator();
+	namesI18n.clear();
+	for (int i=0; i<catalog.size(); ++i)
 	{
-		qWarning() << "NGC name data file" << QDir::toNativeSeparators(catNGCNames) << "not found.";
-		return false;
+		if (catalog.hasName(i))
+			namesI18n.insert(i, trans.qtranslate(catalog.getEnglishName(i)));
 	}
-
-	// Read the names of the NGC objects
-	QString name, record;
-	int totalRecords=0;
-	int lineNumber=0;
-	int readOk=0;
-	int nb;
-	NebulaP e;
-	QRegExp commentRx("^(\\s*#.*|\\s*)$");
-	QRegExp transRx("_[(]\"(.*)\"[)]");
-	while (!ngcNameFile.atEnd())
+	foreach (const QWeakPointer<Nebula>& w, nebulae)
 	{
-		record = QString::fromUtf8(ngcNameFile.readLine());
-		lineNumber++;
-		if (commentRx.exactMatch(record))
-			continue;
-
-		totalRecords++;
-		nb = record.mid(38,4).toInt();
-		if (record[37] == 'I')
-		{
-			e = searchIC(nb);
-		}
-		else
-		{
-			e = searchNGC(nb);
-		}
-
-		// get name, trimmed of whitespace
-		name = record.left(36).trimmed();
-
-		if (e)
-		{
-			// If the name is not a messier number perhaps one is already
-			// defined for this object
-			if (name.left(2).toUpper() != "M " && name.left(2).toUpper() != "C ")
-			{
-				if (transRx.exactMatch(name)) {
-					e->englishName = transRx.capturedTexts().at(1).trimmed();
-				}
-				 else 
-				{
-					e->englishName = name;
-				}
-			}
-			else if (name.left(2).toUpper() != "M " && name.left(2).toUpper() == "C ")
-			{
-				// If it's a caldwellnumber, we will call it a caldwell if there is no better name
-				name = name.mid(2); // remove "C "
-
-				// read the Caldwell number
-				QTextStream istr(&name);
-				int num;
-				istr >> num;
-				if (istr.status()!=QTextStream::Ok)
-				{
-					qWarning() << "cannot read Caldwell number at line" << lineNumber << "of" << QDir::toNativeSeparators(catNGCNames);
-					continue;
-				}
-
-				e->C_nb=(unsigned int)(num);
-				e->englishName = QString("C%1").arg(num);
-			}
-			else if (name.left(2).toUpper() == "M " && name.left(2).toUpper() != "C ")
-			{
-				// If it's a messiernumber, we will call it a messier if there is no better name
-				name = name.mid(2); // remove "M "
-
-				// read the Messier number
-				QTextStream istr(&name);
-				int num;
-				istr >> num;
-				if (istr.status()!=QTextStream::Ok)
-				{
-					qWarning() << "cannot read Messier number at line" << lineNumber << "of" << QDir::toNativeSeparators(catNGCNames);
-					continue;
-				}
-
-				e->M_nb=(unsigned int)(num);
-				e->englishName = QString("M%1").arg(num);
-			}
-
-
-			readOk++;
-		}
-		else
-			qWarning() << "no position data for " << name << "at line" << lineNumber << "of" << QDir::toNativeSeparators(catNGCNames);
+		NebulaP n = w.toStrongRef();
+		if (n)
+			n->translateName(trans);
 	}
-	ngcNameFile.close();
-	qDebug() << "Loaded" << readOk << "/" << totalRecords << "NGC name records successfully";
-
-	return true;
-}
-
-
-void NebulaMgr::updateI18n()
-{
-	const StelTranslator& trans = StelApp::getInstance().getLocaleMgr().getSkyTranslator();
-	foreach (NebulaP n, nebArray)
-		n->translateName(trans);
 }
 
 
@@ -541,114 +428,36 @@ StelObjectP NebulaMgr::searchByNameI18n(const QString& nameI18n) const
 {
 	QString objw = nameI18n.toUpper();
 
-	// Search by NGC numbers (possible formats are "NGC31" or "NGC 31")
-	if (objw.mid(0, 3) == "NGC")
-	{
-		foreach (const NebulaP& n, nebArray)
-		{
-			if (QString("NGC%1").arg(n->NGC_nb) == objw || QString("NGC %1").arg(n->NGC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
 	// Search by common names
-	foreach (const NebulaP& n, nebArray)
+	for (QHash<int, QString>::ConstIterator it=namesI18n.constBegin(); it!=namesI18n.constEnd(); ++it)
 	{
-		QString objwcap = n->nameI18.toUpper();
+		QString objwcap = it.value().toUpper();
 		if (objwcap==objw)
-			return qSharedPointerCast<StelObject>(n);
-	}
-
-	// Search by IC numbers (possible formats are "IC466" or "IC 466")
-	if (objw.mid(0, 2) == "IC")
-	{
-		foreach (const NebulaP& n, nebArray)
-		{
-			if (QString("IC%1").arg(n->IC_nb) == objw || QString("IC %1").arg(n->IC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-
-	// Search by Messier numbers (possible formats are "M31" or "M 31")
-	if (objw.mid(0, 1) == "M")
-	{
-		foreach (const NebulaP& n, nebArray)
-		{
-			if (QString("M%1").arg(n->M_nb) == objw || QString("M %1").arg(n->M_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Caldwell numbers (possible formats are "C31" or "C 31")
-	if (objw.mid(0, 1) == "C")
-	{
-		foreach (const NebulaP& n, nebArray)
-		{
-			if (QString("C%1").arg(n->C_nb) == objw || QString("C %1").arg(n->C_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
+			return qSharedPointerCast<StelObject>(getNebula(it.key()));
 	}
 
-	return StelObjectP();
+	// Search by NGC, IC, Messier and Caldwell numbers (possible formats are "NGC31" or "NGC 31")
+	return qSharedPointerCast<StelObject>(searchCatalogNumber(objw));
 }
 
 
 //! Return the matching Nebula object's pointer if exists or NULL
-//! TODO split common parts of this and I18 fn above into a separate fn.
 StelObjectP NebulaMgr::searchByName(const QString& name) const
 {
 	QString objw = name.toUpper();
 
-	// Search by NGC numbers (possible formats are "NGC31" or "NGC 31")
-	if (objw.mid(0, 3) == "NGC")
-	{
-		foreach (const NebulaP& n, nebArray)
-		{
-			if (QString("NGC%1").arg(n->NGC_nb) == objw || QString("NGC %1").arg(n->NGC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
 	// Search by common names
-	foreach (const NebulaP& n, nebArray)
+	for (int i=0; i<catalog.size(); ++i)
 	{
-		QString objwcap = n->englishName.toUpper();
+		if (!catalog.hasName(i))
+			continue;
+		QString objwcap = catalog.getEnglishName(i).toUpper();
 		if (objwcap==objw)
-			return qSharedPointerCast<StelObject>(n);
+			return qSharedPointerCast<StelObject>(getNebula(i));
 	}
 
-	// Search by IC numbers (possible formats are "IC466" or "IC 466")
-	if (objw.mid(0, 2) == "IC")
-	{
-		foreach (const NebulaP& n, nebArray)
-		{
-			if (QString("IC%1").arg(n->IC_nb) == objw || QString("IC %1").arg(n->IC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Messier numbers (possible formats are "M31" or "M 31")
-	if (objw.mid(0, 1) == "M")
-	{
-		foreach (const NebulaP& n, nebArray)
-		{
-			if (QString("M%1").arg(n->M_nb) == objw || QString("M %1").arg(n->M_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Caldwell numbers (possible formats are "C31" or "C 31")
-	if (objw.mid(0, 1) == "C")
-	{
-		foreach (const NebulaP& n, nebArray)
-		{
-			if (QString("C%1").arg(n->C_nb) == objw || QString("C %1").arg(n->C_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	return NULL;
+	// Search by NGC, IC, Messier and Caldwell numbers (possible formats are "NGC31" or "NGC 31")
+	return qSharedPointerCast<StelObject>(searchCatalogNumber(objw));
 }
 
 
@@ -662,17 +471,18 @@ QStringList NebulaMgr::listMatchingObjectsI18n(const QString& objPrefix, int max
 	// Search by Messier objects number (possible formats are "M31" or "M 31")
 	if (objw.size()>=1 && objw[0]=='M')
 	{
-		foreach (const NebulaP& n, nebArray)
+		for (int i=0; i<catalog.size(); ++i)
 		{
-			if (n->M_nb==0) continue;
-			QString constw = QString("M%1").arg(n->M_nb);
+			const NebulaCatalog::Record& n = catalog.at(i);
+			if (n.M_nb==0) continue;
+			QString constw = QString("M%1").arg(n.M_nb);
 			QString constws = constw.mid(0, objw.size());
 			if (constws==objw)
 			{
 				result << constws;
 				continue;	// Prevent adding both forms for name
 			}
-			constw = QString("M %1").arg(n->M_nb);
+			constw = QString("M %1").arg(n.M_nb);
 			constws = constw.mid(0, objw.size());
 			if (constws==objw)
 				result << constw;
@@ -682,17 +492,18 @@ QStringList NebulaMgr::listMatchingObjectsI18n(const QString& objPrefix, int max
 	// Search by IC objects number (possible formats are "IC466" or "IC 466")
 	if (objw.size()>=1 && objw[0]=='I')
 	{
-		foreach (const NebulaP& n, nebArray)
+		for (int i=0; i<catalog.size(); ++i)
 		{
-			if (n->IC_nb==0) continue;
-			QString constw = QString("IC%1").arg(n->IC_nb);
+			const NebulaCatalog::Record& n = catalog.at(i);
+			if (n.IC_nb==0) continue;
+			QString constw = QString("IC%1").arg(n.IC_nb);
 			QString constws = constw.mid(0, objw.size());
 			if (constws==objw)
 			{
 				result << constws;
 				continue;	// Prevent adding both forms for name
 			}
-			constw = QString("IC %1").arg(n->IC_nb);
+			constw = QString("IC %1").arg(n.IC_nb);
 			constws = constw.mid(0, objw.size());
 			if (constws==objw)
 				result << constw;
@@ -700,17 +511,18 @@ QStringList NebulaMgr::listMatchingObjectsI18n(const QString& objPrefix, int max
 	}
 
 	// Search by NGC numbers (possible formats are "NGC31" or "NGC 31")
-	foreach (const NebulaP& n, nebArray)
+	for (int i=0; i<catalog.size(); ++i)
 	{
-		if (n->NGC_nb==0) continue;
-		QString constw = QString("NGC%1").arg(n->NGC_nb);
+		const NebulaCatalog::Record& n = catalog.at(i);
+		if (n.NGC_nb==0) continue;
+		QString constw = QString("NGC%1").arg(n.NGC_nb);
 		QString constws = constw.mid(0, objw.size());
 		if (constws==objw)
 		{
 			result << constws;
 			continue;
 		}
-		constw = QString("NGC %1").arg(n->NGC_nb);
+		constw = QString("NGC %1").arg(n.NGC_nb);
 		constws = constw.mid(0, objw.size());
 		if (constws==objw)
 			result << constw;
@@ -719,17 +531,18 @@ QStringList NebulaMgr::listMatchingObjectsI18n(const QString& objPrefix, int max
 	// Search by caldwell objects number (possible formats are "C31" or "C 31")
 	if (objw.size()>=1 && objw[0]=='C')
 	{
-		foreach (const NebulaP& n, nebArray)
+		for (int i=0; i<catalog.size(); ++i)
 		{
-			if (n->C_nb==0) continue;
-			QString constw = QString("C%1").arg(n->C_nb);
+			const NebulaCatalog::Record& n = catalog.at(i);
+			if (n.C_nb==0) continue;
+			QString constw = QString("C%1").arg(n.C_nb);
 			QString constws = constw.mid(0, objw.size());
 			if (constws==objw)
 			{
 				result << constws;
 				continue;	// Prevent adding both forms for name
 			}
-			constw = QString("C %1").arg(n->C_nb);
+			constw = QString("C %1").arg(n.C_nb);
 			constws = constw.mid(0, objw.size());
 			if (constws==objw)
 				result << constw;
@@ -739,9 +552,9 @@ QStringList NebulaMgr::listMatchingObjectsI18n(const QString& objPrefix, int max
 	QString dson;
 	bool find;
 	// Search by common names
-	foreach (const NebulaP& n, nebArray)
+	foreach (const QString& nameI18n, namesI18n)
 	{
-		dson = n->nameI18;
+		dson = nameI18n;
 		find = false;
 		if (useStartOfWords)
 		{
@@ -776,17 +589,18 @@ QStringList NebulaMgr::listMatchingObjects(const QString& objPrefix, int maxNbIt
 	// Search by Messier objects number (possible formats are "M31" or "M 31")
 	if (objw.size()>=1 && objw[0]=='M')
 	{
-		foreach (const NebulaP& n, nebArray)
+		for (int i=0; i<catalog.size(); ++i)
 		{
-			if (n->M_nb==0) continue;
-			QString constw = QString("M%1").arg(n->M_nb);
+			const NebulaCatalog::Record& n = catalog.at(i);
+			if (n.M_nb==0) continue;
+			QString constw = QString("M%1").arg(n.M_nb);
 			QString constws = constw.mid(0, objw.size());
 			if (constws==objw)
 			{
 				result << constws;
 				continue;	// Prevent adding both forms for name
 			}
-			constw = QString("M %1").arg(n->M_nb);
+			constw = QString("M %1").arg(n.M_nb);
 			constws = constw.mid(0, objw.size());
 			if (constws==objw)
 				result << constw;
@@ -796,17 +610,18 @@ QStringList NebulaMgr::listMatchingObjects(const QString& objPrefix, int maxNbIt
 	// Search by IC objects number (possible formats are "IC466" or "IC 466")
 	if (objw.size()>=1 && objw[0]=='I')
 	{
-		foreach (const NebulaP& n, nebArray)
+		for (int i=0; i<catalog.size(); ++i)
 		{
-			if (n->IC_nb==0) continue;
-			QString constw = QString("IC%1").arg(n->IC_nb);
+			const NebulaCatalog::Record& n = catalog.at(i);
+			if (n.IC_nb==0) continue;
+			QString constw = QString("IC%1").arg(n.IC_nb);
 			QString constws = constw.mid(0, objw.size());
 			if (constws==objw)
 			{
 				result << constws;
 				continue;	// Prevent adding both forms for name
 			}
-			constw = QString("IC %1").arg(n->IC_nb);
+			constw = QString("IC %1").arg(n.IC_nb);
 			constws = constw.mid(0, objw.size());
 			if (constws==objw)
 				result << constw;
@@ -814,17 +629,18 @@ QStringList NebulaMgr::listMatchingObjects(const QString& objPrefix, int maxNbIt
 	}
 
 	// Search by NGC numbers (possible formats are "NGC31" or "NGC 31")
-	foreach (const NebulaP& n, nebArray)
+	for (int i=0; i<catalog.size(); ++i)
 	{
-		if (n->NGC_nb==0) continue;
-		QString constw = QString("NGC%1").arg(n->NGC_nb);
+		const NebulaCatalog::Record& n = catalog.at(i);
+		if (n.NGC_nb==0) continue;
+		QString constw = QString("NGC%1").arg(n.NGC_nb);
 		QString constws = constw.mid(0, objw.size());
 		if (constws==objw)
 		{
 			result << constws;
 			continue;
 		}
-		constw = QString("NGC %1").arg(n->NGC_nb);
+		constw = QString("NGC %1").arg(n.NGC_nb);
 		constws = constw.mid(0, objw.size());
 		if (constws==objw)
 			result << constw;
@@ -833,17 +649,18 @@ QStringList NebulaMgr::listMatchingObjects(const QString& objPrefix, int maxNbIt
 	// Search by caldwell objects number (possible formats are "C31" or "C 31")
 	if (objw.size()>=1 && objw[0]=='C')
 	{
-		foreach (const NebulaP& n, nebArray)
+		for (int i=0; i<catalog.size(); ++i)
 		{
-			if (n->C_nb==0) continue;
-			QString constw = QString("C%1").arg(n->C_nb);
+			const NebulaCatalog::Record& n = catalog.at(i);
+			if (n.C_nb==0) continue;
+			QString constw = QString("C%1").arg(n.C_nb);
 			QString constws = constw.mid(0, objw.size());
 			if (constws==objw)
 			{
 				result << constws;
 				continue;	// Prevent adding both forms for name
 			}
-			constw = QString("C %1").arg(n->C_nb);
+			constw = QString("C %1").arg(n.C_nb);
 			constws = constw.mid(0, objw.size());
 			if (constws==objw)
 				result << constw;
@@ -853,9 +670,11 @@ QStringList NebulaMgr::listMatchingObjects(const QString& objPrefix, int maxNbIt
 	QString dson;
 	bool find;
 	// Search by common names
-	foreach (const NebulaP& n, nebArray)
+	for (int i=0; i<catalog.size(); ++i)
 	{
-		dson = n->englishName;
+		if (!catalog.hasName(i))
+			continue;
+		dson = catalog.getEnglishName(i);
 		find = false;
 		if (useStartOfWords)
 		{
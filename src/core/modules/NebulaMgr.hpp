@@ -23,13 +23,15 @@
 
 #include "StelObjectType.hpp"
 #include "StelFader.hpp"
-#include "StelSphericalIndex.hpp"
 #include "StelObjectModule.hpp"
 #include "StelTextureTypes.hpp"
+#include "NebulaCatalog.hpp"
 
 #include <QString>
 #include <QStringList>
 #include <QFont>
+#include <QHash>
+#include <QWeakPointer>
 
 class Nebula;
 class StelTranslator;
@@ -42,6 +44,9 @@ typedef QSharedPointer<Nebula> NebulaP;
 //! @class NebulaMgr
 //! Manage a collection of nebulae. This class is used
 //! to display the NGC catalog with information, and textures for some of them.
+//! The catalog is read in place from a NebulaCatalog: the Nebula objects are only
+//! created when they are returned by the search methods, and are shared as long as
+//! they are used.
 // GZ: This doc seems outdated/misleading - photo textures are not mamaged here but in StelSkyImageTile
 
 class NebulaMgr : public StelObjectModule
@@ -200,22 +205,25 @@ private:
 	//! Draw a nice animated pointer around the object
 	void drawPointer(const StelCore* core, StelPainter& sPainter);
 
-	NebulaP searchM(unsigned int M);
-	NebulaP searchNGC(unsigned int NGC);
-	NebulaP searchIC(unsigned int IC);
-	NebulaP searchC(unsigned int C);
-	bool loadNGC(const QString& fileName);
-	bool loadNGCOld(const QString& catNGC);
-	bool loadNGCNames(const QString& fileName);
-
-	QVector<NebulaP> nebArray;		// The nebulas list
-	QHash<unsigned int, NebulaP> ngcIndex;
+	//! Get the object for a record of the catalog, creating it if it is not in use.
+	//! @return a null pointer if i is -1.
+	NebulaP getNebula(int i) const;
+
+	NebulaP searchM(unsigned int M) const;
+	NebulaP searchNGC(unsigned int NGC) const;
+	NebulaP searchIC(unsigned int IC) const;
+	NebulaP searchC(unsigned int C) const;
+	//! Search for a nebula by catalog reference, e.g. "M 31", "NGC31".
+	//! @param uname the reference in upper case.
+	NebulaP searchCatalogNumber(const QString& uname) const;
+
+	NebulaCatalog catalog;
+	QHash<int, QString> namesI18n;	// The translated names of the records which have a name
+	mutable QHash<int, QWeakPointer<Nebula> > nebulae;	// The objects in use, by record
+	mutable int nebulaePruneSize;	// Size of nebulae above which the released objects are removed
 	LinearFader hintsFader;
 	LinearFader flagShow;
 
-	//! The internal grid for fast positional lookup
-	StelSphericalIndex nebGrid;
-
 	//! The amount of hints (between 0 and 10)
 	float hintsAmount;
 	//! The amount of labels (between 0 and 10)
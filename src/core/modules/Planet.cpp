@@ -32,6 +32,7 @@
 #include "StelModuleMgr.hpp"
 #include "StarMgr.hpp"
 #include "StelMovementMgr.hpp"
+#include "LandscapeMgr.hpp"
 #include "StelPainter.hpp"
 #include "StelTranslator.hpp"
 #include "StelUtils.hpp"
@@ -870,7 +871,9 @@ void Planet::draw(StelCore* core, float maxMagLabels, const QFont& planetNameFon
 		}
 		drawHints(core, planetNameFont);
 
-		draw3dModel(core,transfo,screenSz);
+		// Skip the bodies entirely hidden by the terrain. The glare of the Sun may still be seen around it.
+		if (englishName=="Sun" || !GETSTELMODULE(LandscapeMgr)->isHiddenByLandscape(getAltAzPosApparent(core), getAngularSize(core)*M_PI/180.))
+			draw3dModel(core,transfo,screenSz);
 	}
 	return;
 }
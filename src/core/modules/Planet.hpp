@@ -206,6 +206,7 @@ public:
 	double getDistance(void) const {return distance;}
 
 	void setRings(Ring* r) {rings = r;}
+	const Ring* getRings(void) const {return rings;}
 
 	void setSphereScale(float s) {sphereScale = s;}
 	float getSphereScale(void) const {return sphereScale;}
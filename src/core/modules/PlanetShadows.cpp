@@ -43,6 +43,16 @@ void PlanetShadows::setData(const char *data, int size, int count)
 	texture->loadFromMemory(data, size, size, GL_RGBA, GL_FLOAT, GL_RGBA32F);
 }
 
+void PlanetShadows::updateRows(const char *data, int first, int rowCount)
+{
+	if(!supported)
+		return;
+
+	const int size = (int)infoSize;
+	if (!texture->updateFromMemory(data, 0, first, size, rowCount, GL_RGBA, GL_FLOAT))
+		qWarning() << "PlanetShadows: cannot update rows" << first << "to" << first+rowCount-1 << "of the shadow info texture";
+}
+
 void PlanetShadows::setCurrent(int current)
 {
 	this->current = current;
@@ -61,6 +61,11 @@ public:
 	bool isActive();
 
 	void setData(const char* data, int size, int count);
+	//! Replace some rows of the shadow info texture loaded by setData().
+	//! @param data the content of the rows, size texels per row.
+	//! @param first the index of the first row to replace.
+	//! @param rowCount the number of rows to replace.
+	void updateRows(const char* data, int first, int rowCount);
 	void setCurrent(int current);
 	void setRings(StelTextureSP rings_texture, float min, float max);
 	void setMoon(StelTextureSP moon_texture);
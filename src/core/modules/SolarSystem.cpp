@@ -60,7 +60,7 @@
 #include <QDir>
 
 SolarSystem::SolarSystem()
-	: shadowPlanetCount(0)
+	: shadowInfoSize(0)
 	, flagMoonScale(false)
 	, moonScale(1.)
 	, labelsAmount(false)
@@ -268,11 +268,16 @@ void SolarSystem::loadPlanets()
 		}
 	}
 
-	shadowPlanetCount = 0;
-
+	shadowPlanets.clear();
+	shadowPlanetIndices.clear();
+	shadowInfoSize = 0;
+	if (sun)
+		shadowPlanets << sun;
 	foreach (const PlanetP& planet, systemPlanets)
-		if(planet->parent != sun || !planet->satellites.isEmpty())
-			shadowPlanetCount++;
+		if(planet != sun && (planet->parent != sun || !planet->satellites.isEmpty()))
+			shadowPlanets << planet;
+	for (int i=0; i<shadowPlanets.size(); ++i)
+		shadowPlanetIndices.insert(shadowPlanets.at(i).data(), i);
 }
 
 bool SolarSystem::loadPlanets(const QString& filePath)
@@ -955,63 +960,188 @@ struct biggerDistance : public std::binary_function<PlanetP, PlanetP, bool>
 	}
 };
 
-void SolarSystem::computeShadowInfo()
+//! @return the radius of the part of the planet which can receive shadows, rings included.
+static double getShadowTargetRadius(const Planet* target)
+{
+	const double radius = target->getRings() ? target->getRings()->getSize() : target->getRadius();
+	return radius*qMax(1.f, target->getSphereScale());
+}
+
+//! @return true if the source may hide a part of the sun seen from some point of the target.
+//! The positions are heliocentric. This is the test of the shadow shader, made for the whole
+//! target by enlarging the sun and the source by the radius of the target.
+static bool mayCastShadow(const Vec3d& targetPos, const double targetRadius, const Vec3d& sourcePos, const double sourceRadius, const double sunRadius)
+{
+	const Vec3d toSun = -targetPos;
+	const Vec3d toSource = sourcePos - targetPos;
+	const double sunDist = toSun.length();
+	const double sourceDist = toSource.length();
+	if (sourceDist >= sunDist)
+		return false;
+	if (sourceDist <= targetRadius + sourceRadius)
+		return true;
+
+	const double sunAngle = std::asin(qMin(1., (sunRadius + targetRadius)/sunDist));
+	const double sourceAngle = std::asin(qMin(1., (sourceRadius + targetRadius)/sourceDist));
+	const double angle = std::acos(qBound(-1., toSun.dot(toSource)/(sunDist*sourceDist), 1.));
+	return angle < sunAngle + sourceAngle;
+}
+
+const Mat4d& SolarSystem::getShadowModelMatrix(int index)
 {
-	// Acquire shadow informations
-	if(shadowModelMatricesBuffer.size() < shadowPlanetCount)
+	if (!shadowModelMatricesValid.at(index))
 	{
-		shadowModelMatricesBuffer.resize(shadowPlanetCount);
+		shadowPlanets.at(index)->computeModelMatrix(shadowModelMatricesBuffer[index]);
+		shadowModelMatricesValid[index] = true;
 	}
+	return shadowModelMatricesBuffer.at(index);
+}
 
-	Mat4d* modelMatrices = shadowModelMatricesBuffer.data();
-	int p = 1;
-	foreach (const PlanetP& planet, systemPlanets)
+void SolarSystem::computeShadowInfo(const StelCore* core)
+{
+	const int count = shadowPlanets.size();
+	const int size = StelUtils::getBiggerEqualPowerOfTwo(count);
+
+	if(shadowInfoBuffer.size() != size * size)
+	{
+		shadowInfoBuffer.fill(Vec4f(0.f, 0.f, 0.f, 0.f), size * size);
+		shadowInfoSize = 0;
+	}
+	if(shadowModelMatricesBuffer.size() < count)
 	{
-		if(planet->parent != sun || !planet->satellites.isEmpty())
+		shadowModelMatricesBuffer.resize(count);
+	}
+	shadowModelMatricesValid.fill(false, count);
+	shadowInfoRows.fill(false, count);
+
+	// Shadow info texture data
+	Vec4f* data = shadowInfoBuffer.data();
+	const StelProjectorP prj = core->getProjection(StelCore::FrameHeliocentricEcliptic);
+	const double sunRadius = sun->getRadius();
+	const QString& homePlanetName = core->getCurrentLocation().planetName;
+
+	for (int y = 1; y < count; ++y)
+	{
+		const PlanetP& target = shadowPlanets.at(y);
+
+		// Same visibility test as Planet::draw(): the other rows are not used by the shader this frame.
+		// The rings are drawn around the observer, and may cross the screen when the planet is out
+		// of it, so the rows of the home planet and of the ringed planets are always computed.
+		if (!target->getRings() && target->getEnglishName() != homePlanetName)
 		{
-			planet->computeModelMatrix(modelMatrices[planet == sun ? 0 : p++]);
+			const float screenSz = target->getAngularSize(core)*M_PI/180.*prj->getPixelPerRadAtCenter();
+			Vec3d win;
+			if (screenSz <= 1.f || !prj->project(target->getHeliocentricEclipticPos(), win)
+			    || win[0] < prj->getViewportPosX() - screenSz || win[0] > prj->getViewportPosX() + prj->getViewportWidth() + screenSz
+			    || win[1] < prj->getViewportPosY() - screenSz || win[1] > prj->getViewportPosY() + prj->getViewportHeight() + screenSz)
+				continue;
+		}
+		shadowInfoRows[y] = true;
+
+		const Vec3d targetPos = target->getHeliocentricEclipticPos();
+		const double targetRadius = getShadowTargetRadius(target.data());
+		const Mat4d mTarget = getShadowModelMatrix(y).inverse();
+		Vec4f* row = data + y * size;
+		memset(row, '\0', size * sizeof(Vec4f));
+		row[0] = Vec4f(mTarget[12], mTarget[13], mTarget[14], sunRadius);
+
+		for (int x = 1; x < count; ++x)
+		{
+			const PlanetP& source = shadowPlanets.at(x);
+			if (x != y && !mayCastShadow(targetPos, targetRadius, source->getHeliocentricEclipticPos(), source->getRadius(), sunRadius))
+				continue;
+
+			const Vec4d position = mTarget * getShadowModelMatrix(x).getColumn(3);
+			row[x] = Vec4f(position[0], position[1], position[2], source->getRadius());
 		}
 	}
 
-	const int size = StelUtils::getBiggerEqualPowerOfTwo(shadowPlanetCount);
+#ifndef NDEBUG
+	validateShadowInfo(shadowInfoRows);
+#endif
 
-	if(shadowInfoBuffer.size() < size * size)
+	PlanetShadows* shadows = PlanetShadows::getInstance();
+	if (shadowInfoSize != size)
 	{
-		shadowInfoBuffer.resize(size * size);
+		shadows->setData(reinterpret_cast<char*>(data), size, count);
+		shadowInfoSize = size;
+		return;
 	}
 
-	// Shadow info texture data
-	Vec4f* data = shadowInfoBuffer.data();
-	memset(data, '\0', size * size * sizeof(Vec4f));
-
+	// Upload the consecutive computed rows together
 	int y = 1;
-
-	foreach (const PlanetP& target, systemPlanets)
+	while (y < count)
 	{
-		if(target == sun || (target->parent == sun && target->satellites.isEmpty()))
+		if (!shadowInfoRows.at(y))
+		{
+			++y;
 			continue;
+		}
+		const int first = y;
+		while (y < count && shadowInfoRows.at(y))
+			++y;
+		shadows->updateRows(reinterpret_cast<char*>(data + first * size), first, y - first);
+	}
+}
 
-		const Mat4d mTarget = modelMatrices[y].inverse();
+void SolarSystem::computeFullShadowInfo(QVector<Vec4f>& info, int size) const
+{
+	const int count = shadowPlanets.size();
+	QVector<Mat4d> modelMatrices(count);
+	for (int i = 0; i < count; ++i)
+		shadowPlanets.at(i)->computeModelMatrix(modelMatrices[i]);
+
+	info.fill(Vec4f(0.f, 0.f, 0.f, 0.f), size * size);
+	Vec4f* data = info.data();
+
+	for (int y = 1; y < count; ++y)
+	{
+		const Mat4d mTarget = modelMatrices.at(y).inverse();
 		data[y * size] = Vec4f(mTarget[12], mTarget[13], mTarget[14], sun->getRadius());
 
-		int x = 1;
+		for (int x = 1; x < count; ++x)
+		{
+			const Vec4d position = mTarget * modelMatrices.at(x).getColumn(3);
+			data[y * size + x] = Vec4f(position[0], position[1], position[2], shadowPlanets.at(x)->getRadius());
+		}
+	}
+}
 
-		foreach (const PlanetP& source, systemPlanets)
+void SolarSystem::validateShadowInfo(const QVector<bool>& rows) const
+{
+	const int count = shadowPlanets.size();
+	const int size = StelUtils::getBiggerEqualPowerOfTwo(count);
+	QVector<Vec4f> reference;
+	computeFullShadowInfo(reference, size);
+
+	for (int y = 1; y < count; ++y)
+	{
+		if (!rows.at(y))
+			continue;
+		const Vec4f* row = shadowInfoBuffer.constData() + y * size;
+		const Vec4f* referenceRow = reference.constData() + y * size;
+		const Vec3d sunPos(referenceRow[0][0], referenceRow[0][1], referenceRow[0][2]);
+		const double targetRadius = getShadowTargetRadius(shadowPlanets.at(y).data());
+
+		for (int x = 0; x < count; ++x)
 		{
-			if(source == sun || (source->parent == sun && source->satellites.isEmpty()))
+			const Vec4f& entry = row[x];
+			const Vec4f& expected = referenceRow[x];
+			if (entry[3] != 0.f)
+			{
+				// Computed entries must be the same as in the full matrix
+				if (entry != expected)
+					qWarning() << "SolarSystem: wrong shadow info for" << shadowPlanets.at(x)->getEnglishName() << "on" << shadowPlanets.at(y)->getEnglishName();
 				continue;
+			}
 
-			const Mat4d& mSource(modelMatrices[x]);
-			const Vec4d position = mTarget * mSource.getColumn(3);
-
-			data[y * size + x] = Vec4f(position[0], position[1], position[2], source->getRadius());
-			x++;
+			// Skipped entries must be bodies which shadow no part of the target. This is
+			// checked in the frame of the target, where the target is at the origin.
+			const Vec3d sourcePos(expected[0], expected[1], expected[2]);
+			if (mayCastShadow(-sunPos, targetRadius, sourcePos - sunPos, expected[3], sun->getRadius()))
+				qWarning() << "SolarSystem: missing shadow info for" << shadowPlanets.at(x)->getEnglishName() << "on" << shadowPlanets.at(y)->getEnglishName();
 		}
-
-		y++;
 	}
-
-	PlanetShadows::getInstance()->setData(reinterpret_cast<char*>(data), size, shadowPlanetCount);
 }
 
 // Draw all the elements of the solar system
@@ -1048,21 +1178,13 @@ void SolarSystem::draw(StelCore* core)
 
 	if(shadows->isSupported())
 	{
-		computeShadowInfo();
+		computeShadowInfo(core);
 
 		// Draw the elements
-		int i = 1;
 		foreach (const PlanetP& p, systemPlanets)
 		{
-			if((p == sun || (p->parent == sun && p->satellites.isEmpty())))
-			{
-				shadows->setCurrent(0);
-			}
-			else
-			{
-				shadows->setCurrent(i);
-				i++;
-			}
+			// The sun and the planets which need no shadow information have index 0
+			shadows->setCurrent(shadowPlanetIndices.value(p.data(), 0));
 
 			p->draw(core, maxMagLabel, planetNameFont);
 		}
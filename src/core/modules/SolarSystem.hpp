@@ -30,6 +30,7 @@
 #include "Planet.hpp"
 
 #include <QFont>
+#include <QHash>
 
 class Orbit;
 class StelTranslator;
@@ -336,7 +337,20 @@ private:
 	void recreateTrails();
 
 	//! Calculates the shadow information for the shadow planet shader.
-	void computeShadowInfo();
+	//! Only the rows of the planets visible on screen are computed and uploaded, and in
+	//! each row only the bodies close enough to the direction of the sun to shadow the
+	//! planet are filled in. The other entries are left empty.
+	void computeShadowInfo(const StelCore* core);
+
+	//! Calculates the shadow information of all the pairs of planets into info.
+	//! This is the reference for computeShadowInfo(), used to validate it in debug builds.
+	void computeFullShadowInfo(QVector<Vec4f>& info, int size) const;
+
+	//! Check that the rows computed by computeShadowInfo() give the same shadows as the full matrix.
+	void validateShadowInfo(const QVector<bool>& rows) const;
+
+	//! Get the model matrix of a shadow planet, computing it at most once per frame.
+	const Mat4d& getShadowModelMatrix(int index);
 
 	//! Used by computeShadowInfo to generate shadow info texture before uploading it.
 	QVector<Vec4f> shadowInfoBuffer;
@@ -344,9 +358,17 @@ private:
 	//! Used by computeShadowInfo to store computed planet model matrices used to generate the
 	//! shadow info texture.
 	QVector<Mat4d> shadowModelMatricesBuffer;
-
-	//! Used to count how many planets actually need shadow information
-	int shadowPlanetCount;
+	//! Which of the shadowModelMatricesBuffer were computed for the current frame.
+	QVector<bool> shadowModelMatricesValid;
+	//! Which rows of the shadow info texture were computed for the current frame.
+	QVector<bool> shadowInfoRows;
+
+	//! The planets which need shadow information, the sun first.
+	//! The index of a planet in this list is its row and column in the shadow info texture.
+	QList<PlanetP> shadowPlanets;
+	QHash<const Planet*, int> shadowPlanetIndices;
+	//! Size of the uploaded shadow info texture, 0 when it must be uploaded completely.
+	int shadowInfoSize;
 	PlanetP sun;
 	PlanetP moon;
 	PlanetP earth;
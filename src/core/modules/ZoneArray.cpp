@@ -39,6 +39,9 @@ static unsigned int stel_bswap_32(unsigned int val) {
 
 static const Vec3f north(0,0,1);
 
+//! Number of stars projected together when drawing a zone
+static const int STAR_BATCH_SIZE = 256;
+
 void ZoneArray::initTriangle(int index, const Vec3f &c0, const Vec3f &c1, const Vec3f &c2)
 {
 	// initialize center,axis0,axis1:
@@ -505,63 +508,97 @@ void SpecialZoneArray<Star>::draw(StelPainter* sPainter, int index, bool isInsid
 	Q_ASSERT(cutoffMagStep<RCMAG_TABLE_SIZE);
     
 	// Go through all stars, which are sorted by magnitude (bright stars first)
+	// The selected stars are projected by batches, so that the projection runs in tight loops
+	const StelProjectorP& prj = sPainter->getProjector();
+	const unsigned char visibleFlags = isInsideViewport ? StelProjector::ProjectedValid : (StelProjector::ProjectedValid | StelProjector::ProjectedInViewport);
+	const Star* batchStars[STAR_BATCH_SIZE];
+	const RCMag* batchRcMags[STAR_BATCH_SIZE];
+	int batchMagIndexes[STAR_BATCH_SIZE];
+	Vec3f batchPos[STAR_BATCH_SIZE];
+	Vec3f batchWin[STAR_BATCH_SIZE];
+	unsigned char batchFlags[STAR_BATCH_SIZE];
+
 	const SpecialZoneData<Star>* zoneToDraw = getZones() + index;
 	const Star* lastStar = zoneToDraw->getStars() + zoneToDraw->size;
-    for (const Star* s=zoneToDraw->getStars();s<lastStar;++s)
-    {
-		// Artifical cutoff per magnitude
-		if (s->mag > cutoffMagStep)
-			break;
-    
-		// Because of the test above, the star should always be visible from this point.
-		
-		// Array of 2 numbers containing radius and magnitude
-		const RCMag* tmpRcmag = &rcmag_table[s->mag];
-		
-		// Get the star position from the array
-		s->getJ2000Pos(zoneToDraw, movementFactor, vf);
-		
-		// If the star zone is not strictly contained inside the viewport, eliminate from the 
-		// beginning the stars actually outside viewport.
-		if (!isInsideViewport)
+	const Star* s = zoneToDraw->getStars();
+	bool cutoffReached = false;
+	while (s<lastStar && !cutoffReached)
+	{
+		int nbInBatch = 0;
+		for (;s<lastStar && nbInBatch<STAR_BATCH_SIZE;++s)
 		{
-			bool isVisible = true;
-			foreach (const SphericalCap& cap, boundingCaps)
+			// Artifical cutoff per magnitude
+			if (s->mag > cutoffMagStep)
+			{
+				cutoffReached = true;
+				break;
+			}
+
+			// Because of the test above, the star should always be visible from this point.
+
+			// Array of 2 numbers containing radius and magnitude
+			const RCMag* tmpRcmag = &rcmag_table[s->mag];
+
+			// Get the star position from the array
+			s->getJ2000Pos(zoneToDraw, movementFactor, vf);
+
+			// If the star zone is not strictly contained inside the viewport, eliminate from the
+			// beginning the stars actually outside viewport.
+			if (!isInsideViewport)
 			{
-				// Don't use if (!cap.contains(vf)) here because we don't want to normalize the vector yet, but know
-				// that it's almost normalized, enough for manually computing the intersection avoiding the assert.
-				if (vf[0]*static_cast<float>(cap.n[0])+vf[1]*static_cast<float>(cap.n[1])+vf[2]*static_cast<float>(cap.n[2])<static_cast<float>(cap.d))
+				bool isVisible = true;
+				foreach (const SphericalCap& cap, boundingCaps)
 				{
-					isVisible = false;
-					continue;
+					// Don't use if (!cap.contains(vf)) here because we don't want to normalize the vector yet, but know
+					// that it's almost normalized, enough for manually computing the intersection avoiding the assert.
+					if (vf[0]*static_cast<float>(cap.n[0])+vf[1]*static_cast<float>(cap.n[1])+vf[2]*static_cast<float>(cap.n[2])<static_cast<float>(cap.d))
+					{
+						isVisible = false;
+						continue;
+					}
 				}
+				if (!isVisible)
+					continue;
 			}
-			if (!isVisible)
-				continue;
+
+			int extinctedMagIndex = s->mag;
+			if (withExtinction)
+			{
+				Vec3f altAz(vf);
+				altAz.normalize();
+				core->j2000ToAltAzInPlaceNoRefraction(&altAz);
+				float extMagShift=0.0f;
+				extinction.forward(altAz, &extMagShift);
+				extinctedMagIndex = s->mag + (int)(extMagShift/k);
+				if (extinctedMagIndex >= cutoffMagStep) // i.e., if extincted it is dimmer than cutoff, so remove
+					continue;
+				tmpRcmag = &rcmag_table[extinctedMagIndex];
+			}
+
+			batchStars[nbInBatch] = s;
+			batchRcMags[nbInBatch] = tmpRcmag;
+			batchMagIndexes[nbInBatch] = extinctedMagIndex;
+			batchPos[nbInBatch] = vf;
+			++nbInBatch;
 		}
 
-		int extinctedMagIndex = s->mag;
-		if (withExtinction)
+		prj->project(nbInBatch, batchPos, batchWin, batchFlags);
+		for (int i=0;i<nbInBatch;++i)
 		{
-			Vec3f altAz(vf);
-			altAz.normalize();
-			core->j2000ToAltAzInPlaceNoRefraction(&altAz);
-			float extMagShift=0.0f;
-			extinction.forward(altAz, &extMagShift);
-			extinctedMagIndex = s->mag + (int)(extMagShift/k);
-			if (extinctedMagIndex >= cutoffMagStep) // i.e., if extincted it is dimmer than cutoff, so remove
+			if ((batchFlags[i] & visibleFlags) != visibleFlags)
 				continue;
-			tmpRcmag = &rcmag_table[extinctedMagIndex];
-		}
-	
-		if (drawer->drawPointSource(sPainter, vf, *tmpRcmag, s->bV, !isInsideViewport) && s->hasName() && extinctedMagIndex < maxMagStarName && s->hasComponentID()<=1)
-		{
-			const float offset = tmpRcmag->radius*0.7f;
-			const Vec3f colorr = StelSkyDrawer::indexToColor(s->bV)*0.75f;
-			sPainter->setColor(colorr[0], colorr[1], colorr[2],names_brightness);
-			sPainter->drawText(Vec3d(vf[0], vf[1], vf[2]), s->getNameI18n(), 0, offset, offset, false);
+			const Star* star = batchStars[i];
+			const RCMag* tmpRcmag = batchRcMags[i];
+			if (drawer->drawProjectedPointSource(sPainter, batchWin[i], *tmpRcmag, star->bV) && star->hasName() && batchMagIndexes[i] < maxMagStarName && star->hasComponentID()<=1)
+			{
+				const Vec3f& pos = batchPos[i];
+				const float offset = tmpRcmag->radius*0.7f;
+				const Vec3f colorr = StelSkyDrawer::indexToColor(star->bV)*0.75f;
+				sPainter->setColor(colorr[0], colorr[1], colorr[2],names_brightness);
+				sPainter->drawText(Vec3d(pos[0], pos[1], pos[2]), star->getNameI18n(), 0, offset, offset, false);
+			}
 		}
-    }
+	}
 }
 
 template<class Star>
@@ -0,0 +1,134 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QTest>
+
+#include "testHorizonProfile.hpp"
+#include "HorizonProfile.hpp"
+
+#include <cmath>
+
+QTEST_MAIN(TestHorizonProfile);
+
+//! Precision of the sines read from the profile.
+static const double SINE_PRECISION = 1e-3;
+
+//! @return the altitude [radians] of the test horizon in the given azimuth, between -0.15 and 0.25.
+static double horizonAltitude(const double az)
+{
+	return 0.05 + 0.2*std::sin(3.*az);
+}
+
+//! The ground below the test horizon.
+class TestHorizon : public HorizonProfile::OpacitySource
+{
+public:
+	virtual float getOpacity(const Vec3d& v) const
+	{
+		return std::asin(v[2]) < horizonAltitude(std::atan2(v[1], v[0])) ? 1.f : 0.f;
+	}
+};
+
+//! The test horizon with a branch above it, between azimuths 1 and 1.5, from 0.5 to 0.6 radians.
+class TestTree : public TestHorizon
+{
+public:
+	virtual float getOpacity(const Vec3d& v) const
+	{
+		const double az = std::atan2(v[1], v[0]);
+		const double alt = std::asin(v[2]);
+		if (az>1. && az<1.5 && alt>0.5 && alt<0.6)
+			return 1.f;
+		return TestHorizon::getOpacity(v);
+	}
+};
+
+void TestHorizonProfile::testEmptyProfile()
+{
+	HorizonProfile profile;
+	QVERIFY(profile.isEmpty());
+	QCOMPARE(profile.getSine(1., 0.), 0.f);
+	QCOMPARE(profile.getSine(-0.3, -0.7), 0.f);
+	QCOMPARE(profile.getMinAltitude(), 0.f);
+
+	profile.compute(TestHorizon(), true);
+	QVERIFY(!profile.isEmpty());
+	profile.clear();
+	QVERIFY(profile.isEmpty());
+	QCOMPARE(profile.getSine(0., 1.), 0.f);
+	QCOMPARE(profile.getMinAltitude(), 0.f);
+}
+
+void TestHorizonProfile::testSingleTransition()
+{
+	HorizonProfile profile;
+	profile.compute(TestHorizon(), true);
+	for (double az=-M_PI; az<M_PI; az+=0.1)
+	{
+		const float sine = profile.getSine(std::cos(az), std::sin(az));
+		QVERIFY2(std::fabs(sine-std::sin(horizonAltitude(az)))<SINE_PRECISION, qPrintable(QString("azimuth %1: %2").arg(az).arg(sine)));
+	}
+	// Only the azimuth matters
+	QCOMPARE(profile.getSine(2., 0.), profile.getSine(1., 0.));
+	QVERIFY(std::fabs(profile.getMinAltitude()+0.15)<SINE_PRECISION);
+}
+
+void TestHorizonProfile::testHighestTransition()
+{
+	HorizonProfile profile;
+	profile.compute(TestTree(), false);
+	for (double az=-M_PI; az<M_PI; az+=0.1)
+	{
+		// Away from the edges of the branch, where the profile is interpolated
+		if (std::fabs(az-1.)<0.01 || std::fabs(az-1.5)<0.01)
+			continue;
+		const double alt = (az>1. && az<1.5) ? 0.6 : horizonAltitude(az);
+		const float sine = profile.getSine(std::cos(az), std::sin(az));
+		QVERIFY2(std::fabs(sine-std::sin(alt))<SINE_PRECISION, qPrintable(QString("azimuth %1: %2").arg(az).arg(sine)));
+	}
+}
+
+void TestHorizonProfile::testCapAboveHorizon()
+{
+	HorizonProfile profile;
+	profile.compute(TestTree(), false);
+
+	// The directions above the profile, with the zenith in several directions
+	const Mat4d rotations[3] = {Mat4d::identity(), Mat4d::xrotation(0.7), Mat4d::yrotation(-2.)*Mat4d::zrotation(1.)};
+	for (int r=0; r<3; ++r)
+	{
+		const Mat4d& m = rotations[r];
+		const SphericalCap cap = HorizonProfile::getCapAboveHorizon(m*Vec3d(0., 0., 1.), profile.getMinAltitude());
+		for (double az=-M_PI; az<M_PI; az+=0.01)
+		{
+			const double x = std::cos(az);
+			const double y = std::sin(az);
+			const double horizon = std::asin(profile.getSine(x, y));
+			for (double alt=horizon; alt<=M_PI/2.; alt+=0.05)
+				QVERIFY(cap.contains(m*Vec3d(std::cos(alt)*x, std::cos(alt)*y, std::sin(alt))));
+		}
+	}
+
+	// Without profile, the cap is about 2 degrees below the mathematical horizon
+	const SphericalCap cap = HorizonProfile::getCapAboveHorizon(Vec3d(0., 0., 1.), 0.f);
+	QVERIFY(cap.contains(Vec3d(1., 0., 0.)));
+	QVERIFY(cap.contains(Vec3d(std::cos(0.03), 0., -std::sin(0.03))));
+	QVERIFY(!cap.contains(Vec3d(std::cos(0.04), 0., -std::sin(0.04))));
+}
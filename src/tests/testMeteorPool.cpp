@@ -0,0 +1,133 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QDebug>
+#include <QTest>
+
+#include "testMeteorPool.hpp"
+#include "MeteorPool.hpp"
+#include "StelToneReproducer.hpp"
+
+QTEST_MAIN(TestMeteorPool);
+
+//! Fill the pool with meteors seen by an observer at the north pole.
+static void fillPool(MeteorPool& pool, int n)
+{
+	StelToneReproducer eye;
+	const Vec3d observer(0., 0., EARTH_RADIUS);
+	while (pool.size()<n)
+		pool.spawn(observer, 72., eye, 60.f);
+}
+
+void TestMeteorPool::testDeterminism()
+{
+	MeteorPool pool1, pool2;
+	pool1.setRandomSeed(1234);
+	pool2.setRandomSeed(1234);
+	fillPool(pool1, 1000);
+	fillPool(pool2, 1000);
+	for (int i=0; i<20; ++i)
+	{
+		pool1.update(50.);
+		pool2.update(50.);
+	}
+	QCOMPARE(pool1.size(), pool2.size());
+
+	QVector<Vec3d> vertices1, vertices2, heads1, heads2;
+	QVector<Vec4f> colors1, colors2;
+	const Mat4d rot = Mat4d::zrotation(0.3);
+	pool1.fillDrawArrays(rot, vertices1, colors1, heads1);
+	pool2.fillDrawArrays(rot, vertices2, colors2, heads2);
+	QCOMPARE(heads1.size(), pool1.size());
+	QVERIFY(vertices1.isEmpty());
+	QCOMPARE(heads1, heads2);
+	const QVector<Vec3d> firstHeads = heads1;
+
+	// Once drawn as a point, each meteor has a train of 2 segments
+	pool1.fillDrawArrays(rot, vertices1, colors1, heads1);
+	pool2.fillDrawArrays(rot, vertices2, colors2, heads2);
+	QVERIFY(heads1.isEmpty());
+	QCOMPARE(vertices1.size(), 4*pool1.size());
+	QCOMPARE(colors1.size(), vertices1.size());
+	QCOMPARE(vertices1, vertices2);
+	QCOMPARE(colors1, colors2);
+
+	// Another seed gives other meteors
+	MeteorPool pool3;
+	pool3.setRandomSeed(4321);
+	fillPool(pool3, 1000);
+	pool3.fillDrawArrays(rot, vertices2, colors2, heads2);
+	QCOMPARE(heads2.size(), firstHeads.size());
+	QVERIFY(heads2 != firstHeads);
+}
+
+void TestMeteorPool::testCapacity()
+{
+	MeteorPool pool(500);
+	fillPool(pool, 500);
+	QCOMPARE(pool.size(), 500);
+	StelToneReproducer eye;
+	for (int i=0; i<100; ++i)
+		QVERIFY(!pool.spawn(Vec3d(0., 0., EARTH_RADIUS), 72., eye, 60.f));
+	QCOMPARE(pool.size(), 500);
+
+	// The meteors burn out, and the dead ones are removed
+	for (int i=0; i<100; ++i)
+		pool.update(50.);
+	QVERIFY(pool.size()<500);
+	QVector<Vec3d> vertices, heads;
+	QVector<Vec4f> colors;
+	pool.fillDrawArrays(Mat4d::identity(), vertices, colors, heads);
+	QCOMPARE(heads.size(), pool.size());
+
+	pool.setCapacity(10);
+	QVERIFY(pool.size()<=10);
+	pool.clear();
+	QCOMPARE(pool.size(), 0);
+}
+
+void TestMeteorPool::benchmarkUpdate()
+{
+	MeteorPool pool;
+	pool.setRandomSeed(1);
+	fillPool(pool, 100000);
+	QBENCHMARK
+	{
+		// A small step, so that the meteors stay alive during the benchmark
+		pool.update(0.01);
+	}
+	QVERIFY(pool.size()>0);
+}
+
+void TestMeteorPool::benchmarkDrawArrays()
+{
+	MeteorPool pool;
+	pool.setRandomSeed(1);
+	fillPool(pool, 100000);
+	QVector<Vec3d> vertices, heads;
+	QVector<Vec4f> colors;
+	const Mat4d rot = Mat4d::zrotation(0.3);
+	pool.fillDrawArrays(rot, vertices, colors, heads);
+	QBENCHMARK
+	{
+		pool.fillDrawArrays(rot, vertices, colors, heads);
+	}
+	QCOMPARE(vertices.size(), 400000);
+}
@@ -0,0 +1,195 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QBuffer>
+#include <QDataStream>
+#include <QDebug>
+#include <QTest>
+
+#include "testNebulaCatalog.hpp"
+#include "NebulaCatalog.hpp"
+#include "StelGeodesicGrid.hpp"
+#include "StelUtils.hpp"
+
+#include <cmath>
+
+QTEST_MAIN(TestNebulaCatalog);
+
+//! Number of NGC objects in the test catalog, spread over the sky.
+static const int NB_NGC = 500;
+//! Position of the duplicate of NGC 224.
+static const float DUPLICATE_RA = 0.3f;
+static const float DUPLICATE_DEC = 0.4f;
+
+//! Write a record as in ngc2000.dat.
+static void writeRecord(QDataStream& out, bool isIc, int nb, float ra, float dec, float mag)
+{
+	out << isIc << nb << ra << dec << mag << 0.5f << (unsigned int)1;
+}
+
+//! Write a line as in ngc2000names.dat.
+static void writeName(QIODevice& out, const QString& name, bool isIc, int nb)
+{
+	const QString line = QString("%1 %2%3\n").arg(name, -36).arg(isIc ? 'I' : ' ').arg(nb, 4);
+	out.write(line.toUtf8());
+}
+
+void TestNebulaCatalog::initTestCase()
+{
+	QBuffer ngc;
+	ngc.open(QIODevice::WriteOnly);
+	QDataStream out(&ngc);
+	out.setVersion(QDataStream::Qt_4_5);
+	for (int i=1; i<=NB_NGC; ++i)
+		writeRecord(out, false, i, i*0.7f, std::asin(2.f*i/(NB_NGC+1)-1.f), 8.f+(i%10));
+	writeRecord(out, true, 434, 1.5f, -0.04f, 99.f);
+	// A second object with the same NGC number, which receives the names
+	writeRecord(out, false, 224, DUPLICATE_RA, DUPLICATE_DEC, 8.f+(224%10));
+	ngc.close();
+
+	QBuffer names;
+	names.open(QIODevice::WriteOnly | QIODevice::Text);
+	names.write("# Comment line\n");
+	writeName(names, "M 31", false, 224);
+	writeName(names, "Andromeda Galaxy", false, 224);
+	writeName(names, "C 13", false, 457);
+	writeName(names, "M 45", false, 42);
+	writeName(names, "_(\"Pleiades\")", false, 42);
+	writeName(names, "Horsehead Nebula", true, 434);
+	names.close();
+
+	ngc.open(QIODevice::ReadOnly);
+	names.open(QIODevice::ReadOnly | QIODevice::Text);
+	QBuffer result(&compiled);
+	result.open(QIODevice::WriteOnly);
+	QVERIFY(NebulaCatalog::compile(ngc, names, QByteArray(16, 'x'), result));
+}
+
+void TestNebulaCatalog::testZones()
+{
+	NebulaCatalog catalog;
+	QVERIFY(catalog.loadData(compiled));
+	QCOMPARE(catalog.size(), NB_NGC+2);
+
+	const int level = NebulaCatalog::ZONE_LEVEL;
+	StelGeodesicGrid grid(level);
+	const int nbZones = StelGeodesicGrid::nrOfZones(level);
+	QCOMPARE(catalog.getZoneBegin(0), 0);
+	QCOMPARE(catalog.getZoneBegin(nbZones), catalog.size());
+	for (int zone=0; zone<nbZones; ++zone)
+	{
+		QVERIFY(catalog.getZoneBegin(zone)<=catalog.getZoneBegin(zone+1));
+		for (int i=catalog.getZoneBegin(zone); i<catalog.getZoneBegin(zone+1); ++i)
+		{
+			const NebulaCatalog::Record& r = catalog.at(i);
+			QCOMPARE(grid.getZoneNumberForPoint(Vec3f(r.XYZ[0], r.XYZ[1], r.XYZ[2]), level), zone);
+		}
+	}
+}
+
+void TestNebulaCatalog::testFind()
+{
+	NebulaCatalog catalog;
+	QVERIFY(catalog.loadData(compiled));
+	for (int nb=1; nb<=NB_NGC; ++nb)
+	{
+		const int i = catalog.find(NebulaCatalog::CatalogNGC, nb);
+		QVERIFY(i>=0);
+		QCOMPARE((int)catalog.at(i).NGC_nb, nb);
+		QCOMPARE(catalog.at(i).mag, 8.f+(nb%10));
+	}
+	QCOMPARE(catalog.find(NebulaCatalog::CatalogNGC, NB_NGC+1), -1);
+
+	// The last of several objects with the same NGC number is found, the one with the names
+	const NebulaCatalog::Record& duplicate = catalog.at(catalog.find(NebulaCatalog::CatalogNGC, 224));
+	Vec3d XYZ;
+	StelUtils::spheToRect(DUPLICATE_RA, DUPLICATE_DEC, XYZ);
+	QVERIFY(std::fabs(duplicate.XYZ[0]-XYZ[0])<1e-6 && std::fabs(duplicate.XYZ[1]-XYZ[1])<1e-6 && std::fabs(duplicate.XYZ[2]-XYZ[2])<1e-6);
+	QCOMPARE(catalog.find(NebulaCatalog::CatalogM, 31), catalog.find(NebulaCatalog::CatalogNGC, 224));
+	QCOMPARE(catalog.find(NebulaCatalog::CatalogM, 45), catalog.find(NebulaCatalog::CatalogNGC, 42));
+	QCOMPARE(catalog.find(NebulaCatalog::CatalogC, 13), catalog.find(NebulaCatalog::CatalogNGC, 457));
+	QCOMPARE(catalog.find(NebulaCatalog::CatalogM, 1), -1);
+	const int ic = catalog.find(NebulaCatalog::CatalogIC, 434);
+	QVERIFY(ic>=0);
+	QCOMPARE((int)catalog.at(ic).IC_nb, 434);
+	QCOMPARE((int)catalog.at(ic).NGC_nb, 0);
+}
+
+void TestNebulaCatalog::testSearchAround()
+{
+	NebulaCatalog catalog;
+	QVERIFY(catalog.loadData(compiled));
+	StelGeodesicGrid grid(NebulaCatalog::ZONE_LEVEL);
+
+	// Radii of a few pixels, as used when clicking on an object, up to large regions
+	const double radii[4] = {0.01, 0.5, 5., 60.};
+	for (int i=0; i<catalog.size(); i+=7)
+	{
+		const NebulaCatalog::Record& r = catalog.at(i);
+		// Slightly away from the object
+		Vec3d v(r.XYZ[0]+0.00005, r.XYZ[1], r.XYZ[2]);
+		v.normalize();
+		for (int k=0; k<4; ++k)
+		{
+			const double cosLimFov = std::cos(radii[k]*M_PI/180.);
+			QVector<int> found = catalog.searchAround(grid, v, radii[k]);
+			qSort(found);
+			QVector<int> expected;
+			for (int j=0; j<catalog.size(); ++j)
+			{
+				Vec3d pos(catalog.at(j).XYZ[0], catalog.at(j).XYZ[1], catalog.at(j).XYZ[2]);
+				pos.normalize();
+				if (pos*v>=cosLimFov)
+					expected.append(j);
+			}
+			QVERIFY(expected.contains(i));
+			QCOMPARE(found, expected);
+		}
+	}
+}
+
+void TestNebulaCatalog::testNames()
+{
+	NebulaCatalog catalog;
+	QVERIFY(catalog.loadData(compiled));
+	QCOMPARE(catalog.getEnglishName(catalog.find(NebulaCatalog::CatalogNGC, 224)), QString("Andromeda Galaxy"));
+	QCOMPARE(catalog.getEnglishName(catalog.find(NebulaCatalog::CatalogNGC, 457)), QString("C13"));
+	QCOMPARE(catalog.getEnglishName(catalog.find(NebulaCatalog::CatalogIC, 434)), QString("Horsehead Nebula"));
+	QVERIFY(!catalog.hasName(catalog.find(NebulaCatalog::CatalogNGC, 1)));
+	QVERIFY(catalog.getEnglishName(catalog.find(NebulaCatalog::CatalogNGC, 1)).isEmpty());
+
+	// The magnitude used for the hints of the Pleiades and of the objects without magnitude
+	const int pleiades = catalog.find(NebulaCatalog::CatalogNGC, 42);
+	QCOMPARE(catalog.getEnglishName(pleiades), QString("Pleiades"));
+	QCOMPARE(catalog.at(pleiades).hintsMag, 5.f);
+	QCOMPARE(catalog.at(catalog.find(NebulaCatalog::CatalogIC, 434)).hintsMag, 15.f);
+	QCOMPARE(catalog.at(catalog.find(NebulaCatalog::CatalogNGC, 1)).hintsMag, 9.f);
+}
+
+void TestNebulaCatalog::testInvalidData()
+{
+	NebulaCatalog catalog;
+	QVERIFY(!catalog.loadData(QByteArray()));
+	QVERIFY(!catalog.loadData(compiled.left(compiled.size()-1)));
+	QByteArray corrupted = compiled;
+	corrupted[0] = corrupted[0]+1;
+	QVERIFY(!catalog.loadData(corrupted));
+	QCOMPARE(catalog.size(), 0);
+}
@@ -0,0 +1,156 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QTest>
+
+#include <cmath>
+
+#include "StelGeodesicGrid.hpp"
+#include "StelUtils.hpp"
+
+#include "tests/testStelGeodesicGrid.hpp"
+
+QTEST_MAIN(TestStelGeodesicGrid)
+
+static const int GRID_LEVEL = 5;
+
+QVector<SphericalCap> TestStelGeodesicGrid::createViewport(double ra, double dec, double fov)
+{
+	Vec3d center, east, north;
+	StelUtils::spheToRect(ra, dec, center);
+	StelUtils::spheToRect(ra+M_PI_2, 0., east);
+	north = center^east;
+	const double t = std::tan(fov/2.);
+	// The corners of the field, counterclockwise seen from inside the sphere
+	Vec3d corners[4];
+	corners[0] = center - east*t - north*t;
+	corners[1] = center + east*t - north*t;
+	corners[2] = center + east*t + north*t;
+	corners[3] = center - east*t + north*t;
+	QVector<SphericalCap> caps;
+	for (int i=0;i<4;++i)
+	{
+		Vec3d n = corners[(i+1)%4]^corners[i];
+		if (n*center<0.)
+			n = -n;
+		n.normalize();
+		caps.append(SphericalCap(n, 0.));
+	}
+	return caps;
+}
+
+QSet<int> TestStelGeodesicGrid::getZones(const GeodesicSearchResult& result, int level, bool insideOnly)
+{
+	QSet<int> zones;
+	int zone;
+	for (GeodesicSearchInsideIterator it(result, level);(zone = it.next()) >= 0;)
+		zones.insert(zone);
+	if (!insideOnly)
+	{
+		for (GeodesicSearchBorderIterator it(result, level);(zone = it.next()) >= 0;)
+			zones.insert(zone);
+	}
+	return zones;
+}
+
+void TestStelGeodesicGrid::testSearchCover()
+{
+	StelGeodesicGrid grid(GRID_LEVEL);
+	for (int f=0;f<8;++f)
+	{
+		const QVector<SphericalCap> caps = createViewport(0.7*f, 1.2-0.3*f, 0.1+0.15*f);
+		const GeodesicSearchResult* result = grid.search(caps, GRID_LEVEL);
+		const QSet<int> found = getZones(*result, GRID_LEVEL, false);
+		const QSet<int> inside = getZones(*result, GRID_LEVEL, true);
+
+		// Compare with a direct test of the zone corners against the half spaces
+		for (int z=0;z<StelGeodesicGrid::nrOfZones(GRID_LEVEL);++z)
+		{
+			Vec3f c[3];
+			grid.getTriangleCorners(GRID_LEVEL, z, c[0], c[1], c[2]);
+			bool outside = false;
+			bool allInside = true;
+			foreach (const SphericalCap& cap, caps)
+			{
+				int count = 0;
+				for (int i=0;i<3;++i)
+					count += cap.contains(c[i]) ? 1 : 0;
+				outside = outside || count==0;
+				allInside = allInside && count==3;
+			}
+			if (!outside)
+				QVERIFY2(found.contains(z), qPrintable(QString("zone %1 of field %2 is missing").arg(z).arg(f)));
+			if (inside.contains(z))
+				QVERIFY2(allInside, qPrintable(QString("zone %1 of field %2 is not inside").arg(z).arg(f)));
+		}
+	}
+}
+
+void TestStelGeodesicGrid::testSearchCache()
+{
+	StelGeodesicGrid grid(GRID_LEVEL);
+	const QVector<SphericalCap> caps = createViewport(0.3, 0.4, 0.5);
+	const QSet<int> first = getZones(*grid.search(caps, GRID_LEVEL), GRID_LEVEL, false);
+	QCOMPARE(grid.getSearchCount(), 1);
+	QCOMPARE(grid.getSearchCacheHits(), 0);
+
+	// The same region comes from the cache
+	const QSet<int> second = getZones(*grid.search(caps, GRID_LEVEL), GRID_LEVEL, false);
+	QCOMPARE(grid.getSearchCacheHits(), 1);
+	QCOMPARE(second, first);
+
+	// A tiny move keeps the same quantized region
+	QVector<SphericalCap> moved = caps;
+	for (int i=0;i<moved.size();++i)
+	{
+		moved[i].n[2] += 1e-6;
+		moved[i].n.normalize();
+	}
+	grid.search(moved, GRID_LEVEL);
+	QCOMPARE(grid.getSearchCacheHits(), 2);
+
+	// Another search level is another search
+	grid.search(caps, GRID_LEVEL-1);
+	QCOMPARE(grid.getSearchCacheHits(), 2);
+	QCOMPARE(grid.getSearchCount(), 4);
+
+	// An older region is still cached
+	const QSet<int> third = getZones(*grid.search(caps, GRID_LEVEL), GRID_LEVEL, false);
+	QCOMPARE(grid.getSearchCacheHits(), 3);
+	QCOMPARE(third, first);
+}
+
+void TestStelGeodesicGrid::benchmarkSearch()
+{
+	StelGeodesicGrid grid(7);
+	// A slow pan, as when following the sky during the night
+	QVector<QVector<SphericalCap> > fields;
+	for (int i=0;i<200;++i)
+		fields.append(createViewport(1.+0.00005*i, 0.5, 1.));
+	int zoneCount = 0;
+	QBENCHMARK
+	{
+		foreach (const QVector<SphericalCap>& caps, fields)
+			zoneCount += getZones(*grid.search(caps, 7), 7, false).size();
+	}
+	QVERIFY(zoneCount>0);
+	qDebug() << grid.getSearchCacheHits() << "of" << grid.getSearchCount() << "searches from the cache";
+}
@@ -0,0 +1,112 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QDebug>
+#include <QTest>
+
+#include <cmath>
+
+#include "testStelGlyphAtlas.hpp"
+#include "StelGlyphAtlas.hpp"
+
+QTEST_MAIN(TestStelGlyphAtlas);
+
+void TestStelGlyphAtlas::initTestCase()
+{
+	font.setPixelSize(13);
+	for (int i=0; i<5000; ++i)
+		labels << QString("HIP %1").arg(i*37);
+}
+
+void TestStelGlyphAtlas::testGlyphCache()
+{
+	StelGlyphAtlas atlas;
+	StelTextBatch batch;
+	const Vec4f color(1.f, 1.f, 1.f, 1.f);
+
+	atlas.addText(batch, font, "Sirius", 10.f, 10.f, 0.f, color);
+	QCOMPARE(batch.size(), 6);
+	QCOMPARE(atlas.getPageCount(), 1);
+	const int glyphCount = atlas.getGlyphCount();
+	QVERIFY(glyphCount>0 && glyphCount<=5); // 'i' is used twice
+
+	// Spaces produce no quad, and known glyphs are not rendered again
+	atlas.addText(batch, font, "Sirius Sirius", 10.f, 30.f, 0.f, color);
+	QCOMPARE(batch.size(), 18);
+	QCOMPARE(atlas.getGlyphCount(), glyphCount+1);
+
+	int vertexCount = 0;
+	foreach (const StelTextBatch::Page& p, batch.getPages())
+	{
+		QCOMPARE(p.texCoords.size(), p.vertices.size());
+		QCOMPARE(p.colors.size(), p.vertices.size());
+		vertexCount += p.vertices.size();
+	}
+	QCOMPARE(vertexCount, 18*6);
+
+	batch.clear();
+	QVERIFY(batch.isEmpty());
+	QCOMPARE(atlas.getGlyphCount(), glyphCount+1);
+}
+
+void TestStelGlyphAtlas::testRotation()
+{
+	StelGlyphAtlas atlas;
+	StelTextBatch batch;
+	const Vec4f color(1.f, 1.f, 1.f, 1.f);
+
+	atlas.addText(batch, font, "W", 100.f, 100.f, 0.f, color);
+	atlas.addText(batch, font, "W", 100.f, 100.f, 90.f, color);
+	QCOMPARE(batch.size(), 2);
+	const QVector<Vec3f>& v = batch.getPages().begin().value().vertices;
+
+	// Unrotated: top left, top right, bottom right
+	const float width = v[1][0]-v[0][0];
+	const float height = v[0][1]-v[2][1];
+	QVERIFY(width>0.f && height>0.f);
+	QCOMPARE(v[0][1], v[1][1]);
+	// The glyph is above the baseline
+	QVERIFY(v[0][1]>100.f);
+
+	// Rotated by 90 degrees counterclockwise around the start of the baseline
+	const Vec3f* r = v.constData()+6;
+	QVERIFY(std::fabs((r[1][1]-r[0][1]) - width) < 1.5f);
+	QVERIFY(std::fabs((r[2][0]-r[1][0]) - height) < 1.5f);
+	QVERIFY(r[0][0]<100.f);
+}
+
+void TestStelGlyphAtlas::benchmarkLabels()
+{
+	StelGlyphAtlas atlas;
+	StelTextBatch batch;
+	const Vec4f color(0.5f, 0.6f, 1.f, 1.f);
+
+	QBENCHMARK
+	{
+		batch.clear();
+		for (int i=0; i<labels.size(); ++i)
+		{
+			const float x = (i*53)%1920;
+			const float y = (i*71)%1080;
+			atlas.addText(batch, font, labels.at(i), x, y, (i%4==0) ? (float)(i%360) : 0.f, color);
+		}
+	}
+	QVERIFY(batch.size() >= labels.size());
+}
@@ -0,0 +1,41 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _TESTSTELGLYPHATLAS_HPP_
+#define _TESTSTELGLYPHATLAS_HPP_
+
+#include <QFont>
+#include <QObject>
+#include <QStringList>
+#include <QTest>
+
+class TestStelGlyphAtlas : public QObject
+{
+Q_OBJECT
+private slots:
+	void initTestCase();
+	void testGlyphCache();
+	void testRotation();
+	void benchmarkLabels();
+private:
+	QFont font;
+	QStringList labels;
+};
+
+#endif // _TESTSTELGLYPHATLAS_HPP_
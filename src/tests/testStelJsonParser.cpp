@@ -21,13 +21,44 @@
 #include <QDebug>
 #include <QTest>
 #include <QBuffer>
+#include <QDateTime>
+#include <QStringList>
 #include <stdexcept>
+#include <cmath>
 
 #include "testStelJsonParser.hpp"
 #include "StelJsonParser.hpp"
 
 QTEST_MAIN(TestStelJsonParser);
 
+//! Count the events and sum the numbers of a document
+class CountingVisitor : public StelJsonVisitor
+{
+public:
+	CountingVisitor() : objects(0), arrays(0), keys(0), strings(0), numbers(0), sum(0.) {;}
+	void startObject() {++objects;}
+	void startArray() {++arrays;}
+	void key(const char*, int) {++keys;}
+	void stringValue(const char* str, int size) {++strings; lastString = QString::fromUtf8(str, size);}
+	void intValue(int v) {++numbers; sum+=v;}
+	void doubleValue(double v) {++numbers; sum+=v;}
+	int objects, arrays, keys, strings, numbers;
+	double sum;
+	QString lastString;
+};
+
+//! Keep the records and the members of a catalog
+class CatalogVisitor : public StelJsonRecordVisitor
+{
+public:
+	CatalogVisitor(const QString& recordsKey) : StelJsonRecordVisitor(recordsKey) {;}
+	void record(const QString& name, const QVariant& value) {names << name; records << value;}
+	void member(const QString& name, const QVariant& value) {members.insert(name, value);}
+	QStringList names;
+	QVariantList records;
+	QVariantMap members;
+};
+
 void TestStelJsonParser::initTestCase()
 {
 	largeJsonBuff = "{\"test1\": {\"worldCoords\": [[[-0.5,0.5],[0.5,0.5],[0.5,-0.5],[-0.5,-0.5]], [[-0.2,-0.2],[0.2,-0.2],[0.2,0.2],[-0.2,0.2]]]}, \
@@ -140,3 +171,149 @@ void TestStelJsonParser::benchmarkParse()
 		result = StelJsonParser::parse(&buf);
 	}
 }
+
+void TestStelJsonParser::testValues()
+{
+	const QVariantMap m = StelJsonParser::parse("// comment\n{\"s\": \"a\\\"b\\nc\", \"empty\": {}, \"list\": [], // other comment\n"
+		"\"big\": 12345678901, \"d\": 1.5e-3, \"n\": null, \"date\": 2014-02-03T04:05:06}").toMap();
+	QCOMPARE(m.value("s").toString(), QString("a\"b\nc"));
+	QVERIFY(m.value("empty").toMap().isEmpty());
+	QVERIFY(m.value("list").toList().isEmpty());
+	QCOMPARE(m.value("big").type(), QVariant::Double);
+	QCOMPARE(m.value("big").toDouble(), 12345678901.);
+	QCOMPARE(m.value("d").toDouble(), 1.5e-3);
+	QVERIFY(m.contains("n") && m.value("n").isNull());
+	QCOMPARE(m.value("date").toDateTime(), QDateTime(QDate(2014, 2, 3), QTime(4, 5, 6)));
+
+	// The values written by StelJsonParser::write() are read back
+	QCOMPARE(StelJsonParser::parse(StelJsonParser::write(m)), QVariant(m));
+
+	// Parsing a device leaves it after the value
+	QBuffer buf;
+	buf.setData("[1, 2] [3]");
+	buf.open(QIODevice::ReadOnly);
+	QCOMPARE(StelJsonParser::parse(&buf).toList().size(), 2);
+	QCOMPARE(StelJsonParser::parse(&buf).toList().size(), 1);
+	QVERIFY(StelJsonParser::parse(&buf).isNull());
+
+	// The iterator uses its own incremental parser, giving the same values
+	const QVariantList list = StelJsonParser::parse(listJsonBuff).toList();
+	QBuffer listBuf;
+	listBuf.setData(listJsonBuff);
+	listBuf.open(QIODevice::ReadOnly);
+	JsonListIterator iter = StelJsonParser::initListIterator(&listBuf);
+	for (int i=0; iter.hasNext(); ++i)
+		QCOMPARE(iter.next(), list.at(i));
+
+	const char* invalidDocuments[] = {"[1, 2,]", "{\"a\": 1", "[\"abc]", "{\"a\" 1}", "[1 / 2]", "[truth]"};
+	for (unsigned int i=0; i<sizeof(invalidDocuments)/sizeof(invalidDocuments[0]); ++i)
+	{
+		bool wasCatched = false;
+		try
+		{
+			StelJsonParser::parse(invalidDocuments[i]);
+		}
+		catch (std::runtime_error&)
+		{
+			wasCatched = true;
+		}
+		QVERIFY2(wasCatched, invalidDocuments[i]);
+	}
+}
+
+void TestStelJsonParser::testVisitor()
+{
+	CountingVisitor visitor;
+	StelJsonParser::parse(listJsonBuff, visitor);
+	QCOMPARE(visitor.objects, 3*8);
+	QCOMPARE(visitor.strings, 3*18);
+	QCOMPARE(visitor.lastString, QString("GOODS_ISAAC_01_KS_V2.0"));
+
+	CountingVisitor deviceVisitor;
+	QBuffer buf;
+	buf.setData(largeJsonBuff);
+	buf.open(QIODevice::ReadOnly);
+	StelJsonParser::parse(&buf, deviceVisitor);
+	QCOMPARE(deviceVisitor.objects, 1+12);
+	QCOMPARE(deviceVisitor.keys, 12*2);
+	QCOMPARE(deviceVisitor.arrays, 12*(1+2+2*4));
+	QCOMPARE(deviceVisitor.numbers, 12*16);
+	QVERIFY(std::fabs(deviceVisitor.sum) < 1e-9);
+}
+
+void TestStelJsonParser::benchmarkVisitor()
+{
+	QBENCHMARK {
+		CountingVisitor visitor;
+		StelJsonParser::parse(largeJsonBuff, visitor);
+	}
+}
+
+void TestStelJsonParser::testIteratorVisitor()
+{
+	QBuffer buf;
+	buf.setData(listJsonBuff);
+	buf.open(QIODevice::ReadOnly);
+
+	int tot = 0;
+	CountingVisitor visitor;
+	JsonListIterator iter = StelJsonParser::initListIterator(&buf);
+	while (iter.hasNext())
+	{
+		const int objects = visitor.objects;
+		iter.next(visitor);
+		QCOMPARE(visitor.objects, objects+8);
+		++tot;
+	}
+	QCOMPARE(tot, 3);
+	QCOMPARE(visitor.strings, 3*18);
+	QCOMPARE(visitor.lastString, QString("GOODS_ISAAC_01_KS_V2.0"));
+	buf.close();
+}
+
+void TestStelJsonParser::testRecordVisitor()
+{
+	const QByteArray catalog = "{\"creator\": \"test\", \"stars\": {\"a\": {\"mag\": 1, \"planets\": [{\"p\": 2.5}, null]}, \"b\": {}},"
+		"\"empty\": [], \"version\": 3}";
+	CatalogVisitor visitor("stars");
+	StelJsonParser::parse(catalog, visitor);
+	QCOMPARE(visitor.names, QStringList() << "a" << "b");
+	QCOMPARE(visitor.records.size(), 2);
+	const QVariantMap a = visitor.records.at(0).toMap();
+	QCOMPARE(a.value("mag").toInt(), 1);
+	QCOMPARE(a.value("planets").toList().size(), 2);
+	QCOMPARE(a.value("planets").toList().at(0).toMap().value("p").toDouble(), 2.5);
+	QVERIFY(visitor.records.at(1).toMap().isEmpty());
+	QCOMPARE(visitor.members.size(), 3);
+	QCOMPARE(visitor.members.value("creator").toString(), QString("test"));
+	QVERIFY(visitor.members.value("empty").toList().isEmpty());
+	QCOMPARE(visitor.members.value("version").toInt(), 3);
+
+	// Replaying the parsed document gives the same calls
+	CatalogVisitor replayVisitor("stars");
+	replayVisitor.replay(StelJsonParser::parse(catalog).toMap());
+	QCOMPARE(replayVisitor.names, visitor.names);
+	QCOMPARE(replayVisitor.records, visitor.records);
+	QCOMPARE(replayVisitor.members, visitor.members);
+
+	// Records in an array have no name
+	CatalogVisitor arrayVisitor("items");
+	StelJsonParser::parse("{\"items\": [1, {\"x\": [2]}, \"s\"]}", arrayVisitor);
+	QCOMPARE(arrayVisitor.names, QStringList() << QString() << QString() << QString());
+	QCOMPARE(arrayVisitor.records.at(0).toInt(), 1);
+	QCOMPARE(arrayVisitor.records.at(1).toMap().value("x").toList().at(0).toInt(), 2);
+	QCOMPARE(arrayVisitor.records.at(2).toString(), QString("s"));
+	QVERIFY(arrayVisitor.members.isEmpty());
+
+	bool wasCatched = false;
+	try
+	{
+		CatalogVisitor rootVisitor("items");
+		StelJsonParser::parse("[1, 2]", rootVisitor);
+	}
+	catch (std::runtime_error&)
+	{
+		wasCatched = true;
+	}
+	QVERIFY(wasCatched);
+}
@@ -32,6 +32,11 @@ private slots:
 	void testIterator();
 	void benchmarkParse();
 	void testErrors();
+	void testValues();
+	void testVisitor();
+	void benchmarkVisitor();
+	void testIteratorVisitor();
+	void testRecordVisitor();
 private:
 	QByteArray largeJsonBuff;
 	QByteArray listJsonBuff;
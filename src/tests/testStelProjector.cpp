@@ -0,0 +1,369 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+
+#include <QObject>
+#include <QDebug>
+#include <QTest>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+
+#include <cmath>
+
+#include "testStelProjector.hpp"
+#include "StelProjectorClasses.hpp"
+
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+
+QTEST_MAIN(TestStelProjector);
+
+//! A model view transform which is not a matrix, like the refraction.
+class NonLinearTransform : public StelProjector::ModelViewTranform
+{
+public:
+	void forward(Vec3d& v) const {v[1] += 0.01*v[1]*v[1];}
+	void backward(Vec3d&) const {;}
+	void forward(Vec3f& v) const {v[1] += 0.01f*v[1]*v[1];}
+	void backward(Vec3f&) const {;}
+	void combine(const Mat4d&) {;}
+	StelProjector::ModelViewTranformP clone() const {return StelProjector::ModelViewTranformP(new NonLinearTransform());}
+	Mat4d getApproximateLinearTransfo() const {return Mat4d::identity();}
+};
+
+void TestStelProjector::initTestCase()
+{
+	params.viewportXywh.set(0, 0, 1024, 768);
+	params.viewportCenter.set(512.f, 384.f);
+	params.viewportFovDiameter = 768.f;
+	params.fov = 120.f;
+	params.zNear = 0.000001f;
+	params.zFar = 50.f;
+
+	surface = new QOffscreenSurface();
+	surface->create();
+	context = new QOpenGLContext();
+	if (!context->create() || !context->makeCurrent(surface))
+	{
+		delete context;
+		context = NULL;
+	}
+}
+
+void TestStelProjector::cleanupTestCase()
+{
+	if (context)
+		context->doneCurrent();
+	delete context;
+	delete surface;
+}
+
+StelProjectorP TestStelProjector::createProjector(const QString& type, const Mat4d& modelView) const
+{
+	StelProjector::ModelViewTranformP mv(new StelProjector::Mat4dTransform(modelView));
+	StelProjectorP prj;
+	if (type=="perspective")
+		prj = StelProjectorP(new StelProjectorPerspective(mv));
+	else if (type=="equalArea")
+		prj = StelProjectorP(new StelProjectorEqualArea(mv));
+	else if (type=="stereographic")
+		prj = StelProjectorP(new StelProjectorStereographic(mv));
+	else if (type=="fisheye")
+		prj = StelProjectorP(new StelProjectorFisheye(mv));
+	else if (type=="hammer")
+		prj = StelProjectorP(new StelProjectorHammer(mv));
+	else if (type=="cylinder")
+		prj = StelProjectorP(new StelProjectorCylinder(mv));
+	else if (type=="mercator")
+		prj = StelProjectorP(new StelProjectorMercator(mv));
+	else
+		prj = StelProjectorP(new StelProjectorOrthographic(mv));
+	prj->init(params);
+	return prj;
+}
+
+void TestStelProjector::testGlslParams()
+{
+	const Mat4d mv = Mat4d::xrotation(0.3)*Mat4d::zrotation(1.2);
+	StelProjectorP prj = createProjector("stereographic", mv);
+	StelProjector::GlslProjectionParams glslParams;
+	QVERIFY(!prj->getProjectionShader().isEmpty());
+	QVERIFY(prj->getGlslProjectionParams(glslParams));
+	for (int i=0; i<16; ++i)
+		QVERIFY(std::fabs(glslParams.modelViewMatrix[i] - mv[i]) < 1e-6);
+	QCOMPARE(glslParams.viewportCenter[0], 512.f);
+	QCOMPARE(glslParams.viewportCenter[1], 384.f);
+	QCOMPARE(glslParams.projectionScale[0], prj->getPixelPerRadAtCenter());
+	QCOMPARE(glslParams.projectionScale[1], prj->getPixelPerRadAtCenter());
+
+	// Non linear model view transforms are left to the CPU
+	StelProjectorP refracted(new StelProjectorStereographic(StelProjector::ModelViewTranformP(new NonLinearTransform())));
+	refracted->init(params);
+	QVERIFY(!refracted->getGlslProjectionParams(glslParams));
+
+	// As are projections without GLSL implementation
+	StelProjectorP prj2d(new StelProjector2d());
+	QVERIFY(prj2d->getProjectionShader().isEmpty());
+	QVERIFY(!prj2d->getGlslProjectionParams(glslParams));
+}
+
+void TestStelProjector::testApproximatelyEqual()
+{
+	const Mat4d mv = Mat4d::xrotation(0.3)*Mat4d::zrotation(1.2);
+	StelProjectorP prj = createProjector("stereographic", mv);
+	const float pixelTolerance = 1.f;
+	const double pixelAngle = 1./prj->getPixelPerRadAtCenter();
+
+	QVERIFY(prj->isApproximatelyEqual(*createProjector("stereographic", mv), pixelTolerance));
+	QVERIFY(prj->isApproximatelyEqual(*createProjector("stereographic", Mat4d::zrotation(0.1*pixelAngle)*mv), pixelTolerance));
+	QVERIFY(!prj->isApproximatelyEqual(*createProjector("stereographic", Mat4d::zrotation(10.*pixelAngle)*mv), pixelTolerance));
+	QVERIFY(!prj->isApproximatelyEqual(*createProjector("fisheye", mv), pixelTolerance));
+
+	const float fov = params.fov;
+	params.fov = fov*1.01f;
+	StelProjectorP zoomed = createProjector("stereographic", mv);
+	params.fov = fov;
+	QVERIFY(!prj->isApproximatelyEqual(*zoomed, pixelTolerance));
+
+	// Transformations which can not be compared are always different
+	StelProjectorP refracted(new StelProjectorStereographic(StelProjector::ModelViewTranformP(new NonLinearTransform())));
+	refracted->init(params);
+	QVERIFY(!refracted->isApproximatelyEqual(*refracted, pixelTolerance));
+}
+
+bool TestStelProjector::projectOnGpu(const StelProjectorP& prj, const QVector<Vec3f>& points, QVector<Vec3f>& result)
+{
+	StelProjector::GlslProjectionParams glslParams;
+	if (!prj->getGlslProjectionParams(glslParams))
+		return false;
+
+	// Each point is drawn in its own pixel of a float framebuffer, with its projection as color
+	const QByteArray vsrc = prj->getProjectionShader() +
+		"attribute highp vec3 vertex;\n"
+		"attribute highp float index;\n"
+		"uniform highp float pointCount;\n"
+		"varying highp vec3 projected;\n"
+		"void main(void)\n"
+		"{\n"
+		"    projected = projectVertex(vertex);\n"
+		"    gl_Position = vec4(2.*(index+0.5)/pointCount-1., 0., 0., 1.);\n"
+		"}\n";
+	const char* fsrc =
+		"varying highp vec3 projected;\n"
+		"void main(void)\n"
+		"{\n"
+		"    gl_FragColor = vec4(projected, 1.);\n"
+		"}\n";
+	QOpenGLShaderProgram program;
+	if (!program.addShaderFromSourceCode(QOpenGLShader::Vertex, vsrc)
+		|| !program.addShaderFromSourceCode(QOpenGLShader::Fragment, fsrc) || !program.link())
+	{
+		qWarning() << program.log();
+		return false;
+	}
+
+	const int n = points.size();
+	QOpenGLFramebufferObjectFormat format;
+	format.setInternalTextureFormat(GL_RGBA32F);
+	QOpenGLFramebufferObject fbo(n, 1, format);
+	if (!fbo.isValid())
+		return false;
+
+	QVector<float> indexes(n);
+	for (int i=0; i<n; ++i)
+		indexes[i] = i;
+
+	QOpenGLFunctions* gl = context->functions();
+	fbo.bind();
+	gl->glViewport(0, 0, n, 1);
+	gl->glClearColor(0.f, 0.f, 0.f, 0.f);
+	gl->glClear(GL_COLOR_BUFFER_BIT);
+	const Mat4f& mv = glslParams.modelViewMatrix;
+	program.bind();
+	program.setUniformValue("modelViewMatrix", QMatrix4x4(mv[0], mv[4], mv[8], mv[12], mv[1], mv[5], mv[9], mv[13], mv[2], mv[6], mv[10], mv[14], mv[3], mv[7], mv[11], mv[15]));
+	program.setUniformValue("viewportCenter", glslParams.viewportCenter[0], glslParams.viewportCenter[1]);
+	program.setUniformValue("projectionScale", glslParams.projectionScale[0], glslParams.projectionScale[1]);
+	program.setUniformValue("depthParams", glslParams.depthParams[0], glslParams.depthParams[1]);
+	program.setUniformValue("pointCount", (float)n);
+	program.setAttributeArray("vertex", (const GLfloat*)points.constData(), 3);
+	program.enableAttributeArray("vertex");
+	program.setAttributeArray("index", indexes.constData(), 1);
+	program.enableAttributeArray("index");
+	gl->glDrawArrays(GL_POINTS, 0, n);
+	program.disableAttributeArray("vertex");
+	program.disableAttributeArray("index");
+	program.release();
+
+	QVector<float> pixels(4*n);
+	gl->glReadPixels(0, 0, n, 1, GL_RGBA, GL_FLOAT, pixels.data());
+	fbo.release();
+
+	result.resize(n);
+	for (int i=0; i<n; ++i)
+		result[i].set(pixels[4*i], pixels[4*i+1], pixels[4*i+2]);
+	return true;
+}
+
+void TestStelProjector::testGpuProjection_data()
+{
+	QTest::addColumn<QString>("type");
+	QTest::newRow("perspective") << "perspective";
+	QTest::newRow("equalArea") << "equalArea";
+	QTest::newRow("stereographic") << "stereographic";
+	QTest::newRow("fisheye") << "fisheye";
+	QTest::newRow("hammer") << "hammer";
+	QTest::newRow("cylinder") << "cylinder";
+	QTest::newRow("mercator") << "mercator";
+	QTest::newRow("orthographic") << "orthographic";
+}
+
+void TestStelProjector::testGpuProjection()
+{
+	QFETCH(QString, type);
+	if (!context)
+		QSKIP("No OpenGL context available");
+
+	const Mat4d mv = Mat4d::xrotation(0.3)*Mat4d::zrotation(1.2);
+	StelProjectorP prj = createProjector(type, mv);
+
+	// Points spread over the 80 degrees around the center of the view
+	const int n = 1000;
+	const StelProjector::Mat4dTransform transform(mv);
+	QVector<Vec3f> points(n);
+	for (int i=0; i<n; ++i)
+	{
+		const double theta = std::acos(1. - (1.-std::cos(80.*M_PI/180.))*(i+0.5)/n);
+		const double phi = i*2.39996;
+		Vec3d v(std::sin(theta)*std::cos(phi), std::sin(theta)*std::sin(phi), -std::cos(theta));
+		transform.backward(v);
+		points[i].set(v[0], v[1], v[2]);
+	}
+
+	QVector<Vec3f> gpu;
+	if (!projectOnGpu(prj, points, gpu))
+		QSKIP("Float framebuffers or shaders are not supported");
+
+	// The CPU projection is the reference
+	QVector<Vec3f> cpu(n);
+	prj->project(n, points.constData(), cpu.data());
+	for (int i=0; i<n; ++i)
+	{
+		const float tolerance = 0.5f + 1e-5f*std::fabs(cpu[i][0]) + 1e-5f*std::fabs(cpu[i][1]);
+		if (std::fabs(gpu[i][0]-cpu[i][0]) > tolerance || std::fabs(gpu[i][1]-cpu[i][1]) > tolerance || std::fabs(gpu[i][2]-cpu[i][2]) > 1e-4f)
+		{
+			qDebug() << type << "point" << i << "CPU:" << cpu[i].toString() << "GPU:" << gpu[i].toString();
+			QFAIL("The GPU projection differs from the CPU projection");
+		}
+	}
+}
+
+QVector<Vec3d> TestStelProjector::createSpherePoints(int n)
+{
+	QVector<Vec3d> points(n);
+	for (int i=0; i<n; ++i)
+	{
+		const double theta = std::acos(1. - 2.*(i+0.5)/n);
+		const double phi = i*2.39996;
+		points[i].set(std::sin(theta)*std::cos(phi), std::sin(theta)*std::sin(phi), std::cos(theta));
+	}
+	return points;
+}
+
+void TestStelProjector::testProjectArray_data()
+{
+	testGpuProjection_data();
+}
+
+void TestStelProjector::testProjectArray()
+{
+	QFETCH(QString, type);
+	StelProjectorP prj = createProjector(type, Mat4d::xrotation(0.3)*Mat4d::zrotation(1.2));
+
+	const int n = 1000;
+	const QVector<Vec3d> points = createSpherePoints(n);
+	QVector<Vec3f> pointsf(n);
+	for (int i=0; i<n; ++i)
+		pointsf[i].set(points[i][0], points[i][1], points[i][2]);
+
+	QVector<Vec3f> win(n), winf(n);
+	QVector<unsigned char> flags(n), flagsf(n);
+	prj->project(n, points.constData(), win.data(), flags.data());
+	prj->project(n, pointsf.constData(), winf.data(), flagsf.data());
+
+	// The arrays are projected exactly as the single points
+	for (int i=0; i<n; ++i)
+	{
+		Vec3d v = points[i];
+		const bool valid = prj->projectInPlace(v);
+		QCOMPARE(win[i][0], (float)v[0]);
+		QCOMPARE(win[i][1], (float)v[1]);
+		QCOMPARE(win[i][2], (float)v[2]);
+		QCOMPARE((flags[i] & StelProjector::ProjectedValid) != 0, valid);
+		QCOMPARE((flags[i] & StelProjector::ProjectedInViewport) != 0, prj->checkInViewport(v));
+
+		Vec3f vf = pointsf[i];
+		const bool validf = prj->projectInPlace(vf);
+		QCOMPARE(winf[i][0], vf[0]);
+		QCOMPARE(winf[i][1], vf[1]);
+		QCOMPARE(winf[i][2], vf[2]);
+		QCOMPARE((flagsf[i] & StelProjector::ProjectedValid) != 0, validf);
+		QCOMPARE((flagsf[i] & StelProjector::ProjectedInViewport) != 0, prj->checkInViewport(vf));
+		// Without a mask, the viewport and mask flags are the same
+		QCOMPARE((flagsf[i] & StelProjector::ProjectedInMask) != 0, prj->checkInViewport(vf));
+	}
+
+	// With a disk mask, only the points inside the disk are in the mask
+	StelProjector::StelProjectorParams diskParams = params;
+	diskParams.maskType = StelProjector::MaskDisk;
+	prj->init(diskParams);
+	prj->project(n, points.constData(), win.data(), flags.data());
+	const float r = 0.5f*diskParams.viewportFovDiameter;
+	for (int i=0; i<n; ++i)
+	{
+		const float dx = win[i][0]-diskParams.viewportCenter[0];
+		const float dy = win[i][1]-diskParams.viewportCenter[1];
+		const bool inMask = (flags[i] & StelProjector::ProjectedInMask) != 0;
+		QCOMPARE(inMask, (flags[i] & StelProjector::ProjectedInViewport) && dx*dx+dy*dy <= r*r);
+	}
+	prj->init(params);
+}
+
+void TestStelProjector::benchmarkProjectArray_data()
+{
+	testGpuProjection_data();
+}
+
+void TestStelProjector::benchmarkProjectArray()
+{
+	QFETCH(QString, type);
+	StelProjectorP prj = createProjector(type, Mat4d::xrotation(0.3)*Mat4d::zrotation(1.2));
+
+	// About the number of vertices of the stars of a zone, or of a landscape mesh
+	const int n = 10000;
+	const QVector<Vec3d> points = createSpherePoints(n);
+	QVector<Vec3f> win(n);
+	QVector<unsigned char> flags(n);
+	QBENCHMARK {
+		prj->project(n, points.constData(), win.data(), flags.data());
+	}
+}
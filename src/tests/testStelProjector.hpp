@@ -0,0 +1,60 @@
+/*
+ * Stellarium
+ * Copyright (C) 2014 Stellarium Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+
+#ifndef _TESTSTELPROJECTOR_HPP_
+#define _TESTSTELPROJECTOR_HPP_
+
+#include "StelProjector.hpp"
+
+#include <QObject>
+#include <QTest>
+
+class QOffscreenSurface;
+class QOpenGLContext;
+
+class TestStelProjector : public QObject
+{
+Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+	void testGlslParams();
+	void testApproximatelyEqual();
+	void testGpuProjection_data();
+	void testGpuProjection();
+	void testProjectArray_data();
+	void testProjectArray();
+	void benchmarkProjectArray_data();
+	void benchmarkProjectArray();
+private:
+	//! Create an initialized projector of the given type.
+	StelProjectorP createProjector(const QString& type, const Mat4d& modelView) const;
+	//! Create points spread over the whole sphere.
+	static QVector<Vec3d> createSpherePoints(int n);
+	//! Project the points with the GLSL implementation of the projection.
+	//! @return false if the points could not be projected by the GPU.
+	bool projectOnGpu(const StelProjectorP& prj, const QVector<Vec3f>& points, QVector<Vec3f>& result);
+
+	StelProjector::StelProjectorParams params;
+	QOffscreenSurface* surface;
+	QOpenGLContext* context;
+};
+
+#endif // _TESTSTELPROJECTOR_HPP_
@@ -24,6 +24,7 @@
 #include <QBuffer>
 #include <QTest>
 #include <stdexcept>
+#include <cmath>
 
 #include "StelJsonParser.hpp"
 #include "StelSphereGeometry.hpp"
@@ -539,3 +540,67 @@ void TestStelSphericalGeometry::benchmarkCreatePolygon()
 		SphericalPolygon holySquare(contours);
 	}
 }
+
+//! Square of side 2*halfSize radians centered on ra, dec, oriented like the fixtures.
+static QVector<Vec3d> createSquare(double ra, double dec, double halfSize)
+{
+	QVector<Vec3d> c(4);
+	StelUtils::spheToRect(ra-halfSize, dec+halfSize, c[0]);
+	StelUtils::spheToRect(ra+halfSize, dec+halfSize, c[1]);
+	StelUtils::spheToRect(ra+halfSize, dec-halfSize, c[2]);
+	StelUtils::spheToRect(ra-halfSize, dec-halfSize, c[3]);
+	return c;
+}
+
+void TestStelSphericalGeometry::testOperationCache()
+{
+	// A disk of many vertices on 4 sides of the octahedron, tesselated in parallel
+	const int nbVertices = 2000;
+	const double radius = 0.3;
+	QVector<Vec3d> disk(nbVertices);
+	for (int i=0;i<nbVertices;++i)
+	{
+		const double a = -2.*M_PI*i/nbVertices;
+		StelUtils::spheToRect(radius*std::cos(a), radius*std::sin(a), disk[i]);
+	}
+	const OctahedronPolygon diskPoly(disk);
+	QVERIFY(std::fabs(diskPoly.getArea()-2.*M_PI*(1.-std::cos(radius)))<1e-3);
+
+	const OctahedronPolygon squarePoly(createSquare(0.2, 0.2, 0.15));
+	OctahedronPolygon::clearOperationCache();
+	OctahedronPolygon uncached(diskPoly);
+	uncached.inPlaceUnion(squarePoly);
+	OctahedronPolygon cached(diskPoly);
+	cached.inPlaceUnion(squarePoly);
+	QCOMPARE(cached.getFillVertexArray().vertex, uncached.getFillVertexArray().vertex);
+	QCOMPARE(cached.getOutlineVertexArray().vertex, uncached.getOutlineVertexArray().vertex);
+	QVERIFY(cached.getArea()>diskPoly.getArea());
+
+	// The operation is part of the key
+	OctahedronPolygon intersection(diskPoly);
+	intersection.inPlaceIntersection(squarePoly);
+	QVERIFY(intersection.getArea()<squarePoly.getArea());
+	OctahedronPolygon subtraction(diskPoly);
+	subtraction.inPlaceSubtraction(squarePoly);
+	QVERIFY(std::fabs(subtraction.getArea()+intersection.getArea()-diskPoly.getArea())<1e-9);
+}
+
+void TestStelSphericalGeometry::benchmarkFootprintOperations()
+{
+	// Overlapping plates of 6.5 degrees every 5 degrees, as in the DSS survey
+	const double halfSize = 3.25*M_PI/180.;
+	const double step = 5.*M_PI/180.;
+	QList<OctahedronPolygon> plates;
+	for (int i=-3;i<3;++i)
+		for (int j=-3;j<3;++j)
+			plates << OctahedronPolygon(createSquare(i*step, j*step, halfSize));
+	const OctahedronPolygon view(createSquare(0., 0., 10.*M_PI/180.));
+
+	QBENCHMARK {
+		OctahedronPolygon::clearOperationCache();
+		OctahedronPolygon footprint(plates.first());
+		for (int i=1;i<plates.size();++i)
+			footprint.inPlaceUnion(plates.at(i));
+		footprint.inPlaceIntersection(view);
+	}
+}
@@ -44,6 +44,8 @@ private slots:
 	void benchmarkGetIntersection();
 	void testSerialize();
 	void benchmarkCreatePolygon();
+	void testOperationCache();
+	void benchmarkFootprintOperations();
 private:
 	SphericalPolygon holySquare;
 	SphericalPolygon bigSquare;
@@ -21,6 +21,8 @@
 #include <QDebug>
 #include <QTest>
 #include <stdexcept>
+#include <cmath>
+#include <cstdlib>
 
 #include "StelSphereGeometry.hpp"
 #include "StelUtils.hpp"
@@ -33,11 +35,27 @@ class TestRegionObject : public StelRegionObject
 	public:
 		TestRegionObject(SphericalRegionP reg) : region(reg) {;}
 		virtual SphericalRegionP getRegion() const {return region;}
+		virtual Vec3d getPointInRegion() const {return region->getPointInside();}
 		SphericalRegionP region;
 };
 
 void TestStelSphericalIndex::initTestCase()
 {
+	// Small caps spread over the sphere, as in a catalog of deep sky objects
+	qsrand(42);
+	for (int i=0;i<20000;++i)
+	{
+		Vec3d v;
+		StelUtils::spheToRect(2.*M_PI*qrand()/RAND_MAX, std::asin(2.*qrand()/RAND_MAX-1.), v);
+		const double radius = 0.0001+0.005*qrand()/RAND_MAX;
+		objects.append(StelRegionObjectP(new TestRegionObject(SphericalRegionP(new SphericalCap(v, std::cos(radius))))));
+	}
+	for (int i=0;i<50;++i)
+	{
+		Vec3d v;
+		StelUtils::spheToRect(0.37*i, 1.4*std::sin(0.7*i), v);
+		queries.append(SphericalRegionP(new SphericalCap(v, std::cos(0.02+0.004*i))));
+	}
 }
 
 struct CountFuncObject
@@ -56,11 +74,11 @@ void TestStelSphericalIndex::testBase()
 	grid.insert(StelRegionObjectP(new TestRegionObject(SphericalRegionP(new SphericalCap(Vec3d(1,0,0), 0.9)))));
 	grid.insert(StelRegionObjectP(new TestRegionObject(SphericalRegionP(new SphericalCap(Vec3d(-1,0,0), 0.99)))));
 	CountFuncObject countFunc;
- 	grid.processIntersectingRegions(SphericalRegionP(new SphericalCap(Vec3d(1,0,0), 0.5)), countFunc);
-	grid.processIntersectingRegions(SphericalRegionP(new SphericalCap(Vec3d(1,0,0), 0.95)), countFunc);
+	grid.processIntersectingRegions(SphericalRegionP(new SphericalCap(Vec3d(1,0,0), 0.5)).data(), countFunc);
+	grid.processIntersectingRegions(SphericalRegionP(new SphericalCap(Vec3d(1,0,0), 0.95)).data(), countFunc);
 	QVERIFY(countFunc.count==2);
 	countFunc.count=0;
-	grid.processIntersectingRegions(SphericalRegionP(new SphericalCap(Vec3d(0,1,0), 0.99)), countFunc);
+	grid.processIntersectingRegions(SphericalRegionP(new SphericalCap(Vec3d(0,1,0), 0.99)).data(), countFunc);
 	QVERIFY(countFunc.count==0);
 	
 	// Process all
@@ -90,11 +108,112 @@ void TestStelSphericalIndex::testBase()
 		grid.insert(StelRegionObjectP(new TestRegionObject(SphericalRegionP(new SphericalConvexPolygon(c1)))));
 	}
 	countFunc.count=0;
-	grid.processIntersectingRegions(SphericalRegionP(new SphericalCap(Vec3d(1,0,0), 0.5)), countFunc);
+	grid.processIntersectingRegions(SphericalRegionP(new SphericalCap(Vec3d(1,0,0), 0.5)).data(), countFunc);
 	QVERIFY(countFunc.count==30000);
 	countFunc.count=0;
-	grid.processIntersectingRegions(SphericalRegionP(new SphericalConvexPolygon(c1)), countFunc);
+	grid.processIntersectingRegions(SphericalRegionP(new SphericalConvexPolygon(c1)).data(), countFunc);
 	qDebug() << countFunc.count;
 	QVERIFY(countFunc.count==30000);
 }
 
+
+struct CollectFuncObject
+{
+	void operator()(StelRegionObject* obj)
+	{
+		objects.insert(obj);
+	}
+	QSet<StelRegionObject*> objects;
+};
+
+void TestStelSphericalIndex::testBulkLoad()
+{
+	StelSphericalIndex inserted(100);
+	foreach (const StelRegionObjectP& obj, objects)
+		inserted.insert(obj);
+	StelSphericalIndex loaded(objects, 100);
+	QCOMPARE(inserted.count(), (unsigned int)objects.size());
+	QCOMPARE(loaded.count(), (unsigned int)objects.size());
+
+	foreach (const SphericalRegionP& query, queries)
+	{
+		CollectFuncObject insertedFunc, loadedFunc;
+		inserted.processIntersectingRegions(query.data(), insertedFunc);
+		loaded.processIntersectingRegions(query.data(), loadedFunc);
+		QCOMPARE(loadedFunc.objects, insertedFunc.objects);
+
+		// Compare with a linear search
+		int expected = 0;
+		foreach (const StelRegionObjectP& obj, objects)
+		{
+			if (query->intersects(obj->getRegion().data()))
+				++expected;
+		}
+		QCOMPARE(loadedFunc.objects.size(), expected);
+	}
+
+	// Objects inserted after the build are found too
+	const StelRegionObjectP extra(new TestRegionObject(SphericalRegionP(new SphericalCap(Vec3d(0,0,1), 0.9999))));
+	loaded.insert(extra);
+	CollectFuncObject func;
+	loaded.processIntersectingRegions(SphericalRegionP(new SphericalCap(Vec3d(0,0,1), 0.999)).data(), func);
+	QVERIFY(func.objects.contains(extra.data()));
+	QCOMPARE(loaded.count(), (unsigned int)objects.size()+1);
+}
+
+void TestStelSphericalIndex::testParallelQueries()
+{
+	StelSphericalIndex grid(objects, 100);
+	const QVector<QVector<StelRegionObject*> > results = grid.getIntersectingRegions(queries);
+	QCOMPARE(results.size(), queries.size());
+	for (int i=0;i<queries.size();++i)
+	{
+		CollectFuncObject func;
+		grid.processIntersectingRegions(queries.at(i).data(), func);
+		QCOMPARE(results.at(i).size(), func.objects.size());
+		foreach (StelRegionObject* obj, results.at(i))
+			QVERIFY(func.objects.contains(obj));
+	}
+}
+
+void TestStelSphericalIndex::benchmarkInsert()
+{
+	QBENCHMARK
+	{
+		StelSphericalIndex grid(100);
+		foreach (const StelRegionObjectP& obj, objects)
+			grid.insert(obj);
+		QCOMPARE(grid.count(), (unsigned int)objects.size());
+	}
+}
+
+void TestStelSphericalIndex::benchmarkBulkLoad()
+{
+	QBENCHMARK
+	{
+		StelSphericalIndex grid(objects, 100);
+		QCOMPARE(grid.count(), (unsigned int)objects.size());
+	}
+}
+
+void TestStelSphericalIndex::benchmarkQuery()
+{
+	StelSphericalIndex grid(objects, 100);
+	QBENCHMARK
+	{
+		foreach (const SphericalRegionP& query, queries)
+		{
+			CountFuncObject func;
+			grid.processIntersectingRegions(query.data(), func);
+		}
+	}
+}
+
+void TestStelSphericalIndex::benchmarkParallelQuery()
+{
+	StelSphericalIndex grid(objects, 100);
+	QBENCHMARK
+	{
+		grid.getIntersectingRegions(queries);
+	}
+}
@@ -21,7 +21,9 @@
 #define _TESTSTELSPHERICALINDEX_HPP_
 
 #include <QObject>
+#include <QSet>
 #include <QTest>
+#include <QVector>
 #include "StelSphereGeometry.hpp"
 #include "StelSphericalIndex.hpp"
 
@@ -31,7 +33,15 @@ Q_OBJECT
 private slots:
 	void initTestCase();
 	void testBase();
+	void testBulkLoad();
+	void testParallelQueries();
+	void benchmarkInsert();
+	void benchmarkBulkLoad();
+	void benchmarkQuery();
+	void benchmarkParallelQuery();
 private:
+	QVector<StelRegionObjectP> objects;
+	QVector<SphericalRegionP> queries;
 };
 
 #endif // _TESTSTELSPHERICALINDEX_HPP_